@@ -0,0 +1,942 @@
+//
+//  core_bench.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+//  Microbenchmarks for the portable core's hot paths: queue load/save and retry batches at 1k/10k/100k
+//  entries, hasDueScrobble, .scrobbler.log parsing and import at 100k lines, scrobble history open, lookups,
+//  appends and CSV / JSONL export at 1M plays, listening statistics over 1M plays, the user data cache at 100k
+//  tracks, the corrections map at its default budget, the play statistics backfill at 100k library items,
+//  request building and signing, the ListenBrainz import payload, the util string/JSON helpers, the exclusion
+//  filter and the stream title heuristics. Results can be written as JSON
+//  and compared against a stored baseline run:
+//
+//      core_bench --json base.json               (on the reference build)
+//      core_bench --baseline base.json --max-regression 10
+//
+//  Build (one line, from bench/):
+//
+//  c++ -std=c++20 -O2 -I../src core_bench.cpp ../src/lastfm_{queue,scrobble_sink,budget,drain_planner,clock,config_store,request,web_api,util,filter,log}.cpp ../src/lastfm_{json_writer,listenbrainz,scrobbler_log,history,stats,user_data,corrections,backfill,export}.cpp -lpthread -o core_bench
+//
+
+#include "lastfm_backfill.h"
+#include "lastfm_config_store.h"
+#include "lastfm_corrections.h"
+#include "lastfm_export.h"
+#include "lastfm_filter.h"
+#include "lastfm_history.h"
+#include "lastfm_http.h"
+#include "lastfm_listenbrainz.h"
+#include "lastfm_log.h"
+#include "lastfm_queue.h"
+#include "lastfm_request.h"
+#include "lastfm_scrobble_api.h"
+#include "lastfm_scrobbler_log.h"
+#include "lastfm_stats.h"
+#include "lastfm_user_data.h"
+#include "lastfm_util.h"
+#include "lastfm_web_api.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+std::atomic<int> lfmLogLevel{static_cast<int>(LfmLogLevel::OFF)};
+
+namespace
+{
+static constexpr int K_SAMPLES = 5;
+static const std::size_t K_QUEUE_SIZES[] = {1000, 10000, 100000};
+
+struct Options
+{
+    std::string filter;
+    double minTimeMs = 100.0; // measured time per sample
+    std::string jsonPath;
+    std::string baselinePath;
+    double maxRegressionPct = -1.0; // < 0: report only
+};
+
+struct Result
+{
+    std::string name;
+    double nsPerOp = 0.0; // median of K_SAMPLES
+    double minNsPerOp = 0.0;
+    std::uint64_t iterations = 0;
+};
+
+// Keeps results alive so the optimizer cannot drop the work.
+static volatile std::size_t sink;
+
+class Runner
+{
+  public:
+    explicit Runner(const Options& opt) : opt_(opt)
+    {
+    }
+
+    bool selected(const std::string& name) const
+    {
+        return opt_.filter.empty() || name.find(opt_.filter) != std::string::npos;
+    }
+
+    // Cheap operations: timed in batches sized so that one batch takes about a millisecond.
+    void run(const std::string& name, const std::function<void()>& op)
+    {
+        if (!selected(name))
+            return;
+
+        std::uint64_t batch = 1;
+        for (;;)
+        {
+            const double ms = timeMs([&] { repeat(op, batch); });
+            if (ms >= 1.0 || batch >= (1ull << 30))
+                break;
+            batch *= ms > 0.01 ? std::max<std::uint64_t>(2, static_cast<std::uint64_t>(1.0 / ms)) : 100;
+        }
+
+        std::vector<double> samples;
+        std::uint64_t total = 0;
+        for (int s = 0; s < K_SAMPLES; ++s)
+        {
+            double ms = 0.0;
+            std::uint64_t n = 0;
+            while (ms < opt_.minTimeMs)
+            {
+                ms += timeMs([&] { repeat(op, batch); });
+                n += batch;
+            }
+            samples.push_back(ms * 1e6 / static_cast<double>(n));
+            total += n;
+        }
+        record(name, samples, total);
+    }
+
+    // Expensive operations that need fresh state: setup() is not timed, each op() is timed on its own.
+    void runWithSetup(const std::string& name, const std::function<void()>& setup, const std::function<void()>& op)
+    {
+        if (!selected(name))
+            return;
+
+        std::vector<double> samples;
+        std::uint64_t total = 0;
+        for (int s = 0; s < K_SAMPLES; ++s)
+        {
+            double ms = 0.0;
+            std::uint64_t n = 0;
+            while (ms < opt_.minTimeMs || n < 3)
+            {
+                setup();
+                ms += timeMs(op);
+                ++n;
+            }
+            samples.push_back(ms * 1e6 / static_cast<double>(n));
+            total += n;
+        }
+        record(name, samples, total);
+    }
+
+    const std::vector<Result>& results() const
+    {
+        return results_;
+    }
+
+  private:
+    template <typename Fn> static double timeMs(Fn&& fn)
+    {
+        const auto t0 = std::chrono::steady_clock::now();
+        fn();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    }
+
+    static void repeat(const std::function<void()>& op, std::uint64_t n)
+    {
+        for (std::uint64_t i = 0; i < n; ++i)
+            op();
+    }
+
+    void record(const std::string& name, std::vector<double> samples, std::uint64_t iterations)
+    {
+        std::sort(samples.begin(), samples.end());
+        Result r;
+        r.name = name;
+        r.nsPerOp = samples[samples.size() / 2];
+        r.minNsPerOp = samples.front();
+        r.iterations = iterations;
+        results_.push_back(r);
+
+        std::printf("%-40s %14.1f ns/op %12llu iterations\n", name.c_str(), r.nsPerOp,
+                    static_cast<unsigned long long>(iterations));
+        std::fflush(stdout);
+    }
+
+    const Options& opt_;
+    std::vector<Result> results_;
+};
+
+// Scrobble API stand-in: answers immediately with a fixed mix of results.
+class CannedScrobbleApi final : public ILastfmScrobbleApi
+{
+  public:
+    bool isAuthenticated() const override
+    {
+        return true;
+    }
+    bool isSuspended() const override
+    {
+        return false;
+    }
+    bool updateNowPlaying(const LastfmTrackInfo&) override
+    {
+        return true;
+    }
+    LastfmScrobbleResult scrobble(const LastfmTrackInfo&, double, std::time_t) override
+    {
+        // 7 accepted, 2 temporary failures, 1 rejected out of every 10.
+        switch (calls_++ % 10)
+        {
+        case 3:
+        case 7:
+            return LastfmScrobbleResult::TEMPORARY_ERROR;
+        case 9:
+            return LastfmScrobbleResult::OTHER_ERROR;
+        default:
+            return LastfmScrobbleResult::SUCCESS;
+        }
+    }
+
+  private:
+    std::uint64_t calls_ = 0;
+};
+
+// Transport stand-in returning a track.scrobble success body of realistic size.
+class CannedTransport final : public ILastfmHttpTransport
+{
+  public:
+    bool request(const char*, const std::string& url, std::string& outBody, std::string&) override
+    {
+        sink = sink + url.size();
+        outBody = body;
+        return true;
+    }
+
+    std::string body =
+        "{\"scrobbles\":{\"scrobble\":{\"artist\":{\"corrected\":\"0\",\"#text\":\"Sigur R\\u00f3s\"},"
+        "\"album\":{\"corrected\":\"0\",\"#text\":\"( )\"},\"track\":{\"corrected\":\"0\",\"#text\":\"Untitled #1 "
+        "(Vaka)\"},\"ignoredMessage\":{\"code\":\"0\",\"#text\":\"\"},\"albumArtist\":{\"corrected\":\"0\","
+        "\"#text\":\"\"},\"timestamp\":\"1772409600\"},\"@attr\":{\"ignored\":0,\"accepted\":1}}}";
+};
+
+static LastfmTrackInfo sampleTrack()
+{
+    LastfmTrackInfo t;
+    t.artist = "Sigur Rós";
+    t.title = "Untitled #1 (Vaka)";
+    t.album = "( )";
+    t.albumArtist = "Sigur Rós";
+    t.mbid = "5cbef01b-cc35-4f52-af7b-d0df0c4f61b9";
+    t.durationSeconds = 398.4;
+    return t;
+}
+
+// Persisted queue (FSQ2) of n entries inside Last.fm's two-week window. Every dueEvery-th entry is due now,
+// the rest wait for a retry an hour out (0: none due).
+static std::string makeQueueBlob(std::size_t n, std::time_t now, std::size_t dueEvery)
+{
+    const std::time_t span = 13 * 24 * 3600;
+    std::string out = std::string(LastfmQueue::QUEUE_VERSION) + "\n";
+    out.reserve(n * 140);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const std::time_t start = now - span + static_cast<std::time_t>((span * i) / std::max<std::size_t>(1, n));
+        const bool due = dueEvery > 0 && i % dueEvery == 0;
+        const std::time_t nextRetry = due ? 0 : now + 3600;
+        char row[512];
+        std::snprintf(row, sizeof(row),
+                      "Artist %zu\tSome Title With Words %zu\tAlbum %zu\tAlbum Artist\t%d.000000\t%d.000000\t%lld\t0\t"
+                      "%d\t%lld\t%llu\t0\t\n",
+                      i % 977, i, i % 131, 180 + static_cast<int>(i % 240), 120 + static_cast<int>(i % 100),
+                      static_cast<long long>(start), due ? 0 : 1, static_cast<long long>(nextRetry),
+                      static_cast<unsigned long long>(i + 1));
+        out += row;
+    }
+    return out;
+}
+
+static void queueBenchmarks(Runner& runner)
+{
+    const std::time_t now = std::time(nullptr);
+
+    for (std::size_t n : K_QUEUE_SIZES)
+    {
+        const std::string suffix = "/" + std::to_string(n);
+        const std::string allDue = makeQueueBlob(n, now, 1);
+        const std::string noneDue = makeQueueBlob(n, now, 0);
+
+        CannedScrobbleApi api;
+        LastfmMemoryConfigStore store;
+        store.setInt(lastfm::config::DAILY_BUDGET, 0); // unlimited: every retry batch dispatches
+        std::unique_ptr<LastfmQueue> queue;
+
+        auto fresh = [&](const std::string& blob)
+        {
+            queue.reset();
+            store.setString(lastfm::config::PENDING_SCROBBLES, blob);
+            queue = std::make_unique<LastfmQueue>(api, [] {}, store);
+        };
+
+        LastfmQueue::NewScrobble extra;
+        extra.track = sampleTrack();
+        extra.playbackSeconds = 200.0;
+        extra.startTimestamp = now - 300;
+
+        runner.runWithSetup(
+            "queue.load" + suffix,
+            [&]
+            {
+                queue.reset();
+                store.setString(lastfm::config::PENDING_SCROBBLES, allDue);
+            },
+            [&]
+            {
+                LastfmQueue q(api, [] {}, store);
+                sink = sink + q.getPendingScrobbleCount();
+            });
+
+        // First save after a load formats every row; later saves reuse the cached lines.
+        runner.runWithSetup(
+            "queue.save_cold" + suffix,
+            [&]
+            {
+                fresh(allDue);
+                sink = sink + queue->getPendingScrobbleCount();
+            },
+            [&] { queue->queueScrobblesForRetry({extra}); });
+
+        runner.runWithSetup(
+            "queue.save_warm" + suffix,
+            [&]
+            {
+                fresh(allDue);
+                queue->queueScrobblesForRetry({extra});
+            },
+            [&] { queue->queueScrobblesForRetry({extra}); });
+
+        // One retry run: candidate selection, 10 canned results, mergeRetryUpdates and the save.
+        runner.runWithSetup(
+            "queue.retry_batch" + suffix,
+            [&]
+            {
+                fresh(allDue);
+                queue->retryQueuedScrobbles();
+            },
+            [&] { sink = sink + queue->retryQueuedScrobbles(); });
+
+        fresh(noneDue);
+        runner.run("queue.has_due_none" + suffix, [&] { sink = sink + queue->hasDueScrobble(now); });
+
+        fresh(allDue);
+        runner.run("queue.has_due_first" + suffix, [&] { sink = sink + queue->hasDueScrobble(now); });
+        queue.reset();
+    }
+}
+
+// Rockbox-style log of n plays over the last 13 days; every 50th line repeats the previous play.
+static void writeScrobblerLog(const std::string& path, std::size_t n, std::time_t now)
+{
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f)
+        return;
+
+    std::fputs("#AUDIOSCROBBLER/1.1\n#TZ/UTC\n#CLIENT/Rockbox ipodvideo $Revision$\n", f);
+    const std::time_t span = 13 * 24 * 3600;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const std::size_t play = i % 50 == 49 ? i - 1 : i;
+        const std::time_t start = now - span + static_cast<std::time_t>((span * play) / std::max<std::size_t>(1, n));
+        std::fprintf(f, "Artist %zu\tAlbum %zu\tSome Title With Words %zu\t%zu\t%d\t%c\t%lld\t\n", play % 977,
+                     play % 131, play, play % 12 + 1, 180 + static_cast<int>(play % 240), play % 20 == 7 ? 'S' : 'L',
+                     static_cast<long long>(start));
+    }
+    std::fclose(f);
+}
+
+static void importBenchmarks(Runner& runner)
+{
+    if (!runner.selected("scrobbler_log."))
+        return;
+
+    const std::time_t now = std::time(nullptr);
+    const std::string path = (std::filesystem::temp_directory_path() / "core_bench.scrobbler.log").string();
+    writeScrobblerLog(path, 100000, now);
+
+    runner.runWithSetup(
+        "scrobbler_log.parse/100000", [] {},
+        [&]
+        {
+            LastfmScrobblerLogReader reader;
+            std::string error;
+            LastfmScrobblerLogEntry e;
+            if (reader.open(path, error))
+                while (reader.next(e))
+                    sink = sink + e.track.title.size();
+        });
+
+    // Chunked queueing: one save per 5000 plays into an initially empty queue.
+    CannedScrobbleApi api;
+    LastfmMemoryConfigStore store;
+    std::unique_ptr<LastfmQueue> queue;
+    runner.runWithSetup(
+        "scrobbler_log.import/100000",
+        [&]
+        {
+            queue.reset();
+            store.setString(lastfm::config::PENDING_SCROBBLES, "");
+            queue = std::make_unique<LastfmQueue>(api, [] {}, store);
+        },
+        [&] { sink = sink + lastfmImportScrobblerLog(path, *queue).queued; });
+
+    queue.reset();
+    std::remove(path.c_str());
+}
+
+static void historyBenchmarks(Runner& runner)
+{
+    if (!runner.selected("history."))
+        return;
+
+    const std::size_t n = 1000000;
+    const std::time_t base = 1500000000;
+    const std::string path = (std::filesystem::temp_directory_path() / "core_bench.history").string();
+    std::remove(path.c_str());
+
+    auto history = std::make_unique<LastfmScrobbleHistory>();
+    std::string error;
+    if (!history->open(path, error))
+    {
+        std::fprintf(stderr, "history: %s\n", error.c_str());
+        return;
+    }
+
+    std::vector<LastfmHistoryRecord> plays(10000);
+    for (std::size_t i = 0; i < n; i += plays.size())
+    {
+        for (std::size_t j = 0; j < plays.size(); ++j)
+        {
+            const std::size_t play = i + j;
+            LastfmHistoryRecord& r = plays[j];
+            r.timestamp = base + static_cast<std::time_t>(play) * 200;
+            r.artist = "Artist " + std::to_string(play % 977);
+            r.title = "Some Title With Words " + std::to_string(play);
+            r.album = "Album " + std::to_string(play % 131);
+            r.durationSeconds = 180 + static_cast<double>(play % 240);
+        }
+        history->record(plays);
+    }
+
+    runner.runWithSetup(
+        "history.open/1000000", [&] { history.reset(); },
+        [&]
+        {
+            history = std::make_unique<LastfmScrobbleHistory>();
+            if (history->open(path, error))
+                sink = sink + history->stats().plays;
+        });
+
+    // Keys prepared up front so the lookups are timed, not the hashing of the strings.
+    std::vector<std::uint64_t> hits;
+    std::vector<std::uint64_t> misses;
+    for (std::size_t i = 0; i < 4096; ++i)
+    {
+        const std::size_t play = (i * 7919) % n;
+        const std::string artist = "Artist " + std::to_string(play % 977);
+        const std::string title = "Some Title With Words " + std::to_string(play);
+        const std::time_t ts = base + static_cast<std::time_t>(play) * 200;
+        hits.push_back(lastfm::util::playKey(ts, artist, title));
+        misses.push_back(lastfm::util::playKey(ts + 1, artist, title));
+    }
+
+    std::size_t i = 0;
+    runner.run("history.contains_hit/1000000", [&] { sink = sink + history->containsKey(hits[i++ & 4095]); });
+    runner.run("history.contains_miss/1000000", [&] { sink = sink + history->containsKey(misses[i++ & 4095]); });
+
+    // One drain's worth of acknowledgements: 10 new plays, one write and flush. Appended to a copy, so the
+    // 1M-play file the other benchmarks read stays at 1M plays.
+    {
+        const std::string recordPath = path + ".record";
+        std::error_code ec;
+        std::filesystem::copy_file(path, recordPath, std::filesystem::copy_options::overwrite_existing, ec);
+        LastfmScrobbleHistory appended;
+        if (!ec && appended.open(recordPath, error))
+        {
+            std::vector<LastfmHistoryRecord> batch(10, plays.front());
+            std::size_t next = n;
+            runner.run("history.record_10",
+                       [&]
+                       {
+                           for (auto& r : batch)
+                               r.timestamp = base + static_cast<std::time_t>(next++) * 200;
+                           sink = sink + appended.record(batch);
+                       });
+            appended.close();
+        }
+        std::remove(recordPath.c_str());
+    }
+
+    // Full streaming export, read back from the file.
+    const std::string exportPath = path + ".export";
+    for (const auto& format : {std::make_pair(LastfmExportFormat::CSV, "csv"),
+                               std::make_pair(LastfmExportFormat::JSONL, "jsonl")})
+    {
+        LastfmExportOptions options;
+        options.format = format.first;
+        runner.runWithSetup(
+            std::string("history.export_") + format.second + "/1000000", [] {},
+            [&] { sink = sink + lastfmExportScrobbles(exportPath, nullptr, history.get(), options).bytes; });
+    }
+    std::remove(exportPath.c_str());
+
+    const LastfmScrobbleHistory::Stats st = history->stats();
+    std::printf("history: %zu plays, %zu KB index, %.2f%% of misses past the filter\n", st.plays,
+                st.memoryBytes / 1024,
+                st.lookups > st.filterRejects
+                    ? 100.0 * static_cast<double>(st.falsePositives) /
+                          static_cast<double>(st.falsePositives + st.filterRejects)
+                    : 0.0);
+
+    history.reset();
+    std::remove(path.c_str());
+}
+
+// Five years of plays, one every ~2.6 minutes: 5000 artists, 100k tracks, 12k albums; a tenth arrive out of
+// order (imports).
+static void statsBenchmarks(Runner& runner)
+{
+    if (!runner.selected("stats."))
+        return;
+
+    const std::size_t n = 1000000;
+    const std::time_t end = 1790000000;
+    const std::time_t span = 5 * 365 * 24 * 3600;
+
+    std::vector<LastfmHistoryRecord> plays(n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const std::size_t track = (i * 2654435761u) % 100000;
+        LastfmHistoryRecord& r = plays[i];
+        const std::size_t slot = i % 10 == 9 ? (i * 7919) % n : i;
+        r.timestamp = end - span + static_cast<std::time_t>((span * slot) / n);
+        r.artist = "Artist " + std::to_string(track % 5000);
+        r.title = "Some Title With Words " + std::to_string(track);
+        r.album = "Album " + std::to_string(track % 12000);
+        r.durationSeconds = 180 + static_cast<double>(track % 240);
+    }
+
+    std::unique_ptr<LastfmListeningStats> stats;
+    runner.runWithSetup(
+        "stats.ingest/1000000", [&] { stats = std::make_unique<LastfmListeningStats>(); },
+        [&]
+        {
+            for (const auto& r : plays)
+                stats->add(r);
+        });
+
+    std::time_t from = 0;
+    std::time_t to = 0;
+    lastfmStatsPeriodRange(LastfmStatsPeriod::YEAR, end, from, to);
+    runner.run("stats.top_artists_year/1000000",
+               [&] { sink = sink + stats->top(LastfmStatsKind::ARTIST, from, to, 10).size(); });
+    runner.run("stats.top_albums_year/1000000",
+               [&] { sink = sink + stats->top(LastfmStatsKind::ALBUM, from, to, 10).size(); });
+    runner.run("stats.top_tracks_all/1000000",
+               [&] { sink = sink + stats->top(LastfmStatsKind::TRACK, 0, end + 1, 10).size(); });
+
+    lastfmStatsPeriodRange(LastfmStatsPeriod::MONTH, end, from, to);
+    runner.run("stats.totals_month/1000000", [&] { sink = sink + stats->totals(from, to).plays; });
+}
+
+// A library's worth of playcounts, as the field provider sees it while a playlist scrolls.
+static void userDataBenchmarks(Runner& runner)
+{
+    if (!runner.selected("user_data."))
+        return;
+
+    const std::size_t n = 100000;
+    const std::time_t now = 1790000000;
+    const std::string path = (std::filesystem::temp_directory_path() / "core_bench.userdata").string();
+
+    auto cache = std::make_unique<LastfmUserDataCache>();
+    std::vector<std::uint64_t> keys(n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        keys[i] = LastfmUserDataCache::key("Artist " + std::to_string(i % 977), "Title " + std::to_string(i));
+        LastfmTrackUserData d;
+        d.playcount = static_cast<std::uint32_t>(i % 300);
+        d.loved = i % 17 == 0;
+        cache->store(keys[i], d, now - static_cast<std::time_t>(i % 3600));
+    }
+
+    runner.run("user_data.key", [&] { sink = sink + LastfmUserDataCache::key("Some Artist", "Some Title"); });
+
+    std::size_t i = 0;
+    LastfmTrackUserData out;
+    runner.run("user_data.lookup_hit/100000",
+               [&]
+               {
+                   cache->lookup(keys[(i++ * 7919) % n], now, out);
+                   sink = sink + out.playcount;
+               });
+    runner.run("user_data.lookup_miss/100000",
+               [&] { sink = sink + static_cast<int>(cache->lookup(i++ | (1ull << 63), now, out)); });
+
+    std::string error;
+    runner.run("user_data.save/100000", [&] { sink = sink + cache->save(path, "bench", error); });
+    runner.runWithSetup(
+        "user_data.load/100000", [&] { cache = std::make_unique<LastfmUserDataCache>(); },
+        [&]
+        {
+            if (cache->load(path, "bench", error))
+                sink = sink + cache->size();
+        });
+
+    std::remove(path.c_str());
+}
+
+// The corrections map filled to its memory budget; one pair in ten rewrites the artist.
+static void correctionsBenchmarks(Runner& runner)
+{
+    if (!runner.selected("corrections."))
+        return;
+
+    LastfmCorrections corrections;
+    std::size_t n = 0;
+    for (; corrections.stats().memoryBytes < LastfmCorrections::DEFAULT_BUDGET_BYTES * 9 / 10; ++n)
+    {
+        const std::string artist = "artist " + std::to_string(n % 977);
+        const std::string title = "some title " + std::to_string(n);
+        LastfmCorrection c{artist, title};
+        if (n % 10 == 0)
+            c.artist = "Artist " + std::to_string(n % 977);
+        corrections.learn(artist, title, c);
+    }
+
+    std::vector<std::pair<std::string, std::string>> pairs;
+    for (std::size_t i = 0; i < 4096; ++i)
+    {
+        const std::size_t k = (i * 7919) % n;
+        pairs.emplace_back("artist " + std::to_string(k % 977), "some title " + std::to_string(k));
+    }
+
+    std::size_t i = 0;
+    std::string artist;
+    std::string title;
+    runner.run("corrections.apply/" + std::to_string(n),
+               [&]
+               {
+                   const auto& p = pairs[i++ & 4095];
+                   artist = p.first;
+                   title = p.second;
+                   sink = sink + corrections.apply(artist, title);
+               });
+
+    const LastfmCorrections::Stats st = corrections.stats();
+    std::printf("corrections: %zu entries, %zu corrected, %zu KB\n", st.entries, st.corrected, st.memoryBytes / 1024);
+}
+
+// Library items played within the last two weeks, some of them more than once; every fourth last play of those
+// was scrobbled already (history start shortly before the statistics time).
+static void backfillBenchmarks(Runner& runner)
+{
+    if (!runner.selected("backfill."))
+        return;
+
+    const std::time_t now = std::time(nullptr);
+    const std::time_t span = 13 * 24 * 3600;
+    const std::size_t n = 100000;
+    std::vector<LastfmBackfillItem> items(n);
+    std::vector<std::pair<std::pair<std::string, std::string>, std::time_t>> scrobbled;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        LastfmBackfillItem& item = items[i];
+        item.track.artist = "Artist " + std::to_string(i % 977);
+        item.track.title = "Some Title With Words " + std::to_string(i);
+        item.track.album = "Album " + std::to_string(i % 131);
+        item.track.durationSeconds = 180 + static_cast<double>(i % 240);
+        item.playCount = i % 3 == 0 ? 1 + static_cast<std::uint32_t>(i % 7) : 0;
+        item.lastPlayed = item.playCount > 0 ? now - span + static_cast<std::time_t>((span * i) / n) : 0;
+        item.firstPlayed = item.playCount > 1 ? item.lastPlayed - 3 * 24 * 3600 : item.lastPlayed;
+        if (item.playCount > 0 && i % 4 == 0)
+            scrobbled.push_back({{item.track.artist, item.track.title}, item.lastPlayed - 100});
+    }
+
+    // Read chunks of 2000 items, as the library scan hands them over; queued in chunks of 5000 plays.
+    CannedScrobbleApi api;
+    LastfmMemoryConfigStore store;
+    std::unique_ptr<LastfmQueue> queue;
+    std::vector<std::vector<LastfmBackfillItem>> chunks;
+    for (std::size_t i = 0; i < n; i += 2000)
+        chunks.emplace_back(items.begin() + i, items.begin() + std::min(n, i + 2000));
+
+    runner.runWithSetup(
+        "backfill.run/" + std::to_string(n),
+        [&]
+        {
+            queue.reset();
+            store.setString(lastfm::config::PENDING_SCROBBLES, "");
+            queue = std::make_unique<LastfmQueue>(api, [] {}, store);
+        },
+        [&]
+        {
+            LastfmBackfill backfill(*queue);
+            for (const auto& s : scrobbled)
+                backfill.addScrobbled(s.first.first, s.first.second, s.second);
+            for (const auto& chunk : chunks)
+                backfill.add(chunk);
+            sink = sink + backfill.finish().queued;
+        });
+
+    queue.reset();
+}
+
+static void requestBenchmarks(Runner& runner)
+{
+    const LastfmTrackInfo track = sampleTrack();
+    const std::string apiKey = "0123456789abcdef0123456789abcdef";
+    const std::string apiSecret = "fedcba9876543210fedcba9876543210";
+    const std::string sessionKey = "abcdefghijklmnopqrstuvwxyz012345";
+    const std::string base = lastfm::request::DEFAULT_API_BASE_URL;
+
+    runner.run("request.now_playing_url",
+               [&]
+               {
+                   const auto params = lastfm::request::nowPlayingParams(track, apiKey, sessionKey);
+                   sink = sink + lastfm::request::signedUrl(base, params, apiSecret).size();
+               });
+
+    runner.run("request.scrobble_url",
+               [&]
+               {
+                   const auto params = lastfm::request::scrobbleParams(track, 1772409600, apiKey, sessionKey);
+                   sink = sink + lastfm::request::signedUrl(base, params, apiSecret).size();
+               });
+
+    const auto params = lastfm::request::scrobbleParams(track, 1772409600, apiKey, sessionKey);
+    runner.run("request.signature", [&] { sink = sink + lastfm::request::signature(params, apiSecret).size(); });
+
+    CannedTransport transport;
+    LastfmWebApi api(transport, [&] { return LastfmApiCredentials{apiKey, apiSecret, sessionKey, "bench"}; });
+    runner.run("web_api.scrobble",
+               [&] { sink = sink + static_cast<std::size_t>(api.scrobble(track, 200.0, 1772409600)); });
+
+    const std::string errorBody = "{\"message\":\"Invalid session key - Please re-authenticate\",\"error\":9}";
+    runner.run("util.extract_api_error",
+               [&] { sink = sink + lastfm::util::extractLastfmApiError(errorBody.c_str()).errorCode; });
+    runner.run("util.extract_api_error_ok",
+               [&] { sink = sink + lastfm::util::extractLastfmApiError(transport.body.c_str()).hasJson; });
+
+    // One full submit-listens request; the buffer is reused like the sink does.
+    std::vector<LastfmSinkScrobble> listens(lastfm::listenbrainz::BATCH_SIZE);
+    for (std::size_t i = 0; i < listens.size(); ++i)
+    {
+        listens[i].track = track;
+        listens[i].playbackSeconds = 200.0;
+        listens[i].startTimestamp = 1772409600 + static_cast<std::time_t>(i) * 240;
+    }
+    std::string payload;
+    runner.run("listenbrainz.import_payload_500",
+               [&]
+               {
+                   payload.clear();
+                   lastfm::listenbrainz::appendImportPayload(payload, listens, 0, listens.size());
+                   sink = sink + payload.size();
+               });
+}
+
+static void stringBenchmarks(Runner& runner)
+{
+    const std::string plain = "Boards of Canada";
+    const std::string mixed = "Sigur Rós & Jónsi: Untitled #1 (Vaka) [Live at Laugardalshöll, 2008]";
+    runner.run("util.url_encode_plain", [&] { sink = sink + lastfm::util::urlEncode(plain).size(); });
+    runner.run("util.url_encode_mixed", [&] { sink = sink + lastfm::util::urlEncode(mixed).size(); });
+
+    runner.run("util.clean_tag_value", [&] { sink = sink + lastfm::util::cleanTagValue("  Aphex Twin  ").size(); });
+    runner.run("util.clean_tag_value_unknown",
+               [&] { sink = sink + lastfm::util::cleanTagValue(" Unknown Artist ").size(); });
+
+    const std::string streamTitle = "Massive Attack - Teardrop";
+    const std::string slogan = "You are listening to the best mix of chill and downtempo - www.example-radio.com";
+    runner.run("stream.looks_like_station_title",
+               [&] { sink = sink + lastfm::util::looksLikeStationTitle(streamTitle); });
+    runner.run("stream.looks_like_station_slogan", [&] { sink = sink + lastfm::util::looksLikeStationTitle(slogan); });
+
+    std::string artist;
+    std::string title;
+    runner.run("stream.parse_artist_title",
+               [&]
+               {
+                   sink = sink + lastfm::util::parseArtistTitleFromCombined(streamTitle, artist, title);
+               });
+}
+
+static void filterBenchmarks(Runner& runner)
+{
+    // Same rule set as filter_bench: 20 substrings + 12 regexes.
+    const std::string rules = "podcast;audiobook;jingle;advert;commercial;station id;interview;rehearsal;"
+                              "soundcheck;skit;test tone;white noise;rain sounds;asmr;karaoke;tribute band;"
+                              "sleep music;meditation;chapter one;unknown track;"
+                              "^the (beatles|doors)$;live (at|in) .+ 19[6-9][0-9];\\(live\\)$;^track ?\\d+$;"
+                              "[0-9]{4} remaster;^unknown( artist)?$;feat\\. dj;(?:part|pt)\\.? ?[ivx]+$;"
+                              "\\[.*demo.*\\];^a{2,4}b;ch(a|e)pter \\d+;\\bintro\\b";
+    const auto filter = LastfmExclusionFilter::compile(rules, "bench");
+
+    const std::vector<std::string> values = {"Teardrop", "Live at Wembley 1986", "Interview with the band",
+                                             "Windowlicker", "Track 12", "Roygbiv (2011 Remaster)",
+                                             "Hunter", "Intro"};
+    std::size_t i = 0;
+    runner.run("filter.matches", [&] { sink = sink + filter->matches(values[i++ % values.size()]); });
+}
+
+// Our own output format: one result object per line.
+static bool loadBaseline(const std::string& path, std::map<std::string, double>& out)
+{
+    std::ifstream in(path);
+    if (!in)
+        return false;
+
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::string name;
+        if (!lastfm::util::jsonFindStringValue(line.c_str(), "name", name))
+            continue;
+
+        const char* key = "\"ns_per_op\":";
+        const std::size_t pos = line.find(key);
+        if (pos == std::string::npos)
+            continue;
+
+        out[name] = std::strtod(line.c_str() + pos + std::strlen(key), nullptr);
+    }
+    return true;
+}
+
+static bool writeJson(const std::string& path, const std::vector<Result>& results)
+{
+    std::FILE* f = std::fopen(path.c_str(), "w");
+    if (!f)
+        return false;
+
+    std::fprintf(f, "{\n  \"suite\": \"core_bench\",\n  \"unit\": \"ns\",\n  \"results\": [\n");
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        const Result& r = results[i];
+        std::fprintf(f,
+                     "    {\"name\": \"%s\", \"ns_per_op\": %.3f, \"min_ns_per_op\": %.3f, \"iterations\": %llu}%s\n",
+                     r.name.c_str(), r.nsPerOp, r.minNsPerOp, static_cast<unsigned long long>(r.iterations),
+                     i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(f, "  ]\n}\n");
+    return std::fclose(f) == 0;
+}
+
+static void usage()
+{
+    std::fprintf(stderr, "usage: core_bench [--filter TEXT] [--min-time MS] [--json OUT] [--baseline FILE]\n"
+                         "                  [--max-regression PCT]\n");
+}
+
+static bool parseArgs(int argc, char** argv, Options& opt)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string a = argv[i];
+        if (i + 1 >= argc)
+            return false;
+        const char* v = argv[++i];
+
+        if (a == "--filter")
+            opt.filter = v;
+        else if (a == "--min-time")
+            opt.minTimeMs = std::atof(v);
+        else if (a == "--json")
+            opt.jsonPath = v;
+        else if (a == "--baseline")
+            opt.baselinePath = v;
+        else if (a == "--max-regression")
+            opt.maxRegressionPct = std::atof(v);
+        else
+            return false;
+    }
+    return opt.minTimeMs > 0.0;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parseArgs(argc, argv, opt))
+    {
+        usage();
+        return 2;
+    }
+
+    std::map<std::string, double> baseline;
+    if (!opt.baselinePath.empty() && !loadBaseline(opt.baselinePath, baseline))
+    {
+        std::fprintf(stderr, "cannot read baseline %s\n", opt.baselinePath.c_str());
+        return 2;
+    }
+
+    Runner runner(opt);
+    stringBenchmarks(runner);
+    requestBenchmarks(runner);
+    filterBenchmarks(runner);
+    queueBenchmarks(runner);
+    importBenchmarks(runner);
+    historyBenchmarks(runner);
+    statsBenchmarks(runner);
+    userDataBenchmarks(runner);
+    correctionsBenchmarks(runner);
+    backfillBenchmarks(runner);
+
+    if (!opt.jsonPath.empty() && !writeJson(opt.jsonPath, runner.results()))
+    {
+        std::fprintf(stderr, "cannot write %s\n", opt.jsonPath.c_str());
+        return 2;
+    }
+
+    int regressions = 0;
+    if (!baseline.empty())
+    {
+        std::printf("\n%-40s %14s %14s %9s\n", "vs baseline", "baseline ns", "now ns", "change");
+        for (const Result& r : runner.results())
+        {
+            auto it = baseline.find(r.name);
+            if (it == baseline.end() || it->second <= 0.0)
+            {
+                std::printf("%-40s %14s %14.1f %9s\n", r.name.c_str(), "-", r.nsPerOp, "new");
+                continue;
+            }
+
+            const double pct = (r.nsPerOp / it->second - 1.0) * 100.0;
+            const bool regressed = opt.maxRegressionPct >= 0.0 && pct > opt.maxRegressionPct;
+            regressions += regressed ? 1 : 0;
+            std::printf("%-40s %14.1f %14.1f %+8.1f%%%s\n", r.name.c_str(), it->second, r.nsPerOp, pct,
+                        regressed ? "  REGRESSION" : "");
+        }
+    }
+
+    lastfmLogShutdown();
+    return regressions == 0 ? 0 : 1;
+}
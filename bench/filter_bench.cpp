@@ -0,0 +1,227 @@
+//
+//  filter_bench.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+//  Exclusion filter benchmark: 32 patterns x 100k artist/title pairs, compiled filter vs the previous
+//  std::regex implementation. Also checks both agree on every pair.
+//
+//  c++ -std=c++20 -O2 -I../src filter_bench.cpp ../src/lastfm_filter.cpp ../src/lastfm_log.cpp -o filter_bench
+//
+
+#include "lastfm_filter.h"
+#include "lastfm_log.h"
+
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+std::atomic<int> lfmLogLevel{static_cast<int>(LfmLogLevel::OFF)};
+
+namespace
+{
+// Previous tracker implementation, minus logging.
+class LegacyTextOrRegexFilter
+{
+  public:
+    bool matches(const std::string& value, const std::string& rawRules, std::uint64_t rulesVersion)
+    {
+        rebuildIfNeeded(rawRules, rulesVersion);
+        std::lock_guard<std::mutex> lock(m_);
+        if (raw_.empty())
+            return false;
+
+        const std::string vLower = lowerCopy(value);
+
+        for (const auto& needle : substrLower_)
+        {
+            if (!needle.empty() && vLower.find(needle) != std::string::npos)
+                return true;
+        }
+
+        for (const auto& rx : regexes_)
+        {
+            if (std::regex_search(value, rx))
+                return true;
+        }
+
+        return false;
+    }
+
+  private:
+    static bool hasRegexMeta(const std::string& s)
+    {
+        return s.find_first_of(".^$|?*+()[]{}\\") != std::string::npos;
+    }
+
+    static std::string trimCopy(const std::string& in)
+    {
+        std::size_t b = 0;
+        while (b < in.size() && std::isspace((unsigned char)in[b]))
+            ++b;
+        std::size_t e = in.size();
+        while (e > b && std::isspace((unsigned char)in[e - 1]))
+            --e;
+        return (e > b) ? in.substr(b, e - b) : std::string{};
+    }
+
+    static std::string lowerCopy(const std::string& in)
+    {
+        std::string out;
+        out.reserve(in.size());
+        for (unsigned char c : in)
+            out.push_back((char)std::tolower(c));
+        return out;
+    }
+
+    void rebuildIfNeeded(const std::string& rawRules, std::uint64_t rulesVersion)
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        if (rulesVersion == builtVersion_)
+            return;
+
+        builtVersion_ = rulesVersion;
+        if (rawRules == raw_)
+            return;
+
+        raw_ = rawRules;
+        substrLower_.clear();
+        regexes_.clear();
+
+        std::size_t start = 0;
+        while (start <= raw_.size() && (substrLower_.size() + regexes_.size()) < 32)
+        {
+            std::size_t end = raw_.find(';', start);
+            if (end == std::string::npos)
+                end = raw_.size();
+
+            std::string entry = trimCopy(raw_.substr(start, end - start));
+            start = end + 1;
+
+            if (entry.empty() || entry.size() > 256)
+                continue;
+
+            if (!hasRegexMeta(entry))
+            {
+                substrLower_.push_back(lowerCopy(entry));
+                continue;
+            }
+
+            try
+            {
+                regexes_.emplace_back(entry, std::regex::ECMAScript | std::regex::icase);
+            }
+            catch (const std::regex_error&)
+            {
+            }
+        }
+    }
+
+    std::mutex m_;
+    std::string raw_;
+    std::uint64_t builtVersion_ = 0;
+    std::vector<std::string> substrLower_;
+    std::vector<std::regex> regexes_;
+};
+
+// 20 substrings + 12 regexes (one of them, \b, takes the std::regex fallback).
+static const char* kRules = "podcast;audiobook;jingle;advert;commercial;station id;interview;rehearsal;"
+                            "soundcheck;skit;test tone;white noise;rain sounds;asmr;karaoke;tribute band;"
+                            "sleep music;meditation;chapter one;unknown track;"
+                            "^the (beatles|doors)$;live (at|in) .+ 19[6-9][0-9];\\(live\\)$;^track ?\\d+$;"
+                            "[0-9]{4} remaster;^unknown( artist)?$;feat\\. dj;(?:part|pt)\\.? ?[ivx]+$;"
+                            "\\[.*demo.*\\];^a{2,4}b;ch(a|e)pter \\d+;\\bintro\\b";
+
+static const char* kWords[] = {"the",   "doors",  "beatles", "live",  "at",    "in",      "london", "1969",
+                               "track", "12",     "2011",    "remaster", "part", "iv",    "demo",   "[home",
+                               "demo]", "feat.",  "dj",      "love",  "night", "blue",    "river",  "intro",
+                               "outro", "podcast", "ASMR",   "Karaoke", "song", "dream",  "city",   "(Live)",
+                               "chapter", "7",    "aab",     "unknown", "artist", "sunset", "echo", "Interview"};
+
+static std::string randomPhrase(std::mt19937& rng, int minWords, int maxWords)
+{
+    std::uniform_int_distribution<int> count(minWords, maxWords);
+    std::uniform_int_distribution<std::size_t> word(0, sizeof(kWords) / sizeof(kWords[0]) - 1);
+
+    std::string out;
+    const int n = count(rng);
+    for (int i = 0; i < n; ++i)
+    {
+        if (!out.empty())
+            out.push_back(' ');
+        out += kWords[word(rng)];
+    }
+    return out;
+}
+
+template <typename Fn> static double timeMs(Fn&& fn)
+{
+    const auto t0 = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+} // namespace
+
+int main()
+{
+    constexpr std::size_t kPairs = 100000;
+
+    std::mt19937 rng(20260101);
+    std::vector<std::pair<std::string, std::string>> pairs;
+    pairs.reserve(kPairs);
+    for (std::size_t i = 0; i < kPairs; ++i)
+        pairs.emplace_back(randomPhrase(rng, 1, 3), randomPhrase(rng, 1, 6));
+
+    const std::string rules = kRules;
+
+    LegacyTextOrRegexFilter legacyArtist;
+    LegacyTextOrRegexFilter legacyTitle;
+    std::vector<char> legacyResult(kPairs);
+    const double legacyMs = timeMs(
+        [&]
+        {
+            for (std::size_t i = 0; i < kPairs; ++i)
+                legacyResult[i] = legacyArtist.matches(pairs[i].first, rules, 1) ||
+                                  legacyTitle.matches(pairs[i].second, rules, 1);
+        });
+
+    std::shared_ptr<const LastfmExclusionFilter> filter;
+    const double compileMs = timeMs([&] { filter = LastfmExclusionFilter::compile(rules, "bench"); });
+
+    std::vector<char> result(kPairs);
+    const double newMs = timeMs(
+        [&]
+        {
+            for (std::size_t i = 0; i < kPairs; ++i)
+                result[i] = filter->matches(pairs[i].first) || filter->matches(pairs[i].second);
+        });
+
+    std::size_t matched = 0;
+    std::size_t mismatched = 0;
+    for (std::size_t i = 0; i < kPairs; ++i)
+    {
+        matched += result[i] ? 1 : 0;
+        if (result[i] != legacyResult[i])
+        {
+            if (++mismatched <= 5)
+                std::printf("mismatch: \"%s\" / \"%s\" legacy=%d new=%d\n", pairs[i].first.c_str(),
+                            pairs[i].second.c_str(), legacyResult[i], result[i]);
+        }
+    }
+
+    std::printf("patterns: %zu substring, %zu regex in DFA, %zu std::regex fallback\n", filter->substringCount(),
+                filter->dfaPatternCount(), filter->fallbackCount());
+    std::printf("pairs: %zu, excluded: %zu, mismatches: %zu\n", kPairs, matched, mismatched);
+    std::printf("legacy:   %9.2f ms  (%7.1f ns/pair)\n", legacyMs, legacyMs * 1e6 / kPairs);
+    std::printf("compiled: %9.2f ms  (%7.1f ns/pair), compile %.2f ms\n", newMs, newMs * 1e6 / kPairs, compileMs);
+    std::printf("speedup:  %9.1fx\n", legacyMs / newMs);
+
+    lastfmLogShutdown();
+    return mismatched == 0 ? 0 : 1;
+}
@@ -7,4 +7,20 @@
 
 #include "debug.h"
 
+#include <foobar2000/SDK/foobar2000.h>
+
 std::atomic<int> lfmLogLevel{static_cast<int>(LfmLogLevel::INFO)};
+
+namespace
+{
+static void consoleSink(const char* line)
+{
+    console::formatter f;
+    f << "foo_scrobbler_mac: " << line;
+}
+} // namespace
+
+void lastfmLogUseConsole()
+{
+    lastfmLogSetSink(&consoleSink);
+}
@@ -7,39 +7,12 @@
 
 #pragma once
 
-#include <atomic>
+#include "lastfm_log.h"
 
-#include <foobar2000/SDK/foobar2000.h>
+// Level check is a constant plus one relaxed load; formatting and console output happen only when enabled,
+// off the calling thread (see lastfm_log).
+#define LFM_INFO(expr) LFM_LOG_AT(LfmLogLevel::INFO, expr)
+#define LFM_DEBUG(expr) LFM_LOG_AT(LfmLogLevel::DEBUG_LOG, expr)
 
-enum class LfmLogLevel : int
-{
-    OFF = 0,
-    INFO = 1,
-    DEBUG_LOG = 2
-};
-
-extern std::atomic<int> lfmLogLevel;
-
-void lastfmSyncLogLevelFromPrefs();
-
-#define LFM_INFO(expr)                                                                                                 \
-    do                                                                                                                 \
-    {                                                                                                                  \
-        lastfmSyncLogLevelFromPrefs();                                                                                 \
-        if (lfmLogLevel.load() >= static_cast<int>(LfmLogLevel::INFO))                                                 \
-        {                                                                                                              \
-            console::formatter lfm_f;                                                                                  \
-            lfm_f << "foo_scrobbler_mac: " << expr;                                                                    \
-        }                                                                                                              \
-    } while (0)
-
-#define LFM_DEBUG(expr)                                                                                                \
-    do                                                                                                                 \
-    {                                                                                                                  \
-        lastfmSyncLogLevelFromPrefs();                                                                                 \
-        if (lfmLogLevel.load() >= static_cast<int>(LfmLogLevel::DEBUG_LOG))                                            \
-        {                                                                                                              \
-            console::formatter f;                                                                                      \
-            f << "foo_scrobbler_mac: " << expr;                                                                        \
-        }                                                                                                              \
-    } while (0)
+// Route drained log records to the foobar2000 console.
+void lastfmLogUseConsole();
@@ -7,12 +7,11 @@
 
 #include "lastfm_auth.h"
 #include "lastfm_no.h"
+#include "lastfm_platform_fb2k.h"
+#include "lastfm_request.h"
 #include "lastfm_util.h"
 #include "debug.h"
 
-#include <foobar2000/SDK/foobar2000.h>
-
-#include <map>
 #include <string>
 
 namespace
@@ -40,27 +39,15 @@ bool beginAuth(std::string& outAuthUrl)
         return false;
     }
 
-    std::map<std::string, std::string> params = {
+    const lastfm::request::Params params = {
         {"api_key", apiKey},
         {"method", "auth.getToken"},
     };
+    const std::string url = lastfm::request::signedUrl(lastfm::request::DEFAULT_API_BASE_URL, params, apiSecret);
 
-    std::string sig;
-    for (const auto& kv : params)
-    {
-        sig += kv.first;
-        sig += kv.second;
-    }
-    sig += apiSecret;
-    sig = lastfm::util::md5HexLower(sig);
-
-    pfc::string8 url;
-    url << "https://ws.audioscrobbler.com/2.0/?method=auth.getToken"
-        << "&api_key=" << apiKey.c_str() << "&api_sig=" << sig.c_str() << "&format=json";
-
-    pfc::string8 body;
+    std::string body;
     std::string httpError;
-    if (!lastfm::util::httpGetToString(url, body, httpError))
+    if (!lastfmFb2kHttpTransport().request("GET", url, body, httpError))
     {
         LFM_INFO("auth.getToken request failed: " << (httpError.empty() ? "unknown error" : httpError.c_str()));
         return false;
@@ -69,7 +56,7 @@ bool beginAuth(std::string& outAuthUrl)
     std::string token;
     if (!lastfm::util::jsonFindStringValue(body.c_str(), "token", token) || token.empty())
     {
-        LFM_INFO("auth.getToken: token not found. (response omitted, size=" << body.get_length() << ")");
+        LFM_INFO("auth.getToken: token not found. (response omitted, size=" << body.size() << ")");
         return false;
     }
 
@@ -102,29 +89,16 @@ bool completeAuthFromCallbackUrl(const std::string& callbackUrl, LastfmAuthState
         return false;
     }
 
-    std::map<std::string, std::string> params = {
+    const lastfm::request::Params params = {
         {"api_key", apiKey},
         {"method", "auth.getSession"},
         {"token", lastfmPendingToken},
     };
+    const std::string url = lastfm::request::signedUrl(lastfm::request::DEFAULT_API_BASE_URL, params, apiSecret);
 
-    std::string sig;
-    for (const auto& kv : params)
-    {
-        sig += kv.first;
-        sig += kv.second;
-    }
-    sig += apiSecret;
-    sig = lastfm::util::md5HexLower(sig);
-
-    pfc::string8 url;
-    url << "https://ws.audioscrobbler.com/2.0/?method=auth.getSession"
-        << "&api_key=" << apiKey.c_str() << "&api_sig=" << sig.c_str() << "&token=" << lastfmPendingToken.c_str()
-        << "&format=json";
-
-    pfc::string8 body;
+    std::string body;
     std::string httpError;
-    if (!lastfm::util::httpGetToString(url, body, httpError))
+    if (!lastfmFb2kHttpTransport().request("GET", url, body, httpError))
     {
         LFM_INFO("auth.getSession request failed: " << (httpError.empty() ? "unknown error" : httpError.c_str()));
         return false;
@@ -135,12 +109,12 @@ bool completeAuthFromCallbackUrl(const std::string& callbackUrl, LastfmAuthState
 
     if (!lastfm::util::jsonFindStringValue(body.c_str(), "name", name) || name.empty())
     {
-        LFM_INFO("auth.getSession: username not found. (response omitted, size=" << body.get_length() << ")");
+        LFM_INFO("auth.getSession: username not found. (response omitted, size=" << body.size() << ")");
         return false;
     }
     if (!lastfm::util::jsonFindStringValue(body.c_str(), "key", key) || key.empty())
     {
-        LFM_INFO("auth.getSession: session key not found. (response omitted, size=" << body.get_length() << ")");
+        LFM_INFO("auth.getSession: session key not found. (response omitted, size=" << body.size() << ")");
         return false;
     }
 
@@ -0,0 +1,213 @@
+//
+//  lastfm_backfill.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "lastfm_backfill.h"
+#include "lastfm_rules.h"
+#include "lastfm_util.h"
+#include "debug.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+// Pauses while a track plays still end in one counted play.
+static constexpr std::time_t K_COUNTED_SLACK_SECONDS = 10 * 60;
+
+// Clock adjustments between the scrobble and the statistics write.
+static constexpr std::time_t K_CLOCK_SLACK_SECONDS = 60;
+} // namespace
+
+std::time_t lastfmParsePlayStatsTime(const char* text)
+{
+    if (!text || !*text)
+        return 0;
+
+    int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+    if (std::sscanf(text, "%4d-%2d-%2d %2d:%2d:%2d", &year, &month, &day, &hour, &minute, &second) != 6)
+        return 0;
+    if (year < 1971 || month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60)
+        return 0;
+
+    std::tm tm{};
+    tm.tm_year = year - 1900;
+    tm.tm_mon = month - 1;
+    tm.tm_mday = day;
+    tm.tm_hour = hour;
+    tm.tm_min = minute;
+    tm.tm_sec = second;
+    tm.tm_isdst = -1;
+    const std::time_t t = std::mktime(&tm);
+    return t > 0 ? t : 0;
+}
+
+LastfmBackfill::LastfmBackfill(LastfmQueue& queue, LastfmBackfillOptions options)
+    : queue_(queue), options_(std::move(options))
+{
+    if (options_.chunkSize == 0)
+        options_.chunkSize = 1;
+
+    queue_.collectPlayKeys(seen_);
+    queue_.collectTrackStarts(starts_);
+    chunk_.reserve(options_.chunkSize);
+}
+
+void LastfmBackfill::addScrobbled(const std::string& artist, const std::string& title, std::time_t start)
+{
+    starts_.emplace_back(lastfm::util::trackKey(artist, title), start);
+    sorted_ = false;
+}
+
+bool LastfmBackfill::add(const std::vector<LastfmBackfillItem>& items)
+{
+    if (r_.cancelled)
+        return false;
+
+    if (!sorted_)
+    {
+        std::sort(starts_.begin(), starts_.end());
+        sorted_ = true;
+    }
+
+    for (const LastfmBackfillItem& item : items)
+    {
+        if (options_.cancelled && options_.cancelled())
+        {
+            r_.cancelled = true;
+            return false;
+        }
+
+        ++r_.items;
+        if (item.lastPlayed <= 0)
+        {
+            ++r_.neverPlayed;
+            continue;
+        }
+        if (item.track.durationSeconds > 0.0 &&
+            item.track.durationSeconds < LastfmScrobbleConfig::MIN_TRACK_DURATION_SECONDS)
+        {
+            ++r_.tooShort;
+            continue;
+        }
+        if (options_.accept && !options_.accept(item.track))
+        {
+            ++r_.excluded;
+            continue;
+        }
+
+        std::uint32_t dated = 1;
+        offer(item, item.lastPlayed);
+        if (item.playCount > 1 && item.firstPlayed > 0 && item.firstPlayed < item.lastPlayed)
+        {
+            ++dated;
+            offer(item, item.firstPlayed);
+        }
+        if (item.playCount > dated)
+            r_.undated += item.playCount - dated;
+    }
+    return true;
+}
+
+void LastfmBackfill::offer(const LastfmBackfillItem& item, std::time_t timestamp)
+{
+    if (options_.notBefore > 0 && timestamp < options_.notBefore)
+    {
+        ++r_.tooOld;
+        return;
+    }
+
+    const std::uint64_t key = lastfm::util::playKey(timestamp, item.track.artist, item.track.title);
+    if (seen_.contains(key) || nearScrobbled(item.track, timestamp))
+    {
+        ++r_.duplicates;
+        return;
+    }
+    seen_.insert(key);
+
+    LastfmQueue::NewScrobble s;
+    s.track = item.track;
+    s.playbackSeconds = item.track.durationSeconds;
+    s.startTimestamp = timestamp;
+    chunk_.push_back(std::move(s));
+
+    if (chunk_.size() >= options_.chunkSize)
+        flush();
+}
+
+bool LastfmBackfill::nearScrobbled(const LastfmTrackInfo& track, std::time_t counted) const
+{
+    if (starts_.empty())
+        return false;
+
+    if (nearScrobbledKey(lastfm::util::trackKey(track.artist, track.title), counted, track.durationSeconds))
+        return true;
+    if (!options_.corrections)
+        return false;
+
+    std::string artist = track.artist;
+    std::string title = track.title;
+    return options_.corrections->apply(artist, title) &&
+           nearScrobbledKey(lastfm::util::trackKey(artist, title), counted, track.durationSeconds);
+}
+
+bool LastfmBackfill::nearScrobbledKey(std::uint64_t trackKey, std::time_t counted, double durationSeconds) const
+{
+    const std::time_t length = durationSeconds > 0.0 ? static_cast<std::time_t>(durationSeconds) : 0;
+    const std::pair<std::uint64_t, std::time_t> from{trackKey, counted - length - K_COUNTED_SLACK_SECONDS};
+
+    const auto it = std::lower_bound(starts_.begin(), starts_.end(), from);
+    return it != starts_.end() && it->first == trackKey && it->second <= counted + K_CLOCK_SLACK_SECONDS;
+}
+
+void LastfmBackfill::flush()
+{
+    if (chunk_.empty())
+        return;
+    LastfmQueue::Refusals refused;
+    r_.queued += queue_.queueScrobblesForRetry(chunk_, &refused, options_.lastfmNotBefore);
+    r_.duplicates += refused.alreadyScrobbled;
+    r_.tooOld += refused.tooOld;
+    r_.notQueued += refused.noSink + refused.invalid;
+    chunk_.clear();
+}
+
+LastfmBackfillResult LastfmBackfill::finish()
+{
+    if (!r_.cancelled)
+        flush();
+    chunk_.clear();
+    r_.ok = !r_.cancelled;
+
+    LFM_INFO("Backfill: " << lastfmDescribeBackfill(r_).c_str());
+    return r_;
+}
+
+std::string lastfmDescribeBackfill(const LastfmBackfillResult& r)
+{
+    std::string s = r.cancelled ? "Backfill cancelled: queued " : "Backfill queued ";
+    s += std::to_string(r.queued) + " play(s) from " + std::to_string(r.items) + " library item(s)";
+
+    const std::pair<std::uint64_t, const char*> parts[] = {{r.duplicates, "already scrobbled"},
+                                                           {r.tooOld, "too old to scrobble"},
+                                                           {r.undated, "earlier plays without a date"},
+                                                           {r.neverPlayed, "items never played"},
+                                                           {r.tooShort, "too short"},
+                                                           {r.excluded, "excluded"},
+                                                           {r.notQueued, "not queued (not logged in)"}};
+
+    std::string details;
+    for (const auto& p : parts)
+    {
+        if (p.first == 0)
+            continue;
+        details += details.empty() ? "" : ", ";
+        details += std::to_string(p.first) + " " + p.second;
+    }
+    if (!details.empty())
+        s += " (" + details + ")";
+    return s + ".";
+}
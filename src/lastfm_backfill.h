@@ -0,0 +1,118 @@
+//
+//  lastfm_backfill.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "lastfm_key_set.h"
+#include "lastfm_queue.h"
+#include "lastfm_track_info.h"
+
+// One library item with foobar2000's playback statistics (%play_count%, %first_played%, %last_played%).
+struct LastfmBackfillItem
+{
+    LastfmTrackInfo track;
+    std::uint32_t playCount = 0;
+    std::time_t firstPlayed = 0; // UTC, 0 when not recorded
+    std::time_t lastPlayed = 0;
+};
+
+// "YYYY-MM-DD HH:MM:SS" in local time, as the statistics fields are formatted; 0 if empty or not a time.
+std::time_t lastfmParsePlayStatsTime(const char* text);
+
+struct LastfmBackfillOptions
+{
+    // Plays kept in memory before they are handed to the queue; each chunk is one queue save.
+    std::size_t chunkSize = 5000;
+
+    // Optional: false drops the item (exclusion rules).
+    std::function<bool(const LastfmTrackInfo&)> accept;
+
+    // Optional: names are matched in Last.fm's spelling as well, the one delivered plays were recorded in.
+    ILastfmCorrections* corrections = nullptr;
+
+    // Plays before this are counted as too old and not queued (0 = no limit).
+    std::time_t notBefore = 0;
+
+    // Plays before this are queued for the other sinks only (see LastfmQueue::queueScrobblesForRetry).
+    std::time_t lastfmNotBefore = 0;
+
+    // Optional: polled once per item; true stops the backfill after the chunks already queued.
+    std::function<bool()> cancelled;
+};
+
+struct LastfmBackfillResult
+{
+    bool ok = false;
+    bool cancelled = false;
+
+    std::uint64_t items = 0;
+    std::uint64_t neverPlayed = 0; // no last played time
+    std::uint64_t queued = 0;
+    std::uint64_t duplicates = 0;  // already scrobbled or already pending
+    std::uint64_t tooShort = 0;    // under the minimum track length
+    std::uint64_t excluded = 0;
+    std::uint64_t tooOld = 0;      // before notBefore, or before lastfmNotBefore with no other sink ready
+    std::uint64_t undated = 0;     // plays counted by %play_count% without a time of their own
+    std::uint64_t notQueued = 0;   // no sink was ready when the chunk was handed over
+};
+
+// Turns playback statistics into plays: the last played time always, the first played time as well when the
+// item was played more than once. Plays in between have no time and are only counted (undated).
+//
+// The statistics record when foobar2000 counted a play, somewhere between its start and its end, while a
+// scrobble carries the start. A statistics time up to a track length plus pauses after a scrobbled or pending
+// start of the same track is therefore taken to be that play.
+class LastfmBackfill
+{
+  public:
+    // Pending queue entries are collected here; add what was scrobbled before with addScrobbled().
+    explicit LastfmBackfill(LastfmQueue& queue, LastfmBackfillOptions options = {});
+
+    LastfmBackfill(const LastfmBackfill&) = delete;
+    LastfmBackfill& operator=(const LastfmBackfill&) = delete;
+
+    // A play already scrobbled (history). Call before the first add().
+    void addScrobbled(const std::string& artist, const std::string& title, std::time_t start);
+
+    // Items in any order, over any number of calls; full chunks go to the queue on the way. False once
+    // cancelled.
+    bool add(const std::vector<LastfmBackfillItem>& items);
+
+    // Queues the last partial chunk unless cancelled.
+    LastfmBackfillResult finish();
+
+    const LastfmBackfillResult& progress() const
+    {
+        return r_;
+    }
+
+  private:
+    void offer(const LastfmBackfillItem& item, std::time_t timestamp);
+    bool nearScrobbled(const LastfmTrackInfo& track, std::time_t counted) const;
+    bool nearScrobbledKey(std::uint64_t trackKey, std::time_t counted, double durationSeconds) const;
+    void flush();
+
+    LastfmQueue& queue_;
+    LastfmBackfillOptions options_;
+    LastfmBackfillResult r_;
+
+    std::vector<std::pair<std::uint64_t, std::time_t>> starts_; // (trackKey, start), sorted on first add()
+    bool sorted_ = false;
+    LastfmPlayKeySet seen_; // play keys pending or taken so far
+    std::vector<LastfmQueue::NewScrobble> chunk_;
+};
+
+// One-line summary for the console or a popup.
+std::string lastfmDescribeBackfill(const LastfmBackfillResult& r);
@@ -0,0 +1,182 @@
+//
+//  lastfm_backfill_library.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "lastfm_backfill_library.h"
+#include "lastfm_settings.h"
+#include "lastfm_titleformat.h"
+#include "lastfm_tracker.h"
+#include "lastfm_util.h"
+#include "debug.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace
+{
+// Playback statistics and the MusicBrainz id in one format_title() call, joined by a unit separator (0x1F).
+static constexpr const char* K_PLAY_STATS_TF =
+    "[%play_count%]\x1f[%first_played%]\x1f[%last_played%]\x1f[%musicbrainz_trackid%]";
+static constexpr std::size_t K_PLAY_STATS_FIELDS = 4;
+
+// Chunks read ahead of the caller per worker: keeps the workers busy while the caller saves the queue, without
+// holding the whole library in memory.
+static constexpr std::size_t K_READ_AHEAD_PER_THREAD = 2;
+
+static void readPlayStats(const metadb_handle_ptr& track, const LastfmSettings& settings,
+                          const LastfmTitleformatSet& tf, const service_ptr_t<titleformat_object>& statsScript,
+                          LastfmBackfillItem& out)
+{
+    lastfmFillTrackInfo(settings, tf, track, out.track);
+
+    // Library items are local files: the tracker's "Artist - Title" split applies.
+    if (out.track.artist.empty() && !out.track.title.empty())
+    {
+        std::string a, t;
+        if (lastfm::util::parseArtistTitleFromCombined(out.track.title, a, t))
+        {
+            out.track.artist = std::move(a);
+            out.track.title = std::move(t);
+        }
+    }
+    out.track.durationSeconds = track->get_length();
+
+    pfc::string8 text;
+    if (statsScript.is_valid())
+        track->format_title(nullptr, text, statsScript, nullptr);
+
+    std::string fields[K_PLAY_STATS_FIELDS];
+    std::size_t field = 0;
+    for (const char* p = text.c_str(); *p; ++p)
+    {
+        if (*p == '\x1f')
+        {
+            if (++field == K_PLAY_STATS_FIELDS)
+                break;
+            continue;
+        }
+        fields[field].push_back(*p);
+    }
+
+    out.playCount = static_cast<std::uint32_t>(std::strtoul(fields[0].c_str(), nullptr, 10));
+    out.firstPlayed = lastfmParsePlayStatsTime(fields[1].c_str());
+    out.lastPlayed = lastfmParsePlayStatsTime(fields[2].c_str());
+    out.track.mbid = lastfm::util::cleanTagValue(fields[3].c_str());
+}
+} // namespace
+
+bool lastfmReadPlayStats(const metadb_handle_list& items, std::size_t threads, std::size_t chunkSize,
+                         const std::function<void(const std::vector<LastfmBackfillItem>& chunk, std::size_t read)>&
+                             onChunk,
+                         const std::function<bool()>& cancelled)
+{
+    const std::size_t total = items.get_count();
+    chunkSize = std::max<std::size_t>(chunkSize, 1);
+    const std::size_t chunkCount = (total + chunkSize - 1) / chunkSize;
+    if (chunkCount == 0)
+        return true;
+    threads = std::min(std::max<std::size_t>(threads, 1), chunkCount);
+
+    // One snapshot and one compiled expression set for the whole scan, shared by the workers.
+    const std::shared_ptr<const LastfmSettings> snapshot = lastfmSettings();
+    const LastfmSettings& settings = *snapshot;
+    const std::shared_ptr<const LastfmTitleformatSet> tf =
+        LastfmTitleformatSet::get(settings.artistTf, settings.albumArtistTf, settings.titleTf, settings.albumTf);
+    service_ptr_t<titleformat_object> statsScript;
+    static_api_ptr_t<titleformat_compiler>()->compile_safe(statsScript, K_PLAY_STATS_TF);
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<std::vector<LastfmBackfillItem>> chunks(chunkCount);
+    std::vector<bool> ready(chunkCount, false);
+    std::size_t next = 0;     // next chunk to read
+    std::size_t consumed = 0; // chunks handed to onChunk
+    bool stop = false;
+    const std::size_t window = threads * K_READ_AHEAD_PER_THREAD;
+
+    const auto worker = [&]
+    {
+        for (;;)
+        {
+            std::size_t c = 0;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&] { return stop || next >= chunkCount || next < consumed + window; });
+                if (stop || next >= chunkCount)
+                    return;
+                c = next++;
+            }
+
+            const std::size_t begin = c * chunkSize;
+            const std::size_t end = std::min(begin + chunkSize, total);
+            std::vector<LastfmBackfillItem> out(end - begin);
+            try
+            {
+                for (std::size_t i = begin; i < end; ++i)
+                    readPlayStats(items[i], settings, *tf, statsScript, out[i - begin]);
+            }
+            catch (const std::exception& e)
+            {
+                LFM_INFO("Backfill: reading library items failed: " << e.what());
+                out.clear();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                chunks[c] = std::move(out);
+                ready[c] = true;
+            }
+            cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    for (std::size_t t = 0; t < threads; ++t)
+        pool.emplace_back(worker);
+
+    bool finished = true;
+    for (std::size_t c = 0; c < chunkCount; ++c)
+    {
+        if (cancelled && cancelled())
+        {
+            finished = false;
+            break;
+        }
+
+        std::vector<LastfmBackfillItem> chunk;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return ready[c]; });
+            chunk = std::move(chunks[c]);
+        }
+
+        onChunk(chunk, std::min((c + 1) * chunkSize, total));
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            consumed = c + 1;
+        }
+        cv.notify_all();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    cv.notify_all();
+    for (auto& t : pool)
+        t.join();
+
+    LFM_DEBUG("Backfill: read " << (unsigned)total << " library item(s) on " << (unsigned)threads << " thread(s)");
+    return finished;
+}
@@ -0,0 +1,25 @@
+//
+//  lastfm_backfill_library.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <foobar2000/SDK/foobar2000.h>
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "lastfm_backfill.h"
+
+// Track info (read as the tracker reads it) and playback statistics of `items`, on `threads` worker threads,
+// `chunkSize` handles at a time. Workers stay a few chunks ahead of the caller, who gets the chunks in list order
+// through onChunk with the number of handles read so far. cancelled() is polled between chunks; false when it
+// stopped the scan. metadb reads only, so any thread may call it.
+bool lastfmReadPlayStats(const metadb_handle_list& items, std::size_t threads, std::size_t chunkSize,
+                         const std::function<void(const std::vector<LastfmBackfillItem>& chunk, std::size_t read)>&
+                             onChunk,
+                         const std::function<bool()>& cancelled);
@@ -0,0 +1,160 @@
+//
+//  lastfm_budget.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "lastfm_budget.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace
+{
+// YYYYMMDD of the local day containing t; dayEnd receives the following local midnight.
+static int localDayStamp(ILastfmClock& clock, std::time_t t, std::time_t& dayEnd)
+{
+    std::tm tm{};
+    clock.toCalendar(t, tm);
+
+    const int stamp = (tm.tm_year + 1900) * 10000 + (tm.tm_mon + 1) * 100 + tm.tm_mday;
+
+    std::tm next = tm;
+    next.tm_mday += 1;
+    next.tm_hour = 0;
+    next.tm_min = 0;
+    next.tm_sec = 0;
+    next.tm_isdst = -1;
+    dayEnd = clock.fromCalendar(next);
+    if (dayEnd <= t)
+        dayEnd = t + LastfmBudget::SECONDS_PER_DAY;
+
+    return stamp;
+}
+} // namespace
+
+void LastfmBudget::loadLocked()
+{
+    if (loaded_)
+        return;
+
+    limit_ = config_.getInt(lastfm::config::DAILY_BUDGET, lastfm::config::DEFAULT_DAILY_BUDGET);
+    dayStamp_ = static_cast<int>(config_.getInt(lastfm::config::DAY_STAMP, 0));
+    usedToday_.store(config_.getInt(lastfm::config::SCROBBLES_TODAY, 0), std::memory_order_relaxed);
+    dayEnd_ = 0;
+    tokens_ = static_cast<double>(hourlyCapacityLocked());
+    lastRefill_ = 0;
+    loaded_ = true;
+}
+
+void LastfmBudget::rollDayIfNeededLocked(std::time_t now)
+{
+    loadLocked();
+
+    if (now < dayEnd_)
+        return;
+
+    const int stamp = localDayStamp(clock_, now, dayEnd_);
+    if (stamp != dayStamp_)
+    {
+        dayStamp_ = stamp;
+        usedToday_.store(0, std::memory_order_relaxed);
+        dirty_ = true;
+    }
+}
+
+int64_t LastfmBudget::hourlyCapacityLocked() const
+{
+    if (limit_ <= 0)
+        return 0;
+    return std::max<int64_t>(1, (limit_ + HOURS_PER_DAY - 1) / HOURS_PER_DAY);
+}
+
+void LastfmBudget::refillLocked(std::time_t now)
+{
+    if (limit_ <= 0)
+        return;
+
+    const double capacity = static_cast<double>(hourlyCapacityLocked());
+
+    if (lastRefill_ == 0 || now < lastRefill_)
+    {
+        lastRefill_ = now;
+        return;
+    }
+
+    const double perSecond = static_cast<double>(limit_) / static_cast<double>(SECONDS_PER_DAY);
+    tokens_ = std::min(capacity, tokens_ + static_cast<double>(now - lastRefill_) * perSecond);
+    lastRefill_ = now;
+}
+
+int64_t LastfmBudget::available(std::time_t now)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    rollDayIfNeededLocked(now);
+
+    if (limit_ <= 0)
+        return INT64_MAX;
+
+    const int64_t dayLeft = std::max<int64_t>(0, limit_ - usedToday_.load(std::memory_order_relaxed));
+    refillLocked(now);
+
+    return std::min(dayLeft, static_cast<int64_t>(tokens_));
+}
+
+void LastfmBudget::consume(std::time_t now, int64_t n)
+{
+    if (n <= 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    rollDayIfNeededLocked(now);
+
+    usedToday_.fetch_add(n, std::memory_order_relaxed);
+    dirty_ = true;
+
+    if (limit_ > 0)
+    {
+        refillLocked(now);
+        tokens_ = std::max(0.0, tokens_ - static_cast<double>(n));
+    }
+}
+
+std::time_t LastfmBudget::secondsUntilAvailable(std::time_t now)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    rollDayIfNeededLocked(now);
+
+    if (limit_ <= 0)
+        return 0;
+
+    if (usedToday_.load(std::memory_order_relaxed) >= limit_)
+        return std::max<std::time_t>(1, dayEnd_ - now);
+
+    refillLocked(now);
+    if (tokens_ >= 1.0)
+        return 0;
+
+    const double perSecond = static_cast<double>(limit_) / static_cast<double>(SECONDS_PER_DAY);
+    return static_cast<std::time_t>(std::ceil((1.0 - tokens_) / perSecond));
+}
+
+int64_t LastfmBudget::dailyLimit()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    loadLocked();
+    return limit_;
+}
+
+void LastfmBudget::persistIfDirty()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!dirty_)
+        return;
+
+    config_.setInt(lastfm::config::DAY_STAMP, dayStamp_);
+    config_.setInt(lastfm::config::SCROBBLES_TODAY, usedToday_.load(std::memory_order_relaxed));
+    dirty_ = false;
+}
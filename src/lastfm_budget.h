@@ -0,0 +1,75 @@
+//
+//  lastfm_budget.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+
+#include "lastfm_clock.h"
+#include "lastfm_config_store.h"
+
+// Daily scrobble budget accounting.
+// The counter lives in memory; the config store is read once and written back only together with the queue's
+// durable save.
+// On top of the daily cap, an hourly token bucket spreads a large backlog over the day.
+class LastfmBudget
+{
+  public:
+    static constexpr int64_t HOURS_PER_DAY = 24;
+    static constexpr int64_t SECONDS_PER_DAY = 24 * 60 * 60;
+
+    // The clock only decides where day boundaries fall; callers pass `now`.
+    explicit LastfmBudget(ILastfmConfigStore& config, ILastfmClock& clock = lastfmSystemClock())
+        : config_(config), clock_(clock)
+    {
+    }
+
+    // Scrobbles that may be sent right now (INT64_MAX when unlimited).
+    int64_t available(std::time_t now);
+    bool exhausted(std::time_t now)
+    {
+        return available(now) <= 0;
+    }
+
+    // Account for n accepted scrobbles.
+    void consume(std::time_t now, int64_t n = 1);
+
+    // Seconds until the next token becomes available (0 if one is available now).
+    std::time_t secondsUntilAvailable(std::time_t now);
+
+    int64_t dailyLimit();
+    int64_t usedToday() const
+    {
+        return usedToday_.load(std::memory_order_relaxed);
+    }
+
+    // Write counter + day stamp to the config store if they changed. Call from the queue's durable save only.
+    void persistIfDirty();
+
+  private:
+    void loadLocked();
+    void rollDayIfNeededLocked(std::time_t now);
+    void refillLocked(std::time_t now);
+    int64_t hourlyCapacityLocked() const;
+
+    ILastfmConfigStore& config_;
+    ILastfmClock& clock_;
+    std::mutex mutex_;
+    bool loaded_ = false;
+    int64_t limit_ = 0;
+    int dayStamp_ = 0;
+    std::time_t dayEnd_ = 0; // local midnight after dayStamp_
+    std::atomic<int64_t> usedToday_{0};
+    bool dirty_ = false;
+
+    // Hourly bucket (memory only)
+    double tokens_ = 0.0;
+    std::time_t lastRefill_ = 0;
+};
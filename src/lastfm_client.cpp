@@ -7,7 +7,33 @@
 
 #include "lastfm_client.h"
 #include "lastfm_auth.h"
+#include "lastfm_no.h"
+#include "lastfm_platform_fb2k.h"
 #include "lastfm_state.h"
+#include "lastfm_ui.h"
+
+namespace
+{
+static LastfmApiCredentials pluginCredentials()
+{
+    LastfmApiCredentials c;
+    c.apiKey = __key();
+    c.apiSecret = __sec();
+
+    const LastfmAuthState state = getAuthState();
+    if (state.isAuthenticated)
+    {
+        c.sessionKey = state.sessionKey;
+        c.username = state.username;
+    }
+
+    return c;
+}
+} // namespace
+
+LastfmClient::LastfmClient() : api(lastfmFb2kHttpTransport(), &pluginCredentials)
+{
+}
 
 bool LastfmClient::isSuspended() const
 {
@@ -30,6 +56,18 @@ LastfmScrobbleResult LastfmClient::scrobble(const LastfmTrackInfo& track, double
     return api.scrobble(track, playbackSeconds, startTimestamp);
 }
 
+LastfmScrobbleResult LastfmClient::trackCorrection(const std::string& artist, const std::string& title,
+                                                   LastfmCorrection& out)
+{
+    return api.trackCorrection(artist, title, out);
+}
+
+LastfmScrobbleResult LastfmClient::trackUserData(const std::string& artist, const std::string& title,
+                                                 LastfmTrackUserData& out)
+{
+    return api.trackUserData(artist, title, out);
+}
+
 bool LastfmClient::startAuth(std::string& outUrl)
 {
     return beginAuth(outUrl);
@@ -11,22 +11,33 @@
 #include <ctime>
 
 #include "lastfm_auth_api.h"
+#include "lastfm_scrobble_api.h"
 #include "lastfm_track_info.h"
 #include "lastfm_scrobble_result.h"
 #include "lastfm_web_api.h"
 
-class LastfmClient final : public ILastfmAuthApi
+class LastfmClient final : public ILastfmAuthApi, public ILastfmScrobbleApi
 {
   public:
-    LastfmClient() = default;
+    LastfmClient();
 
     // Auth state (from cfg via lastfm_ui)
-    bool isAuthenticated() const;
-    bool isSuspended() const;
+    bool isAuthenticated() const override;
+    bool isSuspended() const override;
 
     // Web API (thin wrappers)
-    bool updateNowPlaying(const LastfmTrackInfo& track);
-    LastfmScrobbleResult scrobble(const LastfmTrackInfo& track, double playbackSeconds, std::time_t startTimestamp);
+    bool updateNowPlaying(const LastfmTrackInfo& track) override;
+    LastfmScrobbleResult scrobble(const LastfmTrackInfo& track, double playbackSeconds,
+                                  std::time_t startTimestamp) override;
+    LastfmScrobbleResult trackCorrection(const std::string& artist, const std::string& title,
+                                         LastfmCorrection& out) override;
+    LastfmScrobbleResult trackUserData(const std::string& artist, const std::string& title, LastfmTrackUserData& out);
+
+    // Corrections reported by scrobble and Now Playing responses go there (nullptr to stop).
+    void setCorrections(ILastfmCorrections* corrections)
+    {
+        api.setCorrections(corrections);
+    }
 
     // ILastfmAuthApi
     bool startAuth(std::string& outUrl) override;
@@ -0,0 +1,194 @@
+//
+//  lastfm_clock.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "lastfm_clock.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+class SystemClock final : public ILastfmClock
+{
+  public:
+    SteadyTime now() override
+    {
+        return std::chrono::steady_clock::now();
+    }
+
+    std::time_t wallNow() override
+    {
+        return std::time(nullptr);
+    }
+
+    void toCalendar(std::time_t t, std::tm& out) override
+    {
+#if defined(_WIN32)
+        localtime_s(&out, &t);
+#else
+        localtime_r(&t, &out);
+#endif
+    }
+
+    std::time_t fromCalendar(std::tm& tm) override
+    {
+        return std::mktime(&tm);
+    }
+
+    void sleepFor(std::chrono::milliseconds d) override
+    {
+        std::this_thread::sleep_for(d);
+    }
+
+    void waitUntil(std::unique_lock<std::mutex>& lock, std::condition_variable& cv, SteadyTime deadline,
+                   const std::function<bool()>& pred) override
+    {
+        if (deadline == SteadyTime::max())
+            cv.wait(lock, pred);
+        else
+            cv.wait_until(lock, deadline, pred);
+    }
+
+    void notify(std::condition_variable& cv) override
+    {
+        cv.notify_one();
+    }
+};
+
+// Steady epoch of a virtual clock: far from time_point::min(), which callers use as "never".
+static constexpr std::chrono::hours K_VIRTUAL_EPOCH{24};
+} // namespace
+
+ILastfmClock& lastfmSystemClock()
+{
+    static SystemClock clock;
+    return clock;
+}
+
+LastfmVirtualClock::LastfmVirtualClock(std::time_t wallStart)
+    : start_(SteadyTime(K_VIRTUAL_EPOCH)), wallStart_(wallStart), now_(start_)
+{
+}
+
+void LastfmVirtualClock::setParticipants(unsigned n)
+{
+    std::lock_guard<std::mutex> l(mutex_);
+    participants_ = n;
+    idle_.notify_all();
+}
+
+bool LastfmVirtualClock::runnableLocked(const Waiter& w) const
+{
+    return released_ || w.deadline <= now_ || (w.notifiable && w.seenGeneration != generation_);
+}
+
+bool LastfmVirtualClock::quiescentLocked() const
+{
+    if (blocked_.size() < participants_)
+        return false;
+    return std::none_of(blocked_.begin(), blocked_.end(), [this](const Waiter* w) { return runnableLocked(*w); });
+}
+
+void LastfmVirtualClock::blockLocked(std::unique_lock<std::mutex>& l, Waiter& w)
+{
+    blocked_.push_back(&w);
+    idle_.notify_all();
+    wake_.wait(l, [&]() { return runnableLocked(w); });
+    blocked_.erase(std::find(blocked_.begin(), blocked_.end(), &w));
+}
+
+bool LastfmVirtualClock::advance(SteadyTime limit)
+{
+    std::unique_lock<std::mutex> l(mutex_);
+    idle_.wait(l, [this]() { return released_ || quiescentLocked(); });
+
+    SteadyTime next = limit;
+    for (const Waiter* w : blocked_)
+        next = std::min(next, w->deadline);
+
+    if (next > now_)
+        now_ = next;
+    wake_.notify_all();
+    return now_ < limit;
+}
+
+void LastfmVirtualClock::release()
+{
+    std::lock_guard<std::mutex> l(mutex_);
+    released_ = true;
+    wake_.notify_all();
+    idle_.notify_all();
+}
+
+ILastfmClock::SteadyTime LastfmVirtualClock::now()
+{
+    std::lock_guard<std::mutex> l(mutex_);
+    return now_;
+}
+
+std::time_t LastfmVirtualClock::wallNow()
+{
+    std::lock_guard<std::mutex> l(mutex_);
+    const auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now_ - start_);
+    return wallStart_ + static_cast<std::time_t>(elapsed.count());
+}
+
+void LastfmVirtualClock::toCalendar(std::time_t t, std::tm& out)
+{
+#if defined(_WIN32)
+    gmtime_s(&out, &t);
+#else
+    gmtime_r(&t, &out);
+#endif
+}
+
+std::time_t LastfmVirtualClock::fromCalendar(std::tm& tm)
+{
+#if defined(_WIN32)
+    return _mkgmtime(&tm);
+#else
+    return timegm(&tm);
+#endif
+}
+
+void LastfmVirtualClock::sleepFor(std::chrono::milliseconds d)
+{
+    std::unique_lock<std::mutex> l(mutex_);
+    Waiter w;
+    w.deadline = now_ + d;
+    blockLocked(l, w);
+}
+
+void LastfmVirtualClock::waitUntil(std::unique_lock<std::mutex>& lock, std::condition_variable&, SteadyTime deadline,
+                                   const std::function<bool()>& pred)
+{
+    // The caller's lock is held from pred() until we are registered, so a state change it guards cannot
+    // slip between the check and the wait; the matching notify() finds us blocked or bumps the generation first.
+    while (!pred())
+    {
+        std::unique_lock<std::mutex> l(mutex_);
+        if (released_ || now_ >= deadline)
+            return;
+
+        Waiter w;
+        w.deadline = deadline;
+        w.notifiable = true;
+        w.seenGeneration = generation_;
+
+        lock.unlock();
+        blockLocked(l, w);
+        l.unlock();
+        lock.lock();
+    }
+}
+
+void LastfmVirtualClock::notify(std::condition_variable&)
+{
+    std::lock_guard<std::mutex> l(mutex_);
+    ++generation_;
+    wake_.notify_all();
+}
@@ -0,0 +1,105 @@
+//
+//  lastfm_clock.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Time source and sleeper for the worker, queue and budget. The plugin uses lastfmSystemClock(); the drain
+// simulator (tools/drain_sim) injects a LastfmVirtualClock so a week of backoff, cooldowns and budget days
+// runs in seconds.
+class ILastfmClock
+{
+  public:
+    using SteadyTime = std::chrono::steady_clock::time_point;
+
+    virtual ~ILastfmClock() = default;
+
+    // Monotonic time for pacing and timed commands.
+    virtual SteadyTime now() = 0;
+
+    // Wall-clock seconds: scrobble timestamps, retry schedule, rate-limit cooldown, budget day.
+    virtual std::time_t wallNow() = 0;
+
+    // Calendar conversion for wallNow() values (localtime/mktime on the system clock).
+    virtual void toCalendar(std::time_t t, std::tm& out) = 0;
+    virtual std::time_t fromCalendar(std::tm& tm) = 0;
+
+    virtual void sleepFor(std::chrono::milliseconds d) = 0;
+
+    // cv.wait_until(lock, deadline, pred) against this clock. SteadyTime::max() waits without a timeout.
+    // Waiters are only guaranteed to wake through notify() below.
+    virtual void waitUntil(std::unique_lock<std::mutex>& lock, std::condition_variable& cv, SteadyTime deadline,
+                           const std::function<bool()>& pred) = 0;
+    virtual void notify(std::condition_variable& cv) = 0;
+};
+
+ILastfmClock& lastfmSystemClock();
+
+// Discrete-event clock: time stands still while any participant thread is running and jumps to the next
+// deadline once all of them are blocked in sleepFor()/waitUntil(). Calendar conversions are UTC so runs are
+// reproducible regardless of the host time zone.
+class LastfmVirtualClock final : public ILastfmClock
+{
+  public:
+    explicit LastfmVirtualClock(std::time_t wallStart);
+
+    // Number of threads that block on this clock (the worker). Time only moves when all of them are blocked.
+    void setParticipants(unsigned n);
+
+    // Waits until every participant is blocked with nothing runnable, then moves time to the earliest
+    // deadline, or to limit if none comes sooner. Returns false once time has reached limit.
+    bool advance(SteadyTime limit);
+
+    // After release() time no longer gates anyone: sleeps and timed waits return immediately. Call before
+    // stopping the participants.
+    void release();
+
+    SteadyTime start() const
+    {
+        return start_;
+    }
+
+    SteadyTime now() override;
+    std::time_t wallNow() override;
+    void toCalendar(std::time_t t, std::tm& out) override;
+    std::time_t fromCalendar(std::tm& tm) override;
+    void sleepFor(std::chrono::milliseconds d) override;
+    void waitUntil(std::unique_lock<std::mutex>& lock, std::condition_variable& cv, SteadyTime deadline,
+                   const std::function<bool()>& pred) override;
+    void notify(std::condition_variable& cv) override;
+
+  private:
+    struct Waiter
+    {
+        SteadyTime deadline;
+        bool notifiable = false; // waitUntil: also woken by notify()
+        std::uint64_t seenGeneration = 0;
+    };
+
+    bool runnableLocked(const Waiter& w) const;
+    bool quiescentLocked() const;
+    void blockLocked(std::unique_lock<std::mutex>& l, Waiter& w);
+
+    const SteadyTime start_;
+    const std::time_t wallStart_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_; // participants
+    std::condition_variable idle_; // advance()
+    SteadyTime now_;
+    std::uint64_t generation_ = 0; // bumped by notify()
+    unsigned participants_ = 1;
+    bool released_ = false;
+    std::vector<Waiter*> blocked_;
+};
@@ -0,0 +1,139 @@
+//
+//  lastfm_config_store.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "lastfm_config_store.h"
+#include "debug.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+namespace
+{
+static void appendEscaped(std::string& out, const std::string& in)
+{
+    for (char c : in)
+    {
+        switch (c)
+        {
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            out.push_back(c);
+            break;
+        }
+    }
+}
+
+static std::string unescape(const std::string& in)
+{
+    std::string out;
+    out.reserve(in.size());
+    for (std::size_t i = 0; i < in.size(); ++i)
+    {
+        if (in[i] != '\\' || i + 1 == in.size())
+        {
+            out.push_back(in[i]);
+            continue;
+        }
+        const char e = in[++i];
+        out.push_back(e == 'n' ? '\n' : e == 't' ? '\t' : e);
+    }
+    return out;
+}
+} // namespace
+
+int64_t LastfmMemoryConfigStore::getInt(const char* key, int64_t fallback)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = values_.find(key);
+    if (it == values_.end() || it->second.empty())
+        return fallback;
+
+    char* end = nullptr;
+    const long long v = std::strtoll(it->second.c_str(), &end, 10);
+    return (end && *end == '\0') ? static_cast<int64_t>(v) : fallback;
+}
+
+void LastfmMemoryConfigStore::setInt(const char* key, int64_t value)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    values_[key] = std::to_string(static_cast<long long>(value));
+    changedLocked();
+}
+
+std::string LastfmMemoryConfigStore::getString(const char* key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = values_.find(key);
+    return it == values_.end() ? std::string() : it->second;
+}
+
+void LastfmMemoryConfigStore::setString(const char* key, const std::string& value)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    values_[key] = value;
+    changedLocked();
+}
+
+LastfmFileConfigStore::LastfmFileConfigStore(std::string path) : path_(std::move(path))
+{
+}
+
+bool LastfmFileConfigStore::load()
+{
+    std::ifstream in(path_, std::ios::binary);
+    if (!in)
+        return errno == ENOENT;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    values_.clear();
+
+    std::string line;
+    while (std::getline(in, line))
+    {
+        const std::size_t eq = line.find('=');
+        if (eq == std::string::npos || eq == 0)
+            continue;
+        values_[line.substr(0, eq)] = unescape(line.substr(eq + 1));
+    }
+    return !in.bad();
+}
+
+void LastfmFileConfigStore::changedLocked()
+{
+    std::string out;
+    for (const auto& kv : values_)
+    {
+        out += kv.first;
+        out += '=';
+        appendEscaped(out, kv.second);
+        out += '\n';
+    }
+
+    const std::string tmp = path_ + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        f.write(out.data(), static_cast<std::streamsize>(out.size()));
+        if (!f)
+        {
+            LFM_INFO("Config: cannot write " << tmp.c_str());
+            return;
+        }
+    }
+
+    if (std::rename(tmp.c_str(), path_.c_str()) != 0)
+        LFM_INFO("Config: cannot replace " << path_.c_str());
+}
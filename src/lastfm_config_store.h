@@ -0,0 +1,85 @@
+//
+//  lastfm_config_store.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace lastfm
+{
+namespace config
+{
+// Persisted core state. The fb2k store maps each key onto its cfg_* variable (GUIDs unchanged).
+inline constexpr const char* PENDING_SCROBBLES = "queue.pending";
+inline constexpr const char* DRAIN_COOLDOWN_SECONDS = "queue.drainCooldownSeconds";
+inline constexpr const char* DRAIN_ENABLED = "queue.drainEnabled";
+inline constexpr const char* DAILY_BUDGET = "budget.dailyLimit";
+inline constexpr const char* SCROBBLES_TODAY = "budget.scrobblesToday";
+inline constexpr const char* DAY_STAMP = "budget.dayStamp";
+
+inline constexpr int64_t DEFAULT_DRAIN_COOLDOWN_SECONDS = 360; // 6 minutes
+inline constexpr int64_t DEFAULT_DRAIN_ENABLED = 1;
+inline constexpr int64_t DEFAULT_DAILY_BUDGET = 2600; // safe default
+} // namespace config
+} // namespace lastfm
+
+// Key/value storage for the queue and budget. Values not present read as the caller's fallback.
+class ILastfmConfigStore
+{
+  public:
+    virtual ~ILastfmConfigStore() = default;
+
+    virtual int64_t getInt(const char* key, int64_t fallback) = 0;
+    virtual void setInt(const char* key, int64_t value) = 0;
+    virtual std::string getString(const char* key) = 0;
+    virtual void setString(const char* key, const std::string& value) = 0;
+
+    // True once the host is tearing down; the queue stops dispatching then so nothing is written late.
+    virtual bool closing()
+    {
+        return false;
+    }
+};
+
+// Process-lifetime map; what the Linux tools use.
+class LastfmMemoryConfigStore : public ILastfmConfigStore
+{
+  public:
+    int64_t getInt(const char* key, int64_t fallback) override;
+    void setInt(const char* key, int64_t value) override;
+    std::string getString(const char* key) override;
+    void setString(const char* key, const std::string& value) override;
+
+  protected:
+    // Called with the lock held after every change.
+    virtual void changedLocked()
+    {
+    }
+
+    std::mutex mutex_;
+    std::map<std::string, std::string> values_;
+};
+
+// Memory store mirrored to a key=value text file (one entry per line, \n \t \\ escaped), rewritten through a
+// temporary file on every change. Lets a tool keep its queue across runs.
+class LastfmFileConfigStore final : public LastfmMemoryConfigStore
+{
+  public:
+    explicit LastfmFileConfigStore(std::string path);
+
+    // False if the file exists but could not be read.
+    bool load();
+
+  protected:
+    void changedLocked() override;
+
+  private:
+    std::string path_;
+};
@@ -0,0 +1,290 @@
+//
+//  lastfm_corrections.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "lastfm_corrections.h"
+#include "lastfm_util.h"
+#include "debug.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+static constexpr char K_MAGIC[7] = {'L', 'F', 'M', 'C', 'O', 'R', 'R'};
+static constexpr std::uint8_t K_VERSION = 1;
+
+// Sanity limit for one stored name.
+static constexpr std::uint64_t K_MAX_NAME = 4096;
+
+// List node, map node and bucket of one entry, on top of its strings.
+static constexpr std::size_t K_ENTRY_OVERHEAD = 96;
+
+static void putVarint(std::string& out, std::uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+static bool getVarint(const std::string& in, std::size_t& pos, std::uint64_t& v)
+{
+    v = 0;
+    for (unsigned shift = 0; shift < 64 && pos < in.size(); shift += 7)
+    {
+        const auto b = static_cast<std::uint8_t>(in[pos++]);
+        v |= static_cast<std::uint64_t>(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+static void putString(std::string& out, const std::string& s)
+{
+    putVarint(out, s.size());
+    out += s;
+}
+
+static bool getString(const std::string& in, std::size_t& pos, std::string& s)
+{
+    std::uint64_t len = 0;
+    if (!getVarint(in, pos, len) || len > K_MAX_NAME || len > in.size() - pos)
+        return false;
+    s.assign(in, pos, static_cast<std::size_t>(len));
+    pos += static_cast<std::size_t>(len);
+    return true;
+}
+} // namespace
+
+LastfmCorrections::LastfmCorrections(std::size_t budgetBytes) : budget_(budgetBytes)
+{
+}
+
+std::size_t LastfmCorrections::entryBytes(const Entry& e)
+{
+    return sizeof(Entry) + K_ENTRY_OVERHEAD + e.correction.artist.size() + e.correction.title.size();
+}
+
+bool LastfmCorrections::apply(std::string& artist, std::string& title)
+{
+    if (artist.empty() || title.empty())
+        return false;
+
+    const std::uint64_t key = lastfm::util::trackKey(artist, title);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = index_.find(key);
+    if (it == index_.end())
+    {
+        if (lookupKeys_.insert(key).second)
+        {
+            lookups_.emplace_back(artist, title);
+            if (lookups_.size() > MAX_LOOKUPS)
+            {
+                lookupKeys_.erase(lastfm::util::trackKey(lookups_.front().first, lookups_.front().second));
+                lookups_.pop_front();
+            }
+        }
+        return false;
+    }
+
+    entries_.splice(entries_.begin(), entries_, it->second);
+    const LastfmCorrection& c = it->second->correction;
+    bool changed = false;
+    if (!c.artist.empty() && c.artist != artist)
+    {
+        artist = c.artist;
+        changed = true;
+    }
+    if (!c.title.empty() && c.title != title)
+    {
+        title = c.title;
+        changed = true;
+    }
+    applied_ += changed ? 1 : 0;
+    return changed;
+}
+
+void LastfmCorrections::learn(const std::string& artist, const std::string& title, const LastfmCorrection& correction)
+{
+    if (artist.empty() || title.empty())
+        return;
+
+    // Only what differs is kept; a pair accepted as sent is stored with empty names.
+    LastfmCorrection c;
+    if (correction.artist != artist)
+        c.artist = correction.artist;
+    if (correction.title != title)
+        c.title = correction.title;
+
+    const std::uint64_t key = lastfm::util::trackKey(artist, title);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    storeLocked(key, c);
+    lookupKeys_.erase(key);
+
+    if (!c.artist.empty() || !c.title.empty())
+        LFM_DEBUG("Corrections: " << artist.c_str() << " - " << title.c_str() << " -> "
+                                  << (c.artist.empty() ? artist : c.artist).c_str() << " - "
+                                  << (c.title.empty() ? title : c.title).c_str());
+}
+
+bool LastfmCorrections::nextLookup(std::string& artist, std::string& title)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (!lookups_.empty())
+    {
+        auto next = std::move(lookups_.back());
+        lookups_.pop_back();
+
+        const std::uint64_t key = lastfm::util::trackKey(next.first, next.second);
+        if (lookupKeys_.erase(key) == 0 || index_.count(key) != 0)
+            continue;
+
+        artist = std::move(next.first);
+        title = std::move(next.second);
+        return true;
+    }
+    return false;
+}
+
+void LastfmCorrections::storeLocked(std::uint64_t key, const LastfmCorrection& correction)
+{
+    const auto it = index_.find(key);
+    if (it != index_.end())
+    {
+        Entry& e = *it->second;
+        bytes_ -= entryBytes(e);
+        corrected_ -= (!e.correction.artist.empty() || !e.correction.title.empty()) ? 1 : 0;
+        e.correction = correction;
+        entries_.splice(entries_.begin(), entries_, it->second);
+    }
+    else
+    {
+        entries_.push_front(Entry{key, correction});
+        index_.emplace(key, entries_.begin());
+    }
+
+    const Entry& e = entries_.front();
+    bytes_ += entryBytes(e);
+    corrected_ += (!e.correction.artist.empty() || !e.correction.title.empty()) ? 1 : 0;
+
+    // Over budget: least recently used first, never the entry just stored.
+    while (bytes_ > budget_ && entries_.size() > 1)
+    {
+        const Entry& old = entries_.back();
+        bytes_ -= entryBytes(old);
+        corrected_ -= (!old.correction.artist.empty() || !old.correction.title.empty()) ? 1 : 0;
+        index_.erase(old.key);
+        entries_.pop_back();
+    }
+}
+
+LastfmCorrections::Stats LastfmCorrections::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats s;
+    s.entries = entries_.size();
+    s.corrected = corrected_;
+    s.memoryBytes = bytes_;
+    s.pendingLookups = lookups_.size();
+    s.applied = applied_;
+    return s;
+}
+
+bool LastfmCorrections::load(const std::string& path, std::string& error)
+{
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f)
+    {
+        if (errno == ENOENT)
+            return true; // first run
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    std::string in;
+    char buf[64 * 1024];
+    std::size_t n = 0;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0)
+        in.append(buf, n);
+    std::fclose(f);
+
+    std::size_t pos = sizeof(K_MAGIC) + 1;
+    if (in.size() < pos || std::memcmp(in.data(), K_MAGIC, sizeof(K_MAGIC)) != 0 ||
+        static_cast<std::uint8_t>(in[sizeof(K_MAGIC)]) != K_VERSION)
+    {
+        LFM_INFO("Corrections: " << path.c_str() << " is not a corrections file, starting empty");
+        return true;
+    }
+
+    std::uint64_t count = 0;
+    if (!getVarint(in, pos, count))
+        return true;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Least recently used first, so the order survives the round trip.
+    LastfmCorrection c;
+    for (std::uint64_t e = 0; e < count; ++e)
+    {
+        if (in.size() - pos < 8)
+            break;
+        std::uint64_t key = 0;
+        for (int b = 0; b < 8; ++b)
+            key |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(in[pos++])) << (8 * b);
+
+        if (!getString(in, pos, c.artist) || !getString(in, pos, c.title))
+            break;
+        storeLocked(key, c);
+    }
+
+    LFM_DEBUG("Corrections: " << (unsigned)entries_.size() << " entries loaded, " << (unsigned)corrected_
+                              << " corrected");
+    return true;
+}
+
+bool LastfmCorrections::save(const std::string& path, std::string& error) const
+{
+    std::string out(K_MAGIC, sizeof(K_MAGIC));
+    out.push_back(static_cast<char>(K_VERSION));
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        out.reserve(out.size() + entries_.size() * 12 + bytes_ / 4);
+        putVarint(out, entries_.size());
+        for (auto it = entries_.rbegin(); it != entries_.rend(); ++it)
+        {
+            for (int b = 0; b < 8; ++b)
+                out.push_back(static_cast<char>((it->key >> (8 * b)) & 0xff));
+            putString(out, it->correction.artist);
+            putString(out, it->correction.title);
+        }
+    }
+
+    // Written next to the old file and renamed over it, so a crash leaves one or the other.
+    const std::string tmp = path + ".tmp";
+    std::FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f)
+    {
+        error = "cannot create " + tmp + ": " + std::strerror(errno);
+        return false;
+    }
+    const bool written = std::fwrite(out.data(), 1, out.size(), f) == out.size();
+    const bool closed = std::fclose(f) == 0;
+    if (!written || !closed || std::rename(tmp.c_str(), path.c_str()) != 0)
+    {
+        error = "cannot write " + path + ": " + std::strerror(errno);
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,98 @@
+//
+//  lastfm_corrections.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+// Last.fm's spelling of an artist / title pair as sent. An empty name means Last.fm keeps the one sent.
+struct LastfmCorrection
+{
+    std::string artist;
+    std::string title;
+};
+
+// What the queue, the Web API and the worker need from the corrections map.
+class ILastfmCorrections
+{
+  public:
+    virtual ~ILastfmCorrections() = default;
+
+    // O(1). Rewrites artist and title when a correction is known; true if either changed. A pair Last.fm has not
+    // answered for yet is remembered for a background track.getCorrection lookup.
+    virtual bool apply(std::string& artist, std::string& title) = 0;
+
+    // Last.fm's answer for a pair as sent, from a scrobble / Now Playing response or track.getCorrection.
+    virtual void learn(const std::string& artist, const std::string& title, const LastfmCorrection& correction) = 0;
+
+    // Next pair waiting for a lookup, newest first; pairs answered in the meantime are skipped.
+    virtual bool nextLookup(std::string& artist, std::string& title) = 0;
+};
+
+// Corrections keyed by lastfm::util::trackKey() of the names as tagged. Pairs Last.fm accepted unchanged are kept
+// too (with empty names), so they are neither rewritten nor looked up again. Least recently used entries are
+// dropped once the estimated memory use passes the budget.
+//
+// File layout: "LFMCORR", u8 version, varint count, then entries from least to most recently used: u64 key (LE),
+// strings artist and title (varint length + bytes).
+class LastfmCorrections final : public ILastfmCorrections
+{
+  public:
+    static constexpr std::size_t DEFAULT_BUDGET_BYTES = 4u << 20;
+    static constexpr std::size_t MAX_LOOKUPS = 1000;
+
+    struct Stats
+    {
+        std::size_t entries = 0;
+        std::size_t corrected = 0; // entries that rewrite something
+        std::size_t memoryBytes = 0;
+        std::size_t pendingLookups = 0;
+        std::uint64_t applied = 0; // apply() calls that rewrote a name
+    };
+
+    explicit LastfmCorrections(std::size_t budgetBytes = DEFAULT_BUDGET_BYTES);
+
+    bool apply(std::string& artist, std::string& title) override;
+    void learn(const std::string& artist, const std::string& title, const LastfmCorrection& correction) override;
+    bool nextLookup(std::string& artist, std::string& title) override;
+
+    Stats stats() const;
+
+    // A missing file loads as empty.
+    bool load(const std::string& path, std::string& error);
+    bool save(const std::string& path, std::string& error) const;
+
+  private:
+    struct Entry
+    {
+        std::uint64_t key = 0;
+        LastfmCorrection correction;
+    };
+
+    static std::size_t entryBytes(const Entry& e);
+    void storeLocked(std::uint64_t key, const LastfmCorrection& correction);
+
+    const std::size_t budget_;
+
+    mutable std::mutex mutex_;
+    std::list<Entry> entries_; // most recently used first
+    std::unordered_map<std::uint64_t, std::list<Entry>::iterator> index_;
+    std::size_t bytes_ = 0;
+    std::size_t corrected_ = 0;
+    std::uint64_t applied_ = 0;
+
+    std::deque<std::pair<std::string, std::string>> lookups_;
+    std::unordered_set<std::uint64_t> lookupKeys_;
+};
@@ -0,0 +1,134 @@
+//
+//  lastfm_drain_planner.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "lastfm_drain_planner.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace
+{
+static constexpr double K_SECONDS_PER_DAY = 24.0 * 60.0 * 60.0;
+static constexpr double K_MIN_ACCEPT_RATE = 0.05;
+
+static std::string formatLocalTime(std::time_t t)
+{
+    if (t <= 0)
+        return "unknown";
+
+    std::tm tm{};
+#if defined(_WIN32)
+    localtime_s(&tm, &t);
+#else
+    localtime_r(&t, &tm);
+#endif
+
+    char buf[32];
+    if (std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M", &tm) == 0)
+        return "unknown";
+    return buf;
+}
+} // namespace
+
+std::time_t LastfmDrainPlanner::priorityKey(std::time_t startTimestamp, std::time_t now)
+{
+    if (isExpired(startTimestamp, now))
+        return now + startTimestamp; // always after every in-window entry
+
+    return startTimestamp;
+}
+
+LastfmDrainPlan LastfmDrainPlanner::plan(const LastfmDrainInputs& in)
+{
+    LastfmDrainPlan p;
+    p.computedAt = in.now;
+    p.pending = in.pending;
+    p.due = in.due;
+    p.expiringSoon = in.expiringSoon;
+    p.expired = in.expired;
+    p.acceptRate = std::clamp(in.acceptRate, K_MIN_ACCEPT_RATE, 1.0);
+    p.budgetLeftToday = (in.dailyLimit > 0) ? std::max<int64_t>(0, in.dailyLimit - in.usedToday) : -1;
+
+    if (in.pending == 0)
+        return p;
+
+    // Steady state: without a budget, one full batch per cooldown; with a budget, send what the
+    // token bucket accrues in one interval so the backlog is spread over the day.
+    std::time_t spacing = std::max<std::time_t>(1, in.minSpacingSeconds);
+    unsigned batch = MAX_RUN_BATCH;
+    double tokensPerSecond = 0.0;
+
+    if (in.dailyLimit > 0)
+    {
+        tokensPerSecond = static_cast<double>(in.dailyLimit) / K_SECONDS_PER_DAY;
+        const double perRun = std::ceil(static_cast<double>(spacing) * tokensPerSecond);
+        batch = static_cast<unsigned>(std::clamp(perRun, 1.0, static_cast<double>(MAX_RUN_BATCH)));
+        spacing = std::max(spacing, static_cast<std::time_t>(std::ceil(batch / tokensPerSecond)));
+    }
+
+    p.spacing = spacing;
+
+    // Next run: first moment something is both due and allowed.
+    if (in.rateLimitedUntil > in.now)
+    {
+        p.nextRun = in.rateLimitedUntil;
+    }
+    else if (in.due > 0)
+    {
+        p.nextRun = (in.availableNow > 0) ? in.now : in.now + std::max<std::time_t>(1, in.secondsUntilToken);
+    }
+    else
+    {
+        p.nextRun = std::max(in.earliestRetry, in.now + in.secondsUntilToken);
+        if (p.nextRun <= in.now)
+            p.nextRun = in.now + spacing;
+    }
+
+    // Next batch: whatever is due and affordable right now, otherwise a steady-state batch.
+    std::size_t nextBatch = batch;
+    if (in.availableNow > 0 && p.nextRun == in.now)
+    {
+        nextBatch = std::min<std::size_t>(MAX_RUN_BATCH, static_cast<std::size_t>(in.availableNow));
+        nextBatch = std::min(nextBatch, in.due);
+    }
+    p.batchSize = static_cast<unsigned>(std::max<std::size_t>(1, nextBatch));
+
+    // ETA from steady-state throughput scaled by how many attempts actually get accepted.
+    double perSecond = static_cast<double>(batch) / static_cast<double>(spacing);
+    if (tokensPerSecond > 0.0)
+        perSecond = std::min(perSecond, tokensPerSecond);
+    perSecond *= p.acceptRate;
+
+    if (perSecond > 0.0)
+        p.completionEta = p.nextRun + static_cast<std::time_t>(std::ceil(in.pending / perSecond));
+
+    return p;
+}
+
+std::string LastfmDrainPlanner::describe(const LastfmDrainPlan& p)
+{
+    std::string out;
+    out += "Pending: " + std::to_string(p.pending) + " (due " + std::to_string(p.due) + ")\n";
+
+    if (p.pending == 0)
+        return out;
+
+    out += "Next run: " + formatLocalTime(p.nextRun) + ", batch " + std::to_string(p.batchSize) + ", every " +
+           std::to_string(static_cast<long long>(p.spacing)) + "s\n";
+    out += "Estimated completion: " + formatLocalTime(p.completionEta) + "\n";
+    out += "Accept rate: " + std::to_string(static_cast<int>(std::lround(p.acceptRate * 100.0))) + "%\n";
+
+    if (p.budgetLeftToday >= 0)
+        out += "Budget left today: " + std::to_string(p.budgetLeftToday) + "\n";
+
+    if (p.expiringSoon > 0 || p.expired > 0)
+        out += "Near acceptance-window end: " + std::to_string(p.expiringSoon) +
+               ", past it: " + std::to_string(p.expired) + "\n";
+
+    return out;
+}
@@ -0,0 +1,81 @@
+//
+//  lastfm_drain_planner.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+// Snapshot of everything the planner looks at. Filled by LastfmQueue.
+struct LastfmDrainInputs
+{
+    std::time_t now = 0;
+    std::size_t pending = 0;
+    std::size_t due = 0;
+    std::size_t expiringSoon = 0; // due, still inside the acceptance window, but close to its end
+    std::size_t expired = 0;      // older than the acceptance window
+    std::time_t earliestRetry = 0;
+    std::time_t rateLimitedUntil = 0;
+    int64_t dailyLimit = 0; // <= 0: unlimited
+    int64_t usedToday = 0;
+    int64_t availableNow = 0;
+    std::time_t secondsUntilToken = 0;
+    std::time_t minSpacingSeconds = 0; // worker cooldown for large queues
+    double acceptRate = 1.0;
+};
+
+struct LastfmDrainPlan
+{
+    std::time_t computedAt = 0;
+    std::size_t pending = 0;
+    std::size_t due = 0;
+    std::size_t expiringSoon = 0;
+    std::size_t expired = 0;
+    unsigned batchSize = 0;      // scrobbles to attempt in the next run
+    std::time_t spacing = 0;     // seconds between runs at steady state
+    std::time_t nextRun = 0;     // wall time of the next useful run (0 = nothing to do)
+    std::time_t completionEta = 0; // wall time the backlog is expected to be empty (0 = unknown)
+    double acceptRate = 1.0;
+    int64_t budgetLeftToday = -1; // -1 = unlimited
+};
+
+// Turns queue size, budget and observed accept rate into a drain schedule.
+class LastfmDrainPlanner
+{
+  public:
+    // Last.fm ignores scrobbles with timestamps older than two weeks.
+    static constexpr std::time_t ACCEPTANCE_WINDOW_SECONDS = 14 * 24 * 60 * 60;
+    // Entries this close to the window end are reported as expiring soon.
+    static constexpr std::time_t EXPIRY_WARNING_SECONDS = 24 * 60 * 60;
+    // Scrobbles one LastfmQueue::retryQueuedScrobbles() call sends per sink, at most.
+    static constexpr unsigned DISPATCH_BATCH = 10;
+    // Upper bound of scrobbles per worker run: a few dispatch rounds, after which the plan, budget and cooldown
+    // are looked at again.
+    static constexpr unsigned MAX_RUN_BATCH = 5 * DISPATCH_BATCH;
+
+    static LastfmDrainPlan plan(const LastfmDrainInputs& in);
+
+    // Dispatch order key: lower goes first. Entries nearest to acceptance-window expiry lead,
+    // already expired entries go last so they never crowd out ones that can still count.
+    static std::time_t priorityKey(std::time_t startTimestamp, std::time_t now);
+
+    static bool isExpired(std::time_t startTimestamp, std::time_t now)
+    {
+        return startTimestamp > 0 && now - startTimestamp > ACCEPTANCE_WINDOW_SECONDS;
+    }
+
+    static bool isExpiringSoon(std::time_t startTimestamp, std::time_t now)
+    {
+        return !isExpired(startTimestamp, now) &&
+               now - startTimestamp > ACCEPTANCE_WINDOW_SECONDS - EXPIRY_WARNING_SECONDS;
+    }
+
+    // Human-readable summary for status output.
+    static std::string describe(const LastfmDrainPlan& plan);
+};
@@ -0,0 +1,346 @@
+//
+//  lastfm_export.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "lastfm_export.h"
+#include "lastfm_json_writer.h"
+#include "lastfm_scrobble_sink.h"
+#include "debug.h"
+
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+namespace
+{
+static constexpr std::size_t K_BUFFER_BYTES = 64 * 1024;
+
+// Rows between progress callbacks.
+static constexpr std::uint64_t K_PROGRESS_ROWS = 4096;
+
+static constexpr const char* K_CSV_HEADER = "source,timestamp,time,artist,title,album,album_artist,duration,mbid,"
+                                            "playback_seconds,sinks,retries,next_retry\r\n";
+
+static const char* sinkName(unsigned slot)
+{
+    switch (slot)
+    {
+    case lastfm::sink::LASTFM:
+        return "lastfm";
+    case lastfm::sink::LISTENBRAINZ:
+        return "listenbrainz";
+    case lastfm::sink::LIBREFM:
+        return "librefm";
+    default:
+        return "other";
+    }
+}
+
+static void appendIsoTime(std::string& out, std::time_t t)
+{
+    std::tm tm{};
+#if defined(_WIN32)
+    gmtime_s(&tm, &t);
+#else
+    gmtime_r(&t, &tm);
+#endif
+    char buf[32];
+    const std::size_t n = std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    out.append(buf, n);
+}
+
+// RFC 4180: quoted only when needed, inner quotes doubled.
+static void appendCsvField(std::string& out, const std::string& value)
+{
+    if (value.find_first_of(",\"\r\n") == std::string::npos)
+    {
+        out += value;
+        return;
+    }
+    out.push_back('"');
+    for (char c : value)
+    {
+        if (c == '"')
+            out.push_back('"');
+        out.push_back(c);
+    }
+    out.push_back('"');
+}
+} // namespace
+
+LastfmExportWriter::~LastfmExportWriter()
+{
+    discard();
+}
+
+bool LastfmExportWriter::open(const std::string& path, std::string& error)
+{
+    discard();
+
+    path_ = path;
+    tmpPath_ = path + ".tmp";
+    file_ = std::fopen(tmpPath_.c_str(), "wb");
+    if (!file_)
+    {
+        error = "cannot create " + tmpPath_ + ": " + std::strerror(errno);
+        return false;
+    }
+
+    failed_ = false;
+    errno_ = 0;
+    rows_ = 0;
+    bytes_ = 0;
+    buffer_.clear();
+    buffer_.reserve(K_BUFFER_BYTES + 4096);
+    if (format_ == LastfmExportFormat::CSV)
+        buffer_ += K_CSV_HEADER;
+    return true;
+}
+
+void LastfmExportWriter::beginRow(const char* source, std::time_t timestamp, const std::string& artist,
+                                  const std::string& title, const std::string& album, const std::string& albumArtist,
+                                  double durationSeconds)
+{
+    const long long duration = static_cast<long long>(durationSeconds + 0.5);
+
+    if (format_ == LastfmExportFormat::CSV)
+    {
+        buffer_ += source;
+        buffer_.push_back(',');
+        buffer_ += std::to_string(static_cast<long long>(timestamp));
+        buffer_.push_back(',');
+        appendIsoTime(buffer_, timestamp);
+        for (const std::string* s : {&artist, &title, &album, &albumArtist})
+        {
+            buffer_.push_back(',');
+            appendCsvField(buffer_, *s);
+        }
+        buffer_.push_back(',');
+        buffer_ += std::to_string(duration);
+        return;
+    }
+
+    // The object stays open for the pending-only keys; endRow() closes it.
+    buffer_ += "{\"source\":\"";
+    buffer_ += source;
+    buffer_ += "\",\"timestamp\":";
+    buffer_ += std::to_string(static_cast<long long>(timestamp));
+    buffer_ += ",\"time\":\"";
+    appendIsoTime(buffer_, timestamp);
+    buffer_ += "\"";
+    const std::pair<const char*, const std::string*> names[] = {
+        {"artist", &artist}, {"title", &title}, {"album", &album}, {"album_artist", &albumArtist}};
+    for (const auto& n : names)
+    {
+        buffer_ += ",\"";
+        buffer_ += n.first;
+        buffer_ += "\":\"";
+        LastfmJsonWriter::appendEscaped(buffer_, *n.second);
+        buffer_.push_back('"');
+    }
+    buffer_ += ",\"duration\":";
+    buffer_ += std::to_string(duration);
+}
+
+bool LastfmExportWriter::endRow()
+{
+    buffer_ += format_ == LastfmExportFormat::CSV ? "\r\n" : "}\n";
+    ++rows_;
+    return buffer_.size() < K_BUFFER_BYTES || flush();
+}
+
+bool LastfmExportWriter::writePending(const LastfmQueue::PendingScrobble& p)
+{
+    if (!file_ || failed_)
+        return false;
+
+    const LastfmTrackInfo& t = p.track;
+    beginRow("pending", p.startTimestamp, t.artist, t.title, t.album, t.albumArtist, t.durationSeconds);
+
+    const std::string playback = std::to_string(static_cast<long long>(p.playbackSeconds + 0.5));
+    if (format_ == LastfmExportFormat::CSV)
+    {
+        buffer_.push_back(',');
+        appendCsvField(buffer_, t.mbid);
+        buffer_.push_back(',');
+        buffer_ += playback;
+        buffer_.push_back(',');
+        bool first = true;
+        for (unsigned slot = 0; slot < lastfm::sink::MAX_SINKS; ++slot)
+        {
+            if ((p.pendingSinks & (1u << slot)) == 0)
+                continue;
+            buffer_ += first ? "" : ";";
+            buffer_ += sinkName(slot);
+            first = false;
+        }
+        buffer_.push_back(',');
+        buffer_ += std::to_string(p.retryCount);
+        buffer_.push_back(',');
+        buffer_ += std::to_string(static_cast<long long>(p.nextRetryTimestamp));
+        return endRow();
+    }
+
+    if (!t.mbid.empty())
+    {
+        buffer_ += ",\"mbid\":\"";
+        LastfmJsonWriter::appendEscaped(buffer_, t.mbid);
+        buffer_.push_back('"');
+    }
+    buffer_ += ",\"playback_seconds\":";
+    buffer_ += playback;
+    buffer_ += ",\"sinks\":[";
+    bool first = true;
+    for (unsigned slot = 0; slot < lastfm::sink::MAX_SINKS; ++slot)
+    {
+        if ((p.pendingSinks & (1u << slot)) == 0)
+            continue;
+        buffer_ += first ? "\"" : ",\"";
+        buffer_ += sinkName(slot);
+        buffer_.push_back('"');
+        first = false;
+    }
+    buffer_ += "],\"retries\":";
+    buffer_ += std::to_string(p.retryCount);
+    buffer_ += ",\"next_retry\":";
+    buffer_ += std::to_string(static_cast<long long>(p.nextRetryTimestamp));
+    return endRow();
+}
+
+bool LastfmExportWriter::writeHistory(const LastfmHistoryRecord& r)
+{
+    if (!file_ || failed_)
+        return false;
+
+    beginRow("history", r.timestamp, r.artist, r.title, r.album, r.albumArtist, r.durationSeconds);
+    if (format_ == LastfmExportFormat::CSV)
+        buffer_ += ",,,,,";
+    return endRow();
+}
+
+bool LastfmExportWriter::flush()
+{
+    if (buffer_.empty() || failed_)
+        return !failed_;
+
+    if (std::fwrite(buffer_.data(), 1, buffer_.size(), file_) != buffer_.size())
+    {
+        failed_ = true;
+        errno_ = errno;
+        return false;
+    }
+    bytes_ += buffer_.size();
+    buffer_.clear();
+    return true;
+}
+
+bool LastfmExportWriter::close(std::string& error)
+{
+    if (!file_)
+    {
+        error = "export file is not open";
+        return false;
+    }
+
+    flush();
+    const bool closed = std::fclose(file_) == 0;
+    if (!closed && !failed_)
+        errno_ = errno;
+    file_ = nullptr;
+
+    if (failed_ || !closed || std::rename(tmpPath_.c_str(), path_.c_str()) != 0)
+    {
+        error = "cannot write " + path_ + ": " + std::strerror(errno_ ? errno_ : errno);
+        std::remove(tmpPath_.c_str());
+        return false;
+    }
+    return true;
+}
+
+void LastfmExportWriter::discard()
+{
+    if (!file_)
+        return;
+    std::fclose(file_);
+    file_ = nullptr;
+    std::remove(tmpPath_.c_str());
+    buffer_.clear();
+}
+
+LastfmExportResult lastfmExportScrobbles(const std::string& path, const LastfmQueue* queue,
+                                         const LastfmScrobbleHistory* history, const LastfmExportOptions& options)
+{
+    LastfmExportResult r;
+
+    LastfmExportWriter writer(options.format);
+    if (!writer.open(path, r.error))
+    {
+        LFM_INFO("Export: " << r.error.c_str());
+        return r;
+    }
+
+    const bool withHistory = history && history->isOpen();
+    const std::uint64_t total = (queue ? queue->getPendingScrobbleCount() : 0) +
+                                (withHistory ? history->stats().plays : 0);
+
+    // Shared by both walks: false stops the current one.
+    const auto step = [&](bool written)
+    {
+        if (!written)
+            return false;
+        if (options.cancelled && options.cancelled())
+        {
+            r.cancelled = true;
+            return false;
+        }
+        if (options.progress && writer.rows() % K_PROGRESS_ROWS == 0)
+            options.progress(writer.rows(), total);
+        return true;
+    };
+
+    bool ok = true;
+    if (queue)
+    {
+        queue->forEachPending([&](const LastfmQueue::PendingScrobble& p) { return step(writer.writePending(p)); });
+        r.pendingRows = writer.rows();
+        ok = !r.cancelled;
+    }
+
+    if (ok && withHistory)
+    {
+        ok = history->forEach([&](const LastfmHistoryRecord& rec) { return step(writer.writeHistory(rec)); },
+                              r.error) &&
+             !r.cancelled;
+        r.historyRows = writer.rows() - r.pendingRows;
+    }
+
+    if (!ok)
+    {
+        writer.discard();
+        if (!r.cancelled)
+            LFM_INFO("Export: " << r.error.c_str());
+        return r;
+    }
+
+    r.ok = writer.close(r.error);
+    r.bytes = writer.bytes();
+    if (options.progress)
+        options.progress(writer.rows(), total);
+
+    LFM_INFO("Export: " << lastfmDescribeExport(path, r).c_str());
+    return r;
+}
+
+std::string lastfmDescribeExport(const std::string& path, const LastfmExportResult& r)
+{
+    if (r.cancelled)
+        return "Export cancelled.";
+    if (!r.ok)
+        return "Export failed: " + r.error;
+
+    return "Exported " + std::to_string(r.pendingRows) + " pending and " + std::to_string(r.historyRows) +
+           " scrobbled play(s) to " + path + " (" + std::to_string(r.bytes / 1024) + " KB).";
+}
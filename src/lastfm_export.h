@@ -0,0 +1,111 @@
+//
+//  lastfm_export.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <string>
+
+#include "lastfm_history.h"
+#include "lastfm_queue.h"
+
+enum class LastfmExportFormat
+{
+    CSV,   // RFC 4180, header row, UTF-8
+    JSONL, // one JSON object per line
+};
+
+// Streaming writer for exported plays: rows go through a fixed buffer into "<path>.tmp", which close() renames over
+// the target, so memory does not grow with the export and a failed export leaves no partial file.
+//
+// Columns: source (pending / history), timestamp (unix seconds), time (ISO 8601 UTC), artist, title, album,
+// album_artist, duration (seconds), then for pending entries only: mbid, playback_seconds, sinks (names,
+// ';'-separated in CSV, an array in JSONL), retries, next_retry (unix seconds, 0 = due). JSONL rows leave out the
+// keys that do not apply.
+class LastfmExportWriter
+{
+  public:
+    explicit LastfmExportWriter(LastfmExportFormat format) : format_(format)
+    {
+    }
+    ~LastfmExportWriter();
+
+    LastfmExportWriter(const LastfmExportWriter&) = delete;
+    LastfmExportWriter& operator=(const LastfmExportWriter&) = delete;
+
+    bool open(const std::string& path, std::string& error);
+
+    // False once a write failed; close() then reports it.
+    bool writePending(const LastfmQueue::PendingScrobble& p);
+    bool writeHistory(const LastfmHistoryRecord& r);
+
+    bool close(std::string& error);
+
+    // Drops the temporary file, leaving any earlier export in place.
+    void discard();
+
+    std::uint64_t rows() const
+    {
+        return rows_;
+    }
+
+    std::uint64_t bytes() const
+    {
+        return bytes_;
+    }
+
+  private:
+    void beginRow(const char* source, std::time_t timestamp, const std::string& artist, const std::string& title,
+                  const std::string& album, const std::string& albumArtist, double durationSeconds);
+    bool endRow();
+    bool flush();
+
+    const LastfmExportFormat format_;
+    std::string path_;
+    std::string tmpPath_;
+    std::FILE* file_ = nullptr;
+    std::string buffer_;
+    bool failed_ = false;
+    int errno_ = 0;
+    std::uint64_t rows_ = 0;
+    std::uint64_t bytes_ = 0;
+};
+
+struct LastfmExportOptions
+{
+    LastfmExportFormat format = LastfmExportFormat::CSV;
+
+    // Optional: polled once per row; true stops the export and discards the file.
+    std::function<bool()> cancelled;
+
+    // Optional: rows written so far and the expected total, every few thousand rows and at the end.
+    std::function<void(std::uint64_t rows, std::uint64_t total)> progress;
+};
+
+struct LastfmExportResult
+{
+    bool ok = false;
+    bool cancelled = false;
+    std::string error;
+
+    std::uint64_t pendingRows = 0;
+    std::uint64_t historyRows = 0;
+    std::uint64_t bytes = 0;
+};
+
+// Writes the pending queue (when `queue` is set) and then the history (when `history` is set and open), oldest
+// first. Runs on the caller's thread; the queue is locked only while each chunk of its rows is copied out, not
+// while they are written.
+LastfmExportResult lastfmExportScrobbles(const std::string& path, const LastfmQueue* queue,
+                                         const LastfmScrobbleHistory* history, const LastfmExportOptions& options = {});
+
+// One-line summary for the console or a popup.
+std::string lastfmDescribeExport(const std::string& path, const LastfmExportResult& r);
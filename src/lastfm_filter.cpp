@@ -0,0 +1,1293 @@
+//
+//  lastfm_filter.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "lastfm_filter.h"
+#include "debug.h"
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cctype>
+#include <map>
+#include <regex>
+#include <utility>
+
+namespace
+{
+static constexpr std::size_t MAX_NFA_STATES = 4096;
+static constexpr std::size_t MAX_DFA_STATES = 2048;
+static constexpr int MAX_REPEAT = 255;
+
+static constexpr std::uint8_t DFA_ACCEPT = 1;
+static constexpr std::uint8_t DFA_ACCEPT_AT_END = 2;
+static constexpr std::uint8_t DFA_DEAD = 4;
+
+using ByteSet = std::bitset<256>;
+
+static bool isWordByte(unsigned char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// Case-insensitive matching folds input bytes to ASCII lower case, same as std::tolower in the "C" locale
+// (which is what the previous std::regex::icase / lowerCopy path did).
+static unsigned char foldByte(unsigned char c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c + ('a' - 'A')) : c;
+}
+
+static ByteSet foldSet(const ByteSet& s)
+{
+    ByteSet out;
+    for (std::size_t b = 0; b < 256; ++b)
+    {
+        if (s[b])
+            out.set(foldByte(static_cast<unsigned char>(b)));
+    }
+    return out;
+}
+
+static bool hasRegexMeta(const std::string& s)
+{
+    for (char c : s)
+    {
+        switch (c)
+        {
+        case '.':
+        case '^':
+        case '$':
+        case '|':
+        case '?':
+        case '*':
+        case '+':
+        case '(':
+        case ')':
+        case '[':
+        case ']':
+        case '{':
+        case '}':
+        case '\\':
+            return true;
+        default:
+            break;
+        }
+    }
+    return false;
+}
+
+static std::string trimCopy(const std::string& in)
+{
+    std::size_t b = 0;
+    while (b < in.size() && std::isspace((unsigned char)in[b]))
+        ++b;
+    std::size_t e = in.size();
+    while (e > b && std::isspace((unsigned char)in[e - 1]))
+        --e;
+    return (e > b) ? in.substr(b, e - b) : std::string{};
+}
+
+static std::string lowerCopy(const std::string& in)
+{
+    std::string out;
+    out.reserve(in.size());
+    for (unsigned char c : in)
+        out.push_back((char)foldByte(c));
+    return out;
+}
+
+// ---- Regex subset: parser -> AST ----
+
+struct RxNode
+{
+    enum Kind
+    {
+        SET,
+        CONCAT,
+        ALT,
+        REPEAT,
+        BOL,
+        EOL,
+        WORD_BOUNDARY,
+        NOT_WORD_BOUNDARY
+    };
+
+    Kind kind = CONCAT;
+    ByteSet set; // SET: matching (folded) bytes
+    std::vector<int> kids;
+    int min = 0;
+    int max = 0; // REPEAT: -1 = unbounded
+};
+
+struct RxBranch
+{
+    std::vector<int> items;
+    bool anchoredStart = false;
+    bool anchoredEnd = false;
+};
+
+struct ParsedRx
+{
+    std::vector<RxNode> nodes;
+    std::vector<RxBranch> branches;
+};
+
+class RxParser
+{
+  public:
+    explicit RxParser(const std::string& pattern) : p_(pattern)
+    {
+    }
+
+    // Root node index, or -1 when the pattern uses syntax outside the supported subset.
+    int parse(std::vector<RxNode>& nodes)
+    {
+        nodes_ = &nodes;
+        const int root = parseAlt();
+        if (!ok_ || i_ != p_.size())
+            return -1;
+        return root;
+    }
+
+  private:
+    int add(RxNode n)
+    {
+        nodes_->push_back(std::move(n));
+        return static_cast<int>(nodes_->size() - 1);
+    }
+
+    int addSet(const ByteSet& s)
+    {
+        RxNode n;
+        n.kind = RxNode::SET;
+        n.set = s;
+        return add(std::move(n));
+    }
+
+    int addLiteral(unsigned char c)
+    {
+        ByteSet s;
+        s.set(foldByte(c));
+        return addSet(s);
+    }
+
+    int fail()
+    {
+        ok_ = false;
+        return -1;
+    }
+
+    bool more() const
+    {
+        return ok_ && i_ < p_.size();
+    }
+
+    int parseAlt()
+    {
+        std::vector<int> branches;
+        branches.push_back(parseConcat());
+
+        while (more() && p_[i_] == '|')
+        {
+            ++i_;
+            branches.push_back(parseConcat());
+        }
+
+        if (!ok_)
+            return -1;
+        if (branches.size() == 1)
+            return branches[0];
+
+        RxNode n;
+        n.kind = RxNode::ALT;
+        n.kids = std::move(branches);
+        return add(std::move(n));
+    }
+
+    int parseConcat()
+    {
+        RxNode n;
+        n.kind = RxNode::CONCAT;
+
+        while (more() && p_[i_] != '|' && p_[i_] != ')')
+        {
+            int atom = parseAtom();
+            if (ok_)
+                atom = parseQuantifier(atom);
+            if (!ok_)
+                return -1;
+            n.kids.push_back(atom);
+        }
+
+        return add(std::move(n));
+    }
+
+    int parseQuantifier(int atom)
+    {
+        if (!more())
+            return atom;
+
+        int min = 0;
+        int max = 0;
+        switch (p_[i_])
+        {
+        case '*':
+            min = 0;
+            max = -1;
+            ++i_;
+            break;
+        case '+':
+            min = 1;
+            max = -1;
+            ++i_;
+            break;
+        case '?':
+            min = 0;
+            max = 1;
+            ++i_;
+            break;
+        case '{':
+            if (!parseBraces(min, max))
+                return fail();
+            break;
+        default:
+            return atom;
+        }
+
+        // Lazy vs greedy does not change whether a match exists.
+        if (more() && p_[i_] == '?')
+            ++i_;
+
+        if (more() && (p_[i_] == '*' || p_[i_] == '+' || p_[i_] == '?' || p_[i_] == '{'))
+            return fail();
+
+        const RxNode::Kind kind = (*nodes_)[atom].kind;
+        if (kind == RxNode::BOL || kind == RxNode::EOL || kind == RxNode::WORD_BOUNDARY ||
+            kind == RxNode::NOT_WORD_BOUNDARY)
+            return fail();
+
+        RxNode n;
+        n.kind = RxNode::REPEAT;
+        n.kids.push_back(atom);
+        n.min = min;
+        n.max = max;
+        return add(std::move(n));
+    }
+
+    bool parseNumber(int& out)
+    {
+        const std::size_t begin = i_;
+        long value = 0;
+        while (i_ < p_.size() && std::isdigit((unsigned char)p_[i_]))
+        {
+            value = value * 10 + (p_[i_] - '0');
+            if (value > MAX_REPEAT)
+                return false;
+            ++i_;
+        }
+        out = static_cast<int>(value);
+        return i_ > begin;
+    }
+
+    bool parseBraces(int& min, int& max)
+    {
+        ++i_; // '{'
+        if (!parseNumber(min))
+            return false;
+
+        max = min;
+        if (i_ < p_.size() && p_[i_] == ',')
+        {
+            ++i_;
+            max = -1;
+            if (i_ < p_.size() && p_[i_] != '}' && !parseNumber(max))
+                return false;
+        }
+
+        if (i_ >= p_.size() || p_[i_] != '}')
+            return false;
+        ++i_;
+
+        return max < 0 || max >= min;
+    }
+
+    // \d \w \s and their negations, already folded.
+    static bool classEscape(char e, ByteSet& out)
+    {
+        ByteSet s;
+        switch (e)
+        {
+        case 'd':
+        case 'D':
+            for (int c = '0'; c <= '9'; ++c)
+                s.set(c);
+            break;
+        case 'w':
+        case 'W':
+            for (int c = 0; c < 256; ++c)
+            {
+                if (isWordByte(static_cast<unsigned char>(c)))
+                    s.set(c);
+            }
+            break;
+        case 's':
+        case 'S':
+            for (char c : {' ', '\t', '\n', '\v', '\f', '\r'})
+                s.set(static_cast<unsigned char>(c));
+            break;
+        default:
+            return false;
+        }
+
+        s = foldSet(s);
+        if (std::isupper((unsigned char)e))
+            s.flip();
+        out |= s;
+        return true;
+    }
+
+    bool charEscape(char e, unsigned char& out)
+    {
+        switch (e)
+        {
+        case 't':
+            out = '\t';
+            return true;
+        case 'n':
+            out = '\n';
+            return true;
+        case 'v':
+            out = '\v';
+            return true;
+        case 'f':
+            out = '\f';
+            return true;
+        case 'r':
+            out = '\r';
+            return true;
+        case '0':
+            if (i_ < p_.size() && std::isdigit((unsigned char)p_[i_]))
+                return false;
+            out = 0;
+            return true;
+        case 'x':
+        {
+            if (i_ + 2 > p_.size() || !std::isxdigit((unsigned char)p_[i_]) ||
+                !std::isxdigit((unsigned char)p_[i_ + 1]))
+                return false;
+            out = static_cast<unsigned char>(std::stoi(p_.substr(i_, 2), nullptr, 16));
+            i_ += 2;
+            return true;
+        }
+        default:
+            // Identity escapes only for punctuation; letters/digits are either classes or unsupported.
+            if (std::isalnum((unsigned char)e))
+                return false;
+            out = static_cast<unsigned char>(e);
+            return true;
+        }
+    }
+
+    int parseEscape()
+    {
+        if (i_ >= p_.size())
+            return fail();
+
+        const char e = p_[i_++];
+
+        ByteSet s;
+        if (classEscape(e, s))
+            return addSet(s);
+
+        if (e == 'b' || e == 'B')
+        {
+            RxNode n;
+            n.kind = (e == 'b') ? RxNode::WORD_BOUNDARY : RxNode::NOT_WORD_BOUNDARY;
+            return add(std::move(n));
+        }
+
+        unsigned char c = 0;
+        if (charEscape(e, c))
+            return addLiteral(c);
+
+        return fail(); // \1..\9 \u \c \k ...
+    }
+
+    // One class element: either a literal byte (lo >= 0) or a class escape merged into `escapes`.
+    bool parseClassAtom(ByteSet& escapes, int& lo)
+    {
+        lo = -1;
+        if (i_ >= p_.size())
+            return false;
+
+        const char c = p_[i_++];
+        if (c == '\\')
+        {
+            if (i_ >= p_.size())
+                return false;
+
+            const char e = p_[i_++];
+            if (classEscape(e, escapes))
+                return true;
+            if (e == 'b')
+            {
+                lo = '\b';
+                return true;
+            }
+
+            unsigned char ch = 0;
+            if (!charEscape(e, ch))
+                return false;
+            lo = ch;
+            return true;
+        }
+
+        // POSIX classes / collating elements
+        if (c == '[' && i_ < p_.size() && (p_[i_] == ':' || p_[i_] == '.' || p_[i_] == '='))
+            return false;
+
+        lo = static_cast<unsigned char>(c);
+        return true;
+    }
+
+    int parseClass()
+    {
+        bool negated = false;
+        if (i_ < p_.size() && p_[i_] == '^')
+        {
+            negated = true;
+            ++i_;
+        }
+
+        ByteSet raw;
+        ByteSet escapes;
+
+        for (;;)
+        {
+            if (i_ >= p_.size())
+                return fail();
+
+            if (p_[i_] == ']')
+            {
+                ++i_;
+                break;
+            }
+
+            int lo = -1;
+            if (!parseClassAtom(escapes, lo))
+                return fail();
+
+            if (i_ + 1 < p_.size() && p_[i_] == '-' && p_[i_ + 1] != ']')
+            {
+                ++i_;
+                ByteSet ignored;
+                int hi = -1;
+                if (lo < 0 || !parseClassAtom(ignored, hi) || hi < lo)
+                    return fail();
+
+                for (int b = lo; b <= hi; ++b)
+                    raw.set(b);
+            }
+            else if (lo >= 0)
+            {
+                raw.set(lo);
+            }
+        }
+
+        ByteSet s = foldSet(raw) | escapes;
+        if (negated)
+            s.flip();
+        return addSet(s);
+    }
+
+    int parseAtom()
+    {
+        const char c = p_[i_++];
+        switch (c)
+        {
+        case '(':
+        {
+            if (i_ < p_.size() && p_[i_] == '?')
+            {
+                if (i_ + 1 < p_.size() && p_[i_ + 1] == ':')
+                    i_ += 2;
+                else
+                    return fail(); // lookaround, named groups
+            }
+
+            const int inner = parseAlt();
+            if (!ok_ || i_ >= p_.size() || p_[i_] != ')')
+                return fail();
+            ++i_;
+            return inner;
+        }
+        case '[':
+            return parseClass();
+        case '.':
+        {
+            ByteSet s;
+            s.set();
+            s.reset('\n');
+            s.reset('\r');
+            return addSet(s);
+        }
+        case '^':
+        {
+            RxNode n;
+            n.kind = RxNode::BOL;
+            return add(std::move(n));
+        }
+        case '$':
+        {
+            RxNode n;
+            n.kind = RxNode::EOL;
+            return add(std::move(n));
+        }
+        case '\\':
+            return parseEscape();
+        case '*':
+        case '+':
+        case '?':
+        case '{':
+            return fail();
+        default:
+            return addLiteral(static_cast<unsigned char>(c));
+        }
+    }
+
+    const std::string& p_;
+    std::size_t i_ = 0;
+    bool ok_ = true;
+    std::vector<RxNode>* nodes_ = nullptr;
+};
+
+static bool containsAnchor(const std::vector<RxNode>& nodes, int n)
+{
+    const RxNode& node = nodes[n];
+    if (node.kind == RxNode::BOL || node.kind == RxNode::EOL)
+        return true;
+
+    return std::any_of(node.kids.begin(), node.kids.end(), [&](int k) { return containsAnchor(nodes, k); });
+}
+
+// Anchors are supported only as the first (^) / last ($) item of a top-level alternative.
+static bool parseSupportedRegex(const std::string& pattern, ParsedRx& out)
+{
+    RxParser parser(pattern);
+    const int root = parser.parse(out.nodes);
+    if (root < 0)
+        return false;
+
+    std::vector<int> roots;
+    if (out.nodes[root].kind == RxNode::ALT)
+        roots = out.nodes[root].kids;
+    else
+        roots.push_back(root);
+
+    for (int r : roots)
+    {
+        RxBranch b;
+        if (out.nodes[r].kind == RxNode::CONCAT)
+            b.items = out.nodes[r].kids;
+        else
+            b.items.push_back(r);
+
+        if (!b.items.empty() && out.nodes[b.items.front()].kind == RxNode::BOL)
+        {
+            b.anchoredStart = true;
+            b.items.erase(b.items.begin());
+        }
+        if (!b.items.empty() && out.nodes[b.items.back()].kind == RxNode::EOL)
+        {
+            b.anchoredEnd = true;
+            b.items.pop_back();
+        }
+
+        for (int item : b.items)
+        {
+            if (containsAnchor(out.nodes, item))
+                return false;
+        }
+
+        out.branches.push_back(std::move(b));
+    }
+
+    return true;
+}
+
+// ---- Thompson NFA ----
+
+struct NfaState
+{
+    enum Type : std::uint8_t
+    {
+        SET,
+        SPLIT,
+        MATCH,
+        MATCH_AT_END,
+        WORD_BOUNDARY,
+        NOT_WORD_BOUNDARY
+    };
+
+    Type type = SPLIT;
+    int set = -1;
+    int out = -1;
+    int out1 = -1;
+};
+
+class NfaBuilder
+{
+  public:
+    std::vector<NfaState> states;
+    std::vector<ByteSet> sets;
+    std::vector<int> anchoredEntries;
+    std::vector<int> unanchoredEntries;
+    bool overflow = false;
+
+    void addPattern(const ParsedRx& rx)
+    {
+        for (const auto& b : rx.branches)
+        {
+            NfaState m;
+            m.type = b.anchoredEnd ? NfaState::MATCH_AT_END : NfaState::MATCH;
+            int next = add(m);
+
+            for (auto it = b.items.rbegin(); it != b.items.rend(); ++it)
+                next = compile(rx.nodes, *it, next);
+
+            (b.anchoredStart ? anchoredEntries : unanchoredEntries).push_back(next);
+        }
+    }
+
+  private:
+    int add(const NfaState& s)
+    {
+        if (states.size() >= MAX_NFA_STATES)
+            overflow = true;
+        states.push_back(s);
+        return static_cast<int>(states.size() - 1);
+    }
+
+    int split(int a, int b)
+    {
+        NfaState s;
+        s.type = NfaState::SPLIT;
+        s.out = a;
+        s.out1 = b;
+        return add(s);
+    }
+
+    // Builds back to front: returns the entry state of `n` whose exit leads to `next`.
+    int compile(const std::vector<RxNode>& nodes, int n, int next)
+    {
+        if (overflow)
+            return next;
+
+        const RxNode& node = nodes[n];
+        switch (node.kind)
+        {
+        case RxNode::SET:
+        {
+            sets.push_back(node.set);
+            NfaState s;
+            s.type = NfaState::SET;
+            s.set = static_cast<int>(sets.size() - 1);
+            s.out = next;
+            return add(s);
+        }
+        case RxNode::CONCAT:
+            for (auto it = node.kids.rbegin(); it != node.kids.rend(); ++it)
+                next = compile(nodes, *it, next);
+            return next;
+        case RxNode::ALT:
+        {
+            int entry = compile(nodes, node.kids.back(), next);
+            for (std::size_t i = node.kids.size() - 1; i-- > 0;)
+                entry = split(compile(nodes, node.kids[i], next), entry);
+            return entry;
+        }
+        case RxNode::REPEAT:
+        {
+            const int kid = node.kids[0];
+            int tail = next;
+
+            if (node.max < 0)
+            {
+                const int loop = split(-1, next);
+                states[loop].out = compile(nodes, kid, loop);
+                tail = loop;
+            }
+            else
+            {
+                for (int k = node.min; k < node.max && !overflow; ++k)
+                    tail = split(compile(nodes, kid, tail), next);
+            }
+
+            for (int k = 0; k < node.min && !overflow; ++k)
+                tail = compile(nodes, kid, tail);
+
+            return tail;
+        }
+        case RxNode::WORD_BOUNDARY:
+        case RxNode::NOT_WORD_BOUNDARY:
+        {
+            NfaState s;
+            s.type = (node.kind == RxNode::WORD_BOUNDARY) ? NfaState::WORD_BOUNDARY : NfaState::NOT_WORD_BOUNDARY;
+            s.out = next;
+            return add(s);
+        }
+        case RxNode::BOL:
+        case RxNode::EOL:
+        default:
+            overflow = true; // rejected by parseSupportedRegex
+            return next;
+        }
+    }
+};
+} // namespace
+
+// ---- Compiled matchers ----
+
+struct LastfmExclusionFilter::SubstringAutomaton
+{
+    std::array<std::uint16_t, 256> byteClass{}; // raw byte -> alphabet class, case folding baked in
+    std::uint32_t classes = 1;
+    std::vector<std::uint32_t> delta; // state * classes + class -> state
+    std::vector<std::uint8_t> out;    // state ends at least one needle
+
+    explicit SubstringAutomaton(const std::vector<std::string>& needles)
+    {
+        // Class 0 = any byte that does not occur in a needle.
+        std::array<std::uint16_t, 256> folded{};
+        for (const auto& n : needles)
+        {
+            for (unsigned char c : n)
+            {
+                if (folded[c] == 0)
+                    folded[c] = static_cast<std::uint16_t>(classes++);
+            }
+        }
+        for (std::size_t b = 0; b < 256; ++b)
+            byteClass[b] = folded[foldByte(static_cast<unsigned char>(b))];
+
+        constexpr std::uint32_t NONE = UINT32_MAX;
+        delta.assign(classes, NONE);
+        out.assign(1, 0);
+
+        for (const auto& n : needles)
+        {
+            std::uint32_t s = 0;
+            for (unsigned char c : n)
+            {
+                std::uint32_t& next = delta[s * classes + folded[c]];
+                if (next == NONE)
+                {
+                    next = static_cast<std::uint32_t>(out.size());
+                    out.push_back(0);
+                    delta.resize(out.size() * classes, NONE);
+                }
+                s = delta[s * classes + folded[c]];
+            }
+            out[s] = 1;
+        }
+
+        // Fill failure transitions breadth-first so every state has a full row.
+        std::vector<std::uint32_t> fail(out.size(), 0);
+        std::vector<std::uint32_t> queue;
+        queue.reserve(out.size());
+
+        for (std::uint32_t c = 0; c < classes; ++c)
+        {
+            std::uint32_t& v = delta[c];
+            if (v == NONE)
+                v = 0;
+            else
+                queue.push_back(v);
+        }
+
+        for (std::size_t qi = 0; qi < queue.size(); ++qi)
+        {
+            const std::uint32_t u = queue[qi];
+            out[u] |= out[fail[u]];
+
+            for (std::uint32_t c = 0; c < classes; ++c)
+            {
+                std::uint32_t& v = delta[u * classes + c];
+                const std::uint32_t viaFail = delta[fail[u] * classes + c];
+                if (v == NONE)
+                {
+                    v = viaFail;
+                }
+                else
+                {
+                    fail[v] = viaFail;
+                    queue.push_back(v);
+                }
+            }
+        }
+    }
+
+    bool matches(const std::string& value) const
+    {
+        std::uint32_t s = 0;
+        for (unsigned char c : value)
+        {
+            s = delta[s * classes + byteClass[c]];
+            if (out[s])
+                return true;
+        }
+        return false;
+    }
+};
+
+struct LastfmExclusionFilter::RegexDfa
+{
+    std::array<std::uint16_t, 256> byteClass{};
+    std::uint32_t classes = 0;
+    std::vector<std::uint32_t> delta;
+    std::vector<std::uint8_t> flags;
+    std::uint32_t start = 0;
+
+    // Subset construction over the combined NFA. Unanchored alternatives are re-seeded at every position,
+    // which turns "search anywhere" into a plain DFA walk. Word-boundary assertions stay pending in a state
+    // until the next byte (or the end) is known, so such states also remember whether the previous byte was
+    // a word character. Returns nullptr past MAX_DFA_STATES.
+    static std::unique_ptr<RegexDfa> build(const NfaBuilder& nfa)
+    {
+        auto dfa = std::make_unique<RegexDfa>();
+
+        // Alphabet classes: bytes with identical membership in every NFA set (and in \w) behave the same.
+        std::map<std::vector<bool>, std::uint16_t> signatures;
+        std::array<std::uint16_t, 256> folded{};
+        std::vector<unsigned char> representative;
+        for (std::size_t b = 0; b < 256; ++b)
+        {
+            std::vector<bool> sig(nfa.sets.size() + 1);
+            for (std::size_t i = 0; i < nfa.sets.size(); ++i)
+                sig[i] = nfa.sets[i][b];
+            sig.back() = isWordByte(static_cast<unsigned char>(b));
+
+            auto it = signatures.find(sig);
+            if (it == signatures.end())
+            {
+                it = signatures.emplace(std::move(sig), static_cast<std::uint16_t>(representative.size())).first;
+                representative.push_back(static_cast<unsigned char>(b));
+            }
+            folded[b] = it->second;
+        }
+        for (std::size_t b = 0; b < 256; ++b)
+            dfa->byteClass[b] = folded[foldByte(static_cast<unsigned char>(b))];
+        dfa->classes = static_cast<std::uint32_t>(representative.size());
+
+        std::vector<std::uint32_t> mark(nfa.states.size(), 0);
+        std::uint32_t generation = 0;
+        std::vector<int> stack;
+
+        auto isAssertion = [&](int s)
+        {
+            const NfaState::Type t = nfa.states[s].type;
+            return t == NfaState::WORD_BOUNDARY || t == NfaState::NOT_WORD_BOUNDARY;
+        };
+        auto contains = [&](const std::vector<int>& set, NfaState::Type a, NfaState::Type b)
+        {
+            return std::any_of(set.begin(), set.end(),
+                               [&](int s) { return nfa.states[s].type == a || nfa.states[s].type == b; });
+        };
+
+        // Epsilon closure, keeping only states that matter for identity. With context < 0 assertions are kept
+        // pending; otherwise bit 0 = previous byte is a word char, bit 1 = next byte is, and they are resolved.
+        auto closure = [&](const std::vector<int>& seeds, std::vector<int>& out, int context)
+        {
+            ++generation;
+            out.clear();
+            stack.assign(seeds.begin(), seeds.end());
+
+            while (!stack.empty())
+            {
+                const int s = stack.back();
+                stack.pop_back();
+                if (s < 0 || mark[s] == generation)
+                    continue;
+                mark[s] = generation;
+
+                const NfaState& st = nfa.states[s];
+                if (st.type == NfaState::SPLIT)
+                {
+                    stack.push_back(st.out1);
+                    stack.push_back(st.out);
+                }
+                else if (isAssertion(s) && context >= 0)
+                {
+                    const bool boundary = ((context & 1) != 0) != ((context & 2) != 0);
+                    if (boundary == (st.type == NfaState::WORD_BOUNDARY))
+                        stack.push_back(st.out);
+                }
+                else
+                {
+                    out.push_back(s);
+                }
+            }
+
+            std::sort(out.begin(), out.end());
+        };
+
+        using Key = std::pair<std::vector<int>, bool>;
+        std::map<Key, std::uint32_t> ids;
+        std::vector<Key> pending;
+        std::int64_t acceptState = -1;
+        std::vector<int> scratch;
+
+        auto addState = [&](std::uint8_t f) -> std::int64_t
+        {
+            if (dfa->flags.size() >= MAX_DFA_STATES)
+                return -1;
+
+            const auto id = static_cast<std::uint32_t>(dfa->flags.size());
+            dfa->flags.push_back(f);
+            dfa->delta.resize(dfa->flags.size() * dfa->classes, id);
+            return id;
+        };
+
+        auto intern = [&](const std::vector<int>& set, bool prevWord) -> std::int64_t
+        {
+            const bool pendingAssertion = std::any_of(set.begin(), set.end(), isAssertion);
+            Key key(set, pendingAssertion && prevWord);
+
+            auto it = ids.find(key);
+            if (it != ids.end())
+                return it->second;
+
+            std::uint8_t f = set.empty() ? DFA_DEAD : 0;
+            if (contains(set, NfaState::MATCH, NfaState::MATCH))
+                f |= DFA_ACCEPT;
+
+            // End of input counts as a non-word "next byte".
+            closure(set, scratch, key.second ? 1 : 0);
+            if (contains(scratch, NfaState::MATCH, NfaState::MATCH_AT_END))
+                f |= DFA_ACCEPT_AT_END;
+
+            const std::int64_t id = addState(f);
+            if (id < 0)
+                return -1;
+
+            ids.emplace(key, static_cast<std::uint32_t>(id));
+            pending.push_back(std::move(key));
+            return id;
+        };
+
+        std::vector<int> seeds(nfa.anchoredEntries);
+        seeds.insert(seeds.end(), nfa.unanchoredEntries.begin(), nfa.unanchoredEntries.end());
+
+        std::vector<int> set;
+        closure(seeds, set, -1);
+        dfa->start = static_cast<std::uint32_t>(intern(set, false));
+
+        std::vector<int> resolved;
+        for (std::uint32_t q = 0; q < pending.size(); ++q)
+        {
+            // Accepting / dead states keep their self loops: matching stops there anyway.
+            if (dfa->flags[q] & (DFA_ACCEPT | DFA_DEAD))
+                continue;
+
+            const Key current = pending[q];
+            const bool pendingAssertion = std::any_of(current.first.begin(), current.first.end(), isAssertion);
+
+            for (std::uint32_t c = 0; c < dfa->classes; ++c)
+            {
+                const bool nextWord = isWordByte(representative[c]);
+                std::int64_t id = -1;
+
+                const std::vector<int>* active = &current.first;
+                if (pendingAssertion)
+                {
+                    closure(current.first, resolved, (current.second ? 1 : 0) | (nextWord ? 2 : 0));
+                    active = &resolved;
+                }
+
+                if (pendingAssertion && contains(resolved, NfaState::MATCH, NfaState::MATCH))
+                {
+                    // Matched just before this byte.
+                    if (acceptState < 0)
+                    {
+                        acceptState = addState(DFA_ACCEPT);
+                        pending.emplace_back(); // keeps pending[] indexed by state id
+                    }
+                    id = acceptState;
+                }
+                else
+                {
+                    seeds.assign(nfa.unanchoredEntries.begin(), nfa.unanchoredEntries.end());
+                    for (int s : *active)
+                    {
+                        const NfaState& st = nfa.states[s];
+                        if (st.type == NfaState::SET && nfa.sets[st.set][representative[c]])
+                            seeds.push_back(st.out);
+                    }
+
+                    closure(seeds, set, -1);
+                    id = intern(set, nextWord);
+                }
+
+                if (id < 0)
+                    return nullptr;
+                dfa->delta[q * dfa->classes + c] = static_cast<std::uint32_t>(id);
+            }
+        }
+
+        return dfa;
+    }
+
+    bool matches(const std::string& value) const
+    {
+        std::uint32_t s = start;
+        std::uint8_t f = flags[s];
+        if (f & DFA_ACCEPT)
+            return true;
+
+        for (unsigned char c : value)
+        {
+            s = delta[s * classes + byteClass[c]];
+            f = flags[s];
+            if (f & (DFA_ACCEPT | DFA_DEAD))
+                return (f & DFA_ACCEPT) != 0;
+        }
+
+        return (f & DFA_ACCEPT_AT_END) != 0;
+    }
+};
+
+struct LastfmExclusionFilter::RegexFallback
+{
+    std::vector<std::regex> regexes;
+};
+
+namespace
+{
+static std::unique_ptr<LastfmExclusionFilter::RegexDfa> buildDfa(const std::vector<const ParsedRx*>& patterns)
+{
+    NfaBuilder nfa;
+    for (const ParsedRx* rx : patterns)
+    {
+        nfa.addPattern(*rx);
+        if (nfa.overflow)
+            return nullptr;
+    }
+
+    return LastfmExclusionFilter::RegexDfa::build(nfa);
+}
+} // namespace
+
+LastfmExclusionFilter::~LastfmExclusionFilter() = default;
+
+std::size_t LastfmExclusionFilter::fallbackCount() const
+{
+    return fallback_ ? fallback_->regexes.size() : 0;
+}
+
+std::shared_ptr<const LastfmExclusionFilter> LastfmExclusionFilter::compile(const std::string& rules, const char* what)
+{
+    std::shared_ptr<LastfmExclusionFilter> filter(new LastfmExclusionFilter());
+    filter->rules_ = rules;
+
+    if (rules.empty())
+        return filter;
+
+    struct Candidate
+    {
+        std::string pattern;
+        std::regex re;
+        ParsedRx parsed;
+        bool supported = false;
+    };
+
+    std::vector<std::string> needles;
+    std::vector<Candidate> regexes;
+
+    std::size_t start = 0;
+    while (start <= rules.size() && (needles.size() + regexes.size()) < MAX_PATTERNS)
+    {
+        std::size_t end = rules.find(';', start);
+        if (end == std::string::npos)
+            end = rules.size();
+
+        std::string entry = trimCopy(rules.substr(start, end - start));
+        start = end + 1;
+
+        if (entry.empty())
+            continue;
+
+        if (entry.size() > MAX_PATTERN_LENGTH)
+            continue;
+
+        if (!hasRegexMeta(entry))
+        {
+            needles.push_back(lowerCopy(entry));
+            continue;
+        }
+
+        // std::regex stays the authority on what is valid, so accepted rules are unchanged.
+        try
+        {
+            Candidate c;
+            c.re = std::regex(entry, std::regex::ECMAScript | std::regex::icase);
+            c.pattern = std::move(entry);
+            regexes.push_back(std::move(c));
+        }
+        catch (const std::regex_error&)
+        {
+            LFM_INFO("Exclude " << what << ": invalid regex ignored: " << entry.c_str());
+        }
+    }
+
+    filter->substringCount_ = needles.size();
+    if (!needles.empty())
+        filter->substrings_ = std::make_unique<SubstringAutomaton>(needles);
+
+    std::vector<const ParsedRx*> supported;
+    for (auto& c : regexes)
+    {
+        c.supported = parseSupportedRegex(c.pattern, c.parsed);
+        if (c.supported)
+            supported.push_back(&c.parsed);
+    }
+
+    // One DFA for everything; if the product gets too large, one per pattern.
+    if (!supported.empty())
+    {
+        if (auto combined = buildDfa(supported))
+        {
+            filter->dfas_.push_back(std::move(combined));
+        }
+        else
+        {
+            for (auto& c : regexes)
+            {
+                if (!c.supported)
+                    continue;
+
+                auto single = buildDfa({&c.parsed});
+                if (single)
+                    filter->dfas_.push_back(std::move(single));
+                else
+                    c.supported = false;
+            }
+        }
+    }
+
+    for (auto& c : regexes)
+    {
+        if (c.supported)
+        {
+            ++filter->dfaPatternCount_;
+            continue;
+        }
+
+        if (!filter->fallback_)
+            filter->fallback_ = std::make_unique<RegexFallback>();
+        filter->fallback_->regexes.push_back(std::move(c.re));
+    }
+
+    LFM_DEBUG("Exclude " << what << ": " << (unsigned)filter->substringCount_ << " substring(s), "
+                         << (unsigned)filter->dfaPatternCount_ << " regex(es) in " << (unsigned)filter->dfas_.size()
+                         << " DFA(s), " << (unsigned)filter->fallbackCount() << " via std::regex");
+
+    return filter;
+}
+
+bool LastfmExclusionFilter::matches(const std::string& value) const
+{
+    if (substrings_ && substrings_->matches(value))
+        return true;
+
+    for (const auto& dfa : dfas_)
+    {
+        if (dfa->matches(value))
+            return true;
+    }
+
+    if (fallback_)
+    {
+        for (const auto& re : fallback_->regexes)
+        {
+            if (std::regex_search(value, re))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+std::uint64_t LastfmFilterDecisionCache::key(const std::string& artist, const std::string& title,
+                                             std::uint64_t filterVersion)
+{
+    // FNV-1a over artist, a separator that cannot occur in UTF-8, and title; then mix in the version.
+    constexpr std::uint64_t FNV_OFFSET = 0xcbf29ce484222325ull;
+    constexpr std::uint64_t FNV_PRIME = 0x100000001b3ull;
+
+    std::uint64_t h = FNV_OFFSET;
+    for (unsigned char c : artist)
+        h = (h ^ c) * FNV_PRIME;
+    h = (h ^ 0xffu) * FNV_PRIME;
+    for (unsigned char c : title)
+        h = (h ^ c) * FNV_PRIME;
+
+    h ^= filterVersion + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    return h;
+}
+
+bool LastfmFilterDecisionCache::lookup(std::uint64_t key, bool& excluded)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (std::size_t i = 0; i < used_; ++i)
+    {
+        Entry& e = entries_[i];
+        if (e.key == key)
+        {
+            e.lastUse = ++clock_;
+            excluded = e.excluded;
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void LastfmFilterDecisionCache::store(std::uint64_t key, bool excluded)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Entry* slot = nullptr;
+    if (used_ < CAPACITY)
+    {
+        slot = &entries_[used_++];
+    }
+    else
+    {
+        slot = &entries_[0];
+        for (auto& e : entries_)
+        {
+            if (e.lastUse < slot->lastUse)
+                slot = &e;
+        }
+    }
+
+    slot->key = key;
+    slot->excluded = excluded;
+    slot->lastUse = ++clock_;
+}
+
+LastfmFilterDecisionCache::Stats LastfmFilterDecisionCache::stats() const
+{
+    Stats s;
+    s.hits = hits_.load(std::memory_order_relaxed);
+    s.misses = misses_.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    s.entries = used_;
+    return s;
+}
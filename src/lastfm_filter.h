@@ -0,0 +1,107 @@
+//
+//  lastfm_filter.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Exclusion rules ("pat1;pat2;...") compiled once per prefs change. Immutable after compile(), so one
+// instance is shared by all threads; matching takes no locks and does not allocate (regex fallback aside).
+//
+// Entries without regex metacharacters are case-insensitive substrings and go into one Aho-Corasick
+// automaton. The rest are case-insensitive ECMAScript regexes: the common subset (literals, classes,
+// escapes, groups, alternation, quantifiers, leading ^ / trailing $, \b / \B) is combined into one DFA;
+// anything else (backreferences, lookaround, ...) falls back to std::regex for that entry.
+class LastfmExclusionFilter
+{
+  public:
+    static constexpr std::size_t MAX_PATTERNS = 32;
+    static constexpr std::size_t MAX_PATTERN_LENGTH = 256;
+
+    // `what` names the filter in log output ("artist", "title"). Invalid regexes are logged and skipped.
+    static std::shared_ptr<const LastfmExclusionFilter> compile(const std::string& rules, const char* what);
+
+    ~LastfmExclusionFilter();
+
+    bool matches(const std::string& value) const;
+
+    const std::string& rules() const
+    {
+        return rules_;
+    }
+
+    std::size_t substringCount() const
+    {
+        return substringCount_;
+    }
+    std::size_t dfaPatternCount() const
+    {
+        return dfaPatternCount_;
+    }
+    std::size_t fallbackCount() const;
+
+    struct SubstringAutomaton;
+    struct RegexDfa;
+    struct RegexFallback;
+
+  private:
+    LastfmExclusionFilter() = default;
+
+    std::string rules_;
+    std::size_t substringCount_ = 0;
+    std::size_t dfaPatternCount_ = 0;
+
+    std::unique_ptr<SubstringAutomaton> substrings_;
+    std::vector<std::unique_ptr<RegexDfa>> dfas_;
+    std::unique_ptr<RegexFallback> fallback_;
+};
+
+// Remembers recent exclude/keep decisions so a track seen repeatedly (new track, dynamic updates, submit)
+// runs the filters once per rules version. Small fixed-size LRU; thread-safe.
+class LastfmFilterDecisionCache
+{
+  public:
+    static constexpr std::size_t CAPACITY = 64;
+
+    struct Stats
+    {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        std::size_t entries = 0;
+    };
+
+    // 64-bit identity of (artist, title, filter-set version).
+    static std::uint64_t key(const std::string& artist, const std::string& title, std::uint64_t filterVersion);
+
+    bool lookup(std::uint64_t key, bool& excluded);
+    void store(std::uint64_t key, bool excluded);
+
+    Stats stats() const;
+
+  private:
+    struct Entry
+    {
+        std::uint64_t key = 0;
+        std::uint64_t lastUse = 0;
+        bool excluded = false;
+    };
+
+    mutable std::mutex mutex_;
+    std::array<Entry, CAPACITY> entries_{};
+    std::uint64_t clock_ = 0;
+    std::size_t used_ = 0;
+
+    std::atomic<std::uint64_t> hits_{0};
+    std::atomic<std::uint64_t> misses_{0};
+};
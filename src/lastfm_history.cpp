@@ -0,0 +1,563 @@
+//
+//  lastfm_history.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "lastfm_history.h"
+#include "lastfm_key_set.h"
+#include "lastfm_util.h"
+#include "debug.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+namespace
+{
+static constexpr char K_MAGIC[7] = {'L', 'F', 'M', 'H', 'I', 'S', 'T'};
+static constexpr std::uint8_t K_VERSION = 1;
+static constexpr std::size_t K_HEADER_BYTES = sizeof(K_MAGIC) + 1;
+
+static constexpr std::size_t K_READ_BUFFER_BYTES = 64 * 1024;
+
+// Sanity limit for one record body; real ones are a few hundred bytes.
+static constexpr std::uint64_t K_MAX_BODY = 256 * 1024;
+
+static constexpr std::size_t K_MIN_SLOTS = 1024;
+static constexpr std::size_t K_BLOOM_BITS_PER_SLOT = 8;
+static constexpr unsigned K_BLOOM_PROBES = 6;
+
+// Table slots hold the key itself; 0 marks an empty slot, so a (vanishingly unlikely) zero key is stored as 1.
+static std::uint64_t slotKey(std::uint64_t key)
+{
+    return key ? key : 1;
+}
+
+// playKey() is FNV-1a, whose low bits are weak; finish it before masking.
+static std::uint64_t mix(std::uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static void putVarint(std::string& out, std::uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+static void putString(std::string& out, const std::string& s)
+{
+    putVarint(out, s.size());
+    out.append(s);
+}
+
+static void encodeRecord(std::string& out, std::string& body, const LastfmHistoryRecord& r)
+{
+    body.clear();
+    putVarint(body, r.timestamp > 0 ? static_cast<std::uint64_t>(r.timestamp) : 0);
+    putVarint(body, r.durationSeconds > 0.0 ? static_cast<std::uint64_t>(std::llround(r.durationSeconds)) : 0);
+    putString(body, r.artist);
+    putString(body, r.title);
+    putString(body, r.album);
+    putString(body, r.albumArtist);
+
+    putVarint(out, body.size());
+    out.append(body);
+}
+
+// Decodes one record body; false if it does not parse to exactly its length.
+static bool decodeBody(const char* body, std::size_t size, LastfmHistoryRecord& out)
+{
+    std::size_t pos = 0;
+
+    const auto varint = [&](std::uint64_t& v)
+    {
+        v = 0;
+        for (unsigned shift = 0; shift < 64 && pos < size; shift += 7)
+        {
+            const auto b = static_cast<std::uint8_t>(body[pos++]);
+            v |= static_cast<std::uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80))
+                return true;
+        }
+        return false;
+    };
+    const auto string = [&](std::string& s)
+    {
+        std::uint64_t n = 0;
+        if (!varint(n) || n > size - pos)
+            return false;
+        s.assign(body + pos, static_cast<std::size_t>(n));
+        pos += static_cast<std::size_t>(n);
+        return true;
+    };
+
+    std::uint64_t ts = 0;
+    std::uint64_t duration = 0;
+    if (!varint(ts) || !varint(duration) || !string(out.artist) || !string(out.title) || !string(out.album) ||
+        !string(out.albumArtist))
+        return false;
+
+    out.timestamp = static_cast<std::time_t>(ts);
+    out.durationSeconds = static_cast<double>(duration);
+    return pos == size;
+}
+
+// Buffered record reader shared by open() and forEach().
+class RecordScanner
+{
+  public:
+    enum class Result
+    {
+        RECORD,
+        END,
+        TORN,    // file ends inside a record (crash during a write, or a write in progress)
+        DAMAGED, // complete body that does not decode; already skipped
+        CORRUPT, // no plausible length prefix here; resync() finds the next record
+    };
+
+    explicit RecordScanner(std::FILE* file) : file_(file), buffer_(K_READ_BUFFER_BYTES)
+    {
+    }
+
+    // False if the file is not a history file; `empty` is set when it has no complete header.
+    bool readHeader(bool& empty)
+    {
+        empty = !fill(K_HEADER_BYTES);
+        if (empty)
+            return true;
+        const char* header = buffer_.data() + pos_;
+        pos_ += K_HEADER_BYTES;
+        offset_ = K_HEADER_BYTES;
+        return std::memcmp(header, K_MAGIC, sizeof(K_MAGIC)) == 0 &&
+               static_cast<std::uint8_t>(header[sizeof(K_MAGIC)]) == K_VERSION;
+    }
+
+    Result next(LastfmHistoryRecord& out)
+    {
+        std::size_t size = 0;
+        const Result res = parseAt(0, size, out);
+        if (res == Result::RECORD || res == Result::DAMAGED)
+        {
+            pos_ += size;
+            offset_ += size;
+        }
+        return res;
+    }
+
+    // After CORRUPT or TORN: moves byte by byte to the next offset where a record decodes and is followed by
+    // another one or by the end of the file. False when there is none; the scanner is then at the end of the file.
+    // A length that runs past the end is only a torn write when nothing after it decodes.
+    bool resync()
+    {
+        LastfmHistoryRecord r;
+        while (fill(1))
+        {
+            ++pos_;
+            ++offset_;
+
+            std::size_t size = 0;
+            std::size_t following = 0;
+            if (parseAt(0, size, r) != Result::RECORD)
+                continue;
+            const Result after = parseAt(size, following, r);
+            if (after == Result::RECORD || after == Result::END)
+                return true;
+        }
+        return false;
+    }
+
+    // Where the next record starts: the end of the last complete one, or where resync() stopped.
+    std::uint64_t offset() const
+    {
+        return offset_;
+    }
+
+  private:
+    // The record `at` bytes past the current position; size is set for RECORD and DAMAGED.
+    Result parseAt(std::size_t at, std::size_t& size, LastfmHistoryRecord& out)
+    {
+        std::uint64_t length = 0;
+        std::size_t lengthBytes = 0;
+        for (unsigned shift = 0;; shift += 7)
+        {
+            if (!fill(at + lengthBytes + 1))
+                return lengthBytes == 0 ? Result::END : Result::TORN;
+            const auto b = static_cast<std::uint8_t>(buffer_[pos_ + at + lengthBytes]);
+            ++lengthBytes;
+            length |= static_cast<std::uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80))
+                break;
+            if (shift >= 63)
+                return Result::CORRUPT;
+        }
+        if (length > K_MAX_BODY)
+            return Result::CORRUPT;
+
+        size = lengthBytes + static_cast<std::size_t>(length);
+        if (!fill(at + size))
+            return Result::TORN;
+        return decodeBody(buffer_.data() + pos_ + at + lengthBytes, static_cast<std::size_t>(length), out)
+                   ? Result::RECORD
+                   : Result::DAMAGED;
+    }
+
+    // At least n bytes buffered from the current position; false at the end of the file.
+    bool fill(std::size_t n)
+    {
+        if (end_ - pos_ >= n)
+            return true;
+        if (eof_)
+            return false;
+
+        if (pos_ > 0)
+        {
+            std::memmove(buffer_.data(), buffer_.data() + pos_, end_ - pos_);
+            end_ -= pos_;
+            pos_ = 0;
+        }
+        if (buffer_.size() < n)
+            buffer_.resize(n);
+
+        while (end_ < n)
+        {
+            const std::size_t got = std::fread(buffer_.data() + end_, 1, buffer_.size() - end_, file_);
+            if (got == 0)
+            {
+                eof_ = true;
+                return false;
+            }
+            end_ += got;
+        }
+        return true;
+    }
+
+    std::FILE* file_;
+    std::vector<char> buffer_;
+    std::size_t pos_ = 0;
+    std::size_t end_ = 0;
+    bool eof_ = false;
+    std::uint64_t offset_ = 0;
+};
+} // namespace
+
+LastfmScrobbleHistory::~LastfmScrobbleHistory()
+{
+    close();
+}
+
+bool LastfmScrobbleHistory::open(const std::string& path, std::string& error)
+{
+    close();
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    slots_.clear();
+    bloom_.clear();
+    count_ = 0;
+    rehashLocked(K_MIN_SLOTS);
+
+    std::uint64_t keepBytes = 0;
+    bool rewriteHeader = true;
+    std::uint64_t damaged = 0;
+
+    if (std::FILE* in = std::fopen(path.c_str(), "rb"))
+    {
+        RecordScanner scanner(in);
+        bool empty = false;
+        if (!scanner.readHeader(empty))
+        {
+            std::fclose(in);
+            error = path + " is not a scrobble history file";
+            return false;
+        }
+
+        RecordScanner::Result res = RecordScanner::Result::END;
+        if (!empty)
+        {
+            rewriteHeader = false;
+            LastfmHistoryRecord r;
+            while ((res = scanner.next(r)) != RecordScanner::Result::END)
+            {
+                if (res == RecordScanner::Result::CORRUPT || res == RecordScanner::Result::TORN)
+                {
+                    // Only the end of the file is cut; records behind damage are read from the next one that
+                    // decodes, and the damaged bytes stay.
+                    const std::uint64_t at = scanner.offset();
+                    if (!scanner.resync() && res == RecordScanner::Result::TORN)
+                    {
+                        keepBytes = at;
+                        break;
+                    }
+                    LFM_INFO("History: skipped " << static_cast<unsigned long long>(scanner.offset() - at)
+                                                 << " unreadable byte(s) at byte "
+                                                 << static_cast<unsigned long long>(at));
+                    continue;
+                }
+                if (res == RecordScanner::Result::DAMAGED)
+                {
+                    ++damaged;
+                    continue;
+                }
+                const std::uint64_t key = slotKey(lastfm::util::playKey(r.timestamp, r.artist, r.title));
+                if (containsKeyLocked(key))
+                    continue;
+                insertKeyLocked(key);
+                if (listener_)
+                    listener_(r);
+            }
+        }
+        std::fclose(in);
+
+        if (empty || res == RecordScanner::Result::TORN)
+        {
+            std::error_code ec;
+            std::filesystem::resize_file(path, keepBytes, ec);
+            if (ec)
+            {
+                error = "cannot repair " + path + ": " + ec.message();
+                return false;
+            }
+            if (!empty)
+                LFM_INFO("History: cut an incomplete record at byte " << static_cast<unsigned long long>(keepBytes));
+        }
+    }
+
+    file_ = std::fopen(path.c_str(), "ab");
+    if (!file_)
+    {
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    if (rewriteHeader)
+    {
+        std::fwrite(K_MAGIC, 1, sizeof(K_MAGIC), file_);
+        std::fputc(K_VERSION, file_);
+        std::fflush(file_);
+    }
+
+    path_ = path;
+    lookups_ = filterRejects_ = falsePositives_ = 0;
+
+    if (damaged > 0)
+        LFM_INFO("History: skipped " << static_cast<unsigned long long>(damaged) << " damaged record(s)");
+    LFM_DEBUG("History: " << count_ << " play(s) indexed from " << path.c_str());
+    return true;
+}
+
+void LastfmScrobbleHistory::close()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_)
+    {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+bool LastfmScrobbleHistory::isOpen() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return file_ != nullptr;
+}
+
+bool LastfmScrobbleHistory::containsKey(std::uint64_t playKey) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return containsKeyLocked(slotKey(playKey));
+}
+
+bool LastfmScrobbleHistory::contains(std::time_t timestamp, const std::string& artist, const std::string& title) const
+{
+    return containsKey(lastfm::util::playKey(timestamp, artist, title));
+}
+
+std::size_t LastfmScrobbleHistory::record(const std::vector<LastfmHistoryRecord>& plays)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!file_)
+        return 0;
+
+    // Indexed only once written, so a failed write leaves the plays unrecorded rather than half recorded.
+    std::string out;
+    std::string body;
+    std::vector<std::size_t> added;
+    std::vector<std::uint64_t> keys;
+    LastfmPlayKeySet inBatch;
+    inBatch.reserve(plays.size());
+    for (std::size_t i = 0; i < plays.size(); ++i)
+    {
+        const LastfmHistoryRecord& p = plays[i];
+        const std::uint64_t key = slotKey(lastfm::util::playKey(p.timestamp, p.artist, p.title));
+        if (containsKeyLocked(key) || !inBatch.insert(key))
+            continue;
+        keys.push_back(key);
+        added.push_back(i);
+        encodeRecord(out, body, p);
+    }
+
+    if (out.empty())
+        return 0;
+
+    std::fseek(file_, 0, SEEK_END);
+    const long before = std::ftell(file_);
+    if (std::fwrite(out.data(), 1, out.size(), file_) != out.size() || std::fflush(file_) != 0)
+    {
+        LFM_INFO("History: write to " << path_.c_str() << " failed: " << std::strerror(errno));
+
+        // Cut off what did reach the file, so the next record starts on a record boundary.
+        std::clearerr(file_);
+        std::error_code ec;
+        if (before >= 0)
+            std::filesystem::resize_file(path_, static_cast<std::uintmax_t>(before), ec);
+        return 0;
+    }
+
+    for (std::size_t k = 0; k < keys.size(); ++k)
+    {
+        insertKeyLocked(keys[k]);
+        if (listener_)
+            listener_(plays[added[k]]);
+    }
+    return keys.size();
+}
+
+bool LastfmScrobbleHistory::forEach(const std::function<bool(const LastfmHistoryRecord&)>& f,
+                                    std::string& error) const
+{
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        path = path_;
+    }
+    if (path.empty())
+    {
+        error = "history is not open";
+        return false;
+    }
+
+    // Separate handle, no lock: every record() ends with a flush, so a concurrent append shows up at most as a
+    // torn last record, which ends the walk.
+    std::FILE* in = std::fopen(path.c_str(), "rb");
+    if (!in)
+    {
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    RecordScanner scanner(in);
+    bool empty = false;
+    bool ok = scanner.readHeader(empty);
+    if (!ok)
+        error = path + " is not a scrobble history file";
+
+    LastfmHistoryRecord r;
+    RecordScanner::Result res = RecordScanner::Result::END;
+    while (ok && !empty && (res = scanner.next(r)) != RecordScanner::Result::END)
+    {
+        if (res == RecordScanner::Result::CORRUPT || res == RecordScanner::Result::TORN)
+        {
+            if (!scanner.resync())
+                break;
+        }
+        else if (res == RecordScanner::Result::RECORD && !f(r))
+            break;
+    }
+
+    std::fclose(in);
+    return ok;
+}
+
+LastfmScrobbleHistory::Stats LastfmScrobbleHistory::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats s;
+    s.plays = count_;
+    s.memoryBytes = (slots_.capacity() + bloom_.capacity()) * sizeof(std::uint64_t);
+    s.lookups = lookups_;
+    s.filterRejects = filterRejects_;
+    s.falsePositives = falsePositives_;
+    return s;
+}
+
+bool LastfmScrobbleHistory::containsKeyLocked(std::uint64_t key) const
+{
+    ++lookups_;
+
+    const std::uint64_t h = mix(key);
+    const std::uint64_t bitMask = bloom_.size() * 64 - 1;
+    const std::uint64_t step = (h >> 32) | 1;
+    for (unsigned i = 0; i < K_BLOOM_PROBES; ++i)
+    {
+        const std::uint64_t bit = (h + i * step) & bitMask;
+        if (!(bloom_[bit >> 6] & (1ULL << (bit & 63))))
+        {
+            ++filterRejects_;
+            return false;
+        }
+    }
+
+    const std::size_t mask = slots_.size() - 1;
+    for (std::size_t i = static_cast<std::size_t>(h) & mask;; i = (i + 1) & mask)
+    {
+        if (slots_[i] == key)
+            return true;
+        if (slots_[i] == 0)
+        {
+            ++falsePositives_;
+            return false;
+        }
+    }
+}
+
+void LastfmScrobbleHistory::insertKeyLocked(std::uint64_t key)
+{
+    // Load factor at most 0.7.
+    if ((count_ + 1) * 10 > slots_.size() * 7)
+        rehashLocked(slots_.size() * 2);
+
+    const std::uint64_t h = mix(key);
+    const std::uint64_t bitMask = bloom_.size() * 64 - 1;
+    const std::uint64_t step = (h >> 32) | 1;
+    for (unsigned i = 0; i < K_BLOOM_PROBES; ++i)
+    {
+        const std::uint64_t bit = (h + i * step) & bitMask;
+        bloom_[bit >> 6] |= 1ULL << (bit & 63);
+    }
+
+    const std::size_t mask = slots_.size() - 1;
+    std::size_t i = static_cast<std::size_t>(h) & mask;
+    while (slots_[i] != 0)
+        i = (i + 1) & mask;
+    slots_[i] = key;
+    ++count_;
+}
+
+void LastfmScrobbleHistory::rehashLocked(std::size_t slots)
+{
+    std::vector<std::uint64_t> old;
+    old.swap(slots_);
+
+    slots_.assign(slots, 0);
+    bloom_.assign(slots * K_BLOOM_BITS_PER_SLOT / 64, 0);
+    count_ = 0;
+
+    for (const std::uint64_t key : old)
+    {
+        if (key != 0)
+            insertKeyLocked(key);
+    }
+}
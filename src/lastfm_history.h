@@ -0,0 +1,110 @@
+//
+//  lastfm_history.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// One acknowledged scrobble.
+struct LastfmHistoryRecord
+{
+    std::time_t timestamp = 0; // play start, UTC
+    std::string artist;
+    std::string title;
+    std::string album;
+    std::string albumArtist;
+    double durationSeconds = 0.0;
+};
+
+// What the queue needs from the history: O(1) duplicate checks by lastfm::util::playKey() and recording of
+// acknowledged plays.
+class ILastfmScrobbleHistory
+{
+  public:
+    virtual ~ILastfmScrobbleHistory() = default;
+
+    virtual bool containsKey(std::uint64_t playKey) const = 0;
+
+    // Appends the plays that are not recorded yet; returns how many were new.
+    virtual std::size_t record(const std::vector<LastfmHistoryRecord>& plays) = 0;
+};
+
+// Append-only file of acknowledged scrobbles with an in-memory duplicate index: a Bloom filter (11 to 23 bits
+// per play, small enough to stay in cache) in front of an open-addressing table of 64-bit play keys. A play
+// that was never scrobbled is usually rejected by the filter alone; the table settles the rest. Memory is
+// 12 to 26 bytes per recorded play; strings stay on disk.
+//
+// File layout: "LFMHIST", u8 version, then records of varint body length + body: varint timestamp,
+// varint duration seconds, strings artist, title, album, album artist (varint length + bytes). A record cut
+// short by a crash at the end of the file is cut off when the file is opened again; a damaged body is skipped by
+// its length, and bytes without a plausible length are skipped up to the next record that decodes.
+class LastfmScrobbleHistory final : public ILastfmScrobbleHistory
+{
+  public:
+    struct Stats
+    {
+        std::size_t plays = 0;
+        std::size_t memoryBytes = 0;
+        std::uint64_t lookups = 0;
+        std::uint64_t filterRejects = 0; // answered by the Bloom filter alone
+        std::uint64_t falsePositives = 0; // filter said maybe, table said no
+    };
+
+    LastfmScrobbleHistory() = default;
+    LastfmScrobbleHistory(const LastfmScrobbleHistory&) = delete;
+    LastfmScrobbleHistory& operator=(const LastfmScrobbleHistory&) = delete;
+    ~LastfmScrobbleHistory() override;
+
+    // Sees every play once: as open() indexes the file and as record() appends it. Runs under the history lock;
+    // set before open().
+    void setRecordListener(std::function<void(const LastfmHistoryRecord&)> listener)
+    {
+        listener_ = std::move(listener);
+    }
+
+    // Creates the file if needed and indexes it.
+    bool open(const std::string& path, std::string& error);
+    void close();
+    bool isOpen() const;
+
+    bool containsKey(std::uint64_t playKey) const override;
+    bool contains(std::time_t timestamp, const std::string& artist, const std::string& title) const;
+
+    // One buffered write and flush per call; the plays are indexed only once it succeeded.
+    std::size_t record(const std::vector<LastfmHistoryRecord>& plays) override;
+
+    // Reads every record from the start of the file, oldest first, one at a time; false from f stops the walk.
+    bool forEach(const std::function<bool(const LastfmHistoryRecord&)>& f, std::string& error) const;
+
+    Stats stats() const;
+
+  private:
+    bool containsKeyLocked(std::uint64_t key) const;
+    void insertKeyLocked(std::uint64_t key);
+    void rehashLocked(std::size_t slots);
+
+    mutable std::mutex mutex_;
+    std::string path_;
+    std::FILE* file_ = nullptr; // append handle
+    std::function<void(const LastfmHistoryRecord&)> listener_;
+
+    std::vector<std::uint64_t> slots_; // 0 = empty; power-of-two size
+    std::vector<std::uint64_t> bloom_; // 8 bits per slot
+    std::size_t count_ = 0;
+
+    mutable std::uint64_t lookups_ = 0;
+    mutable std::uint64_t filterRejects_ = 0;
+    mutable std::uint64_t falsePositives_ = 0;
+};
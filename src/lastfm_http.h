@@ -0,0 +1,42 @@
+//
+//  lastfm_http.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+struct LastfmHttpHeader
+{
+    std::string name;
+    std::string value;
+};
+
+// Blocking HTTP request returning the whole response body. The plugin goes through foobar2000's http_client
+// (lastfm_platform_fb2k.h); tools plug in their own transport.
+class ILastfmHttpTransport
+{
+  public:
+    virtual ~ILastfmHttpTransport() = default;
+
+    // True when a response body was received, whatever its content. outError is set on failure.
+    virtual bool request(const char* method, const std::string& url, std::string& outBody, std::string& outError) = 0;
+
+    // POST with a request body and extra headers (JSON APIs). Unlike request(), a 4xx/5xx answer still counts as a
+    // response so the caller can read the service's error body.
+    virtual bool post(const std::string& url, const std::vector<LastfmHttpHeader>& headers, const char* contentType,
+                      const std::string& body, std::string& outBody, std::string& outError)
+    {
+        (void)url;
+        (void)headers;
+        (void)contentType;
+        (void)body;
+        outBody.clear();
+        outError = "POST with a body is not supported by this transport.";
+        return false;
+    }
+};
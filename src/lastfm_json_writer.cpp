@@ -0,0 +1,183 @@
+//
+//  lastfm_json_writer.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "lastfm_json_writer.h"
+
+#include <charconv>
+
+namespace
+{
+// Length of the well-formed UTF-8 sequence at s (RFC 3629: no overlong forms, no surrogates, at most U+10FFFF),
+// or 0 if there is none.
+static std::size_t utf8SequenceLength(const unsigned char* s, std::size_t n)
+{
+    std::size_t len = 0;
+    unsigned char lo = 0x80;
+    unsigned char hi = 0xbf;
+    if (s[0] >= 0xc2 && s[0] <= 0xdf)
+        len = 2;
+    else if (s[0] >= 0xe0 && s[0] <= 0xef)
+    {
+        len = 3;
+        lo = s[0] == 0xe0 ? 0xa0 : 0x80;
+        hi = s[0] == 0xed ? 0x9f : 0xbf;
+    }
+    else if (s[0] >= 0xf0 && s[0] <= 0xf4)
+    {
+        len = 4;
+        lo = s[0] == 0xf0 ? 0x90 : 0x80;
+        hi = s[0] == 0xf4 ? 0x8f : 0xbf;
+    }
+    if (len == 0 || len > n || s[1] < lo || s[1] > hi)
+        return 0;
+    for (std::size_t i = 2; i < len; ++i)
+        if (s[i] < 0x80 || s[i] > 0xbf)
+            return 0;
+    return len;
+}
+} // namespace
+
+void LastfmJsonWriter::appendEscaped(std::string& out, std::string_view value)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    std::size_t run = 0; // start of the pending unescaped stretch
+    for (std::size_t i = 0; i < value.size(); ++i)
+    {
+        const unsigned char c = static_cast<unsigned char>(value[i]);
+        if (c >= 0x20 && c < 0x80 && c != '"' && c != '\\')
+            continue;
+        if (c >= 0x80)
+        {
+            const std::size_t len =
+                utf8SequenceLength(reinterpret_cast<const unsigned char*>(value.data()) + i, value.size() - i);
+            if (len > 0)
+            {
+                i += len - 1;
+                continue;
+            }
+        }
+
+        out.append(value.data() + run, i - run);
+        run = i + 1;
+
+        switch (c)
+        {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+        {
+            if (c >= 0x80)
+            {
+                out += "\xef\xbf\xbd"; // U+FFFD for each byte that is not part of a well-formed sequence
+                break;
+            }
+            const char u[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf]};
+            out.append(u, sizeof(u));
+            break;
+        }
+        }
+    }
+    out.append(value.data() + run, value.size() - run);
+}
+
+void LastfmJsonWriter::beforeValue()
+{
+    if (afterKey_)
+    {
+        afterKey_ = false;
+        return;
+    }
+
+    if (depth_ > 0)
+    {
+        const std::uint64_t bit = 1ull << (depth_ - 1);
+        if (hasItems_ & bit)
+            out_ += ',';
+        hasItems_ |= bit;
+    }
+}
+
+void LastfmJsonWriter::open(char c)
+{
+    beforeValue();
+    out_ += c;
+    ++depth_;
+    hasItems_ &= ~(1ull << (depth_ - 1));
+}
+
+void LastfmJsonWriter::close(char c)
+{
+    out_ += c;
+    if (depth_ > 0)
+        --depth_;
+}
+
+LastfmJsonWriter& LastfmJsonWriter::beginObject()
+{
+    open('{');
+    return *this;
+}
+
+LastfmJsonWriter& LastfmJsonWriter::endObject()
+{
+    close('}');
+    return *this;
+}
+
+LastfmJsonWriter& LastfmJsonWriter::beginArray()
+{
+    open('[');
+    return *this;
+}
+
+LastfmJsonWriter& LastfmJsonWriter::endArray()
+{
+    close(']');
+    return *this;
+}
+
+LastfmJsonWriter& LastfmJsonWriter::key(std::string_view name)
+{
+    beforeValue();
+    out_ += '"';
+    appendEscaped(out_, name);
+    out_ += "\":";
+    afterKey_ = true;
+    return *this;
+}
+
+LastfmJsonWriter& LastfmJsonWriter::string(std::string_view value)
+{
+    beforeValue();
+    out_ += '"';
+    appendEscaped(out_, value);
+    out_ += '"';
+    return *this;
+}
+
+LastfmJsonWriter& LastfmJsonWriter::integer(long long value)
+{
+    beforeValue();
+    char num[24];
+    const auto r = std::to_chars(num, num + sizeof(num), value);
+    out_.append(num, r.ptr);
+    return *this;
+}
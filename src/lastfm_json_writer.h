@@ -0,0 +1,47 @@
+//
+//  lastfm_json_writer.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Streaming JSON writer: appends straight into a caller-owned buffer as values are written, no document tree.
+// Commas are inserted automatically; the caller keeps objects/arrays balanced (at most 64 levels deep).
+class LastfmJsonWriter
+{
+  public:
+    explicit LastfmJsonWriter(std::string& out) : out_(out)
+    {
+    }
+
+    LastfmJsonWriter& beginObject();
+    LastfmJsonWriter& endObject();
+    LastfmJsonWriter& beginArray();
+    LastfmJsonWriter& endArray();
+
+    // Inside an object: the next value belongs to this key.
+    LastfmJsonWriter& key(std::string_view name);
+
+    LastfmJsonWriter& string(std::string_view value);
+    LastfmJsonWriter& integer(long long value);
+
+    // Escapes for a JSON string body (no surrounding quotes). Well-formed UTF-8 passes through unchanged; other
+    // bytes become U+FFFD, so the output is always valid JSON.
+    static void appendEscaped(std::string& out, std::string_view value);
+
+  private:
+    void beforeValue();
+    void open(char c);
+    void close(char c);
+
+    std::string& out_;
+    std::uint64_t hasItems_ = 0; // bit per nesting level: something was written at that level
+    unsigned depth_ = 0;
+    bool afterKey_ = false;
+};
@@ -0,0 +1,102 @@
+//
+//  lastfm_key_set.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Set of 64-bit play keys in one open-addressing table (linear probing, load factor at most 0.7): 12 to 23 bytes
+// per key, against 40 or more for a node of std::unordered_set. Key 0 is folded onto 1, as a hash of FNV-1a
+// strings it only costs an occasional false duplicate.
+class LastfmPlayKeySet
+{
+  public:
+    void reserve(std::size_t keys)
+    {
+        std::size_t slots = 16;
+        while (slots * 7 < keys * 10)
+            slots *= 2;
+        if (slots > slots_.size())
+            rehash(slots);
+    }
+
+    // False if the key was already present.
+    bool insert(std::uint64_t key)
+    {
+        if ((count_ + 1) * 10 > slots_.size() * 7)
+            rehash(slots_.empty() ? 16 : slots_.size() * 2);
+
+        key = key ? key : 1;
+        const std::size_t mask = slots_.size() - 1;
+        for (std::size_t i = static_cast<std::size_t>(mix(key)) & mask;; i = (i + 1) & mask)
+        {
+            if (slots_[i] == key)
+                return false;
+            if (slots_[i] == 0)
+            {
+                slots_[i] = key;
+                ++count_;
+                return true;
+            }
+        }
+    }
+
+    bool contains(std::uint64_t key) const
+    {
+        if (slots_.empty())
+            return false;
+
+        key = key ? key : 1;
+        const std::size_t mask = slots_.size() - 1;
+        for (std::size_t i = static_cast<std::size_t>(mix(key)) & mask;; i = (i + 1) & mask)
+        {
+            if (slots_[i] == key)
+                return true;
+            if (slots_[i] == 0)
+                return false;
+        }
+    }
+
+    std::size_t size() const
+    {
+        return count_;
+    }
+
+  private:
+    static std::uint64_t mix(std::uint64_t x)
+    {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    void rehash(std::size_t slots)
+    {
+        std::vector<std::uint64_t> old;
+        old.swap(slots_);
+        slots_.assign(slots, 0);
+
+        const std::size_t mask = slots - 1;
+        for (const std::uint64_t key : old)
+        {
+            if (key == 0)
+                continue;
+            std::size_t i = static_cast<std::size_t>(mix(key)) & mask;
+            while (slots_[i] != 0)
+                i = (i + 1) & mask;
+            slots_[i] = key;
+        }
+    }
+
+    std::vector<std::uint64_t> slots_; // 0 = empty; power-of-two size
+    std::size_t count_ = 0;
+};
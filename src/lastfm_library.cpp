@@ -0,0 +1,155 @@
+//
+//  lastfm_library.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "lastfm_library.h"
+#include "debug.h"
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+// Handles seen by the tracker, not the whole library: a few thousand covers long sessions.
+static constexpr std::size_t K_MAX_ENTRIES = 4096;
+
+// Least recently used entries go first when full, so a large playlist played through does not evict the tracks
+// that keep coming back.
+class MembershipCache
+{
+  public:
+    bool lookup(const metadb_handle_ptr& track, bool& inLibrary)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(track.get_ptr());
+        if (it == index_.end())
+            return false;
+
+        lru_.splice(lru_.begin(), lru_, it->second);
+        inLibrary = it->second->inLibrary;
+        return true;
+    }
+
+    void store(const metadb_handle_ptr& track, bool inLibrary)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_)
+            return;
+
+        auto it = index_.find(track.get_ptr());
+        if (it != index_.end())
+        {
+            it->second->inLibrary = inLibrary;
+            lru_.splice(lru_.begin(), lru_, it->second);
+            return;
+        }
+
+        if (lru_.size() >= K_MAX_ENTRIES)
+        {
+            index_.erase(lru_.back().handle.get_ptr());
+            lru_.pop_back();
+        }
+
+        // The entry holds a reference, so the pointer key cannot be reused by another item while cached.
+        lru_.push_front(Entry{track, inLibrary});
+        index_[track.get_ptr()] = lru_.begin();
+    }
+
+    // Only items already cached are updated; a library scan must not fill the cache.
+    void update(metadb_handle_list_cref items, bool inLibrary)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (index_.empty())
+            return;
+
+        const std::size_t count = items.get_count();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            auto it = index_.find(items[i].get_ptr());
+            if (it != index_.end())
+                it->second->inLibrary = inLibrary;
+        }
+    }
+
+    // Drops the handle references before the metadb goes away; nothing is cached afterwards.
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        index_.clear();
+        lru_.clear();
+    }
+
+  private:
+    struct Entry
+    {
+        metadb_handle_ptr handle;
+        bool inLibrary = false;
+    };
+
+    std::mutex mutex_;
+    std::list<Entry> lru_; // most recently used first
+    std::unordered_map<const metadb_handle*, std::list<Entry>::iterator> index_;
+    bool closed_ = false;
+};
+
+static MembershipCache& membershipCache()
+{
+    static MembershipCache cache;
+    return cache;
+}
+
+class LastfmLibraryCallback : public library_callback
+{
+  public:
+    void on_items_added(metadb_handle_list_cref items) override
+    {
+        membershipCache().update(items, true);
+    }
+
+    void on_items_removed(metadb_handle_list_cref items) override
+    {
+        membershipCache().update(items, false);
+    }
+
+    void on_items_modified(metadb_handle_list_cref) override
+    {
+    }
+};
+
+static library_callback_factory_t<LastfmLibraryCallback> lastfmLibraryCallbackFactory;
+} // namespace
+
+bool lastfmLookupMediaLibrary(const metadb_handle_ptr& track, bool& inLibrary)
+{
+    if (!track.is_valid())
+    {
+        inLibrary = false;
+        return true;
+    }
+
+    return membershipCache().lookup(track, inLibrary);
+}
+
+bool lastfmIsInMediaLibrary(const metadb_handle_ptr& track)
+{
+    bool inLibrary = false;
+    if (lastfmLookupMediaLibrary(track, inLibrary))
+        return inLibrary;
+
+    static_api_ptr_t<library_manager> lm;
+    inLibrary = lm->is_item_in_library(track);
+    membershipCache().store(track, inLibrary);
+
+    LFM_DEBUG("Media Library: cached membership=" << (inLibrary ? "yes" : "no"));
+    return inLibrary;
+}
+
+void lastfmMediaLibraryShutdown()
+{
+    membershipCache().close();
+}
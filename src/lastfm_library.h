@@ -0,0 +1,20 @@
+//
+//  lastfm_library.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <foobar2000/SDK/foobar2000.h>
+
+// Media Library membership, cached per handle and kept current by a library_callback (add/remove).
+// Only the first check of a handle asks library_manager; main thread only, like library_manager itself.
+bool lastfmIsInMediaLibrary(const metadb_handle_ptr& track);
+
+// Cached answer only, never touches library_manager. Returns false if the handle is not cached yet.
+bool lastfmLookupMediaLibrary(const metadb_handle_ptr& track, bool& inLibrary);
+
+// Releases the cached handles; call on quit, after playback tracking has stopped.
+void lastfmMediaLibraryShutdown();
@@ -0,0 +1,196 @@
+//
+//  lastfm_listenbrainz.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "lastfm_listenbrainz.h"
+#include "lastfm_json_writer.h"
+#include "lastfm_util.h"
+#include "debug.h"
+#include "version.h"
+
+#include <cmath>
+#include <utility>
+
+namespace lastfm
+{
+namespace listenbrainz
+{
+void appendImportPayload(std::string& out, const std::vector<LastfmSinkScrobble>& batch, std::size_t begin,
+                         std::size_t end)
+{
+    LastfmJsonWriter w(out);
+    w.beginObject();
+    w.key("listen_type").string("import");
+    w.key("payload").beginArray();
+
+    for (std::size_t i = begin; i < end && i < batch.size(); ++i)
+    {
+        const LastfmSinkScrobble& s = batch[i];
+        const LastfmTrackInfo& t = s.track;
+
+        w.beginObject();
+        w.key("listened_at").integer(static_cast<long long>(s.startTimestamp));
+        w.key("track_metadata").beginObject();
+        w.key("artist_name").string(t.artist);
+        w.key("track_name").string(t.title);
+        if (!t.album.empty())
+            w.key("release_name").string(t.album);
+
+        w.key("additional_info").beginObject();
+        w.key("media_player").string("foobar2000");
+        w.key("submission_client").string(FOOSCROBBLER_NAME);
+        w.key("submission_client_version").string(FOOSCROBBLER_VERSION);
+        if (t.durationSeconds > 0.0)
+            w.key("duration_ms").integer(std::llround(t.durationSeconds * 1000.0));
+        if (!t.mbid.empty())
+            w.key("recording_mbid").string(t.mbid);
+        if (!t.albumArtist.empty())
+            w.key("release_artist_name").string(t.albumArtist);
+        w.endObject();
+
+        w.endObject();
+        w.endObject();
+    }
+
+    w.endArray();
+    w.endObject();
+}
+
+LastfmScrobbleResult classifyResponse(bool httpOk, const std::string& httpError, const std::string& body, int* code)
+{
+    int unused = 0;
+    int& status = code ? *code : unused;
+    status = 0;
+
+    if (!httpOk)
+    {
+        LFM_INFO("ListenBrainz HTTP failure: " << (httpError.empty() ? "unknown error" : httpError.c_str()));
+        return LastfmScrobbleResult::TEMPORARY_ERROR;
+    }
+
+    std::string state;
+    if (util::jsonFindStringValue(body.c_str(), "status", state) && state == "ok")
+        return LastfmScrobbleResult::SUCCESS;
+
+    // Errors are {"code": <http status>, "error": "..."}; anything else is a proxy page or a truncated answer.
+    if (!util::jsonFindIntValue(body.c_str(), "code", status))
+    {
+        LFM_INFO("ListenBrainz response is not valid JSON (size=" << body.size() << ")");
+        status = 0;
+        return LastfmScrobbleResult::TEMPORARY_ERROR;
+    }
+
+    std::string error;
+    util::jsonFindStringValue(body.c_str(), "error", error);
+    LFM_INFO("ListenBrainz error " << status << ": " << error.c_str());
+
+    if (status == 401)
+        return LastfmScrobbleResult::INVALID_SESSION;
+    if (status == 429)
+        return LastfmScrobbleResult::RATE_LIMITED;
+    if (status >= 500)
+        return LastfmScrobbleResult::TEMPORARY_ERROR;
+    return LastfmScrobbleResult::OTHER_ERROR;
+}
+} // namespace listenbrainz
+} // namespace lastfm
+
+LastfmListenBrainzSink::LastfmListenBrainzSink(ILastfmHttpTransport& http, std::function<std::string()> token,
+                                               std::string baseUrl)
+    : http_(http), token_(std::move(token)), submitUrl_(std::move(baseUrl))
+{
+    if (!submitUrl_.empty() && submitUrl_.back() != '/')
+        submitUrl_ += '/';
+    submitUrl_ += "1/submit-listens";
+}
+
+bool LastfmListenBrainzSink::ready() const
+{
+    const std::string token = token_ ? token_() : std::string();
+    if (token.empty())
+        return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    return token != rejectedToken_;
+}
+
+void LastfmListenBrainzSink::submit(const std::vector<LastfmSinkScrobble>& batch,
+                                    std::vector<LastfmScrobbleResult>& results)
+{
+    results.clear();
+    results.reserve(batch.size());
+
+    const std::string token = token_ ? token_() : std::string();
+    if (token.empty() || batch.empty())
+        return;
+
+    splitPosts_ = 0;
+    settleRange(batch, 0, batch.size(), token, post(batch, 0, batch.size(), token), false, results);
+}
+
+LastfmListenBrainzSink::Answer LastfmListenBrainzSink::post(const std::vector<LastfmSinkScrobble>& batch,
+                                                            std::size_t begin, std::size_t end,
+                                                            const std::string& token)
+{
+    payload_.clear();
+    lastfm::listenbrainz::appendImportPayload(payload_, batch, begin, end);
+
+    Answer a;
+    std::string httpError;
+    const bool httpOk = http_.post(submitUrl_, {{"Authorization", "Token " + token}}, "application/json", payload_,
+                                   a.body, httpError);
+    a.result = lastfm::listenbrainz::classifyResponse(httpOk, httpError, a.body, &a.code);
+    LFM_DEBUG("ListenBrainz: " << (unsigned)(end - begin) << " listen(s) sent, " << (unsigned)payload_.size()
+                               << " bytes.");
+    return a;
+}
+
+// Records the answer for batch[begin, end). bothHalvesFailed: the enclosing split had both halves rejected with
+// the same error. False once the sink has to stop (rate limit, rejected token).
+bool LastfmListenBrainzSink::settleRange(const std::vector<LastfmSinkScrobble>& batch, std::size_t begin,
+                                         std::size_t end, const std::string& token, const Answer& answer,
+                                         bool bothHalvesFailed, std::vector<LastfmScrobbleResult>& results)
+{
+    const LastfmScrobbleResult r = answer.result;
+
+    // 400 is a malformed listen, which fails the whole request: halve until it is isolated. Both halves rejected
+    // alike at two nested splits means the request itself is at fault (a bad listen in each half only explains
+    // one level), so the range fails as a whole; the split budget bounds a batch full of bad listens.
+    if (r == LastfmScrobbleResult::OTHER_ERROR && answer.code == 400 && end - begin > 1 &&
+        splitPosts_ + 2 <= K_MAX_SPLIT_POSTS)
+    {
+        const std::size_t mid = begin + (end - begin) / 2;
+        splitPosts_ += 2;
+        const Answer left = post(batch, begin, mid, token);
+        if (left.result == LastfmScrobbleResult::RATE_LIMITED || left.result == LastfmScrobbleResult::INVALID_SESSION)
+            return settleRange(batch, begin, mid, token, left, false, results);
+
+        const Answer right = post(batch, mid, end, token);
+        const bool alike =
+            left.code == 400 && right.code == 400 && left.body == answer.body && right.body == answer.body;
+        if (!(alike && bothHalvesFailed))
+            return settleRange(batch, begin, mid, token, left, alike, results) &&
+                   settleRange(batch, mid, end, token, right, alike, results);
+
+        LFM_INFO("ListenBrainz: " << (unsigned)(end - begin) << " listen(s) rejected as a whole, not split further.");
+    }
+
+    if (r == LastfmScrobbleResult::INVALID_SESSION)
+    {
+        LFM_INFO("ListenBrainz rejected the user token; paused until it is changed.");
+        std::lock_guard<std::mutex> lock(mutex_);
+        rejectedToken_ = token;
+    }
+
+    if (r == LastfmScrobbleResult::INVALID_SESSION || r == LastfmScrobbleResult::RATE_LIMITED)
+    {
+        results.push_back(r);
+        return false;
+    }
+
+    results.insert(results.end(), end - begin, r);
+    return true;
+}
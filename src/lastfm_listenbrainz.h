@@ -0,0 +1,87 @@
+//
+//  lastfm_listenbrainz.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "lastfm_http.h"
+#include "lastfm_scrobble_sink.h"
+
+namespace lastfm
+{
+namespace listenbrainz
+{
+inline constexpr const char* DEFAULT_API_BASE_URL = "https://api.listenbrainz.org/";
+
+// Listens per submit-listens request. The server takes up to 1000; half keeps a request well under its size cap.
+inline constexpr std::size_t BATCH_SIZE = 500;
+
+// submit-listens body with listen_type "import" for batch[begin, end).
+void appendImportPayload(std::string& out, const std::vector<LastfmSinkScrobble>& batch, std::size_t begin,
+                         std::size_t end);
+
+// Maps a submit-listens answer onto the result the queue acts on. code, when given, receives the error's HTTP
+// status (0 for success or an unreadable answer).
+LastfmScrobbleResult classifyResponse(bool httpOk, const std::string& httpError, const std::string& body,
+                                      int* code = nullptr);
+} // namespace listenbrainz
+} // namespace lastfm
+
+// ListenBrainz sink (slot lastfm::sink::LISTENBRAINZ): bulk submit-listens "import" requests of up to BATCH_SIZE
+// listens. The user token is fetched per batch; a token the server rejected makes the sink not ready until it
+// changes. A batch answered 400 is halved to isolate the malformed listens, at most K_MAX_SPLIT_POSTS extra
+// requests per batch; other 4xx answers fail the whole batch.
+class LastfmListenBrainzSink final : public ILastfmScrobbleSink
+{
+  public:
+    LastfmListenBrainzSink(ILastfmHttpTransport& http, std::function<std::string()> token,
+                           std::string baseUrl = lastfm::listenbrainz::DEFAULT_API_BASE_URL);
+
+    const char* name() const override
+    {
+        return "ListenBrainz";
+    }
+
+    bool ready() const override;
+
+    std::size_t maxBatch() const override
+    {
+        return lastfm::listenbrainz::BATCH_SIZE;
+    }
+
+    void submit(const std::vector<LastfmSinkScrobble>& batch, std::vector<LastfmScrobbleResult>& results) override;
+
+  private:
+    static constexpr unsigned K_MAX_SPLIT_POSTS = 40; // isolates two bad listens in a full batch
+
+    struct Answer
+    {
+        LastfmScrobbleResult result = LastfmScrobbleResult::OTHER_ERROR;
+        int code = 0;
+        std::string body;
+    };
+
+    Answer post(const std::vector<LastfmSinkScrobble>& batch, std::size_t begin, std::size_t end,
+                const std::string& token);
+    bool settleRange(const std::vector<LastfmSinkScrobble>& batch, std::size_t begin, std::size_t end,
+                     const std::string& token, const Answer& answer, bool bothHalvesFailed,
+                     std::vector<LastfmScrobbleResult>& results);
+
+    ILastfmHttpTransport& http_;
+    std::function<std::string()> token_;
+    std::string submitUrl_;
+    std::string payload_; // reused between requests
+    unsigned splitPosts_ = 0; // requests spent halving the current batch
+
+    mutable std::mutex mutex_;
+    std::string rejectedToken_;
+};
@@ -0,0 +1,345 @@
+//
+//  lastfm_log.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "lastfm_log.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+// Power of two. Producers never block: when the ring is full the record is counted and dropped.
+static constexpr std::size_t RING_CAPACITY = 512;
+static constexpr std::size_t RING_MASK = RING_CAPACITY - 1;
+
+// Drained records kept for lastfmLogDump().
+static constexpr std::size_t HISTORY_CAPACITY = 256;
+
+static constexpr auto IDLE_WAIT = std::chrono::milliseconds(200);
+
+static void stderrSink(const char* line)
+{
+    std::fprintf(stderr, "foo_scrobbler_mac: %s\n", line);
+}
+
+// Bounded MPMC queue (Vyukov): each cell carries a sequence number that tells producers and the
+// consumer whether it is free or filled for a given lap. One CAS per push, no locks.
+class LogRing
+{
+  public:
+    LogRing()
+    {
+        for (std::size_t i = 0; i < RING_CAPACITY; ++i)
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    bool push(const LastfmLogRecord& rec)
+    {
+        std::size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        Cell* cell = nullptr;
+
+        for (;;)
+        {
+            cell = &cells_[pos & RING_MASK];
+            const std::size_t seq = cell->seq.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+
+            if (diff == 0)
+            {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false; // full
+            }
+            else
+            {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        copyRecord(cell->rec, rec);
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Single consumer (the log thread, or the flushing thread after it stopped).
+    bool pop(LastfmLogRecord& out)
+    {
+        const std::size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        Cell& cell = cells_[pos & RING_MASK];
+        const std::size_t seq = cell.seq.load(std::memory_order_acquire);
+
+        if (static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1) < 0)
+            return false; // empty, or the producer is still writing this cell
+
+        copyRecord(out, cell.rec);
+        cell.seq.store(pos + RING_CAPACITY, std::memory_order_release);
+        dequeuePos_.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    static void copyRecord(LastfmLogRecord& dst, const LastfmLogRecord& src)
+    {
+        dst.timeMs = src.timeMs;
+        dst.thread = src.thread;
+        dst.level = src.level;
+        dst.length = src.length;
+        std::memcpy(dst.text, src.text, src.length + 1u);
+    }
+
+  private:
+    struct Cell
+    {
+        std::atomic<std::size_t> seq{0};
+        LastfmLogRecord rec;
+    };
+
+    Cell cells_[RING_CAPACITY];
+    alignas(64) std::atomic<std::size_t> enqueuePos_{0};
+    alignas(64) std::atomic<std::size_t> dequeuePos_{0};
+};
+
+class LogState
+{
+  public:
+    ~LogState()
+    {
+        shutdown();
+    }
+
+    void commit(const LastfmLogRecord& rec)
+    {
+        if (stopped_.load(std::memory_order_acquire))
+            return;
+
+        if (!ring_.push(rec))
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        if (!started_.load(std::memory_order_acquire))
+            start();
+        else if (waiting_.load(std::memory_order_acquire))
+            cv_.notify_one();
+    }
+
+    void setSink(LastfmLogSink sink)
+    {
+        sink_.store(sink ? sink : &stderrSink, std::memory_order_release);
+    }
+
+    void dump()
+    {
+        std::vector<LastfmLogRecord> copy;
+        {
+            std::lock_guard<std::mutex> lock(historyMutex_);
+            copy.reserve(historyCount_);
+
+            const std::size_t first = (historyNext_ + HISTORY_CAPACITY - historyCount_) % HISTORY_CAPACITY;
+            for (std::size_t i = 0; i < historyCount_; ++i)
+                copy.push_back(history_[(first + i) % HISTORY_CAPACITY]);
+        }
+
+        const LastfmLogSink sink = sink_.load(std::memory_order_acquire);
+        sink(("---- log buffer: " + std::to_string(copy.size()) + " record(s) ----").c_str());
+        for (const auto& rec : copy)
+            sink(lastfmLogFormatRecord(rec).c_str());
+        sink("---- end of log buffer ----");
+    }
+
+    void shutdown()
+    {
+        if (stopped_.exchange(true, std::memory_order_acq_rel))
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(threadMutex_);
+            stopRequested_ = true;
+        }
+        cv_.notify_one();
+
+        if (thread_.joinable())
+            thread_.join();
+    }
+
+  private:
+    void start()
+    {
+        std::lock_guard<std::mutex> lock(threadMutex_);
+        if (started_.load(std::memory_order_relaxed) || stopRequested_)
+            return;
+
+        thread_ = std::thread([this] { run(); });
+        started_.store(true, std::memory_order_release);
+    }
+
+    void run()
+    {
+        for (;;)
+        {
+            drainOnce();
+
+            std::unique_lock<std::mutex> lock(threadMutex_);
+            if (stopRequested_)
+                break;
+
+            // A producer that misses the flag is picked up on the next timeout.
+            waiting_.store(true, std::memory_order_release);
+            cv_.wait_for(lock, IDLE_WAIT);
+            waiting_.store(false, std::memory_order_release);
+        }
+
+        drainOnce();
+    }
+
+    void drainOnce()
+    {
+        const LastfmLogSink sink = sink_.load(std::memory_order_acquire);
+
+        const unsigned dropped = dropped_.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0)
+            sink(("log ring full, " + std::to_string(dropped) + " record(s) dropped").c_str());
+
+        LastfmLogRecord rec;
+        while (ring_.pop(rec))
+        {
+            sink(rec.text);
+
+            std::lock_guard<std::mutex> lock(historyMutex_);
+            LogRing::copyRecord(history_[historyNext_], rec);
+            historyNext_ = (historyNext_ + 1) % HISTORY_CAPACITY;
+            if (historyCount_ < HISTORY_CAPACITY)
+                ++historyCount_;
+        }
+    }
+
+    LogRing ring_;
+
+    std::atomic<LastfmLogSink> sink_{&stderrSink};
+    std::atomic<unsigned> dropped_{0};
+    std::atomic<bool> started_{false};
+    std::atomic<bool> stopped_{false};
+    std::atomic<bool> waiting_{false};
+
+    std::mutex threadMutex_;
+    std::condition_variable cv_;
+    std::thread thread_;
+    bool stopRequested_ = false;
+
+    std::mutex historyMutex_;
+    LastfmLogRecord history_[HISTORY_CAPACITY];
+    std::size_t historyNext_ = 0;
+    std::size_t historyCount_ = 0;
+};
+
+static LogState& logState()
+{
+    static LogState state;
+    return state;
+}
+
+static std::uint32_t currentThreadTag()
+{
+    static thread_local const std::uint32_t tag =
+        static_cast<std::uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()) & 0xffffu);
+    return tag;
+}
+} // namespace
+
+LastfmLogLine::LastfmLogLine(LfmLogLevel level)
+{
+    rec_.timeMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      std::chrono::system_clock::now().time_since_epoch())
+                      .count();
+    rec_.thread = currentThreadTag();
+    rec_.level = static_cast<std::uint8_t>(level);
+    rec_.length = 0;
+    rec_.text[0] = '\0';
+}
+
+void LastfmLogLine::append(const char* s, std::size_t n)
+{
+    const std::size_t room = LastfmLogRecord::TEXT_CAPACITY - 1 - rec_.length;
+    if (n > room)
+        n = room;
+
+    std::memcpy(rec_.text + rec_.length, s, n);
+    rec_.length = static_cast<std::uint16_t>(rec_.length + n);
+    rec_.text[rec_.length] = '\0';
+}
+
+void LastfmLogLine::appendSigned(long long v)
+{
+    char buf[24];
+    const int n = std::snprintf(buf, sizeof(buf), "%lld", v);
+    append(buf, n > 0 ? static_cast<std::size_t>(n) : 0);
+}
+
+void LastfmLogLine::appendUnsigned(unsigned long long v)
+{
+    char buf[24];
+    const int n = std::snprintf(buf, sizeof(buf), "%llu", v);
+    append(buf, n > 0 ? static_cast<std::size_t>(n) : 0);
+}
+
+LastfmLogLine& LastfmLogLine::operator<<(double v)
+{
+    char buf[32];
+    const int n = std::snprintf(buf, sizeof(buf), "%g", v);
+    append(buf, n > 0 ? static_cast<std::size_t>(n) : 0);
+    return *this;
+}
+
+void LastfmLogLine::commit()
+{
+    logState().commit(rec_);
+}
+
+void lastfmLogSetSink(LastfmLogSink sink)
+{
+    logState().setSink(sink);
+}
+
+void lastfmLogDump()
+{
+    logState().dump();
+}
+
+void lastfmLogShutdown()
+{
+    logState().shutdown();
+}
+
+std::string lastfmLogFormatRecord(const LastfmLogRecord& rec)
+{
+    const std::time_t secs = static_cast<std::time_t>(rec.timeMs / 1000);
+    const int millis = static_cast<int>(rec.timeMs % 1000);
+
+    std::tm tm{};
+#if defined(_WIN32)
+    localtime_s(&tm, &secs);
+#else
+    localtime_r(&secs, &tm);
+#endif
+
+    const char levelTag = (rec.level >= static_cast<std::uint8_t>(LfmLogLevel::DEBUG_LOG)) ? 'D' : 'I';
+
+    char prefix[48];
+    std::snprintf(prefix, sizeof(prefix), "%02d:%02d:%02d.%03d [%c] t%04x ", tm.tm_hour, tm.tm_min, tm.tm_sec, millis,
+                  levelTag, static_cast<unsigned>(rec.thread));
+
+    return std::string(prefix) + rec.text;
+}
@@ -0,0 +1,116 @@
+//
+//  lastfm_log.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+enum class LfmLogLevel : int
+{
+    OFF = 0,
+    INFO = 1,
+    DEBUG_LOG = 2
+};
+
+// Highest level compiled in. Release builds may define 1 (INFO) or 0 (OFF) to strip the rest entirely.
+#ifndef LFM_COMPILED_LOG_LEVEL
+#define LFM_COMPILED_LOG_LEVEL 2
+#endif
+
+// Runtime level. Kept in sync with prefs by lastfmPublishSettings().
+extern std::atomic<int> lfmLogLevel;
+
+struct LastfmLogRecord
+{
+    static constexpr std::size_t TEXT_CAPACITY = 384;
+
+    std::int64_t timeMs = 0; // wall clock, ms since epoch
+    std::uint32_t thread = 0;
+    std::uint16_t length = 0;
+    std::uint8_t level = 0;
+    char text[TEXT_CAPACITY];
+};
+
+// Stack-only formatter used by the LFM_* macros: no allocation, truncates at capacity.
+class LastfmLogLine
+{
+  public:
+    explicit LastfmLogLine(LfmLogLevel level);
+
+    LastfmLogLine& operator<<(const char* s)
+    {
+        append(s ? s : "(null)", s ? std::strlen(s) : 6);
+        return *this;
+    }
+    LastfmLogLine& operator<<(char* s)
+    {
+        return *this << static_cast<const char*>(s);
+    }
+    LastfmLogLine& operator<<(const std::string& s)
+    {
+        append(s.data(), s.size());
+        return *this;
+    }
+    LastfmLogLine& operator<<(char c)
+    {
+        append(&c, 1);
+        return *this;
+    }
+    LastfmLogLine& operator<<(double v);
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    LastfmLogLine& operator<<(T v)
+    {
+        if (std::is_signed<T>::value)
+            appendSigned(static_cast<long long>(v));
+        else
+            appendUnsigned(static_cast<unsigned long long>(v));
+        return *this;
+    }
+
+    // Hands the record to the ring buffer.
+    void commit();
+
+  private:
+    void append(const char* s, std::size_t n);
+    void appendSigned(long long v);
+    void appendUnsigned(unsigned long long v);
+
+    LastfmLogRecord rec_;
+};
+
+// Receives one line of text per drained record. Called on the log thread (or the dumping thread).
+// Defaults to stderr until replaced.
+using LastfmLogSink = void (*)(const char* line);
+void lastfmLogSetSink(LastfmLogSink sink);
+
+// Write the most recent drained records through the sink, oldest first,
+// with timestamp, level and thread tag.
+void lastfmLogDump();
+
+// Flush pending records and stop the log thread. Records committed afterwards are dropped.
+void lastfmLogShutdown();
+
+// "HH:MM:SS.mmm [I] t1a2b text"
+std::string lastfmLogFormatRecord(const LastfmLogRecord& rec);
+
+#define LFM_LOG_AT(lvl, expr)                                                                                          \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (static_cast<int>(lvl) <= LFM_COMPILED_LOG_LEVEL &&                                                         \
+            lfmLogLevel.load(std::memory_order_relaxed) >= static_cast<int>(lvl))                                      \
+        {                                                                                                              \
+            LastfmLogLine lfm_line(lvl);                                                                               \
+            lfm_line << expr;                                                                                          \
+            lfm_line.commit();                                                                                         \
+        }                                                                                                              \
+    } while (0)
@@ -6,10 +6,13 @@
 //
 
 #include "lastfm_menu.h"
+#include "lastfm_playback_pipeline.h"
+#include "lastfm_prefs_pane.h"
 #include "lastfm_ui.h"
 #include "lastfm_core.h"
 #include "lastfm_track_info.h"
 #include "lastfm_state.h"
+#include "lastfm_tracker.h"
 #include "lastfm_util.h"
 #include "debug.h"
 
@@ -17,6 +20,7 @@
 
 #include <string>
 #include <cstdlib>
+#include <ctime>
 
 #if defined(_WIN32)
 #include <windows.h>
@@ -34,6 +38,33 @@ static const GUID GUID_LASTFM_MENU_GROUP = {
 
 static const GUID GUID_LASTFM_SUSPEND = {0x3b5aca2b, 0x731e, 0x4ac4, {0xa3, 0xc5, 0x59, 0x4f, 0xcd, 0x27, 0xea, 0x49}};
 
+static const GUID GUID_LASTFM_QUEUE_STATUS = {
+    0x5c1e8a37, 0x2f64, 0x4d0b, {0x9e, 0x41, 0x73, 0xb2, 0x0c, 0xd8, 0x6a, 0x95}};
+
+static const GUID GUID_LASTFM_DUMP_LOG = {
+    0x9a2d4f61, 0x0b8e, 0x4c73, {0xa5, 0x1f, 0x36, 0xe8, 0x7d, 0x02, 0xc4, 0x5b}};
+
+static const GUID GUID_LASTFM_TRACE = {
+    0xa750708b, 0xaa68, 0x4bd0, {0x81, 0x12, 0xa2, 0x8d, 0xdc, 0x6e, 0x05, 0x88}};
+
+static const GUID GUID_LASTFM_IMPORT_LOG = {
+    0xa307c64b, 0x5bd3, 0x4876, {0x80, 0x7c, 0x18, 0xe5, 0x98, 0x67, 0xdd, 0x0f}};
+
+static const GUID GUID_LASTFM_LISTENING_STATS = {
+    0x2e6c91d4, 0x7a15, 0x4f38, {0xb4, 0x0d, 0x93, 0x5a, 0x1e, 0xc2, 0x68, 0x7f}};
+
+static const GUID GUID_LASTFM_BACKFILL = {
+    0x6d83b2e5, 0xc41a, 0x4e97, {0x8f, 0x2b, 0x51, 0x0e, 0xa7, 0x3c, 0xd9, 0x64}};
+
+static const GUID GUID_LASTFM_EXPORT_CSV = {
+    0x1f94c7a2, 0x58e3, 0x4b0d, {0x9c, 0x61, 0xe2, 0x3a, 0x8d, 0x45, 0x07, 0xb9}};
+
+static const GUID GUID_LASTFM_EXPORT_JSONL = {
+    0xc5a7031e, 0x2d6b, 0x49f4, {0xa8, 0x93, 0x7e, 0x14, 0xb6, 0x5f, 0xc0, 0x2d}};
+
+static const GUID GUID_LASTFM_DISCARD_PARKED = {
+    0x8e2b61d4, 0x97c3, 0x4f0a, {0xb5, 0x1d, 0x36, 0xe9, 0x0c, 0x72, 0xa8, 0x4f}};
+
 static mainmenu_group_popup_factory lastfmMenuGroupFactory(GUID_LASTFM_MENU_GROUP, mainmenu_groups::playback,
                                                            mainmenu_commands::sort_priority_dontcare, "Last.fm");
 
@@ -97,6 +128,24 @@ GUID LastfmMenu::get_command(t_uint32 index)
         return GUID_LASTFM_CLEAR_AUTH;
     case CMD_SUSPEND:
         return GUID_LASTFM_SUSPEND;
+    case CMD_QUEUE_STATUS:
+        return GUID_LASTFM_QUEUE_STATUS;
+    case CMD_DUMP_LOG:
+        return GUID_LASTFM_DUMP_LOG;
+    case CMD_TRACE:
+        return GUID_LASTFM_TRACE;
+    case CMD_IMPORT_LOG:
+        return GUID_LASTFM_IMPORT_LOG;
+    case CMD_LISTENING_STATS:
+        return GUID_LASTFM_LISTENING_STATS;
+    case CMD_BACKFILL:
+        return GUID_LASTFM_BACKFILL;
+    case CMD_EXPORT_CSV:
+        return GUID_LASTFM_EXPORT_CSV;
+    case CMD_EXPORT_JSONL:
+        return GUID_LASTFM_EXPORT_JSONL;
+    case CMD_DISCARD_PARKED:
+        return GUID_LASTFM_DISCARD_PARKED;
     default:
         uBugCheck();
     }
@@ -115,6 +164,33 @@ void LastfmMenu::get_name(t_uint32 index, pfc::string_base& out)
     case CMD_SUSPEND:
         out = isSuspended() ? "Resume scrobbling" : "Pause scrobbling";
         break;
+    case CMD_QUEUE_STATUS:
+        out = "Queue status";
+        break;
+    case CMD_DUMP_LOG:
+        out = "Dump log buffer";
+        break;
+    case CMD_TRACE:
+        out = "Record playback trace";
+        break;
+    case CMD_IMPORT_LOG:
+        out = "Import .scrobbler.log";
+        break;
+    case CMD_LISTENING_STATS:
+        out = "Listening statistics";
+        break;
+    case CMD_BACKFILL:
+        out = "Backfill from playback statistics";
+        break;
+    case CMD_EXPORT_CSV:
+        out = "Export scrobbles (CSV)";
+        break;
+    case CMD_EXPORT_JSONL:
+        out = "Export scrobbles (JSON Lines)";
+        break;
+    case CMD_DISCARD_PARKED:
+        out = "Discard ListenBrainz deliveries";
+        break;
     default:
         uBugCheck();
     }
@@ -133,6 +209,31 @@ bool LastfmMenu::get_description(t_uint32 index, pfc::string_base& out)
     case CMD_SUSPEND:
         out = "Suspend user from scrobbling.";
         return true;
+    case CMD_QUEUE_STATUS:
+        out = "Show pending scrobbles and their drain schedule.";
+        return true;
+    case CMD_DUMP_LOG:
+        out = "Print recent log records and internal counters to the console.";
+        return true;
+    case CMD_TRACE:
+        out = "Record playback events to a trace file in the profile folder, for offline replay.";
+        return true;
+    case CMD_IMPORT_LOG:
+        out = "Queue the plays of the portable player log set under Advanced preferences (Scrobbling).";
+        return true;
+    case CMD_LISTENING_STATS:
+        out = "Show top artists, tracks and albums and listening time, computed from the local scrobble history.";
+        return true;
+    case CMD_BACKFILL:
+        out = "Queue the first and last played times recorded by foobar2000 for every Media Library item.";
+        return true;
+    case CMD_EXPORT_CSV:
+    case CMD_EXPORT_JSONL:
+        out = "Write pending and scrobbled plays to a file in the profile folder.";
+        return true;
+    case CMD_DISCARD_PARKED:
+        out = "Drop the scrobbles still owed to ListenBrainz while no ListenBrainz user token is set.";
+        return true;
     default:
         return false;
     }
@@ -161,9 +262,25 @@ bool LastfmMenu::get_display(t_uint32 index, pfc::string_base& text, uint32_t& f
         break;
     case CMD_CLEAR_AUTH:
     case CMD_SUSPEND:
+    case CMD_QUEUE_STATUS:
+    case CMD_IMPORT_LOG:
+    case CMD_BACKFILL:
         if (!authed)
             return false;
         break;
+    case CMD_DUMP_LOG:
+    case CMD_LISTENING_STATS:
+    case CMD_EXPORT_CSV:
+    case CMD_EXPORT_JSONL:
+        break;
+    case CMD_DISCARD_PARKED:
+        if (LastfmCore::instance().scrobbler().parkedDeliveries() == 0)
+            return false;
+        break;
+    case CMD_TRACE:
+        if (lastfmPlaybackTraceActive())
+            flags |= flag_checked;
+        break;
     default:
         return false;
     }
@@ -291,6 +408,99 @@ void LastfmMenu::execute(t_uint32 index, ctx_t)
         break;
     }
 
+    case CMD_QUEUE_STATUS:
+    {
+        const LastfmDrainPlan plan = LastfmCore::instance().scrobbler().drainPlan();
+        std::string text = LastfmDrainPlanner::describe(plan);
+        const std::size_t parked = LastfmCore::instance().scrobbler().parkedDeliveries();
+        if (parked > 0)
+            text += std::to_string(parked) +
+                    " scrobble(s) are kept for ListenBrainz, which has no user token set; they are not sent.\n";
+        popup_message::g_show(text.c_str(), "Foo Scrobbler");
+        break;
+    }
+
+    case CMD_DUMP_LOG:
+    {
+        const LastfmFilterDecisionCache::Stats filterStats = lastfmFilterDecisionStats();
+        const std::string counters = "Filter decision cache: hits " + std::to_string(filterStats.hits) + ", misses " +
+                                     std::to_string(filterStats.misses) + ", entries " +
+                                     std::to_string(filterStats.entries);
+        console::formatter f;
+        f << "foo_scrobbler_mac: " << counters.c_str();
+
+        lastfmLogDump();
+        break;
+    }
+
+    case CMD_TRACE:
+    {
+        if (lastfmPlaybackTraceActive())
+        {
+            lastfmPlaybackTraceStop();
+            break;
+        }
+
+        std::string path;
+        std::string error;
+        if (!lastfmPlaybackTraceStart(path, error))
+            popup_message::g_show(("Could not start the playback trace: " + error).c_str(), "Foo Scrobbler");
+        break;
+    }
+
+    case CMD_IMPORT_LOG:
+    {
+        const std::string path = lastfmScrobblerLogImportPath();
+        if (path.empty())
+        {
+            popup_message::g_show("Set the .scrobbler.log path first:\n"
+                                  "Preferences > Advanced > Tools > Foo Scrobbler > Scrobbling.",
+                                  "Foo Scrobbler");
+            break;
+        }
+
+        // Runs in the background; a popup reports the result.
+        if (!LastfmCore::instance().scrobbler().importScrobblerLog(path))
+            popup_message::g_show("An import or backfill is already running.", "Foo Scrobbler");
+        break;
+    }
+
+    case CMD_BACKFILL:
+    {
+        // Runs behind a progress dialog; a popup reports the result.
+        if (!LastfmCore::instance().scrobbler().backfillFromPlayStats())
+            popup_message::g_show("An import or backfill is already running.", "Foo Scrobbler");
+        break;
+    }
+
+    case CMD_EXPORT_CSV:
+    case CMD_EXPORT_JSONL:
+    {
+        // Runs behind a progress dialog; a popup reports the file written.
+        const LastfmExportFormat format =
+            index == CMD_EXPORT_CSV ? LastfmExportFormat::CSV : LastfmExportFormat::JSONL;
+        if (!LastfmCore::instance().scrobbler().exportScrobbles(format))
+            popup_message::g_show("An export is already running.", "Foo Scrobbler");
+        break;
+    }
+
+    case CMD_DISCARD_PARKED:
+    {
+        const std::size_t discarded = LastfmCore::instance().scrobbler().discardParkedDeliveries();
+        popup_message::g_show(("Discarded ListenBrainz deliveries of " + std::to_string(discarded) + " scrobble(s).")
+                                  .c_str(),
+                              "Foo Scrobbler");
+        break;
+    }
+
+    case CMD_LISTENING_STATS:
+    {
+        const std::string text =
+            lastfmDescribeListeningStats(LastfmCore::instance().scrobbler().listeningStats(), std::time(nullptr), 5);
+        popup_message::g_show(text.c_str(), "Foo Scrobbler");
+        break;
+    }
+
     default:
         uBugCheck();
     }
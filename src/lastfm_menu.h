@@ -17,6 +17,15 @@ class LastfmMenu : public mainmenu_commands
         CMD_AUTHENTICATE = 0,
         CMD_CLEAR_AUTH,
         CMD_SUSPEND,
+        CMD_QUEUE_STATUS,
+        CMD_DUMP_LOG,
+        CMD_TRACE,
+        CMD_IMPORT_LOG,
+        CMD_LISTENING_STATS,
+        CMD_BACKFILL,
+        CMD_EXPORT_CSV,
+        CMD_EXPORT_JSONL,
+        CMD_DISCARD_PARKED,
         CMD_COUNT
     };
 
@@ -0,0 +1,242 @@
+//
+//  lastfm_platform_fb2k.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "lastfm_platform_fb2k.h"
+#include "debug.h"
+
+#include <foobar2000/SDK/foobar2000.h>
+
+#include <cstring>
+#include <exception>
+
+namespace
+{
+static const GUID GUID_CFG_LASTFM_PENDING_SCROBBLES = {
+    0x9b3b2c41, 0x4c2d, 0x4d8f, {0x9a, 0xa1, 0x1e, 0x37, 0x5b, 0x6a, 0x82, 0x19}};
+
+static const GUID GUID_CFG_LASTFM_DRAIN_COOLDOWN_SECS = {
+    0xad4ee3df, 0x0091, 0x4bc9, {0x8b, 0x31, 0x68, 0xa8, 0x09, 0x35, 0x2c, 0x46}};
+
+static const GUID GUID_CFG_LASTFM_DRAIN_ENABLED = {
+    0xff0d2adc, 0x0e4b, 0x436a, {0x88, 0xa2, 0x44, 0x98, 0x5c, 0x66, 0x83, 0xe5}};
+
+static const GUID GUID_CFG_LASTFM_DAILY_BUDGET = {
+    0x98b413ba, 0xfd05, 0x47c2, {0xb6, 0x5a, 0x94, 0xe4, 0xc1, 0x69, 0x81, 0x13}};
+
+static const GUID GUID_CFG_LASTFM_SCROBBLES_TODAY = {
+    0x1f309229, 0x43df, 0x44f4, {0xaf, 0x42, 0x68, 0x63, 0xc6, 0xb4, 0x6f, 0x11}};
+
+static const GUID GUID_CFG_LASTFM_DAY_STAMP = {
+    0xb9d93960, 0x37ab, 0x4bd5, {0x89, 0xb1, 0x9d, 0xd3, 0x09, 0x73, 0xea, 0xbd}};
+
+static cfg_string cfgLastfmPendingScrobbles(GUID_CFG_LASTFM_PENDING_SCROBBLES, "");
+
+static cfg_int cfgLastfmDrainCooldownSeconds(GUID_CFG_LASTFM_DRAIN_COOLDOWN_SECS,
+                                             lastfm::config::DEFAULT_DRAIN_COOLDOWN_SECONDS);
+
+static cfg_int cfgLastfmDrainEnabled(GUID_CFG_LASTFM_DRAIN_ENABLED, lastfm::config::DEFAULT_DRAIN_ENABLED);
+
+static cfg_int cfgLastfmDailyBudget(GUID_CFG_LASTFM_DAILY_BUDGET, lastfm::config::DEFAULT_DAILY_BUDGET);
+
+static cfg_int cfgLastfmScrobblesToday(GUID_CFG_LASTFM_SCROBBLES_TODAY, 0);
+
+static cfg_int cfgLastfmDayStamp(GUID_CFG_LASTFM_DAY_STAMP, 0);
+
+static std::string redact_url_for_log(const char* url)
+{
+    if (!url)
+        return "(null)";
+
+    std::string s(url);
+
+    // If there's a query, don't log it.
+    auto q = s.find('?');
+    if (q != std::string::npos)
+    {
+        s.resize(q);
+        s += "?<redacted>";
+    }
+    return s;
+}
+
+class Fb2kConfigStore final : public ILastfmConfigStore
+{
+  public:
+    int64_t getInt(const char* key, int64_t fallback) override
+    {
+        cfg_int* var = intVar(key);
+        return var ? static_cast<int64_t>(var->get()) : fallback;
+    }
+
+    void setInt(const char* key, int64_t value) override
+    {
+        if (cfg_int* var = intVar(key))
+            var->set(value);
+    }
+
+    std::string getString(const char* key) override
+    {
+        if (std::strcmp(key, lastfm::config::PENDING_SCROBBLES) != 0)
+            return {};
+
+        pfc::string8 raw = cfgLastfmPendingScrobbles.get();
+        return raw.c_str();
+    }
+
+    void setString(const char* key, const std::string& value) override
+    {
+        if (std::strcmp(key, lastfm::config::PENDING_SCROBBLES) == 0)
+            cfgLastfmPendingScrobbles.set(value.c_str());
+    }
+
+    bool closing() override
+    {
+        return core_api::is_shutting_down();
+    }
+
+  private:
+    static cfg_int* intVar(const char* key)
+    {
+        if (std::strcmp(key, lastfm::config::DRAIN_COOLDOWN_SECONDS) == 0)
+            return &cfgLastfmDrainCooldownSeconds;
+        if (std::strcmp(key, lastfm::config::DRAIN_ENABLED) == 0)
+            return &cfgLastfmDrainEnabled;
+        if (std::strcmp(key, lastfm::config::DAILY_BUDGET) == 0)
+            return &cfgLastfmDailyBudget;
+        if (std::strcmp(key, lastfm::config::SCROBBLES_TODAY) == 0)
+            return &cfgLastfmScrobblesToday;
+        if (std::strcmp(key, lastfm::config::DAY_STAMP) == 0)
+            return &cfgLastfmDayStamp;
+        return nullptr;
+    }
+};
+
+class Fb2kHttpTransport final : public ILastfmHttpTransport
+{
+  public:
+    bool request(const char* method, const std::string& url, std::string& outBody, std::string& outError) override
+    {
+        outBody.clear();
+        outError.clear();
+
+        if (!method || !*method)
+        {
+            outError = "Invalid HTTP method (empty).";
+            return false;
+        }
+        if (url.empty())
+        {
+            outError = "Invalid URL (empty).";
+            return false;
+        }
+
+        try
+        {
+            auto client = standard_api_create_t<http_client>();
+            http_request::ptr req = client->create_request(method);
+
+            LFM_DEBUG("HTTP " << method << " " << redact_url_for_log(url.c_str()).c_str());
+
+            file::ptr stream = req->run(url.c_str(), fb2k::noAbort);
+            return readBody(stream, outBody, outError);
+        }
+        catch (const std::exception& e)
+        {
+            outError = e.what() ? e.what() : "HTTP exception";
+            LFM_DEBUG("HTTP exception: " << (outError.empty() ? "(empty)" : outError.c_str()));
+            return false;
+        }
+    }
+
+    bool post(const std::string& url, const std::vector<LastfmHttpHeader>& headers, const char* contentType,
+              const std::string& body, std::string& outBody, std::string& outError) override
+    {
+        outBody.clear();
+        outError.clear();
+
+        if (url.empty())
+        {
+            outError = "Invalid URL (empty).";
+            return false;
+        }
+
+        try
+        {
+            auto client = standard_api_create_t<http_client>();
+            http_request::ptr req = client->create_request("POST");
+
+            service_ptr_t<http_request_post_v2> post;
+            if (!req->service_query_t(post))
+            {
+                outError = "http_client has no request body support.";
+                return false;
+            }
+
+            for (const auto& h : headers)
+                req->add_header(h.name.c_str(), h.value.c_str());
+            post->set_post_data(body.data(), body.size(), contentType);
+
+            LFM_DEBUG("HTTP POST " << url.c_str() << " (" << (unsigned)body.size() << " bytes)");
+
+            // run_ex: error statuses come back as a readable body instead of an exception.
+            file::ptr stream = req->run_ex(url.c_str(), fb2k::noAbort);
+            return readBody(stream, outBody, outError);
+        }
+        catch (const std::exception& e)
+        {
+            outError = e.what() ? e.what() : "HTTP exception";
+            LFM_DEBUG("HTTP exception: " << (outError.empty() ? "(empty)" : outError.c_str()));
+            return false;
+        }
+    }
+
+  private:
+    static bool readBody(file::ptr& stream, std::string& outBody, std::string& outError)
+    {
+        if (!stream.is_valid())
+        {
+            outError = "No response stream.";
+            return false;
+        }
+
+        pfc::string8 line;
+        while (!stream->is_eof(fb2k::noAbort))
+        {
+            line.reset();
+            stream->read_string_raw(line, fb2k::noAbort);
+            outBody += line.c_str();
+        }
+
+        return true;
+    }
+};
+} // namespace
+
+ILastfmConfigStore& lastfmFb2kConfigStore()
+{
+    static Fb2kConfigStore store;
+    return store;
+}
+
+ILastfmHttpTransport& lastfmFb2kHttpTransport()
+{
+    static Fb2kHttpTransport transport;
+    return transport;
+}
+
+bool lastfmFb2kProfilePath(const char* name, std::string& outPath)
+{
+    pfc::string8 folder;
+    if (!filesystem::g_get_native_path(core_api::get_profile_path(), folder))
+        return false;
+
+    outPath = folder.c_str();
+    if (!outPath.empty() && outPath.back() != '/')
+        outPath.push_back('/');
+    outPath += name;
+    return true;
+}
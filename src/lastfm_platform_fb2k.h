@@ -0,0 +1,24 @@
+//
+//  lastfm_platform_fb2k.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include "lastfm_config_store.h"
+#include "lastfm_http.h"
+
+#include <string>
+
+// foobar2000 adapters for the portable core: cfg_* storage and http_client. Logging goes through
+// lastfmLogUseConsole() (debug.h); the clock is lastfmSystemClock().
+// The core itself (lastfm_{queue,scrobble_sink,budget,worker,drain_planner,clock,config_store,request,web_api,util,
+// filter,log,json_writer,listenbrainz,scrobbler_log,history,stats,user_data,corrections,backfill,export}.cpp plus
+// lastfm_rules.h) builds without the SDK; the Linux tools link it against LastfmMemoryConfigStore.
+ILastfmConfigStore& lastfmFb2kConfigStore();
+ILastfmHttpTransport& lastfmFb2kHttpTransport();
+
+// Native path of `name` in the profile folder; false if the profile is not a local folder.
+bool lastfmFb2kProfilePath(const char* name, std::string& outPath);
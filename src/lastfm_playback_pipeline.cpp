@@ -0,0 +1,568 @@
+//
+//  lastfm_playback_pipeline.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "lastfm_playback_pipeline.h"
+#include "lastfm_core.h"
+#include "lastfm_library.h"
+#include "lastfm_platform_fb2k.h"
+#include "lastfm_settings.h"
+#include "lastfm_spsc_ring.h"
+#include "lastfm_trace.h"
+#include "lastfm_tracker.h"
+#include "lastfm_util.h"
+#include "debug.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+// Power of two. At ~10 time ticks per second this is close to a minute of events.
+static constexpr std::size_t RING_CAPACITY = 512;
+
+// Backstop only; the producer wakes the consumer whenever it sleeps.
+static constexpr auto IDLE_WAIT = std::chrono::milliseconds(100);
+
+// Longer tag values (lyrics, embedded cue sheets, ...) are left out of traces.
+static constexpr std::size_t K_TRACE_MAX_VALUE = 1024;
+
+static std::int64_t steadyMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static void copyTraceMeta(const file_info& info, LastfmTraceMeta& out)
+{
+    out.clear();
+    const std::size_t count = info.meta_get_count();
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (info.meta_enum_value_count(i) == 0)
+            continue;
+
+        const char* name = info.meta_enum_name(i);
+        const char* value = info.meta_enum_value(i, 0);
+        if (!name || !value || std::strlen(value) > K_TRACE_MAX_VALUE)
+            continue;
+
+        out.emplace_back(name, value);
+    }
+}
+
+// Writes what the pipeline thread dispatches. Start/stop come from the main thread, so the writer sits
+// behind a mutex; while no trace is recording, record() is one relaxed load.
+class TraceRecorder
+{
+  public:
+    bool active() const
+    {
+        return active_.load(std::memory_order_relaxed);
+    }
+
+    bool start(const std::string& path, std::string& error)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (writer_.isOpen())
+        {
+            error = "a trace is already recording";
+            return false;
+        }
+
+        if (!writer_.open(path, error))
+            return false;
+
+        ids_.clear();
+        held_.clear();
+        active_.store(true, std::memory_order_relaxed);
+        return true;
+    }
+
+    void stop()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!writer_.isOpen())
+            return;
+
+        active_.store(false, std::memory_order_relaxed);
+        writer_.close();
+        LFM_INFO("Playback trace stopped: " << writer_.eventCount() << " event(s), " << held_.size()
+                                            << " track(s), " << writer_.bytesWritten() << " bytes");
+        ids_.clear();
+        held_.clear();
+    }
+
+    void record(const LastfmPlaybackEvent& ev)
+    {
+        if (!active())
+            return;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!writer_.isOpen())
+            return;
+
+        LastfmTraceEvent out;
+        out.atMs = ev.postedMs ? ev.postedMs : steadyMs(); // posted before the trace started
+
+        switch (ev.kind)
+        {
+        case LastfmPlaybackEvent::Kind::NEW_TRACK:
+            out.kind = LastfmTraceKind::NEW_TRACK;
+            out.trackId = defineTrack(ev.track, false);
+            break;
+        case LastfmPlaybackEvent::Kind::EDITED:
+            out.kind = LastfmTraceKind::EDITED;
+            out.trackId = defineTrack(ev.track, true);
+            break;
+        case LastfmPlaybackEvent::Kind::STOP:
+            out.kind = LastfmTraceKind::STOP;
+            break;
+        case LastfmPlaybackEvent::Kind::SEEK:
+            out.kind = LastfmTraceKind::SEEK;
+            out.time = ev.time;
+            break;
+        case LastfmPlaybackEvent::Kind::PAUSE:
+            out.kind = LastfmTraceKind::PAUSE;
+            out.flag = ev.flag;
+            break;
+        case LastfmPlaybackEvent::Kind::TIME:
+            out.kind = LastfmTraceKind::TIME;
+            out.time = ev.time;
+            break;
+        case LastfmPlaybackEvent::Kind::DYNAMIC_INFO:
+            out.kind = LastfmTraceKind::DYNAMIC_INFO;
+            if (ev.info)
+                copyTraceMeta(*ev.info, out.meta);
+            break;
+        case LastfmPlaybackEvent::Kind::NONE:
+            return;
+        }
+
+        writer_.writeEvent(out);
+    }
+
+  private:
+    // Each handle gets an id and its tags are written once; EDITED rewrites them.
+    std::uint32_t defineTrack(const metadb_handle_ptr& track, bool refresh)
+    {
+        if (!track.is_valid())
+            return 0;
+
+        auto it = ids_.find(track.get_ptr());
+        if (it != ids_.end() && !refresh)
+            return it->second;
+
+        LastfmTraceTrack def;
+        if (it != ids_.end())
+        {
+            def.id = it->second;
+        }
+        else
+        {
+            def.id = static_cast<std::uint32_t>(held_.size() + 1);
+            ids_.emplace(track.get_ptr(), def.id);
+            held_.push_back(track); // keeps the pointer key unique while recording
+        }
+
+        const char* path = track->get_path();
+        def.path = path ? path : "";
+
+        file_info_impl info;
+        if (track->get_info(info))
+        {
+            def.length = info.get_length();
+            copyTraceMeta(info, def.meta);
+        }
+
+        writer_.writeTrack(def);
+        return def.id;
+    }
+
+    std::atomic<bool> active_{false};
+    std::mutex mutex_;
+    LastfmTraceWriter writer_;
+    std::unordered_map<const metadb_handle*, std::uint32_t> ids_;
+    std::vector<metadb_handle_ptr> held_;
+};
+
+static TraceRecorder& traceRecorder()
+{
+    static TraceRecorder instance;
+    return instance;
+}
+
+// Single producer (the main thread, where play and metadb callbacks arrive), single consumer (the
+// pipeline thread, which owns the tracker). The producer never waits on tracker work: events go into the
+// ring, and if the consumer falls that far behind they spill into a locked overflow list instead of being
+// dropped, since a lost stop or new-track would corrupt the scrobble state. Once spilling, the producer
+// keeps spilling until the consumer has emptied the ring and taken the overflow, which keeps order.
+class PlaybackPipeline
+{
+  public:
+    ~PlaybackPipeline()
+    {
+        shutdown();
+    }
+
+    void post(LastfmPlaybackEvent&& ev)
+    {
+        if (stopped_.load(std::memory_order_acquire))
+            return;
+
+        if (traceRecorder().active())
+            ev.postedMs = steadyMs();
+
+        if (hasOverflow_.load(std::memory_order_relaxed) || !ring_.push(ev))
+        {
+            std::lock_guard<std::mutex> lock(overflowMutex_);
+            overflow_.push_back(std::move(ev));
+            hasOverflow_.store(true, std::memory_order_relaxed);
+        }
+
+        if (!started_.load(std::memory_order_acquire))
+        {
+            start();
+            return;
+        }
+
+        // Pairs with the fence in run(): either the consumer sees the event or we see it waiting.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting_.load(std::memory_order_relaxed))
+        {
+            // Taking the lock orders the notify after the consumer has actually entered wait.
+            {
+                std::lock_guard<std::mutex> lock(threadMutex_);
+            }
+            cv_.notify_one();
+        }
+    }
+
+    void shutdown()
+    {
+        if (stopped_.exchange(true, std::memory_order_acq_rel))
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(threadMutex_);
+            stopRequested_ = true;
+        }
+        cv_.notify_one();
+
+        if (thread_.joinable())
+            thread_.join();
+    }
+
+  private:
+    void start()
+    {
+        std::lock_guard<std::mutex> lock(threadMutex_);
+        if (started_.load(std::memory_order_relaxed) || stopRequested_)
+            return;
+
+        thread_ = std::thread([this] { run(); });
+        started_.store(true, std::memory_order_release);
+    }
+
+    bool hasPending()
+    {
+        return !ring_.empty() || hasOverflow_.load(std::memory_order_relaxed);
+    }
+
+    void run()
+    {
+        for (;;)
+        {
+            drain();
+
+            std::unique_lock<std::mutex> lock(threadMutex_);
+            if (stopRequested_)
+                break;
+
+            waiting_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!hasPending())
+                cv_.wait_for(lock, IDLE_WAIT);
+            waiting_.store(false, std::memory_order_relaxed);
+        }
+
+        drain();
+    }
+
+    void drain()
+    {
+        for (;;)
+        {
+            while (LastfmPlaybackEvent* ev = ring_.peek())
+            {
+                dispatch(*ev);
+                ring_.pop();
+            }
+
+            std::deque<LastfmPlaybackEvent> spilled;
+            {
+                std::lock_guard<std::mutex> lock(overflowMutex_);
+                if (overflow_.empty())
+                    return;
+
+                spilled.swap(overflow_);
+                hasOverflow_.store(false, std::memory_order_relaxed);
+            }
+
+            LFM_DEBUG("Playback pipeline: " << spilled.size() << " event(s) delivered from overflow");
+            for (auto& ev : spilled)
+                dispatch(ev);
+        }
+    }
+
+    void dispatch(LastfmPlaybackEvent& ev)
+    {
+        traceRecorder().record(ev);
+
+        try
+        {
+            switch (ev.kind)
+            {
+            case LastfmPlaybackEvent::Kind::NEW_TRACK:
+                tracker_.onNewTrack(ev.track);
+                break;
+            case LastfmPlaybackEvent::Kind::STOP:
+                tracker_.onStop();
+                break;
+            case LastfmPlaybackEvent::Kind::SEEK:
+                tracker_.onSeek(ev.time);
+                break;
+            case LastfmPlaybackEvent::Kind::PAUSE:
+                tracker_.onPause(ev.flag);
+                break;
+            case LastfmPlaybackEvent::Kind::TIME:
+                tracker_.onTime(ev.time);
+                break;
+            case LastfmPlaybackEvent::Kind::EDITED:
+                tracker_.onTagsEdited(ev.track);
+                break;
+            case LastfmPlaybackEvent::Kind::DYNAMIC_INFO:
+                if (ev.info)
+                    tracker_.onDynamicInfo(*ev.info);
+                break;
+            case LastfmPlaybackEvent::Kind::NONE:
+                break;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            LFM_INFO("Playback event failed: " << e.what());
+        }
+    }
+
+    LastfmTracker tracker_{LastfmCore::instance().scrobbler()};
+
+    LastfmSpscRing<LastfmPlaybackEvent, RING_CAPACITY> ring_;
+
+    std::mutex overflowMutex_;
+    std::deque<LastfmPlaybackEvent> overflow_;
+    std::atomic<bool> hasOverflow_{false};
+
+    std::atomic<bool> started_{false};
+    std::atomic<bool> stopped_{false};
+    std::atomic<bool> waiting_{false};
+
+    std::mutex threadMutex_;
+    std::condition_variable cv_;
+    std::thread thread_;
+    bool stopRequested_ = false;
+};
+
+static PlaybackPipeline& pipeline()
+{
+    static PlaybackPipeline instance;
+    return instance;
+}
+
+static void postEvent(LastfmPlaybackEvent::Kind kind, double time = 0.0, bool flag = false,
+                      metadb_handle_ptr track = metadb_handle_ptr(),
+                      std::shared_ptr<const file_info_impl> info = nullptr)
+{
+    LastfmPlaybackEvent ev;
+    ev.kind = kind;
+    ev.time = time;
+    ev.flag = flag;
+    ev.track = std::move(track);
+    ev.info = std::move(info);
+    pipeline().post(std::move(ev));
+}
+
+// Main-thread front-end: records events and does the few things that must stay on the main thread
+// (library_manager lookups, metadb callback registration).
+class LastfmPlaybackCallbacks : public play_callback_static
+{
+  public:
+    unsigned get_flags() override
+    {
+        return flag_on_playback_new_track | flag_on_playback_stop | flag_on_playback_time | flag_on_playback_seek |
+               flag_on_playback_pause | flag_on_playback_edited | flag_on_playback_dynamic_info |
+               flag_on_playback_dynamic_info_track;
+    }
+
+    void on_playback_new_track(metadb_handle_ptr track) override
+    {
+        // Resolve membership now so the pipeline's check is a cache hit.
+        if (lastfmSettings()->onlyFromMediaLibrary && track.is_valid())
+            lastfmIsInMediaLibrary(track);
+
+        watchTags(track);
+        postEvent(LastfmPlaybackEvent::Kind::NEW_TRACK, 0.0, false, track);
+    }
+
+    void on_playback_stop(play_control::t_stop_reason) override
+    {
+        unwatchTags();
+        postEvent(LastfmPlaybackEvent::Kind::STOP);
+    }
+
+    void on_playback_seek(double time) override
+    {
+        postEvent(LastfmPlaybackEvent::Kind::SEEK, time);
+    }
+
+    void on_playback_pause(bool paused) override
+    {
+        postEvent(LastfmPlaybackEvent::Kind::PAUSE, 0.0, paused);
+    }
+
+    void on_playback_time(double time) override
+    {
+        postEvent(LastfmPlaybackEvent::Kind::TIME, time);
+    }
+
+    void on_playback_edited(metadb_handle_ptr track) override
+    {
+        postEvent(LastfmPlaybackEvent::Kind::EDITED, 0.0, false, track);
+    }
+
+    void on_playback_dynamic_info(const file_info& info) override
+    {
+        postDynamicInfo(info);
+    }
+
+    void on_playback_dynamic_info_track(const file_info& info) override
+    {
+        postDynamicInfo(info);
+    }
+
+    // Unused callbacks (required by interface)
+    void on_playback_starting(play_control::t_track_command, bool) override
+    {
+    }
+    void on_volume_change(float) override
+    {
+    }
+
+  private:
+    // Forwards tag changes of the playing handle. Registered only while a local track is playing;
+    // streams report changes through dynamic info instead.
+    class TagWatcher : public metadb_io_callback_dynamic_impl_base
+    {
+      public:
+        explicit TagWatcher(LastfmPlaybackCallbacks& owner) : owner_(owner)
+        {
+        }
+        void on_changed_sorted(metadb_handle_list_cref items, bool) override
+        {
+            const metadb_handle_ptr& handle = owner_.playing_;
+            if (handle.is_valid() && metadb_handle_list_helper::bsearch_by_pointer(items, handle) != SIZE_MAX)
+                postEvent(LastfmPlaybackEvent::Kind::EDITED, 0.0, false, handle);
+        }
+
+      private:
+        LastfmPlaybackCallbacks& owner_;
+    };
+
+    void postDynamicInfo(const file_info& info)
+    {
+        // The reference is only valid for the duration of the callback.
+        postEvent(LastfmPlaybackEvent::Kind::DYNAMIC_INFO, 0.0, false, metadb_handle_ptr(),
+                  std::make_shared<const file_info_impl>(info));
+    }
+
+    void watchTags(const metadb_handle_ptr& track)
+    {
+        if (!track.is_valid() || lastfm::util::isNetworkStreamPath(track->get_path()))
+        {
+            unwatchTags();
+            return;
+        }
+
+        playing_ = track;
+        if (!tagWatcher_.is_dynamic_callback_registered())
+            tagWatcher_.dynamic_callback_register();
+    }
+
+    void unwatchTags()
+    {
+        if (tagWatcher_.is_dynamic_callback_registered())
+            tagWatcher_.dynamic_callback_unregister();
+        playing_.release();
+    }
+
+    metadb_handle_ptr playing_;
+    TagWatcher tagWatcher_{*this};
+};
+
+static play_callback_static_factory_t<LastfmPlaybackCallbacks> lastfmPlaybackCallbacksFactory;
+} // namespace
+
+void lastfmPlaybackPipelineShutdown()
+{
+    pipeline().shutdown();
+    traceRecorder().stop();
+}
+
+bool lastfmPlaybackTraceStart(std::string& outPath, std::string& outError)
+{
+    outPath.clear();
+    outError.clear();
+
+    const std::time_t now = std::time(nullptr);
+    std::tm tm{};
+    localtime_r(&now, &tm);
+    char name[64];
+    std::strftime(name, sizeof(name), "foo_scrobbler_mac-%Y%m%d-%H%M%S.lfmtrace", &tm);
+
+    std::string path;
+    if (!lastfmFb2kProfilePath(name, path))
+    {
+        outError = "profile folder is not a local path";
+        return false;
+    }
+
+    if (!traceRecorder().start(path, outError))
+        return false;
+
+    LFM_INFO("Recording playback trace to " << path);
+    outPath = std::move(path);
+    return true;
+}
+
+void lastfmPlaybackTraceStop()
+{
+    traceRecorder().stop();
+}
+
+bool lastfmPlaybackTraceActive()
+{
+    return traceRecorder().active();
+}
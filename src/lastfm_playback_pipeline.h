@@ -0,0 +1,50 @@
+//
+//  lastfm_playback_pipeline.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <foobar2000/SDK/foobar2000.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// What the playback callbacks hand to the background stage: the handle, a time or flag, and for dynamic
+// info a copy of the file_info. Everything else (get_info, titleformat, filters, queueing) happens later
+// on the pipeline thread.
+struct LastfmPlaybackEvent
+{
+    enum class Kind : std::uint8_t
+    {
+        NONE = 0,
+        NEW_TRACK,
+        STOP,
+        SEEK,
+        PAUSE,
+        TIME,
+        EDITED,
+        DYNAMIC_INFO
+    };
+
+    Kind kind = Kind::NONE;
+    bool flag = false; // PAUSE: paused
+    double time = 0.0; // SEEK, TIME
+    metadb_handle_ptr track;
+    std::shared_ptr<const file_info_impl> info; // DYNAMIC_INFO
+    std::int64_t postedMs = 0;                  // steady clock; stamped only while a trace is recording
+};
+
+// Delivers the remaining events to the tracker and stops the pipeline thread. Call before the scrobbler
+// shuts down so a final stop can still queue its scrobble; events posted afterwards are ignored.
+void lastfmPlaybackPipelineShutdown();
+
+// Playback trace (lastfm_trace.h): every event the pipeline receives, plus the tags of each track it
+// refers to, written to "foo_scrobbler_mac-<date>-<time>.lfmtrace" in the profile folder.
+// Replay it with tools/trace_replay.
+bool lastfmPlaybackTraceStart(std::string& outPath, std::string& outError);
+void lastfmPlaybackTraceStop();
+bool lastfmPlaybackTraceActive();
@@ -10,6 +10,7 @@
 #include <foobar2000/SDK/foobar2000.h>
 
 #include "lastfm_prefs_pane.h"
+#include "lastfm_settings.h"
 #include "debug.h"
 
 #include <atomic>
@@ -66,6 +67,12 @@ static const GUID GUID_LASTFM_PREFS_EXCLUDE_ARTISTS = {
 static const GUID GUID_LASTFM_PREFS_EXCLUDE_TITLES = {
     0xf168a4ff, 0xeb5b, 0x4e4c, {0xa5, 0x02, 0x65, 0x91, 0x08, 0x37, 0xdf, 0x0a}};
 
+static const GUID GUID_LASTFM_PREFS_LISTENBRAINZ_TOKEN = {
+    0xa3290f8b, 0xe8a2, 0x4991, {0xba, 0xe1, 0x41, 0xcb, 0x12, 0x2e, 0x1e, 0xd4}};
+
+static const GUID GUID_LASTFM_PREFS_IMPORT_LOG_PATH = {
+    0x8f0b111a, 0xd027, 0x4c71, {0x96, 0xeb, 0x8d, 0x85, 0xc2, 0x15, 0x0b, 0x52}};
+
 static const GUID GUID_LASTFM_PREFS_TF_ARTIST = {
     0x9a60376f, 0xc792, 0x4af9, {0xa1, 0x39, 0xa2, 0x0a, 0xd7, 0xba, 0x03, 0x6c}};
 
@@ -78,6 +85,43 @@ static const GUID GUID_LASTFM_PREFS_TF_TITLE = {
 static const GUID GUID_LASTFM_PREFS_TF_ALBUM = {
     0xf9ed3ea2, 0x2dc3, 0x4116, {0x94, 0x58, 0xec, 0xf0, 0xbe, 0x05, 0x70, 0x45}};
 
+// Entries that republish the settings snapshot when edited from Preferences → Advanced.
+class LastfmCheckboxEntry : public advconfig_entry_checkbox_impl
+{
+  public:
+    using advconfig_entry_checkbox_impl::advconfig_entry_checkbox_impl;
+
+    void set_state(bool p_state) override
+    {
+        advconfig_entry_checkbox_impl::set_state(p_state);
+        lastfmPublishSettings();
+    }
+
+    void reset() override
+    {
+        advconfig_entry_checkbox_impl::reset();
+        lastfmPublishSettings();
+    }
+};
+
+class LastfmStringEntry : public advconfig_entry_string_impl
+{
+  public:
+    using advconfig_entry_string_impl::advconfig_entry_string_impl;
+
+    void set_state(const char* p_string, t_size p_length) override
+    {
+        advconfig_entry_string_impl::set_state(p_string, p_length);
+        lastfmPublishSettings();
+    }
+
+    void reset() override
+    {
+        advconfig_entry_string_impl::reset();
+        lastfmPublishSettings();
+    }
+};
+
 // Branches
 static advconfig_branch_factory g_lastfmPrefsBranchFactory("Foo Scrobbler", GUID_LASTFM_PREFS_BRANCH,
                                                            advconfig_branch::guid_branch_tools, -50);
@@ -96,26 +140,26 @@ static advconfig_branch_factory g_lastfmPrefsDynamicBranchFactory("Dynamic sourc
                                                                   GUID_LASTFM_PREFS_BRANCH_DYNAMIC,
                                                                   GUID_LASTFM_PREFS_BRANCH, 3);
 
-static service_factory_single_t<advconfig_entry_checkbox_impl>
+static service_factory_single_t<LastfmCheckboxEntry>
     g_tagCheckboxTreatVA("Treat \"Various Artists\" as empty (Album Artist only)",
                          "foo_scrobbler.tags.compilation.treat_va_empty", GUID_LASTFM_TAG_CHECKBOX_VA_AS_EMPTY,
                          GUID_LASTFM_PREFS_BRANCH_TAG_FORMATTING, 4.0, false, false, 0);
 
-static service_factory_single_t<advconfig_entry_string_impl>
+static service_factory_single_t<LastfmStringEntry>
     g_tagArtistTf("Artist (Title Formatting)", "foo_scrobbler.tf.artist", GUID_LASTFM_PREFS_TF_ARTIST,
                   GUID_LASTFM_PREFS_BRANCH_TAG_FORMATTING, 0.0, "[%ARTIST%]", 0);
 
-static service_factory_single_t<advconfig_entry_string_impl> g_tagAlbumArtistTf("Album Artist (Title Formatting)",
+static service_factory_single_t<LastfmStringEntry> g_tagAlbumArtistTf("Album Artist (Title Formatting)",
                                                                                 "foo_scrobbler.tf.album_artist",
                                                                                 GUID_LASTFM_PREFS_TF_ALBUM_ARTIST,
                                                                                 GUID_LASTFM_PREFS_BRANCH_TAG_FORMATTING,
                                                                                 1.0, "[%ALBUM ARTIST%]", 0);
 
-static service_factory_single_t<advconfig_entry_string_impl>
+static service_factory_single_t<LastfmStringEntry>
     g_tagTitleTf("Title (Title Formatting)", "foo_scrobbler.tf.title", GUID_LASTFM_PREFS_TF_TITLE,
                  GUID_LASTFM_PREFS_BRANCH_TAG_FORMATTING, 2.0, "[%TITLE%]", 0);
 
-static service_factory_single_t<advconfig_entry_string_impl>
+static service_factory_single_t<LastfmStringEntry>
     g_tagAlbumTf("Album (Title Formatting)", "foo_scrobbler.tf.album", GUID_LASTFM_PREFS_TF_ALBUM,
                  GUID_LASTFM_PREFS_BRANCH_TAG_FORMATTING, 3.0, "[%ALBUM%]", 0);
 
@@ -136,53 +180,65 @@ static void advSetCheckboxState(const GUID& g, bool v)
 }
 
 // Radios
-static service_factory_single_t<advconfig_entry_checkbox_impl> g_radio0("None", "foo_scrobbler.console.no",
+static service_factory_single_t<LastfmCheckboxEntry> g_radio0("None", "foo_scrobbler.console.no",
                                                                         GUID_LASTFM_PREFS_RADIO_0,
                                                                         GUID_LASTFM_PREFS_BRANCH_CONSOLE, 0.0, false,
                                                                         true, // isRadio
                                                                         0     // flags
 );
 
-static service_factory_single_t<advconfig_entry_checkbox_impl> g_radio1("Basic", "foo_scrobbler.console.basic",
+static service_factory_single_t<LastfmCheckboxEntry> g_radio1("Basic", "foo_scrobbler.console.basic",
                                                                         GUID_LASTFM_PREFS_RADIO_1,
                                                                         GUID_LASTFM_PREFS_BRANCH_CONSOLE, 1.0, true,
                                                                         true, 0);
 
-static service_factory_single_t<advconfig_entry_checkbox_impl> g_radio2("Debug", "foo_scrobbler.console.debug",
+static service_factory_single_t<LastfmCheckboxEntry> g_radio2("Debug", "foo_scrobbler.console.debug",
                                                                         GUID_LASTFM_PREFS_RADIO_2,
                                                                         GUID_LASTFM_PREFS_BRANCH_CONSOLE, 2.0, false,
                                                                         true, 0);
 
 // Checkboxes, defaults: no, no
-static service_factory_single_t<advconfig_entry_checkbox_impl>
+static service_factory_single_t<LastfmCheckboxEntry>
     g_checkbox0("Disable NowPlaying notifications", "foo_scrobbler.scrobbling.disable_nowplaying",
                 GUID_LASTFM_PREFS_CHECKBOX_0, GUID_LASTFM_PREFS_BRANCH_SCROBBLING, 0.0, false, false, 0);
 
-static service_factory_single_t<advconfig_entry_checkbox_impl>
+static service_factory_single_t<LastfmCheckboxEntry>
     g_checkbox1("Only scrobble from media library", "foo_scrobbler.scrobbling.only_from_library",
                 GUID_LASTFM_PREFS_CHECKBOX_1, GUID_LASTFM_PREFS_BRANCH_SCROBBLING, 1.0, false, false, 0);
 
 // Dynamic sources (3-choice radio group)
-static service_factory_single_t<advconfig_entry_checkbox_impl>
+static service_factory_single_t<LastfmCheckboxEntry>
     g_dynamicRadio0("No dynamic sources", "foo_scrobbler.dynamic.no", GUID_LASTFM_PREFS_DYNAMIC_RADIO_0,
                     GUID_LASTFM_PREFS_BRANCH_DYNAMIC, 0.0, false, true, 0);
 
-static service_factory_single_t<advconfig_entry_checkbox_impl>
+static service_factory_single_t<LastfmCheckboxEntry>
     g_dynamicRadio1("Only NP notifications", "foo_scrobbler.dynamic.np_only", GUID_LASTFM_PREFS_DYNAMIC_RADIO_1,
                     GUID_LASTFM_PREFS_BRANCH_DYNAMIC, 1.0, false, true, 0);
 
-static service_factory_single_t<advconfig_entry_checkbox_impl>
+static service_factory_single_t<LastfmCheckboxEntry>
     g_dynamicRadio2("NP & Scrobbling", "foo_scrobbler.dynamic.np_and_scrobble", GUID_LASTFM_PREFS_DYNAMIC_RADIO_2,
                     GUID_LASTFM_PREFS_BRANCH_DYNAMIC, 2.0, true, true, 0);
 
-static service_factory_single_t<advconfig_entry_string_impl>
+static service_factory_single_t<LastfmStringEntry>
     g_excludeArtists("Exclude artists (text or regex; ';' separated)", "foo_scrobbler.scrobbling.exclude_artists",
                      GUID_LASTFM_PREFS_EXCLUDE_ARTISTS, GUID_LASTFM_PREFS_BRANCH_SCROBBLING, 2.0, "", 0);
 
-static service_factory_single_t<advconfig_entry_string_impl>
+static service_factory_single_t<LastfmStringEntry>
     g_excludeTitles("Exclude titles (text or regex; ';' separated)", "foo_scrobbler.scrobbling.exclude_titles",
                     GUID_LASTFM_PREFS_EXCLUDE_TITLES, GUID_LASTFM_PREFS_BRANCH_SCROBBLING, 3.0, "", 0);
 
+// Read when foobar2000 starts: the ListenBrainz sink is registered only with a token set. Advanced prefs keep the
+// token as a plain string in the configuration, and the label says so.
+static service_factory_single_t<LastfmStringEntry>
+    g_listenBrainzToken("ListenBrainz user token (stored unencrypted; restart to enable)",
+                        "foo_scrobbler.scrobbling.listenbrainz_token", GUID_LASTFM_PREFS_LISTENBRAINZ_TOKEN,
+                        GUID_LASTFM_PREFS_BRANCH_SCROBBLING, 4.0, "", 0);
+
+// Used by Last.fm > Import .scrobbler.log
+static service_factory_single_t<advconfig_entry_string_impl>
+    g_importLogPath("Portable player .scrobbler.log to import (full path)", "foo_scrobbler.scrobbling.import_log_path",
+                    GUID_LASTFM_PREFS_IMPORT_LOG_PATH, GUID_LASTFM_PREFS_BRANCH_SCROBBLING, 5.0, "", 0);
+
 static void enforceOneOfN(const GUID* ids, std::size_t n, std::size_t defaultIndex)
 {
     std::size_t firstOn = n; // "none"
@@ -275,21 +331,19 @@ static std::string advGetStringState(const GUID& g)
 }
 } // namespace
 
-void lastfmSyncLogLevelFromPrefs()
+int lastfmConsoleLogLevel()
 {
     const int choice = getConsoleRadioChoice();
 
-    const int desired = (choice == 0)   ? static_cast<int>(LfmLogLevel::OFF)
-                        : (choice == 1) ? static_cast<int>(LfmLogLevel::INFO)
-                                        : static_cast<int>(LfmLogLevel::DEBUG_LOG);
-
-    lfmLogLevel.store(desired);
+    return (choice == 0)   ? static_cast<int>(LfmLogLevel::OFF)
+           : (choice == 1) ? static_cast<int>(LfmLogLevel::INFO)
+                           : static_cast<int>(LfmLogLevel::DEBUG_LOG);
 }
 
 void lastfmRegisterPrefsPane()
 {
-    // Force sync once at startup, so atomic matches prefs immediately.
-    lastfmSyncLogLevelFromPrefs();
+    // Force a snapshot once at startup, so the log level matches prefs immediately.
+    lastfmPublishSettings();
 
     pfc::string_formatter f;
     f << "PrefsPane: Advanced prefs registered. consoleChoice=" << getConsoleRadioChoice()
@@ -342,6 +396,16 @@ std::string lastfmAlbumTf()
     return advGetStringState(GUID_LASTFM_PREFS_TF_ALBUM);
 }
 
+std::string lastfmListenBrainzToken()
+{
+    return advGetStringState(GUID_LASTFM_PREFS_LISTENBRAINZ_TOKEN);
+}
+
+std::string lastfmScrobblerLogImportPath()
+{
+    return advGetStringState(GUID_LASTFM_PREFS_IMPORT_LOG_PATH);
+}
+
 bool lastfmTagTreatVariousArtistsAsEmpty()
 {
     return advGetCheckboxState(GUID_LASTFM_TAG_CHECKBOX_VA_AS_EMPTY);
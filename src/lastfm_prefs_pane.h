@@ -12,6 +12,11 @@
 // Advanced Preferences registration (Preferences → Advanced).
 void lastfmRegisterPrefsPane();
 
+// Live advconfig reads. Hot paths use the lastfmSettings() snapshot instead.
+
+// Advanced → Tools → Foo Scrobbler → Console info (LfmLogLevel value)
+int lastfmConsoleLogLevel();
+
 // Advanced → Tools → Foo Scrobbler → Scrobbling
 bool lastfmOnlyScrobbleFromMediaLibrary();
 
@@ -29,3 +34,8 @@ bool lastfmTagTreatVariousArtistsAsEmpty();
 
 std::string lastfmExcludedArtistsPatternList();
 std::string lastfmExcludedTitlesPatternList();
+
+// Empty = ListenBrainz submissions off.
+std::string lastfmListenBrainzToken();
+
+std::string lastfmScrobblerLogImportPath();
@@ -6,12 +6,11 @@
 //
 
 #include "lastfm_queue.h"
-#include "lastfm_client.h"
 #include "debug.h"
-
-#include <foobar2000/SDK/foobar2000.h>
+#include "lastfm_util.h"
 
 #include <algorithm>
+#include <bit>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
@@ -23,52 +22,23 @@
 #include <cctype>
 #include <cerrno>
 #include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <unordered_map>
 
 namespace
 {
-static const GUID GUID_CFG_LASTFM_PENDING_SCROBBLES = {
-    0x9b3b2c41, 0x4c2d, 0x4d8f, {0x9a, 0xa1, 0x1e, 0x37, 0x5b, 0x6a, 0x82, 0x19}};
-
-static const GUID GUID_CFG_LASTFM_DRAIN_COOLDOWN_SECS = {
-    0xad4ee3df, 0x0091, 0x4bc9, {0x8b, 0x31, 0x68, 0xa8, 0x09, 0x35, 0x2c, 0x46}};
-
-static const GUID GUID_CFG_LASTFM_DRAIN_ENABLED = {
-    0xff0d2adc, 0x0e4b, 0x436a, {0x88, 0xa2, 0x44, 0x98, 0x5c, 0x66, 0x83, 0xe5}};
-
-static const GUID GUID_CFG_LASTFM_DAILY_BUDGET = {
-    0x98b413ba, 0xfd05, 0x47c2, {0xb6, 0x5a, 0x94, 0xe4, 0xc1, 0x69, 0x81, 0x13}};
-
-static const GUID GUID_CFG_LASTFM_SCROBBLES_TODAY = {
-    0x1f309229, 0x43df, 0x44f4, {0xaf, 0x42, 0x68, 0x63, 0xc6, 0xb4, 0x6f, 0x11}};
-
-static const GUID GUID_CFG_LASTFM_DAY_STAMP = {
-    0xb9d93960, 0x37ab, 0x4bd5, {0x89, 0xb1, 0x9d, 0xd3, 0x09, 0x73, 0xea, 0xbd}};
-
-// Dispatch at most 10 per run
-static constexpr size_t K_MAX_DISPATCH_BATCH = 10;
+// Weight of the latest dispatch in the accept-rate average
+static constexpr double K_ACCEPT_RATE_ALPHA = 0.2;
 
 // Linear backoff: 60s, 120s, 180s… capped
 static constexpr int K_RETRY_STEP_SECONDS = 60;
 static constexpr int K_RETRY_MAX_SECONDS = 60 * 60; // 1h cap
 static constexpr int K_RATE_LIMIT_COOLDOWN_SECONDS = 6 * 60;
 
-static cfg_string cfgLastfmPendingScrobbles(GUID_CFG_LASTFM_PENDING_SCROBBLES, "");
-
-static cfg_int cfgLastfmDrainCooldownSeconds(GUID_CFG_LASTFM_DRAIN_COOLDOWN_SECS,
-                                             360 // 6 minutes
-);
-
-static cfg_int cfgLastfmDrainEnabled(GUID_CFG_LASTFM_DRAIN_ENABLED,
-                                     1 // enabled by default
-);
-
-static cfg_int cfgLastfmDailyBudget(GUID_CFG_LASTFM_DAILY_BUDGET,
-                                    2600 // safe default
-);
-
-static cfg_int cfgLastfmScrobblesToday(GUID_CFG_LASTFM_SCROBBLES_TODAY, 0);
-
-static cfg_int cfgLastfmDayStamp(GUID_CFG_LASTFM_DAY_STAMP, 0);
+// Entries forEachPending() copies per lock.
+static constexpr std::size_t K_PENDING_CHUNK = 1024;
 
 static std::uint64_t nextQueueId()
 {
@@ -88,45 +58,16 @@ static std::uint64_t nextQueueId()
     const std::uint64_t id = base ^ (s * 0x9e3779b97f4a7c15ull);
     return id ? id : 1;
 }
+} // namespace
 
-static bool lastfmDailyBudgetExhausted(const std::function<bool()>& isShuttingDown)
+void LastfmQueue::appendEscaped(std::string& out, const std::string& in)
 {
-    if (isShuttingDown && isShuttingDown())
-        return true; // treat as exhausted during shutdown: do nothing
-
-    const std::time_t now = std::time(nullptr);
-    std::tm tmNow{};
-#if defined(_WIN32)
-    localtime_s(&tmNow, &now);
-#else
-    localtime_r(&now, &tmNow);
-#endif
-
-    const int todayStamp = (tmNow.tm_year + 1900) * 10000 + (tmNow.tm_mon + 1) * 100 + tmNow.tm_mday;
-
-    if (cfgLastfmDayStamp.get() != todayStamp)
+    if (in.find_first_of("\\\t\n\r") == std::string::npos)
     {
-        if (isShuttingDown && isShuttingDown())
-            return true;
-
-        cfgLastfmDayStamp.set(todayStamp);
-        cfgLastfmScrobblesToday.set(0);
+        out += in;
+        return;
     }
 
-    const int64_t dailyBudget = static_cast<int64_t>(cfgLastfmDailyBudget.get());
-    const int64_t todayCount = static_cast<int64_t>(cfgLastfmScrobblesToday.get());
-    if (dailyBudget > 0 && todayCount >= dailyBudget)
-        return true;
-
-    return false;
-}
-} // namespace
-
-std::string LastfmQueue::escapeField(const std::string& in)
-{
-    std::string out;
-    out.reserve(in.size());
-
     for (char c : in)
     {
         switch (c)
@@ -148,8 +89,6 @@ std::string LastfmQueue::escapeField(const std::string& in)
             break;
         }
     }
-
-    return out;
 }
 
 std::string LastfmQueue::unescapeField(const std::string& in)
@@ -190,35 +129,75 @@ std::string LastfmQueue::unescapeField(const std::string& in)
     return out;
 }
 
-std::string LastfmQueue::serializeScrobble(const QueuedScrobble& q)
+// Appends straight into the save buffer: a large backlog is rewritten after every dispatch batch.
+void LastfmQueue::appendSerialized(std::string& out, const QueuedScrobble& q)
 {
-    std::string out;
-    out += escapeField(q.artist);
+    char num[64];
+    auto appendInteger = [&](long long v)
+    {
+        const auto r = std::to_chars(num, num + sizeof(num), v);
+        out.append(num, r.ptr);
+    };
+    // Fixed six decimals like std::to_string(double) / "%f", without going through printf per field.
+    auto appendSeconds = [&](double v)
+    {
+        if (!(v >= 0.0 && v < 1e9))
+        {
+            const int n = std::snprintf(num, sizeof(num), "%f", v);
+            if (n > 0)
+                out.append(num, std::min<std::size_t>(static_cast<std::size_t>(n), sizeof(num) - 1));
+            return;
+        }
+        const long long micros = std::llround(v * 1e6);
+        appendInteger(micros / 1000000);
+        char frac[8] = {'.', '0', '0', '0', '0', '0', '0', '0'};
+        long long f = micros % 1000000;
+        for (int i = 6; i >= 1; --i, f /= 10)
+            frac[i] = static_cast<char>('0' + f % 10);
+        out.append(frac, 7);
+    };
+
+    appendEscaped(out, q.artist);
     out += '\t';
-    out += escapeField(q.title);
+    appendEscaped(out, q.title);
     out += '\t';
-    out += escapeField(q.album);
+    appendEscaped(out, q.album);
     out += '\t';
-    out += escapeField(q.albumArtist);
+    appendEscaped(out, q.albumArtist);
     out += '\t';
-    out += std::to_string(q.durationSeconds);
+    appendSeconds(q.durationSeconds);
     out += '\t';
-    out += std::to_string(q.playbackSeconds);
+    appendSeconds(q.playbackSeconds);
     out += '\t';
-    out += std::to_string((long long)q.startTimestamp);
+    appendInteger((long long)q.startTimestamp);
     out += '\t';
-    out += q.refreshOnSubmit ? "1" : "0";
+    out += q.refreshOnSubmit ? '1' : '0';
     out += '\t';
-    out += std::to_string(q.retryCount);
+    // Columns 8, 9 and 11 keep their FSQ2 meaning: the Last.fm sink's retry state.
+    const SinkRetry& first = q.retry[lastfm::sink::LASTFM];
+    appendInteger(first.retryCount);
     out += '\t';
-    out += std::to_string((long long)q.nextRetryTimestamp);
+    appendInteger((long long)first.nextRetryTimestamp);
     out += '\t';
-    out += std::to_string((unsigned long long)q.id);
+    out.append(num, std::to_chars(num, num + sizeof(num), (unsigned long long)q.id).ptr);
     out += '\t';
-    out += std::to_string(q.otherErrorCount);
+    appendInteger(first.otherErrorCount);
     out += '\t';
-    out += escapeField(q.mbid);
-    return out;
+    appendEscaped(out, q.mbid);
+
+    // FSQ3: pending-sink mask, then "retry,other,next" per further slot up to the highest one still pending.
+    out += '\t';
+    appendInteger(q.pendingSinks);
+    for (unsigned slot = 1; slot < lastfm::sink::MAX_SINKS && (q.pendingSinks >> slot) != 0; ++slot)
+    {
+        const SinkRetry& r = q.retry[slot];
+        out += '\t';
+        appendInteger(r.retryCount);
+        out += ',';
+        appendInteger(r.otherErrorCount);
+        out += ',';
+        appendInteger((long long)r.nextRetryTimestamp);
+    }
 }
 
 void LastfmQueue::ensureCacheLoadedLocked() const
@@ -227,8 +206,10 @@ void LastfmQueue::ensureCacheLoadedLocked() const
         return;
 
     cache_.clear();
+    parked_.clear();
+    parkedCount_ = 0;
 
-    pfc::string8 raw = cfgLastfmPendingScrobbles.get();
+    const std::string raw = config_.getString(lastfm::config::PENDING_SCROBBLES);
     const char* data = raw.c_str();
     if (!data || !*data)
     {
@@ -238,13 +219,16 @@ void LastfmQueue::ensureCacheLoadedLocked() const
 
     const char* line = data;
 
-    // Optional header handling (FSQ2 / FSQ1). Headerless legacy is accepted for migration.
+    // Optional header handling (FSQ3 / FSQ2 / FSQ1). Headerless legacy is accepted for migration; everything
+    // before FSQ3 was queued for Last.fm only.
+    bool hasSinkColumns = false;
     {
         const char* nl = std::strchr(line, '\n');
         const std::string first = nl ? std::string(line, nl - line) : std::string(line);
 
-        if (first == LastfmQueue::QUEUE_VERSION || first == "#FSQ1")
+        if (first == LastfmQueue::QUEUE_VERSION || first == "#FSQ2" || first == "#FSQ1")
         {
+            hasSinkColumns = first == LastfmQueue::QUEUE_VERSION;
             line = nl ? (nl + 1) : (line + first.size());
         }
         else if (!first.empty() && first[0] == '#')
@@ -289,16 +273,30 @@ void LastfmQueue::ensureCacheLoadedLocked() const
         q.playbackSeconds = std::atof(parts[5].c_str());
         q.startTimestamp = static_cast<std::time_t>(std::atoll(parts[6].c_str()));
         q.refreshOnSubmit = (parts[7] == "1");
-        q.retryCount = std::atoi(parts[8].c_str());
-        q.nextRetryTimestamp = static_cast<std::time_t>(std::atoll(parts[9].c_str()));
+        SinkRetry& first = q.retry[lastfm::sink::LASTFM];
+        first.retryCount = std::atoi(parts[8].c_str());
+        first.nextRetryTimestamp = static_cast<std::time_t>(std::atoll(parts[9].c_str()));
         q.id = static_cast<std::uint64_t>(std::strtoull(parts[10].c_str(), nullptr, 10));
-        q.otherErrorCount = (parts.size() >= 12) ? std::atoi(parts[11].c_str()) : 0;
+        first.otherErrorCount = (parts.size() >= 12) ? std::atoi(parts[11].c_str()) : 0;
         q.mbid = (parts.size() >= 13) ? unescapeField(parts[12]) : "";
 
-        if (q.otherErrorCount < 0)
-            q.otherErrorCount = 0;
-        else if (q.otherErrorCount > 100)
-            q.otherErrorCount = 100;
+        q.pendingSinks = SinkMask(1u << lastfm::sink::LASTFM);
+        if (hasSinkColumns && parts.size() >= 14)
+        {
+            q.pendingSinks = static_cast<SinkMask>(std::strtoul(parts[13].c_str(), nullptr, 10));
+            for (unsigned slot = 1; slot < lastfm::sink::MAX_SINKS && 13 + slot < parts.size(); ++slot)
+            {
+                SinkRetry& r = q.retry[slot];
+                long long next = 0;
+                if (std::sscanf(parts[13 + slot].c_str(), "%d,%d,%lld", &r.retryCount, &r.otherErrorCount, &next) == 3)
+                    r.nextRetryTimestamp = static_cast<std::time_t>(next);
+                else
+                    r = SinkRetry{};
+            }
+        }
+
+        for (auto& r : q.retry)
+            r.otherErrorCount = std::clamp(r.otherErrorCount, 0, 100);
 
         if (q.id == 0)
             continue;
@@ -307,148 +305,238 @@ void LastfmQueue::ensureCacheLoadedLocked() const
         if (q.startTimestamp <= 0)
             continue;
 
-        cache_.push_back(q);
+        if (q.pendingSinks == 0)
+            continue;
+
+        q.order = ++lastOrder_;
+
+        // Deliveries owed to sinks that are not configured this session are kept, not sent, until the service
+        // comes back or the user discards them.
+        if ((q.pendingSinks & ~registeredSinks_) != 0)
+        {
+            ++parkedCount_;
+            if ((q.pendingSinks & registeredSinks_) == 0)
+            {
+                parked_.push_back(std::move(q));
+                continue;
+            }
+        }
+
+        cache_.push_back(std::move(q));
     }
 
+    if (parkedCount_ > 0)
+        LFM_INFO("Queue: keeping " << (unsigned)parkedCount_
+                                   << " scrobble(s) owed to services that are not configured.");
+
     cacheLoaded_ = true;
 }
 
 void LastfmQueue::saveCacheLocked()
 {
-    pfc::string8 raw;
+    std::string raw;
+    raw.reserve(lastSaveBytes_ + 256);
     raw += LastfmQueue::QUEUE_VERSION;
-    raw += "\n";
+    raw += '\n';
 
-    for (const auto& q : cache_)
+    // Only entries changed since the last save are formatted again.
+    for (auto* list : {&cache_, &parked_})
     {
-        raw += serializeScrobble(q).c_str();
-        raw += "\n";
+        for (auto& q : *list)
+        {
+            if (q.saved.empty())
+                appendSerialized(q.saved, q);
+            raw += q.saved;
+            raw += '\n';
+        }
     }
 
-    cfgLastfmPendingScrobbles.set(raw);
+    config_.setString(lastfm::config::PENDING_SCROBBLES, raw);
+    lastSaveBytes_ = raw.size();
     cacheLoaded_ = true;
+
+    // Budget counter rides along with the queue write instead of a cfg write per scrobble.
+    budget_.persistIfDirty();
 }
 
-LastfmQueue::DispatchOutcome
-LastfmQueue::dispatchAndBuildRetryUpdates(const std::vector<QueuedScrobble>& snapshot, unsigned maxToAttempt,
-                                          const std::function<bool()>& isShuttingDown, LastfmClient& client,
-                                          const std::function<void()>& onInvalidSession, int64_t dailyBudget)
+bool LastfmQueue::isDueFor(const QueuedScrobble& q, unsigned slot, std::time_t now)
 {
-    const std::time_t nowCheck = std::time(nullptr);
+    if ((q.pendingSinks & (1u << slot)) == 0)
+        return false;
 
-    DispatchOutcome out;
-    out.updates.reserve(maxToAttempt);
+    const std::time_t next = q.retry[slot].nextRetryTimestamp;
+    return next == 0 || next <= now;
+}
 
-    bool invalidSessionSeen = false;
-    unsigned attempted = 0;
+std::vector<LastfmQueue::QueuedScrobble> LastfmQueue::selectDispatchCandidatesLocked(unsigned slot, std::time_t now,
+                                                                                    unsigned maxCount) const
+{
+    // (priority, position) keeps insertion order among equal timestamps.
+    std::vector<std::pair<std::time_t, std::size_t>> due;
+    due.reserve(std::min<std::size_t>(cache_.size(), 1024));
 
-    for (const auto& q : snapshot)
+    for (std::size_t i = 0; i < cache_.size(); ++i)
     {
-        if (invalidSessionSeen || attempted >= maxToAttempt)
-            break;
-
-        if (q.nextRetryTimestamp > 0 && q.nextRetryTimestamp > nowCheck)
+        const auto& q = cache_[i];
+        if (!isDueFor(q, slot, now))
             continue;
+        due.emplace_back(LastfmDrainPlanner::priorityKey(q.startTimestamp, now), i);
+    }
 
-        if (q.artist.empty() || q.title.empty())
-        {
-            LFM_INFO("Queue: pending still invalid metadata, deferring.");
-            continue;
-        }
+    const std::size_t n = std::min<std::size_t>(maxCount, due.size());
+    std::partial_sort(due.begin(), due.begin() + n, due.end());
 
-        ++attempted;
+    std::vector<QueuedScrobble> out;
+    out.reserve(n);
+    for (std::size_t i = 0; i < n; ++i)
+        out.push_back(cache_[due[i].second]);
+    return out;
+}
 
-        if (isShuttingDown && isShuttingDown())
-            break;
+LastfmQueue::DispatchOutcome
+LastfmQueue::dispatchAndBuildRetryUpdates(const std::vector<QueuedScrobble>& snapshot, unsigned slot,
+                                          ILastfmScrobbleSink& sink, unsigned maxToAttempt,
+                                          const std::function<bool()>& isShuttingDown, LastfmBudget* budget,
+                                          ILastfmClock& clock)
+{
+    DispatchOutcome out;
 
-        LastfmTrackInfo t;
-        t.artist = q.artist;
-        t.title = q.title;
-        t.album = q.album;
-        t.albumArtist = q.albumArtist;
-        t.mbid = q.mbid;
-        t.durationSeconds = q.durationSeconds;
+    const std::time_t nowCheck = clock.wallNow();
+    out.updates.reserve(maxToAttempt);
 
-        auto res = client.scrobble(t, q.playbackSeconds, q.startTimestamp);
+    const std::size_t maxBatch = std::max<std::size_t>(1, sink.maxBatch());
+    std::vector<const QueuedScrobble*> sent;
+    std::vector<LastfmSinkScrobble> batch;
+    std::vector<LastfmScrobbleResult> results;
+    std::size_t next = 0;
+    bool stop = false;
 
-        RetryUpdate u;
-        u.id = q.id;
-        u.newOtherErrorCount = q.otherErrorCount;
+    while (!stop && next < snapshot.size() && out.attempted < maxToAttempt)
+    {
+        sent.clear();
+        batch.clear();
 
-        if (res == LastfmScrobbleResult::SUCCESS)
+        const std::size_t limit = std::min<std::size_t>(maxBatch, maxToAttempt - out.attempted);
+        for (; next < snapshot.size() && batch.size() < limit; ++next)
         {
-            u.remove = true;
-            out.updates.push_back(u);
+            const auto& q = snapshot[next];
+            if (q.artist.empty() || q.title.empty())
+            {
+                LFM_INFO("Queue: pending still invalid metadata, deferring.");
+                continue;
+            }
 
-            if (isShuttingDown && isShuttingDown())
-                break;
+            LastfmSinkScrobble s;
+            s.track.artist = q.artist;
+            s.track.title = q.title;
+            s.track.album = q.album;
+            s.track.albumArtist = q.albumArtist;
+            s.track.mbid = q.mbid;
+            s.track.durationSeconds = q.durationSeconds;
+            s.playbackSeconds = q.playbackSeconds;
+            s.startTimestamp = q.startTimestamp;
+            batch.push_back(std::move(s));
+            sent.push_back(&q);
+        }
 
-            cfgLastfmScrobblesToday.set(cfgLastfmScrobblesToday.get() + 1);
+        if (batch.empty() || (isShuttingDown && isShuttingDown()))
+            break;
 
-            if (dailyBudget > 0 && cfgLastfmScrobblesToday.get() >= dailyBudget)
-                break;
+        sink.submit(batch, results);
 
-            continue;
-        }
+        // The sink stopped early (rate limit, invalid session): nothing more for it this run.
+        if (results.size() < batch.size())
+            stop = true;
 
-        if (res == LastfmScrobbleResult::INVALID_SESSION)
+        const std::time_t nowSchedule = clock.wallNow();
+
+        for (std::size_t i = 0; i < results.size() && i < sent.size(); ++i)
         {
-            invalidSessionSeen = true;
+            const QueuedScrobble& q = *sent[i];
+            const SinkRetry& was = q.retry[slot];
+            const LastfmScrobbleResult res = results[i];
 
-            if (onInvalidSession)
-                onInvalidSession();
-            break;
-        }
+            RetryUpdate u;
+            u.id = q.id;
+            u.slot = slot;
+            u.newOtherErrorCount = was.otherErrorCount;
 
-        const std::time_t nowSchedule = std::time(nullptr);
+            ++out.attempted;
+            if (res != LastfmScrobbleResult::RATE_LIMITED && res != LastfmScrobbleResult::INVALID_SESSION)
+                ++out.accepted;
 
-        u.newRetryCount = std::min(q.retryCount + 1, 100);
+            if (res == LastfmScrobbleResult::SUCCESS)
+            {
+                ++out.succeeded;
+                u.remove = true;
+                u.delivered = true;
+                out.updates.push_back(u);
+
+                if (budget)
+                {
+                    budget->consume(nowCheck);
+                    if (budget->exhausted(nowCheck))
+                        stop = true;
+                }
+                continue;
+            }
 
-        if (res == LastfmScrobbleResult::RATE_LIMITED)
-        {
-            u.newRetryCount = q.retryCount;
-            u.newOtherErrorCount = 0;
-            u.newNextRetryTimestamp = q.nextRetryTimestamp;
-            out.updates.push_back(u);
-            out.rateLimited = true;
-            break;
-        }
-        else if (res == LastfmScrobbleResult::TEMPORARY_ERROR)
-        {
-            u.newOtherErrorCount = 0;
-        }
-        else if (res == LastfmScrobbleResult::OTHER_ERROR)
-        {
-            u.newOtherErrorCount = q.otherErrorCount + 1;
+            // The sink has already reported it (LastfmApiSink calls the invalid-session handler).
+            if (res == LastfmScrobbleResult::INVALID_SESSION)
+            {
+                stop = true;
+                break;
+            }
+
+            u.newRetryCount = std::min(was.retryCount + 1, 100);
 
-            if (u.newOtherErrorCount >= 5)
+            if (res == LastfmScrobbleResult::RATE_LIMITED)
             {
-                u.remove = true;
-                LFM_INFO("Queue: dropping scrobble after repeated OTHER_ERRORs: "
-                         << q.artist.c_str() << " - " << q.title.c_str() << " (otherErrorCount=" << u.newOtherErrorCount
-                         << ")");
+                u.newRetryCount = was.retryCount;
+                u.newOtherErrorCount = 0;
+                u.newNextRetryTimestamp = was.nextRetryTimestamp;
+                out.updates.push_back(u);
+                out.rateLimited = true;
+                stop = true;
+                break;
+            }
+            else if (res == LastfmScrobbleResult::TEMPORARY_ERROR)
+            {
+                u.newOtherErrorCount = 0;
+            }
+            else if (res == LastfmScrobbleResult::OTHER_ERROR)
+            {
+                u.newOtherErrorCount = was.otherErrorCount + 1;
+
+                if (u.newOtherErrorCount >= 5)
+                {
+                    u.remove = true;
+                    LFM_INFO("Queue: " << sink.name() << ": dropping scrobble after repeated OTHER_ERRORs: "
+                                       << q.artist.c_str() << " - " << q.title.c_str()
+                                       << " (otherErrorCount=" << u.newOtherErrorCount << ")");
+                }
+            }
+            else
+            {
+                u.newOtherErrorCount = was.otherErrorCount + 1;
+
+                if (u.newOtherErrorCount >= 5)
+                {
+                    u.remove = true;
+                    LFM_INFO("Queue: " << sink.name() << ": dropping scrobble after repeated unknown errors: "
+                                       << q.artist.c_str() << " - " << q.title.c_str()
+                                       << " (otherErrorCount=" << u.newOtherErrorCount << ")");
+                }
             }
-        }
-        else
-        {
-            u.newOtherErrorCount = q.otherErrorCount + 1;
 
-            if (u.newOtherErrorCount >= 5)
+            if (!u.remove)
             {
-                u.remove = true;
-                LFM_INFO("Queue: dropping scrobble after repeated unknown errors: "
-                         << q.artist.c_str() << " - " << q.title.c_str() << " (otherErrorCount=" << u.newOtherErrorCount
-                         << ")");
+                u.newNextRetryTimestamp =
+                    nowSchedule + std::min(u.newRetryCount * K_RETRY_STEP_SECONDS, K_RETRY_MAX_SECONDS);
             }
-        }
 
-        if (!u.remove)
-        {
-            u.newNextRetryTimestamp =
-                nowSchedule + std::min(u.newRetryCount * K_RETRY_STEP_SECONDS, K_RETRY_MAX_SECONDS);
+            out.updates.push_back(u);
         }
-
-        out.updates.push_back(u);
     }
 
     return out;
@@ -456,34 +544,104 @@ LastfmQueue::dispatchAndBuildRetryUpdates(const std::vector<QueuedScrobble>& sna
 
 void LastfmQueue::mergeRetryUpdates(std::vector<QueuedScrobble>& latest, const std::vector<RetryUpdate>& updates)
 {
+    if (updates.empty())
+        return;
+
+    // One entry can carry an update per sink.
+    std::unordered_multimap<std::uint64_t, const RetryUpdate*> byId;
+    byId.reserve(updates.size());
     for (const auto& u : updates)
+        byId.emplace(u.id, &u);
+
+    // One compacting pass: erasing entries one at a time near the front shifts the whole backlog each time.
+    auto out = latest.begin();
+    for (auto it = latest.begin(); it != latest.end(); ++it)
     {
-        for (auto it = latest.begin(); it != latest.end();)
+        const auto range = byId.equal_range(it->id);
+        if (range.first != range.second)
         {
-            if (it->id != u.id)
+            it->saved.clear();
+            for (auto f = range.first; f != range.second; ++f)
             {
-                ++it;
-                continue;
+                const RetryUpdate& u = *f->second;
+                SinkRetry& r = it->retry[u.slot];
+                if (u.remove)
+                {
+                    it->pendingSinks &= static_cast<SinkMask>(~(1u << u.slot));
+                    r = SinkRetry{};
+                    continue;
+                }
+
+                r.retryCount = u.newRetryCount;
+                r.otherErrorCount = u.newOtherErrorCount;
+                r.nextRetryTimestamp = u.newNextRetryTimestamp;
             }
 
-            if (u.remove)
-                it = latest.erase(it);
-            else
-            {
-                it->retryCount = u.newRetryCount;
-                it->otherErrorCount = u.newOtherErrorCount;
-                it->nextRetryTimestamp = u.newNextRetryTimestamp;
-                ++it;
-            }
-
-            break;
+            // Delivered (or given up) everywhere.
+            if (it->pendingSinks == 0)
+                continue;
         }
+
+        if (out != it)
+            *out = std::move(*it);
+        ++out;
     }
+    latest.erase(out, latest.end());
 }
 
-LastfmQueue::LastfmQueue(LastfmClient& client, std::function<void()> onInvalidSession)
-    : client(client), onInvalidSession(std::move(onInvalidSession))
+LastfmQueue::LastfmQueue(ILastfmScrobbleApi& client, std::function<void()> onInvalidSession,
+                         ILastfmConfigStore& config, ILastfmClock& clock)
+    : lastfmSink_(std::make_unique<LastfmApiSink>(client, std::move(onInvalidSession))), config_(config),
+      clock_(clock), budget_(config, clock)
 {
+    sinks_[lastfm::sink::LASTFM].sink = lastfmSink_.get();
+    registeredSinks_ = SinkMask(1u << lastfm::sink::LASTFM);
+}
+
+void LastfmQueue::addSink(unsigned slot, ILastfmScrobbleSink& sink)
+{
+    if (slot == lastfm::sink::LASTFM || slot >= lastfm::sink::MAX_SINKS)
+    {
+        LFM_INFO("Queue: sink slot " << slot << " is not available.");
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    sinks_[slot] = SinkSlot{};
+    sinks_[slot].sink = &sink;
+    registeredSinks_ |= SinkMask(1u << slot);
+}
+
+void LastfmQueue::holdSink(unsigned slot, bool held)
+{
+    if (slot >= lastfm::sink::MAX_SINKS)
+        return;
+
+    const SinkMask bit = SinkMask(1u << slot);
+    if (held)
+        heldSinks_.fetch_or(bit);
+    else
+        heldSinks_.fetch_and(static_cast<SinkMask>(~bit));
+}
+
+// Sinks are registered before the queue is used, so the slots are read without the lock; ready() may take the
+// client's own locks.
+LastfmQueue::SinkMask LastfmQueue::readySinks() const
+{
+    const SinkMask candidates = registeredSinks_ & static_cast<SinkMask>(~heldSinks_.load());
+
+    SinkMask ready = 0;
+    for (unsigned slot = 0; slot < lastfm::sink::MAX_SINKS; ++slot)
+    {
+        if ((candidates & (1u << slot)) != 0 && sinks_[slot].sink->ready())
+            ready |= SinkMask(1u << slot);
+    }
+    return ready;
+}
+
+bool LastfmQueue::hasReadySink() const
+{
+    return readySinks() != 0;
 }
 
 void LastfmQueue::refreshPendingScrobbleMetadata(const LastfmTrackInfo& track)
@@ -497,12 +655,15 @@ void LastfmQueue::refreshPendingScrobbleMetadata(const LastfmTrackInfo& track)
             continue;
 
         LFM_DEBUG("Queue: refresh metadata");
+        it->saved.clear();
 
         // Only overwrite with non-empty values
         if (!track.artist.empty())
             it->artist = track.artist;
         if (!track.title.empty())
             it->title = track.title;
+        if (corrections_)
+            corrections_->apply(it->artist, it->title);
         if (!track.album.empty())
             it->album = track.album;
         if (!track.albumArtist.empty())
@@ -517,135 +678,375 @@ void LastfmQueue::refreshPendingScrobbleMetadata(const LastfmTrackInfo& track)
     }
 }
 
+bool LastfmQueue::makeQueued(const NewScrobble& in, SinkMask sinks, QueuedScrobble& out)
+{
+    if (in.track.artist.empty() || in.track.title.empty())
+        return false;
+
+    out = QueuedScrobble{};
+    out.artist = in.track.artist;
+    out.title = in.track.title;
+    out.album = in.track.album;
+    out.albumArtist = in.track.albumArtist;
+    out.mbid = in.track.mbid;
+    out.durationSeconds = in.track.durationSeconds;
+    out.playbackSeconds = in.playbackSeconds;
+    out.startTimestamp = in.startTimestamp;
+    out.refreshOnSubmit = in.refreshOnSubmit;
+    out.pendingSinks = sinks;
+    out.id = nextQueueId();
+    return true;
+}
+
+bool LastfmQueue::alreadyScrobbled(const QueuedScrobble& q) const
+{
+    return history_ && history_->containsKey(lastfm::util::playKey(q.startTimestamp, q.artist, q.title));
+}
+
+bool LastfmQueue::admit(QueuedScrobble& q) const
+{
+    if (alreadyScrobbled(q))
+        return false;
+    if (corrections_ && corrections_->apply(q.artist, q.title) && alreadyScrobbled(q))
+        return false;
+    return true;
+}
+
+void LastfmQueue::recordDelivered(const std::vector<QueuedScrobble>& candidates,
+                                  const std::vector<RetryUpdate>& updates)
+{
+    if (!history_)
+        return;
+
+    // Updates come back in candidate order, so one forward pass pairs them up.
+    std::vector<LastfmHistoryRecord> delivered;
+    std::size_t c = 0;
+    for (const auto& u : updates)
+    {
+        if (!u.delivered)
+            continue;
+        while (c < candidates.size() && candidates[c].id != u.id)
+            ++c;
+        if (c == candidates.size())
+            break;
+
+        const QueuedScrobble& q = candidates[c];
+        LastfmHistoryRecord r;
+        r.timestamp = q.startTimestamp;
+        r.artist = q.artist;
+        r.title = q.title;
+        r.album = q.album;
+        r.albumArtist = q.albumArtist;
+        r.durationSeconds = q.durationSeconds;
+        delivered.push_back(std::move(r));
+    }
+
+    if (!delivered.empty())
+        history_->record(delivered);
+}
+
 void LastfmQueue::queueScrobbleForRetry(const LastfmTrackInfo& track, double playbackSeconds, bool refreshOnSubmit,
                                         std::time_t startTimestamp)
 {
-    if (track.artist.empty() || track.title.empty())
+    const SinkMask sinks = readySinks();
+    if (sinks == 0)
         return;
 
     QueuedScrobble q;
-    q.artist = track.artist;
-    q.title = track.title;
-    q.album = track.album;
-    q.albumArtist = track.albumArtist;
-    q.mbid = track.mbid;
-    q.durationSeconds = track.durationSeconds;
-    q.playbackSeconds = playbackSeconds;
-    q.startTimestamp = startTimestamp;
-    q.refreshOnSubmit = refreshOnSubmit;
-    q.id = nextQueueId();
-    q.otherErrorCount = 0;
+    if (!makeQueued(NewScrobble{track, playbackSeconds, startTimestamp, refreshOnSubmit}, sinks, q))
+        return;
+
+    if (!admit(q))
+    {
+        LFM_INFO("Queue: " << q.artist.c_str() << " - " << q.title.c_str() << " is already scrobbled, not queued");
+        return;
+    }
 
     std::lock_guard<std::mutex> lock(mutex);
     ensureCacheLoadedLocked();
+    q.order = ++lastOrder_;
     cache_.push_back(q);
     saveCacheLocked();
 
     LFM_DEBUG("Queue: queued scrobble, pending=" << (unsigned)cache_.size());
 }
 
-void LastfmQueue::enterRateLimitCooldownLocked(std::time_t now, std::time_t cooldownSeconds)
+std::size_t LastfmQueue::queueScrobblesForRetry(const std::vector<NewScrobble>& batch, Refusals* refusals,
+                                                std::time_t lastfmNotBefore)
+{
+    Refusals none;
+    Refusals& refused = refusals ? *refusals : none;
+
+    const SinkMask sinks = readySinks();
+    if (sinks == 0)
+    {
+        refused.noSink += batch.size();
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ensureCacheLoadedLocked();
+
+    const SinkMask lateSinks = sinks & static_cast<SinkMask>(~(1u << lastfm::sink::LASTFM));
+
+    const std::size_t before = cache_.size();
+    std::size_t scrobbled = 0;
+    cache_.reserve(before + batch.size());
+    for (const auto& in : batch)
+    {
+        const bool late = lastfmNotBefore > 0 && in.startTimestamp < lastfmNotBefore;
+        if (late && lateSinks == 0)
+        {
+            ++refused.tooOld;
+            continue;
+        }
+
+        QueuedScrobble q;
+        if (!makeQueued(in, late ? lateSinks : sinks, q))
+        {
+            ++refused.invalid;
+            continue;
+        }
+        if (!admit(q))
+        {
+            ++scrobbled;
+            continue;
+        }
+        q.order = ++lastOrder_;
+        cache_.push_back(std::move(q));
+    }
+    refused.alreadyScrobbled += scrobbled;
+
+    if (scrobbled > 0)
+        LFM_INFO("Queue: " << (unsigned)scrobbled << " already scrobbled play(s) not queued");
+
+    if (cache_.size() == before)
+        return 0;
+
+    saveCacheLocked();
+    LFM_DEBUG("Queue: queued " << (unsigned)(cache_.size() - before)
+                               << " scrobble(s), pending=" << (unsigned)cache_.size());
+    return cache_.size() - before;
+}
+
+void LastfmQueue::collectPlayKeys(LastfmPlayKeySet& out) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    ensureCacheLoadedLocked();
+
+    out.reserve(out.size() + cache_.size() + parked_.size());
+    for (const auto* list : {&cache_, &parked_})
+        for (const auto& q : *list)
+            out.insert(lastfm::util::playKey(q.startTimestamp, q.artist, q.title));
+}
+
+std::size_t LastfmQueue::forEachPending(const std::function<bool(const PendingScrobble&)>& f) const
+{
+    // Both lists are sorted by order, which entries keep while they move between them, so a walk by order visits
+    // every entry once however the queue changes between chunks.
+    const auto byOrder = [](const QueuedScrobble& q, std::uint64_t order) { return q.order < order; };
+
+    std::vector<PendingScrobble> chunk;
+    std::uint64_t after = 0; // order of the last entry copied
+    std::size_t visited = 0;
+    for (;;)
+    {
+        chunk.clear();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ensureCacheLoadedLocked();
+
+            auto a = std::lower_bound(cache_.begin(), cache_.end(), after + 1, byOrder);
+            auto b = std::lower_bound(parked_.begin(), parked_.end(), after + 1, byOrder);
+            while (chunk.size() < K_PENDING_CHUNK && (a != cache_.end() || b != parked_.end()))
+            {
+                const bool fromCache = b == parked_.end() || (a != cache_.end() && a->order < b->order);
+                const QueuedScrobble& q = fromCache ? *a++ : *b++;
+                after = q.order;
+
+                PendingScrobble& p = chunk.emplace_back();
+                p.id = q.id;
+                p.track.artist = q.artist;
+                p.track.title = q.title;
+                p.track.album = q.album;
+                p.track.albumArtist = q.albumArtist;
+                p.track.mbid = q.mbid;
+                p.track.durationSeconds = q.durationSeconds;
+                p.playbackSeconds = q.playbackSeconds;
+                p.startTimestamp = q.startTimestamp;
+                p.pendingSinks = q.pendingSinks;
+
+                bool first = true;
+                for (unsigned slot = 0; slot < lastfm::sink::MAX_SINKS; ++slot)
+                {
+                    if ((q.pendingSinks & (1u << slot)) == 0)
+                        continue;
+                    const SinkRetry& r = q.retry[slot];
+                    p.retryCount = std::max(p.retryCount, r.retryCount);
+                    p.nextRetryTimestamp =
+                        first ? r.nextRetryTimestamp : std::min(p.nextRetryTimestamp, r.nextRetryTimestamp);
+                    first = false;
+                }
+            }
+        }
+
+        if (chunk.empty())
+            return visited;
+        for (const PendingScrobble& p : chunk)
+        {
+            ++visited;
+            if (!f(p))
+                return visited;
+        }
+    }
+}
+
+void LastfmQueue::collectTrackStarts(std::vector<std::pair<std::uint64_t, std::time_t>>& out) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    ensureCacheLoadedLocked();
+
+    out.reserve(out.size() + cache_.size() + parked_.size());
+    for (const auto* list : {&cache_, &parked_})
+        for (const auto& q : *list)
+            out.emplace_back(lastfm::util::trackKey(q.artist, q.title), q.startTimestamp);
+}
+
+void LastfmQueue::enterRateLimitCooldownLocked(unsigned slot, std::time_t now, std::time_t cooldownSeconds)
 {
     if (cooldownSeconds <= 0)
         cooldownSeconds = K_RATE_LIMIT_COOLDOWN_SECONDS;
 
+    SinkSlot& s = sinks_[slot];
     const std::time_t until = now + cooldownSeconds;
-    if (until > rateLimitedUntil_)
-        rateLimitedUntil_ = until;
+    if (until > s.rateLimitedUntil)
+        s.rateLimitedUntil = until;
 
-    if (!rateLimitLogged_)
+    if (!s.rateLimitLogged)
     {
-        LFM_INFO("Queue: Last.fm rate limit hit (error 29), pausing retries for "
-                 << static_cast<long long>(cooldownSeconds) << "s.");
-        rateLimitLogged_ = true;
+        LFM_INFO("Queue: " << s.sink->name() << " rate limit hit, pausing retries for "
+                           << static_cast<long long>(cooldownSeconds) << "s.");
+        s.rateLimitLogged = true;
     }
 }
 
-bool LastfmQueue::isRateLimitedLocked(std::time_t now)
+bool LastfmQueue::isRateLimitedLocked(unsigned slot, std::time_t now)
 {
-    if (rateLimitedUntil_ <= 0)
+    SinkSlot& s = sinks_[slot];
+    if (s.rateLimitedUntil <= 0)
         return false;
 
-    if (now >= rateLimitedUntil_)
+    if (now >= s.rateLimitedUntil)
     {
-        rateLimitedUntil_ = 0;
-        rateLimitLogged_ = false;
+        s.rateLimitedUntil = 0;
+        s.rateLimitLogged = false;
         return false;
     }
 
     return true;
 }
 
-void LastfmQueue::retryQueuedScrobbles()
+bool LastfmQueue::canDispatchLocked(unsigned slot, std::time_t now)
 {
-    if (core_api::is_shutting_down())
-        return;
+    if (isRateLimitedLocked(slot, now))
+        return false;
+
+    return !(sinks_[slot].sink->usesDailyBudget() && budget_.exhausted(now));
+}
+
+unsigned LastfmQueue::retryQueuedScrobbles()
+{
+    if (config_.closing())
+        return 0;
 
     auto isShuttingDown = [this]() -> bool { return shuttingDown_ && shuttingDown_->load(std::memory_order_acquire); };
 
     // IMPORTANT: do NOT touch cfg_* during shutdown, ever.
     if (isShuttingDown())
-        return;
+        return 0;
+
+    const SinkMask ready = readySinks();
+    std::vector<RetryUpdate> updates;
+    unsigned attempted = 0;
 
+    // Each sink drains its own share; all outcomes land in one merge and one save.
+    for (unsigned slot = 0; slot < lastfm::sink::MAX_SINKS; ++slot)
     {
-        std::lock_guard<std::mutex> lock(mutex);
-        if (isRateLimitedLocked(std::time(nullptr)))
-            return;
-    }
+        if ((ready & (1u << slot)) == 0)
+            continue;
 
-    if (lastfmDailyBudgetExhausted(isShuttingDown))
-        return;
+        ILastfmScrobbleSink& sink = *sinks_[slot].sink;
+        const std::time_t now = clock_.wallNow();
 
-    const int64_t dailyBudget = static_cast<int64_t>(cfgLastfmDailyBudget.get());
-    const int64_t todayCount = static_cast<int64_t>(cfgLastfmScrobblesToday.get());
+        unsigned maxToAttempt = (unsigned)std::max<std::size_t>(LastfmDrainPlanner::DISPATCH_BATCH, sink.maxBatch());
+        if (sink.usesDailyBudget())
+        {
+            const int64_t remaining = budget_.available(now);
+            if (remaining <= 0)
+                continue;
+            maxToAttempt = (unsigned)std::min<int64_t>((int64_t)maxToAttempt, remaining);
+        }
 
-    int64_t remaining = (dailyBudget > 0) ? (dailyBudget - todayCount) : INT64_MAX;
-    remaining = std::max<int64_t>(0, remaining);
+        // Only the entries about to be sent are copied, ordered by acceptance-window urgency.
+        std::vector<QueuedScrobble> candidates;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (isRateLimitedLocked(slot, now))
+                continue;
 
-    if (dailyBudget > 0 && remaining <= 0)
-        return;
+            ensureCacheLoadedLocked();
+            candidates = selectDispatchCandidatesLocked(slot, now, maxToAttempt);
+        }
 
-    const unsigned maxToAttempt = (dailyBudget > 0)
-                                      ? (unsigned)std::min<int64_t>((int64_t)K_MAX_DISPATCH_BATCH, remaining)
-                                      : (unsigned)K_MAX_DISPATCH_BATCH;
+        if (candidates.empty())
+            continue;
 
-    std::vector<QueuedScrobble> snapshot;
-    {
-        std::lock_guard<std::mutex> lock(mutex);
-        ensureCacheLoadedLocked();
-        snapshot = cache_;
-    }
+        const auto dispatch =
+            dispatchAndBuildRetryUpdates(candidates, slot, sink, maxToAttempt, isShuttingDown,
+                                         sink.usesDailyBudget() ? &budget_ : nullptr, clock_);
+        attempted += dispatch.attempted;
 
-    if (snapshot.empty())
-        return;
+        // Delivered is delivered, shutdown or not.
+        recordDelivered(candidates, dispatch.updates);
 
-    const auto dispatch =
-        dispatchAndBuildRetryUpdates(snapshot, maxToAttempt, isShuttingDown, client, onInvalidSession, dailyBudget);
+        if (isShuttingDown())
+            return attempted;
 
-    if (isShuttingDown())
-        return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            SinkSlot& s = sinks_[slot];
 
-    if (dispatch.rateLimited)
-    {
-        std::lock_guard<std::mutex> lock(mutex);
-        enterRateLimitCooldownLocked(std::time(nullptr), K_RATE_LIMIT_COOLDOWN_SECONDS);
+            if (dispatch.accepted > 0)
+            {
+                const double rate = static_cast<double>(dispatch.succeeded) / static_cast<double>(dispatch.accepted);
+                s.acceptRate = (1.0 - K_ACCEPT_RATE_ALPHA) * s.acceptRate + K_ACCEPT_RATE_ALPHA * rate;
+            }
+
+            if (dispatch.rateLimited)
+                enterRateLimitCooldownLocked(slot, clock_.wallNow(), K_RATE_LIMIT_COOLDOWN_SECONDS);
+        }
+
+        updates.insert(updates.end(), dispatch.updates.begin(), dispatch.updates.end());
     }
 
-    if (dispatch.updates.empty())
-        return;
+    if (updates.empty())
+        return attempted;
 
     if (isShuttingDown())
-        return;
+        return attempted;
 
     std::lock_guard<std::mutex> lock(mutex);
     ensureCacheLoadedLocked();
-    mergeRetryUpdates(cache_, dispatch.updates);
+    mergeRetryUpdates(cache_, updates);
+    if (parkedCount_ > 0)
+        parkUnreachableLocked();
 
     if (isShuttingDown())
-        return;
+        return attempted;
 
     saveCacheLocked();
     LFM_DEBUG("Queue: merge-save done, pending=" << (unsigned)cache_.size());
+    return attempted;
 }
 
 std::size_t LastfmQueue::getPendingScrobbleCount() const
@@ -655,38 +1056,211 @@ std::size_t LastfmQueue::getPendingScrobbleCount() const
     return cache_.size();
 }
 
+std::size_t LastfmQueue::getPendingScrobbleCount(unsigned slot) const
+{
+    if (slot >= lastfm::sink::MAX_SINKS)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ensureCacheLoadedLocked();
+    const auto owed = [slot](const QueuedScrobble& q) { return (q.pendingSinks & (1u << slot)) != 0; };
+    return (std::size_t)(std::count_if(cache_.begin(), cache_.end(), owed) +
+                         std::count_if(parked_.begin(), parked_.end(), owed));
+}
+
+std::size_t LastfmQueue::getParkedScrobbleCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    ensureCacheLoadedLocked();
+    return parkedCount_;
+}
+
+std::size_t LastfmQueue::discardParkedDeliveries()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    ensureCacheLoadedLocked();
+    if (parkedCount_ == 0)
+        return 0;
+
+    const std::size_t discarded = parkedCount_;
+    for (auto& q : cache_)
+    {
+        if ((q.pendingSinks & ~registeredSinks_) == 0)
+            continue;
+        q.pendingSinks &= registeredSinks_;
+        for (unsigned slot = 0; slot < lastfm::sink::MAX_SINKS; ++slot)
+            if ((registeredSinks_ & (1u << slot)) == 0)
+                q.retry[slot] = SinkRetry{};
+        q.saved.clear();
+    }
+    parked_.clear();
+    parkedCount_ = 0;
+    saveCacheLocked();
+
+    LFM_INFO("Queue: discarded deliveries of " << (unsigned)discarded
+                                               << " scrobble(s) to services that are not configured.");
+    return discarded;
+}
+
+// Entries whose configured sinks are all done but that still owe a parked one leave the drain.
+void LastfmQueue::parkUnreachableLocked()
+{
+    const std::size_t before = parked_.size();
+    auto out = cache_.begin();
+    for (auto it = cache_.begin(); it != cache_.end(); ++it)
+    {
+        if ((it->pendingSinks & registeredSinks_) == 0)
+        {
+            parked_.push_back(std::move(*it));
+            continue;
+        }
+        if (out != it)
+            *out = std::move(*it);
+        ++out;
+    }
+    cache_.erase(out, cache_.end());
+
+    // parked_ stays sorted by order, as forEachPending() expects.
+    if (parked_.size() > before)
+        std::inplace_merge(parked_.begin(), parked_.begin() + static_cast<std::ptrdiff_t>(before), parked_.end(),
+                           [](const QueuedScrobble& x, const QueuedScrobble& y) { return x.order < y.order; });
+}
+
+std::time_t LastfmQueue::rateLimitedUntil(unsigned slot)
+{
+    if (slot >= lastfm::sink::MAX_SINKS)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return isRateLimitedLocked(slot, clock_.wallNow()) ? sinks_[slot].rateLimitedUntil : 0;
+}
+
+void LastfmQueue::noteRateLimited(unsigned slot)
+{
+    if (slot >= lastfm::sink::MAX_SINKS)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (sinks_[slot].sink)
+        enterRateLimitCooldownLocked(slot, clock_.wallNow(), K_RATE_LIMIT_COOLDOWN_SECONDS);
+}
+
 bool LastfmQueue::hasDueScrobble(std::time_t now)
 {
+    const SinkMask ready = readySinks();
+
     std::lock_guard<std::mutex> lock(mutex);
     ensureCacheLoadedLocked();
-    if (isRateLimitedLocked(now))
-        return false;
 
-    for (const auto& q : cache_)
-        if (q.nextRetryTimestamp == 0 || q.nextRetryTimestamp <= now)
-            return true;
+    // One pass per open sink keeps the usual single-sink scan a plain loop.
+    for (unsigned slot = 0; slot < lastfm::sink::MAX_SINKS; ++slot)
+    {
+        if ((ready & (1u << slot)) == 0 || !canDispatchLocked(slot, now))
+            continue;
+
+        for (const auto& q : cache_)
+            if (isDueFor(q, slot, now))
+                return true;
+    }
     return false;
 }
 
+LastfmDrainPlan LastfmQueue::drainPlan(std::time_t now, std::time_t minSpacingSeconds)
+{
+    LastfmDrainInputs in;
+    in.now = now;
+    in.minSpacingSeconds = minSpacingSeconds;
+
+    // With nothing ready (not authenticated yet) the plan still describes the whole backlog.
+    SinkMask sinks = readySinks();
+    if (sinks == 0)
+        sinks = registeredSinks_;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ensureCacheLoadedLocked();
+
+        // Rate-limited only while every sink is; the plan then waits for the first one to reopen.
+        bool anyOpen = false;
+        for (unsigned slot = 0; slot < lastfm::sink::MAX_SINKS; ++slot)
+        {
+            if ((sinks & (1u << slot)) == 0)
+                continue;
+            if (!isRateLimitedLocked(slot, now))
+                anyOpen = true;
+            else if (in.rateLimitedUntil == 0 || sinks_[slot].rateLimitedUntil < in.rateLimitedUntil)
+                in.rateLimitedUntil = sinks_[slot].rateLimitedUntil;
+        }
+        if (anyOpen)
+            in.rateLimitedUntil = 0;
+
+        in.pending = cache_.size();
+        in.acceptRate = sinks_[lastfm::sink::LASTFM].acceptRate; // the budgeted sink sets the pace
+
+        for (const auto& q : cache_)
+        {
+            bool due = false;
+            std::time_t earliest = 0;
+            for (unsigned m = q.pendingSinks & sinks; m != 0; m &= m - 1)
+            {
+                const std::time_t next = q.retry[std::countr_zero(m)].nextRetryTimestamp;
+                if (next == 0 || next <= now)
+                {
+                    due = true;
+                    break;
+                }
+                if (earliest == 0 || next < earliest)
+                    earliest = next;
+            }
+
+            if (!due)
+            {
+                if (earliest > 0 && (in.earliestRetry == 0 || earliest < in.earliestRetry))
+                    in.earliestRetry = earliest;
+                continue;
+            }
+
+            ++in.due;
+            if (LastfmDrainPlanner::isExpired(q.startTimestamp, now))
+                ++in.expired;
+            else if (LastfmDrainPlanner::isExpiringSoon(q.startTimestamp, now))
+                ++in.expiringSoon;
+        }
+    }
+
+    in.dailyLimit = budget_.dailyLimit();
+    in.usedToday = budget_.usedToday();
+    in.availableNow = budget_.available(now);
+    in.secondsUntilToken = budget_.secondsUntilAvailable(now);
+
+    return LastfmDrainPlanner::plan(in);
+}
+
 void LastfmQueue::clearAll()
 {
     std::lock_guard<std::mutex> lock(mutex);
     cache_.clear();
+    parked_.clear();
+    parkedCount_ = 0;
     cacheLoaded_ = true;
     saveCacheLocked();
-    rateLimitedUntil_ = 0;
-    rateLimitLogged_ = false;
+    for (auto& s : sinks_)
+    {
+        s.rateLimitedUntil = 0;
+        s.rateLimitLogged = false;
+    }
     LFM_INFO("Queue: cleared all pending scrobbles.");
 }
 
-bool LastfmQueue::drainEnabled()
+bool LastfmQueue::drainEnabled() const
 {
-    return cfgLastfmDrainEnabled.get() != 0;
+    return config_.getInt(lastfm::config::DRAIN_ENABLED, lastfm::config::DEFAULT_DRAIN_ENABLED) != 0;
 }
 
-std::chrono::seconds LastfmQueue::drainCooldown()
+std::chrono::seconds LastfmQueue::drainCooldown() const
 {
-    int64_t cooldown = cfgLastfmDrainCooldownSeconds.get();
+    int64_t cooldown =
+        config_.getInt(lastfm::config::DRAIN_COOLDOWN_SECONDS, lastfm::config::DEFAULT_DRAIN_COOLDOWN_SECONDS);
 
     if (cooldown < 0)
         cooldown = 0;
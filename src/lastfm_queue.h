@@ -7,50 +7,164 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <ctime>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "lastfm_auth_state.h"
-#include "lastfm_client.h"
+#include "lastfm_budget.h"
+#include "lastfm_clock.h"
+#include "lastfm_config_store.h"
+#include "lastfm_corrections.h"
+#include "lastfm_drain_planner.h"
+#include "lastfm_history.h"
+#include "lastfm_key_set.h"
+#include "lastfm_scrobble_api.h"
+#include "lastfm_scrobble_sink.h"
 
 class LastfmQueue
 {
   public:
-    static constexpr const char* QUEUE_VERSION = "#FSQ2";
-    LastfmQueue(LastfmClient& client, std::function<void()> onInvalidSession);
+    static constexpr const char* QUEUE_VERSION = "#FSQ3";
+
+    struct NewScrobble
+    {
+        LastfmTrackInfo track;
+        double playbackSeconds = 0.0;
+        std::time_t startTimestamp = 0;
+        bool refreshOnSubmit = false;
+    };
+
+    // One pending entry as exports and offline tools see it.
+    struct PendingScrobble
+    {
+        std::uint64_t id = 0;
+        LastfmTrackInfo track;
+        double playbackSeconds = 0.0;
+        std::time_t startTimestamp = 0;
+        unsigned pendingSinks = 0;          // bit per lastfm::sink slot still owed the scrobble
+        int retryCount = 0;                 // highest over the pending sinks
+        std::time_t nextRetryTimestamp = 0; // earliest over the pending sinks; 0 = due now
+    };
+
+    // The client becomes the Last.fm sink (slot lastfm::sink::LASTFM).
+    LastfmQueue(ILastfmScrobbleApi& client, std::function<void()> onInvalidSession, ILastfmConfigStore& config,
+                ILastfmClock& clock = lastfmSystemClock());
+
+    // Registers a further sink; call before the queue is first used. Pending deliveries for slots that are not
+    // registered when the queue loads are parked (see getParkedScrobbleCount()).
+    void addSink(unsigned slot, ILastfmScrobbleSink& sink);
+
+    // A held sink is skipped until released (invalid session until re-authentication).
+    void holdSink(unsigned slot, bool held);
+
+    // Some registered sink is ready and not held.
+    bool hasReadySink() const;
 
     void setShuttingDownFlag(std::atomic<bool>* flag)
     {
         shuttingDown_ = flag;
     }
 
+    // Optional; set before the queue is first used. Delivered scrobbles are recorded there, and plays it already
+    // holds are not queued again.
+    void setHistory(ILastfmScrobbleHistory* history)
+    {
+        history_ = history;
+    }
+
+    // Optional; set before the queue is first used. Artist and title are rewritten to Last.fm's spelling when it
+    // is known, as entries are queued or refreshed.
+    void setCorrections(ILastfmCorrections* corrections)
+    {
+        corrections_ = corrections;
+    }
+
     // Called when metadata changes before submit
     void refreshPendingScrobbleMetadata(const LastfmTrackInfo& track);
 
-    // Queue a scrobble for retry
+    // Queue a scrobble for retry, once, for every sink ready right now
     void queueScrobbleForRetry(const LastfmTrackInfo& track, double playbackSeconds, bool refreshOnSubmit,
                                std::time_t startTimestamp);
 
-    // Retry logic
-    void retryQueuedScrobbles();
+    // Why entries of a batch were not queued.
+    struct Refusals
+    {
+        std::size_t noSink = 0;           // no sink was ready
+        std::size_t alreadyScrobbled = 0; // in the history, as given or in Last.fm's spelling
+        std::size_t invalid = 0;          // no artist or title
+        std::size_t tooOld = 0;           // before lastfmNotBefore, and no other sink was ready
+    };
+
+    // Same for many entries with a single save (bulk imports, drain simulation). Returns the number queued;
+    // refusals, when given, adds up the rest. Plays that started before lastfmNotBefore (0 = no limit) are not
+    // owed to Last.fm, which would only spend its daily budget on them to have them ignored.
+    std::size_t queueScrobblesForRetry(const std::vector<NewScrobble>& batch, Refusals* refusals = nullptr,
+                                       std::time_t lastfmNotBefore = 0);
+
+    // lastfm::util::playKey() of every pending entry, for imports that must not queue a play twice.
+    void collectPlayKeys(LastfmPlayKeySet& out) const;
+
+    // lastfm::util::trackKey() and start of every pending entry, for imports whose times only approximate the
+    // play start.
+    void collectTrackStarts(std::vector<std::pair<std::uint64_t, std::time_t>>& out) const;
+
+    // Visits the pending entries in queue order, one at a time. They are copied out in bounded chunks and f runs
+    // without the queue lock, so it may block; entries queued meanwhile are visited too, entries delivered
+    // meanwhile may be. False from f stops the walk. Returns the number of entries visited.
+    std::size_t forEachPending(const std::function<bool(const PendingScrobble&)>& f) const;
+
+    // Retry logic. Returns the number of scrobbles attempted.
+    unsigned retryQueuedScrobbles();
 
     // Introspection
     std::size_t getPendingScrobbleCount() const;
+    std::size_t getPendingScrobbleCount(unsigned slot) const;
     bool hasDueScrobble(std::time_t now);
 
+    // Rate-limit cooldown of one sink, shared with other callers of the same service (the user data prefetcher):
+    // 0 when not cooling down, and a way to report a rate-limit answer they received.
+    std::time_t rateLimitedUntil(unsigned slot);
+    void noteRateLimited(unsigned slot);
+
+    // Drain schedule for the current backlog (budget, rate limit, accept rate).
+    LastfmDrainPlan drainPlan(std::time_t now, std::time_t minSpacingSeconds);
+
+    // Plays still owed to a sink that is not registered this session (its service was turned off). Those
+    // deliveries are kept, not sent; entries owing nothing else stay out of the drain.
+    std::size_t getParkedScrobbleCount() const;
+
+    // Drops those deliveries; entries then owing nothing are removed. Returns the number of entries affected.
+    std::size_t discardParkedDeliveries();
+
     // Clear all pending scrobbles (persistent storage).
     void clearAll();
 
-    static bool drainEnabled();
-    static std::chrono::seconds drainCooldown();
+    bool drainEnabled() const;
+    std::chrono::seconds drainCooldown() const;
+
+    // One text field of a saved row with its escapes (\\ \t \n \r) undone, for tools that read the rows directly.
+    static std::string unescapeField(const std::string& in);
 
   private:
+    using SinkMask = std::uint8_t;
+    static_assert(lastfm::sink::MAX_SINKS <= 8, "SinkMask holds one bit per sink");
+
+    struct SinkRetry
+    {
+        int retryCount = 0;
+        int otherErrorCount = 0;
+        std::time_t nextRetryTimestamp = 0;
+    };
+
     struct QueuedScrobble
     {
         std::uint64_t id = 0;
@@ -63,15 +177,22 @@ class LastfmQueue
         double playbackSeconds = 0.0;
         std::time_t startTimestamp = 0;
         bool refreshOnSubmit = false;
-        int retryCount = 0;
-        int otherErrorCount = 0;
-        std::time_t nextRetryTimestamp = 0;
+        SinkMask pendingSinks = 0; // bit per sink still owed this scrobble
+        std::array<SinkRetry, lastfm::sink::MAX_SINKS> retry{};
+
+        // Insertion order, this session only; cache_ and parked_ are each sorted by it.
+        std::uint64_t order = 0;
+
+        // Serialized line from the last save; cleared whenever a field above changes.
+        std::string saved;
     };
 
     struct RetryUpdate
     {
         std::uint64_t id = 0;
-        bool remove = false;
+        unsigned slot = 0;
+        bool remove = false;    // delivered (or given up) for this sink
+        bool delivered = false; // accepted by the sink
         int newRetryCount = 0;
         int newOtherErrorCount = 0;
         std::time_t newNextRetryTimestamp = 0;
@@ -81,30 +202,62 @@ class LastfmQueue
     {
         std::vector<RetryUpdate> updates;
         bool rateLimited = false;
+        unsigned attempted = 0;
+        unsigned accepted = 0; // attempted minus rate-limited / invalid-session answers
+        unsigned succeeded = 0;
+    };
+
+    // Runtime state of a registered sink.
+    struct SinkSlot
+    {
+        ILastfmScrobbleSink* sink = nullptr;
+        std::time_t rateLimitedUntil = 0;
+        bool rateLimitLogged = false;
+        double acceptRate = 1.0; // EWMA of successes per classified attempt
     };
 
+    static bool makeQueued(const NewScrobble& in, SinkMask sinks, QueuedScrobble& out);
+    bool alreadyScrobbled(const QueuedScrobble& q) const;
+    // Applies the known correction; false when the play is in the history under either spelling.
+    bool admit(QueuedScrobble& q) const;
+    void recordDelivered(const std::vector<QueuedScrobble>& candidates, const std::vector<RetryUpdate>& updates);
+    static bool isDueFor(const QueuedScrobble& q, unsigned slot, std::time_t now);
+    SinkMask readySinks() const;
+    bool canDispatchLocked(unsigned slot, std::time_t now);
     void ensureCacheLoadedLocked() const;
+    std::vector<QueuedScrobble> selectDispatchCandidatesLocked(unsigned slot, std::time_t now,
+                                                               unsigned maxCount) const;
     void saveCacheLocked();
+    void parkUnreachableLocked();
 
-    static std::string escapeField(const std::string& in);
-    static std::string unescapeField(const std::string& in);
-    static std::string serializeScrobble(const QueuedScrobble& q);
+    static void appendEscaped(std::string& out, const std::string& in);
+    static void appendSerialized(std::string& out, const QueuedScrobble& q);
 
-    static DispatchOutcome
-    dispatchAndBuildRetryUpdates(const std::vector<QueuedScrobble>& snapshot, unsigned maxToAttempt,
-                                 const std::function<bool()>& isShuttingDown, LastfmClient& client,
-                                 const std::function<void()>& onInvalidSession, int64_t dailyBudget);
+    // budget is null for sinks the daily limit does not apply to.
+    static DispatchOutcome dispatchAndBuildRetryUpdates(const std::vector<QueuedScrobble>& snapshot, unsigned slot,
+                                                        ILastfmScrobbleSink& sink, unsigned maxToAttempt,
+                                                        const std::function<bool()>& isShuttingDown,
+                                                        LastfmBudget* budget, ILastfmClock& clock);
     static void mergeRetryUpdates(std::vector<QueuedScrobble>& latest, const std::vector<RetryUpdate>& updates);
 
-    void enterRateLimitCooldownLocked(std::time_t now, std::time_t cooldownSeconds);
-    bool isRateLimitedLocked(std::time_t now);
+    void enterRateLimitCooldownLocked(unsigned slot, std::time_t now, std::time_t cooldownSeconds);
+    bool isRateLimitedLocked(unsigned slot, std::time_t now);
     std::atomic<bool>* shuttingDown_ = nullptr;
-    LastfmClient& client;
-    std::function<void()> onInvalidSession;
+    ILastfmScrobbleHistory* history_ = nullptr;
+    ILastfmCorrections* corrections_ = nullptr;
+    std::unique_ptr<LastfmApiSink> lastfmSink_;
+    std::array<SinkSlot, lastfm::sink::MAX_SINKS> sinks_{};
+    SinkMask registeredSinks_ = 0;
+    std::atomic<SinkMask> heldSinks_{0};
+    ILastfmConfigStore& config_;
+    ILastfmClock& clock_;
 
     mutable std::mutex mutex;
     mutable std::vector<QueuedScrobble> cache_;
+    mutable std::vector<QueuedScrobble> parked_; // owed only to sinks not registered this session
+    mutable std::size_t parkedCount_ = 0;        // entries in cache_ or parked_ owed to such a sink
     mutable bool cacheLoaded_ = false;
-    std::time_t rateLimitedUntil_ = 0;
-    bool rateLimitLogged_ = false;
+    mutable std::uint64_t lastOrder_ = 0;
+    std::size_t lastSaveBytes_ = 0;
+    LastfmBudget budget_;
 };
@@ -0,0 +1,175 @@
+//
+//  lastfm_request.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "lastfm_request.h"
+#include "lastfm_util.h"
+#include "debug.h"
+
+namespace lastfm
+{
+namespace request
+{
+std::string signature(const Params& params, const std::string& apiSecret)
+{
+    std::string sigSrc;
+    for (const auto& kv : params)
+    {
+        sigSrc += kv.first;
+        sigSrc += kv.second;
+    }
+    sigSrc += apiSecret;
+
+    return util::md5HexLower(sigSrc);
+}
+
+std::string signedUrl(const std::string& baseUrl, const Params& params, const std::string& apiSecret)
+{
+    std::string url;
+    url.reserve(baseUrl.size() + 256);
+    url += baseUrl;
+    url += '?';
+
+    bool first = true;
+    for (const auto& kv : params)
+    {
+        if (!first)
+            url += '&';
+        first = false;
+
+        url += kv.first;
+        url += '=';
+        url += util::urlEncode(kv.second);
+    }
+
+    url += "&api_sig=";
+    url += signature(params, apiSecret);
+    url += "&format=json";
+    return url;
+}
+
+Params nowPlayingParams(const LastfmTrackInfo& track, const std::string& apiKey, const std::string& sessionKey)
+{
+    Params params = {
+        {"api_key", apiKey},
+        {"artist", track.artist},
+        {"track", track.title},
+        {"method", "track.updateNowPlaying"},
+        {"sk", sessionKey},
+    };
+
+    if (!track.album.empty())
+        params["album"] = track.album;
+    if (!track.albumArtist.empty())
+        params["albumArtist"] = track.albumArtist;
+    if (!track.mbid.empty())
+        params["mbid"] = track.mbid;
+    if (track.durationSeconds > 0.0)
+        params["duration"] = std::to_string(static_cast<int>(track.durationSeconds + 0.5));
+
+    return params;
+}
+
+Params scrobbleParams(const LastfmTrackInfo& track, std::time_t startTimestamp, const std::string& apiKey,
+                      const std::string& sessionKey)
+{
+    Params params = {
+        {"api_key", apiKey},          {"artist", track.artist},
+        {"track", track.title},       {"timestamp", std::to_string(static_cast<long long>(startTimestamp))},
+        {"method", "track.scrobble"}, {"sk", sessionKey},
+    };
+
+    if (!track.album.empty())
+        params["album"] = track.album;
+    if (!track.albumArtist.empty())
+        params["albumArtist"] = track.albumArtist;
+    if (!track.mbid.empty())
+        params["mbid"] = track.mbid;
+    if (track.durationSeconds > 0.0)
+        params["duration"] = std::to_string(static_cast<int>(track.durationSeconds));
+
+    return params;
+}
+
+Params trackInfoParams(const std::string& artist, const std::string& title, const std::string& apiKey,
+                       const std::string& username)
+{
+    return {
+        {"api_key", apiKey},  {"artist", artist},
+        {"autocorrect", "1"}, {"method", "track.getInfo"},
+        {"track", title},     {"username", username},
+    };
+}
+
+Params trackCorrectionParams(const std::string& artist, const std::string& title, const std::string& apiKey)
+{
+    return {
+        {"api_key", apiKey},
+        {"artist", artist},
+        {"method", "track.getCorrection"},
+        {"track", title},
+    };
+}
+
+ApiOutcome classifyResponse(bool httpOk, const std::string& httpError, const std::string& body)
+{
+    ApiOutcome out;
+
+    // Transport failure
+    if (!httpOk)
+    {
+        LFM_INFO("Last.fm HTTP failure: " << (httpError.empty() ? "unknown error" : httpError.c_str()));
+        out.result = LastfmScrobbleResult::TEMPORARY_ERROR;
+        return out;
+    }
+
+    util::LastfmApiErrorInfo apiInfo = util::extractLastfmApiError(body.c_str());
+
+    if (!apiInfo.hasJson)
+    {
+        LFM_INFO("Last.fm response is not valid JSON (size=" << body.size() << ")");
+        out.result = LastfmScrobbleResult::TEMPORARY_ERROR;
+        return out;
+    }
+
+    out.hasJson = true;
+
+    if (apiInfo.hasError)
+    {
+        out.apiError = apiInfo.errorCode;
+        out.apiMessage = apiInfo.message;
+
+        switch (apiInfo.errorCode)
+        {
+        case 9:
+            out.result = LastfmScrobbleResult::INVALID_SESSION;
+            break;
+
+        case 8:
+        case 11:
+        case 16:
+            out.result = LastfmScrobbleResult::TEMPORARY_ERROR;
+            break;
+        case 29:
+            out.result = LastfmScrobbleResult::RATE_LIMITED;
+            break;
+        default:
+            out.result = LastfmScrobbleResult::OTHER_ERROR;
+            break;
+        }
+
+        LFM_INFO("Last.fm API error " << apiInfo.errorCode << (apiInfo.message.empty() ? "" : ": ")
+                                      << apiInfo.message.c_str());
+        return out;
+    }
+
+    // Success
+    out.result = LastfmScrobbleResult::SUCCESS;
+    return out;
+}
+
+} // namespace request
+} // namespace lastfm
@@ -0,0 +1,53 @@
+//
+//  lastfm_request.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <ctime>
+#include <map>
+#include <string>
+
+#include "lastfm_scrobble_result.h"
+#include "lastfm_track_info.h"
+
+namespace lastfm
+{
+namespace request
+{
+inline constexpr const char* DEFAULT_API_BASE_URL = "https://ws.audioscrobbler.com/2.0/";
+
+// Sorted by name, which is the order api_sig is computed in.
+using Params = std::map<std::string, std::string>;
+
+// api_sig: md5 of name/value pairs in name order followed by the shared secret.
+std::string signature(const Params& params, const std::string& apiSecret);
+
+// baseUrl?name=value&...&api_sig=...&format=json
+std::string signedUrl(const std::string& baseUrl, const Params& params, const std::string& apiSecret);
+
+Params nowPlayingParams(const LastfmTrackInfo& track, const std::string& apiKey, const std::string& sessionKey);
+Params scrobbleParams(const LastfmTrackInfo& track, std::time_t startTimestamp, const std::string& apiKey,
+                      const std::string& sessionKey);
+// track.getInfo for `username`; fills userplaycount and userloved. Autocorrected, so the counts are the ones Last.fm
+// files the scrobbles under.
+Params trackInfoParams(const std::string& artist, const std::string& title, const std::string& apiKey,
+                       const std::string& username);
+Params trackCorrectionParams(const std::string& artist, const std::string& title, const std::string& apiKey);
+
+struct ApiOutcome
+{
+    LastfmScrobbleResult result = LastfmScrobbleResult::OTHER_ERROR;
+    int apiError = 0;
+    std::string apiMessage;
+    bool hasJson = false;
+};
+
+// Maps a transport result and response body onto the scrobble result the queue acts on.
+ApiOutcome classifyResponse(bool httpOk, const std::string& httpError, const std::string& body);
+
+} // namespace request
+} // namespace lastfm
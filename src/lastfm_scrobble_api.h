@@ -0,0 +1,38 @@
+//
+//  lastfm_scrobble_api.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <ctime>
+#include <string>
+
+#include "lastfm_corrections.h"
+#include "lastfm_scrobble_result.h"
+#include "lastfm_track_info.h"
+
+// What the worker and queue need from the Web API. LastfmClient in the plugin, a simulated service in
+// tools/drain_sim.
+class ILastfmScrobbleApi
+{
+  public:
+    virtual ~ILastfmScrobbleApi() = default;
+
+    virtual bool isAuthenticated() const = 0;
+    virtual bool isSuspended() const = 0;
+    virtual bool updateNowPlaying(const LastfmTrackInfo& track) = 0;
+    virtual LastfmScrobbleResult scrobble(const LastfmTrackInfo& track, double playbackSeconds,
+                                          std::time_t startTimestamp) = 0;
+
+    // track.getCorrection, for the worker's background lookups. Services without it have nothing to offer.
+    virtual LastfmScrobbleResult trackCorrection(const std::string& artist, const std::string& title,
+                                                 LastfmCorrection& out)
+    {
+        out.artist = artist;
+        out.title = title;
+        return LastfmScrobbleResult::OTHER_ERROR;
+    }
+};
@@ -0,0 +1,42 @@
+//
+//  lastfm_scrobble_sink.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "lastfm_scrobble_sink.h"
+
+#include <utility>
+
+LastfmApiSink::LastfmApiSink(ILastfmScrobbleApi& client, std::function<void()> onInvalidSession, const char* name,
+                             bool usesDailyBudget)
+    : client_(client), onInvalidSession_(std::move(onInvalidSession)), name_(name), usesDailyBudget_(usesDailyBudget)
+{
+}
+
+bool LastfmApiSink::ready() const
+{
+    return client_.isAuthenticated() && !client_.isSuspended();
+}
+
+void LastfmApiSink::submit(const std::vector<LastfmSinkScrobble>& batch, std::vector<LastfmScrobbleResult>& results)
+{
+    results.clear();
+    results.reserve(batch.size());
+
+    for (const auto& s : batch)
+    {
+        const LastfmScrobbleResult r = client_.scrobble(s.track, s.playbackSeconds, s.startTimestamp);
+        results.push_back(r);
+
+        if (r == LastfmScrobbleResult::INVALID_SESSION)
+        {
+            if (onInvalidSession_)
+                onInvalidSession_();
+            return;
+        }
+        if (r == LastfmScrobbleResult::RATE_LIMITED)
+            return;
+    }
+}
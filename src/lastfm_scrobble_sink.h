@@ -0,0 +1,94 @@
+//
+//  lastfm_scrobble_sink.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <cstddef>
+#include <ctime>
+#include <functional>
+#include <vector>
+
+#include "lastfm_scrobble_api.h"
+#include "lastfm_scrobble_result.h"
+#include "lastfm_track_info.h"
+
+namespace lastfm
+{
+namespace sink
+{
+// Slots are persisted as bits of each queue record: never renumber.
+inline constexpr unsigned LASTFM = 0;
+inline constexpr unsigned LISTENBRAINZ = 1;
+inline constexpr unsigned LIBREFM = 2;
+inline constexpr unsigned MAX_SINKS = 4;
+} // namespace sink
+} // namespace lastfm
+
+struct LastfmSinkScrobble
+{
+    LastfmTrackInfo track;
+    double playbackSeconds = 0.0;
+    std::time_t startTimestamp = 0;
+};
+
+// A service LastfmQueue delivers to. Every queued play is one record carrying a pending bit per sink; each sink
+// drains its share independently (own batch size, rate-limit cooldown and retry backoff).
+class ILastfmScrobbleSink
+{
+  public:
+    virtual ~ILastfmScrobbleSink() = default;
+
+    // Short name for logs.
+    virtual const char* name() const = 0;
+
+    // Authenticated and not suspended. New plays are only queued for sinks that are ready at that moment.
+    virtual bool ready() const = 0;
+
+    // Most entries a single submit() takes.
+    virtual std::size_t maxBatch() const
+    {
+        return 1;
+    }
+
+    // LastfmBudget (Last.fm's daily scrobble limit) applies to this sink.
+    virtual bool usesDailyBudget() const
+    {
+        return false;
+    }
+
+    // One result per attempted entry, in order. A sink stops at an answer that concerns the whole service
+    // (RATE_LIMITED, INVALID_SESSION); entries past the end of results were not sent.
+    virtual void submit(const std::vector<LastfmSinkScrobble>& batch, std::vector<LastfmScrobbleResult>& results) = 0;
+};
+
+// Last.fm (or any 2.0-compatible service, e.g. Libre.fm) through ILastfmScrobbleApi, one request per scrobble.
+class LastfmApiSink final : public ILastfmScrobbleSink
+{
+  public:
+    LastfmApiSink(ILastfmScrobbleApi& client, std::function<void()> onInvalidSession, const char* name = "Last.fm",
+                  bool usesDailyBudget = true);
+
+    const char* name() const override
+    {
+        return name_;
+    }
+
+    bool ready() const override;
+
+    bool usesDailyBudget() const override
+    {
+        return usesDailyBudget_;
+    }
+
+    void submit(const std::vector<LastfmSinkScrobble>& batch, std::vector<LastfmScrobbleResult>& results) override;
+
+  private:
+    ILastfmScrobbleApi& client_;
+    std::function<void()> onInvalidSession_;
+    const char* name_;
+    bool usesDailyBudget_;
+};
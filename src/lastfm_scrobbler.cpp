@@ -6,30 +6,153 @@
 //
 
 #include "lastfm_scrobbler.h"
+#include "lastfm_backfill.h"
+#include "lastfm_backfill_library.h"
 #include "lastfm_client.h"
+#include "lastfm_platform_fb2k.h"
+#include "lastfm_scrobbler_log.h"
+#include "lastfm_settings.h"
+#include "lastfm_state.h"
+#include "lastfm_tracker.h"
 #include "lastfm_ui.h"
+#include "lastfm_user_data_fields.h"
 #include "debug.h"
 
 #include <foobar2000/SDK/main_thread_callback.h>
 #include <foobar2000/SDK/popup_message.h>
 
+#include <algorithm>
 #include <ctime>
+#include <memory>
 #include <thread>
 #include <chrono>
 
+namespace
+{
+// Library items per read chunk: the unit of work of one reader thread and of progress updates.
+static constexpr std::size_t K_BACKFILL_READ_CHUNK = 2000;
+static constexpr unsigned K_BACKFILL_MAX_THREADS = 8;
+
+// threaded_process callback running a bulk job (backfill, export) on the dialog's thread. `running` counts the
+// jobs inside run() so shutdown can wait for them; a job reaching run() after shutdown began does nothing.
+class DialogJob : public threaded_process_callback
+{
+  public:
+    using Run = std::function<void(threaded_process_status&, abort_callback&)>;
+
+    DialogJob(std::atomic<int>& running, const std::atomic<bool>& shuttingDown, Run run, std::function<void()> done)
+        : running_(running), shuttingDown_(shuttingDown), run_(std::move(run)), done_(std::move(done))
+    {
+    }
+
+    void run(threaded_process_status& status, abort_callback& abort) override
+    {
+        running_.fetch_add(1);
+        struct Leave
+        {
+            std::atomic<int>& running;
+            ~Leave()
+            {
+                running.fetch_sub(1);
+            }
+        } leave{running_};
+
+        if (!shuttingDown_.load())
+            run_(status, abort);
+    }
+
+    void on_done(ctx_t, bool) override
+    {
+        done_();
+    }
+
+  private:
+    std::atomic<int>& running_;
+    const std::atomic<bool>& shuttingDown_;
+    Run run_;
+    std::function<void()> done_;
+};
+
+static bool startDialogJob(const char* title, service_ptr_t<threaded_process_callback> job)
+{
+    const unsigned flags = threaded_process::flag_show_progress | threaded_process::flag_show_item |
+                           threaded_process::flag_show_abort | threaded_process::flag_show_delayed;
+    return threaded_process::g_run_modeless(job, flags, core_api::get_main_window(), title);
+}
+} // namespace
+
 LastfmScrobbler::LastfmScrobbler(LastfmClient& client)
-    : client(client), queue(client, [this]() { handleInvalidSessionOnce(); }),
+    : client(client), listenBrainz(lastfmFb2kHttpTransport(), [] { return lastfmSettings()->listenBrainzToken; }),
+      queue(client, [this]() { handleInvalidSessionOnce(); }, lastfmFb2kConfigStore()),
+      userDataPrefetcher(
+          userData, [&client](const std::string& artist, const std::string& title, LastfmTrackUserData& out)
+          { return client.trackUserData(artist, title, out); },
+          [this]
+          {
+              // Same Last.fm account as the scrobbles: share their rate-limit cooldown and let them go first.
+              LastfmUserDataPrefetcher::Config c;
+              c.blockedUntil = [this] { return queue.rateLimitedUntil(lastfm::sink::LASTFM); };
+              c.busy = [this] { return queue.hasDueScrobble(std::time(nullptr)); };
+              c.onRateLimited = [this] { queue.noteRateLimited(lastfm::sink::LASTFM); };
+              c.onResolved = [](const std::vector<std::uint64_t>& keys) { lastfmUserDataFieldsResolved(keys); };
+              c.onDropped = [](const std::vector<std::uint64_t>& keys) { lastfmUserDataFieldsDropped(keys); };
+              return c;
+          }()),
       worker(client, queue,
-             []
+             [this]
              {
                  LastfmWorker::Config c;
-                 c.drainEnabled = &LastfmQueue::drainEnabled;
-                 c.drainMinInterval = LastfmQueue::drainCooldown();
+                 c.drainEnabled = [this]() { return queue.drainEnabled(); };
+                 c.drainMinInterval = queue.drainCooldown();
+                 c.corrections = &corrections;
                  return c;
              }())
 {
     queue.setShuttingDownFlag(&shuttingDown);
+
+    history.setRecordListener([this](const LastfmHistoryRecord& play) { stats.add(play); });
+
+    std::string historyPath;
+    std::string historyError;
+    if (!lastfmFb2kProfilePath("foo_scrobbler_mac.history", historyPath))
+        LFM_INFO("History: profile folder is not a local path, duplicate check limited to the queue.");
+    else if (!history.open(historyPath, historyError))
+        LFM_INFO("History: " << historyError.c_str() << ", duplicate check limited to the queue.");
+    else
+        queue.setHistory(&history);
+
+    std::string correctionsError;
+    if (lastfmFb2kProfilePath("foo_scrobbler_mac.corrections", correctionsPath) &&
+        !corrections.load(correctionsPath, correctionsError))
+        LFM_INFO("Corrections: " << correctionsError.c_str() << ", starting with an empty map.");
+    queue.setCorrections(&corrections);
+    client.setCorrections(&corrections);
+
+    const LastfmAuthState auth = lastfmGetAuthState();
+    userDataOwner = auth.isAuthenticated ? auth.username : std::string();
+    std::string userDataError;
+    if (lastfmFb2kProfilePath("foo_scrobbler_mac.userdata", userDataPath) && !userDataOwner.empty() &&
+        !userData.load(userDataPath, userDataOwner, userDataError))
+        LFM_INFO("User data: " << userDataError.c_str() << ", starting with an empty cache.");
+
+    if (!lastfmSettings()->listenBrainzToken.empty())
+    {
+        queue.addSink(lastfm::sink::LISTENBRAINZ, listenBrainz);
+        listenBrainzRegistered = true;
+        LFM_INFO("ListenBrainz submissions enabled.");
+    }
+
+    const std::size_t parked = queue.getParkedScrobbleCount();
+    if (parked > 0)
+    {
+        const std::string text = std::to_string(parked) +
+                                 " scrobble(s) are still owed to ListenBrainz, but no ListenBrainz user token is set.\n"
+                                 "They are kept until the token is set again, or until you discard them with\n"
+                                 "Playback > Last.fm > Discard ListenBrainz deliveries.";
+        fb2k::inMainThread([text] { popup_message::g_show(text.c_str(), "Foo Scrobbler"); });
+    }
     worker.start();
+    userDataPrefetcher.start();
     LFM_DEBUG("Startup: authenticated=" << (client.isAuthenticated() ? "yes" : "no")
                                         << " suspended=" << (client.isSuspended() ? "yes" : "no")
                                         << " pending=" << (unsigned)queue.getPendingScrobbleCount());
@@ -51,7 +174,8 @@ void LastfmScrobbler::sendNowPlayingOnly(const LastfmTrackInfo& track)
     if (lastfmDisableNowplaying())
         return;
 
-    worker.postNowPlaying(track);
+    worker.postNowPlaying(corrected(track));
+    worker.postCorrectionLookup();
 }
 
 void LastfmScrobbler::dispatchRetryIfDue(const char* reasonTag)
@@ -59,9 +183,6 @@ void LastfmScrobbler::dispatchRetryIfDue(const char* reasonTag)
     if (core_api::is_shutting_down() || shuttingDown.load(std::memory_order_acquire))
         return;
 
-    if (!client.isAuthenticated() || client.isSuspended())
-        return;
-
     const std::time_t now = std::time(nullptr);
     const std::size_t pending = queue.getPendingScrobbleCount();
     const bool due = pending > 0 ? queue.hasDueScrobble(now) : false;
@@ -73,6 +194,13 @@ void LastfmScrobbler::dispatchRetryIfDue(const char* reasonTag)
         worker.postDrain();
 }
 
+LastfmTrackInfo LastfmScrobbler::corrected(const LastfmTrackInfo& track)
+{
+    LastfmTrackInfo out = track;
+    corrections.apply(out.artist, out.title);
+    return out;
+}
+
 void LastfmScrobbler::onNowPlaying(const LastfmTrackInfo& track)
 {
     if (core_api::is_shutting_down() || shuttingDown.load(std::memory_order_acquire))
@@ -91,7 +219,8 @@ void LastfmScrobbler::onNowPlaying(const LastfmTrackInfo& track)
     if (!client.isAuthenticated() || client.isSuspended())
         return;
 
-    worker.postNowPlaying(track);
+    worker.postNowPlaying(corrected(track));
+    worker.postCorrectionLookup();
 }
 
 void LastfmScrobbler::refreshPendingMetadata(const LastfmTrackInfo& track)
@@ -105,10 +234,9 @@ void LastfmScrobbler::queueScrobble(const LastfmTrackInfo& track, double playbac
     if (core_api::is_shutting_down() || shuttingDown.load(std::memory_order_acquire))
         return;
 
-    if (!client.isAuthenticated() || client.isSuspended())
-        return;
-
+    // Queued once for every sink that is ready (authenticated, not suspended); dropped if none is.
     queue.queueScrobbleForRetry(track, playbackSeconds, refreshOnSubmit, startWallclock);
+    worker.postCorrectionLookup();
 }
 
 void LastfmScrobbler::retryAsync()
@@ -119,6 +247,11 @@ void LastfmScrobbler::retryAsync()
     worker.postDrain();
 }
 
+LastfmDrainPlan LastfmScrobbler::drainPlan() const
+{
+    return worker.drainPlan();
+}
+
 void LastfmScrobbler::handleInvalidSessionOnce()
 {
     if (core_api::is_shutting_down() || shuttingDown.load())
@@ -148,6 +281,16 @@ void LastfmScrobbler::clearQueue()
     queue.clearAll();
 }
 
+std::size_t LastfmScrobbler::parkedDeliveries() const
+{
+    return queue.getParkedScrobbleCount();
+}
+
+std::size_t LastfmScrobbler::discardParkedDeliveries()
+{
+    return queue.discardParkedDeliveries();
+}
+
 void LastfmScrobbler::resetInvalidSessionHandling()
 {
     invalidSessionHandled.store(false);
@@ -160,11 +303,249 @@ void LastfmScrobbler::onAuthenticationRecovered()
     worker.postAuthRecovered();
 }
 
+LastfmUserDataCache::Lookup LastfmScrobbler::trackUserData(const std::string& artist, const std::string& title,
+                                                          LastfmTrackUserData& out, bool& fetching)
+{
+    fetching = false;
+    {
+        // Another account's counts are not this one's.
+        std::lock_guard<std::mutex> lock(userDataMutex);
+        const std::string username = lastfmSettings()->username;
+        if (username != userDataOwner)
+        {
+            userDataPrefetcher.clearPending();
+            userData.clear();
+            userDataOwner = username;
+        }
+        if (userDataOwner.empty())
+            return LastfmUserDataCache::Lookup::MISS;
+    }
+
+    const std::uint64_t key = LastfmUserDataCache::key(artist, title);
+    const auto found = userData.lookup(key, std::time(nullptr), out);
+    if (found != LastfmUserDataCache::Lookup::FRESH && !shuttingDown.load(std::memory_order_acquire))
+        fetching = userDataPrefetcher.request(key, artist, title);
+    return found;
+}
+
+bool LastfmScrobbler::importScrobblerLog(const std::string& path)
+{
+    if (core_api::is_shutting_down() || shuttingDown.load(std::memory_order_acquire))
+        return false;
+
+    if (importRunning.exchange(true))
+        return false;
+
+    if (importThread.joinable())
+        importThread.join(); // previous import, already finished
+
+    importThread = std::thread(
+        [this, path]
+        {
+            // One snapshot for the whole import, held until it returns.
+            const std::shared_ptr<const LastfmSettings> snapshot = lastfmSettings();
+            const LastfmSettings& settings = *snapshot;
+
+            LastfmScrobblerLogImportOptions options;
+            options.accept = [&settings](const LastfmTrackInfo& t)
+            { return !lastfmIsExcludedByFilters(settings, t.artist, t.title); };
+            options.cancelled = [this] { return shuttingDown.load(std::memory_order_acquire); };
+            if (history.isOpen())
+                options.history = &history;
+            // As for the backfill: Last.fm ignores plays older than two weeks, ListenBrainz takes them.
+            options.lastfmNotBefore = std::time(nullptr) - LastfmDrainPlanner::ACCEPTANCE_WINDOW_SECONDS;
+            if (!listenBrainzRegistered)
+                options.notBefore = options.lastfmNotBefore;
+
+            LFM_INFO("Import: reading " << path.c_str());
+            const LastfmScrobblerLogImportResult r = lastfmImportScrobblerLog(path, queue, options);
+            importRunning.store(false);
+
+            if (r.cancelled)
+                return;
+
+            // Imported plays go out through the usual batched drain.
+            if (r.queued > 0)
+            {
+                worker.postDrain();
+                worker.postCorrectionLookup();
+            }
+
+            const std::string text = lastfmDescribeScrobblerLogImport(r);
+            fb2k::inMainThread([text] { popup_message::g_show(text.c_str(), "Foo Scrobbler"); });
+        });
+    return true;
+}
+
+bool LastfmScrobbler::backfillFromPlayStats()
+{
+    if (core_api::is_shutting_down() || shuttingDown.load(std::memory_order_acquire))
+        return false;
+
+    if (importRunning.exchange(true))
+        return false;
+
+    // library_manager is main thread only; the handles are read on the reader threads.
+    auto items = std::make_shared<metadb_handle_list>();
+    library_manager::get()->get_all_items(*items);
+    auto result = std::make_shared<LastfmBackfillResult>();
+
+    auto run = [this, items, result](threaded_process_status& status, abort_callback& abort)
+    {
+        const std::shared_ptr<const LastfmSettings> snapshot = lastfmSettings(); // as for the import
+        const LastfmSettings& settings = *snapshot;
+
+        LastfmBackfillOptions options;
+        options.accept = [&settings](const LastfmTrackInfo& t)
+        { return !lastfmIsExcludedByFilters(settings, t.artist, t.title); };
+        options.corrections = &corrections;
+        options.cancelled = [this, &abort]
+        { return abort.is_aborting() || shuttingDown.load(std::memory_order_acquire); };
+
+        // Last.fm ignores plays older than two weeks, so they are owed to ListenBrainz only, and not read at all
+        // without it.
+        options.lastfmNotBefore = std::time(nullptr) - LastfmDrainPlanner::ACCEPTANCE_WINDOW_SECONDS;
+        if (!listenBrainzRegistered)
+            options.notBefore = options.lastfmNotBefore;
+
+        status.set_item("Reading the scrobble history...");
+        LastfmBackfill backfill(queue, options);
+        std::string error;
+        if (history.isOpen() &&
+            !history.forEach(
+                [&](const LastfmHistoryRecord& r)
+                {
+                    backfill.addScrobbled(r.artist, r.title, r.timestamp);
+                    return !options.cancelled();
+                },
+                error))
+            LFM_INFO("Backfill: " << error.c_str());
+
+        const std::size_t total = items->get_count();
+        const unsigned threads = std::min(std::max(std::thread::hardware_concurrency(), 1u), K_BACKFILL_MAX_THREADS);
+        LFM_INFO("Backfill: reading " << (unsigned)total << " library item(s)");
+        status.set_item("Reading playback statistics...");
+
+        lastfmReadPlayStats(
+            *items, threads, K_BACKFILL_READ_CHUNK,
+            [&](const std::vector<LastfmBackfillItem>& chunk, std::size_t read)
+            {
+                backfill.add(chunk);
+                status.set_progress(read, total);
+            },
+            options.cancelled);
+
+        *result = backfill.finish();
+    };
+
+    auto done = [this, result]
+    {
+        importRunning.store(false);
+        if (shuttingDown.load(std::memory_order_acquire))
+            return;
+
+        // Backfilled plays go out through the usual batched drain.
+        if (result->queued > 0)
+        {
+            worker.postDrain();
+            worker.postCorrectionLookup();
+        }
+        popup_message::g_show(lastfmDescribeBackfill(*result).c_str(), "Foo Scrobbler");
+    };
+
+    if (!startDialogJob("Backfilling scrobbles",
+                        fb2k::service_new<DialogJob>(dialogJobs, shuttingDown, std::move(run), std::move(done))))
+    {
+        importRunning.store(false);
+        return false;
+    }
+    return true;
+}
+
+bool LastfmScrobbler::exportScrobbles(LastfmExportFormat format)
+{
+    if (core_api::is_shutting_down() || shuttingDown.load(std::memory_order_acquire))
+        return false;
+
+    if (exportRunning.exchange(true))
+        return false;
+
+    const std::time_t now = std::time(nullptr);
+    std::tm tm{};
+    localtime_r(&now, &tm);
+    char name[64];
+    std::strftime(name, sizeof(name),
+                  format == LastfmExportFormat::CSV ? "foo_scrobbler_mac-export-%Y%m%d-%H%M%S.csv"
+                                                    : "foo_scrobbler_mac-export-%Y%m%d-%H%M%S.jsonl",
+                  &tm);
+
+    std::string path;
+    if (!lastfmFb2kProfilePath(name, path))
+    {
+        exportRunning.store(false);
+        popup_message::g_show("Export failed: profile folder is not a local path.", "Foo Scrobbler");
+        return true;
+    }
+
+    auto result = std::make_shared<LastfmExportResult>();
+
+    auto run = [this, format, path, result](threaded_process_status& status, abort_callback& abort)
+    {
+        LastfmExportOptions options;
+        options.format = format;
+        options.cancelled = [this, &abort]
+        { return abort.is_aborting() || shuttingDown.load(std::memory_order_acquire); };
+        options.progress = [&status](std::uint64_t rows, std::uint64_t total)
+        {
+            status.set_progress(static_cast<t_size>(std::min(rows, total)), static_cast<t_size>(total));
+            status.set_item((std::to_string(rows) + " play(s) written").c_str());
+        };
+
+        *result = lastfmExportScrobbles(path, &queue, history.isOpen() ? &history : nullptr, options);
+    };
+
+    auto done = [this, path, result]
+    {
+        exportRunning.store(false);
+        if (!shuttingDown.load(std::memory_order_acquire))
+            popup_message::g_show(lastfmDescribeExport(path, *result).c_str(), "Foo Scrobbler");
+    };
+
+    if (!startDialogJob("Exporting scrobbles",
+                        fb2k::service_new<DialogJob>(dialogJobs, shuttingDown, std::move(run), std::move(done))))
+    {
+        exportRunning.store(false);
+        return false;
+    }
+    return true;
+}
+
 void LastfmScrobbler::shutdown()
 {
     // idempotent
     if (shuttingDown.exchange(true))
         return;
 
+    // An import stops at its next line; its last chunk is not queued.
+    if (importThread.joinable())
+        importThread.join();
+
+    // A backfill stops at its next library item (its last chunk is not queued), an export at its next row.
+    while (dialogJobs.load() > 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    userDataPrefetcher.stop();
+    {
+        std::lock_guard<std::mutex> lock(userDataMutex);
+        std::string error;
+        if (!userDataPath.empty() && !userDataOwner.empty() && !userData.save(userDataPath, userDataOwner, error))
+            LFM_INFO("User data: " << error.c_str());
+    }
+
     worker.stop();
+
+    client.setCorrections(nullptr);
+    std::string error;
+    if (!correctionsPath.empty() && !corrections.save(correctionsPath, error))
+        LFM_INFO("Corrections: " << error.c_str());
 }
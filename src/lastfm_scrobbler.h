@@ -10,41 +10,98 @@
 #include <ctime>
 #include <atomic>
 #include <mutex>
+#include <string>
+#include <thread>
 
+#include "lastfm_corrections.h"
+#include "lastfm_export.h"
+#include "lastfm_history.h"
+#include "lastfm_listenbrainz.h"
 #include "lastfm_queue.h"
+#include "lastfm_stats.h"
 #include "lastfm_track_info.h"
+#include "lastfm_tracker_output.h"
+#include "lastfm_user_data.h"
 #include "lastfm_worker.h"
 
 class LastfmClient;
 class LastfmWorker;
 
-class LastfmScrobbler
+class LastfmScrobbler : public ILastfmTrackerOutput
 {
   public:
     explicit LastfmScrobbler(LastfmClient& client);
     ~LastfmScrobbler();
 
     void shutdown();
-    void onNowPlaying(const LastfmTrackInfo& track);
-    void sendNowPlayingOnly(const LastfmTrackInfo& track);
-    void refreshPendingMetadata(const LastfmTrackInfo& track);
+    void onNowPlaying(const LastfmTrackInfo& track) override;
+    void sendNowPlayingOnly(const LastfmTrackInfo& track) override;
+    void refreshPendingMetadata(const LastfmTrackInfo& track) override;
 
     void queueScrobble(const LastfmTrackInfo& track, double playbackSeconds, std::time_t startWallclock,
-                       bool refreshOnSubmit);
+                       bool refreshOnSubmit) override;
 
-    void retryAsync();
+    void retryAsync() override;
+
+    // Status: pending backlog and its drain schedule.
+    LastfmDrainPlan drainPlan() const;
     void clearQueue();
+
+    // Scrobbles still owed to ListenBrainz while it is not configured; kept until discarded here.
+    std::size_t parkedDeliveries() const;
+    std::size_t discardParkedDeliveries();
+
     void resetInvalidSessionHandling();
     void onAuthenticationRecovered();
 
+    // Queues a portable player's .scrobbler.log on a background thread and reports the result in a popup.
+    // False if an import is already running.
+    bool importScrobblerLog(const std::string& path);
+
+    // Queues the plays recorded by foobar2000's playback statistics for the whole Media Library, read in parallel
+    // behind a progress dialog that can cancel. Main thread. False if an import or backfill is already running.
+    bool backfillFromPlayStats();
+
+    // Writes the pending queue and the scrobble history to a new file in the profile folder, behind a progress
+    // dialog that can cancel. Main thread. False if an export is already running.
+    bool exportScrobbles(LastfmExportFormat format);
+
+    // Local statistics over the scrobble history.
+    const LastfmListeningStats& listeningStats() const
+    {
+        return stats;
+    }
+
+    // Last.fm playcount and loved flag of the current user, for the titleformat fields. An entry missing or past
+    // its time to live is fetched in the background; MISS means there is nothing to show yet. fetching is set
+    // when such a fetch is queued or under way, and its key is then reported back resolved or dropped.
+    LastfmUserDataCache::Lookup trackUserData(const std::string& artist, const std::string& title,
+                                              LastfmTrackUserData& out, bool& fetching);
+
   private:
     void handleInvalidSessionOnce();
     void dispatchRetryIfDue(const char* reasonTag);
+    LastfmTrackInfo corrected(const LastfmTrackInfo& track);
 
   private:
     LastfmClient& client;
+    LastfmListenBrainzSink listenBrainz; // registered with the queue when a token is set
+    LastfmListeningStats stats;          // fed by the history
+    LastfmScrobbleHistory history;       // outlives the queue that records into it
+    LastfmCorrections corrections;       // likewise for the queue, worker and client that use it
+    std::string correctionsPath;         // empty when the profile folder is not a local path
     LastfmQueue queue;
+    LastfmUserDataCache userData;
+    LastfmUserDataPrefetcher userDataPrefetcher; // stopped before the cache and the queue it reads go away
     LastfmWorker worker; //  Kepp the order for proper destruction later.
+    std::mutex userDataMutex;
+    std::string userDataOwner; // Last.fm user the cached entries belong to
+    std::string userDataPath;  // empty when the profile folder is not a local path
     std::atomic<bool> invalidSessionHandled{false};
     std::atomic<bool> shuttingDown{false};
+    std::thread importThread;
+    std::atomic<bool> importRunning{false}; // also held by a backfill: one bulk job at a time
+    std::atomic<bool> exportRunning{false};
+    std::atomic<int> dialogJobs{0}; // backfill / export runs on their dialogs' threads; shutdown waits for them
+    bool listenBrainzRegistered = false;
 };
@@ -0,0 +1,303 @@
+//
+//  lastfm_scrobbler_log.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "lastfm_scrobbler_log.h"
+#include "lastfm_history.h"
+#include "lastfm_key_set.h"
+#include "lastfm_queue.h"
+#include "lastfm_rules.h"
+#include "lastfm_util.h"
+#include "debug.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+namespace
+{
+static constexpr std::size_t K_READ_BUFFER_BYTES = 64 * 1024;
+
+// Longer lines are not scrobbler.log lines; they are read past and counted as malformed.
+static constexpr std::size_t K_MAX_LINE_BYTES = 16 * 1024;
+
+static constexpr std::size_t K_MIN_FIELDS = 7;
+
+// Device wall-clock seconds (written as if they were UTC) to real UTC, using the host time zone.
+static std::time_t localWallClockToUtc(std::time_t t)
+{
+    std::tm tm{};
+#if defined(_WIN32)
+    gmtime_s(&tm, &t);
+#else
+    gmtime_r(&t, &tm);
+#endif
+    tm.tm_isdst = -1;
+    const std::time_t utc = std::mktime(&tm);
+    return utc == static_cast<std::time_t>(-1) ? t : utc;
+}
+
+static void splitTabs(const std::string& line, std::vector<std::string>& fields)
+{
+    std::size_t n = 0;
+    std::size_t start = 0;
+    for (;;)
+    {
+        const std::size_t tab = line.find('\t', start);
+        const std::size_t end = tab == std::string::npos ? line.size() : tab;
+        if (n == fields.size())
+            fields.emplace_back();
+        fields[n++].assign(line, start, end - start);
+        if (tab == std::string::npos)
+            break;
+        start = tab + 1;
+    }
+    fields.resize(n);
+}
+} // namespace
+
+LastfmScrobblerLogReader::~LastfmScrobblerLogReader()
+{
+    if (file_)
+        std::fclose(file_);
+}
+
+bool LastfmScrobblerLogReader::open(const std::string& path, std::string& error)
+{
+    file_ = std::fopen(path.c_str(), "rb");
+    if (!file_)
+    {
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    buffer_.resize(K_READ_BUFFER_BYTES);
+    line_.reserve(256);
+    return true;
+}
+
+bool LastfmScrobblerLogReader::readLine()
+{
+    line_.clear();
+    lineTooLong_ = false;
+
+    for (;;)
+    {
+        if (pos_ == end_)
+        {
+            if (eof_ || !file_)
+                return !line_.empty() || lineTooLong_;
+
+            end_ = std::fread(buffer_.data(), 1, buffer_.size(), file_);
+            pos_ = 0;
+            if (end_ == 0)
+            {
+                eof_ = true;
+                continue;
+            }
+        }
+
+        const char* start = buffer_.data() + pos_;
+        const std::size_t avail = end_ - pos_;
+        const char* nl = static_cast<const char*>(std::memchr(start, '\n', avail));
+        const std::size_t take = nl ? static_cast<std::size_t>(nl - start) : avail;
+
+        if (!lineTooLong_ && line_.size() + take <= K_MAX_LINE_BYTES)
+            line_.append(start, take);
+        else
+            lineTooLong_ = true;
+
+        pos_ += nl ? take + 1 : take;
+        if (!nl)
+            continue;
+
+        if (!line_.empty() && line_.back() == '\r')
+            line_.pop_back();
+        return true;
+    }
+}
+
+bool LastfmScrobblerLogReader::next(LastfmScrobblerLogEntry& out)
+{
+    while (readLine())
+    {
+        ++lines_;
+
+        if (lineTooLong_)
+        {
+            ++malformed_;
+            continue;
+        }
+
+        if (lines_ == 1 && line_.compare(0, 3, "\xEF\xBB\xBF") == 0)
+            line_.erase(0, 3);
+
+        if (line_.empty())
+            continue;
+
+        if (line_[0] == '#')
+        {
+            if (line_.compare(0, 4, "#TZ/") == 0)
+                localTimes_ = line_.compare(4, std::string::npos, "UNKNOWN") == 0;
+            continue;
+        }
+
+        if (parseLine(out))
+            return true;
+        ++malformed_;
+    }
+    return false;
+}
+
+bool LastfmScrobblerLogReader::parseLine(LastfmScrobblerLogEntry& out)
+{
+    splitTabs(line_, fields_);
+    if (fields_.size() < K_MIN_FIELDS)
+        return false;
+
+    char* endp = nullptr;
+    const long long ts = std::strtoll(fields_[6].c_str(), &endp, 10);
+    if (endp == fields_[6].c_str() || ts <= 0)
+        return false;
+
+    out = LastfmScrobblerLogEntry{};
+    out.track.artist = lastfm::util::cleanTagValue(fields_[0].c_str());
+    out.track.album = lastfm::util::cleanTagValue(fields_[1].c_str());
+    out.track.title = lastfm::util::cleanTagValue(fields_[2].c_str());
+    if (out.track.artist.empty() || out.track.title.empty())
+        return false;
+
+    out.track.durationSeconds = static_cast<double>(std::atoi(fields_[4].c_str()));
+    out.skipped = fields_[5] == "S";
+    out.timestamp = localTimes_ ? localWallClockToUtc(static_cast<std::time_t>(ts)) : static_cast<std::time_t>(ts);
+    if (fields_.size() > 7)
+        out.track.mbid = lastfm::util::cleanTagValue(fields_[7].c_str());
+    return true;
+}
+
+LastfmScrobblerLogImportResult lastfmImportScrobblerLog(const std::string& path, LastfmQueue& queue,
+                                                        const LastfmScrobblerLogImportOptions& options)
+{
+    LastfmScrobblerLogImportResult r;
+
+    LastfmScrobblerLogReader reader;
+    if (!reader.open(path, r.error))
+    {
+        LFM_INFO("Import: " << r.error.c_str());
+        return r;
+    }
+
+    // Keys of everything pending plus everything taken from the file so far, in a flat table (12 to 23 bytes per
+    // play); it still grows with the file.
+    LastfmPlayKeySet seen;
+    queue.collectPlayKeys(seen);
+
+    const std::size_t chunkSize = options.chunkSize > 0 ? options.chunkSize : 1;
+    std::vector<LastfmQueue::NewScrobble> chunk;
+    chunk.reserve(chunkSize);
+
+    const auto flush = [&]
+    {
+        if (chunk.empty())
+            return;
+        LastfmQueue::Refusals refused;
+        r.queued += queue.queueScrobblesForRetry(chunk, &refused, options.lastfmNotBefore);
+        r.duplicates += refused.alreadyScrobbled;
+        r.tooOld += refused.tooOld;
+        r.notQueued += refused.noSink;
+        r.malformed += refused.invalid;
+        chunk.clear();
+        if (options.progress)
+            options.progress(reader.lines());
+    };
+
+    LastfmScrobblerLogEntry e;
+    while (reader.next(e))
+    {
+        if (options.cancelled && options.cancelled())
+        {
+            r.cancelled = true;
+            break;
+        }
+
+        if (e.skipped)
+        {
+            ++r.skipped;
+            continue;
+        }
+        if (options.notBefore > 0 && e.timestamp < options.notBefore)
+        {
+            ++r.tooOld;
+            continue;
+        }
+        if (e.track.durationSeconds > 0.0 &&
+            e.track.durationSeconds < LastfmScrobbleConfig::MIN_TRACK_DURATION_SECONDS)
+        {
+            ++r.tooShort;
+            continue;
+        }
+        if (options.accept && !options.accept(e.track))
+        {
+            ++r.excluded;
+            continue;
+        }
+        const std::uint64_t key = lastfm::util::playKey(e.timestamp, e.track.artist, e.track.title);
+        if ((options.history && options.history->containsKey(key)) || !seen.insert(key))
+        {
+            ++r.duplicates;
+            continue;
+        }
+
+        LastfmQueue::NewScrobble s;
+        s.playbackSeconds = e.track.durationSeconds;
+        s.startTimestamp = e.timestamp;
+        s.track = std::move(e.track);
+        chunk.push_back(std::move(s));
+
+        if (chunk.size() >= chunkSize)
+            flush();
+    }
+
+    if (!r.cancelled)
+        flush();
+
+    r.lines = reader.lines();
+    r.malformed = reader.malformedLines();
+    r.ok = !r.cancelled;
+
+    LFM_INFO("Import: " << lastfmDescribeScrobblerLogImport(r).c_str());
+    return r;
+}
+
+std::string lastfmDescribeScrobblerLogImport(const LastfmScrobblerLogImportResult& r)
+{
+    if (!r.error.empty())
+        return "Import failed: " + r.error;
+
+    std::string s = r.cancelled ? "Import cancelled: " : "Imported ";
+    s += std::to_string(r.queued) + " play(s) from " + std::to_string(r.lines) + " line(s)";
+
+    const std::pair<std::uint64_t, const char*> parts[] = {{r.duplicates, "duplicate"},
+                                                           {r.skipped, "skipped on the device"},
+                                                           {r.tooOld, "too old to scrobble"},
+                                                           {r.tooShort, "too short"},
+                                                           {r.excluded, "excluded"},
+                                                           {r.malformed, "malformed"},
+                                                           {r.notQueued, "not queued (not logged in)"}};
+
+    std::string details;
+    for (const auto& p : parts)
+    {
+        if (p.first == 0)
+            continue;
+        details += details.empty() ? "" : ", ";
+        details += std::to_string(p.first) + " " + p.second;
+    }
+    if (!details.empty())
+        s += " (" + details + ")";
+    return s + ".";
+}
@@ -0,0 +1,129 @@
+//
+//  lastfm_scrobbler_log.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "lastfm_track_info.h"
+
+class ILastfmScrobbleHistory;
+class LastfmQueue;
+
+// One play line of a portable player's .scrobbler.log (AUDIOSCROBBLER/1.0 and 1.1, as written by Rockbox):
+// artist, album, title, track number, length, rating (L = listened, S = skipped), timestamp[, MusicBrainz id],
+// tab separated.
+struct LastfmScrobblerLogEntry
+{
+    LastfmTrackInfo track;
+    std::time_t timestamp = 0; // UTC, also for #TZ/UNKNOWN logs
+    bool skipped = false;
+};
+
+// Streaming reader: fixed read buffer plus one reused line, so memory does not grow with the file.
+class LastfmScrobblerLogReader
+{
+  public:
+    LastfmScrobblerLogReader() = default;
+    ~LastfmScrobblerLogReader();
+
+    LastfmScrobblerLogReader(const LastfmScrobblerLogReader&) = delete;
+    LastfmScrobblerLogReader& operator=(const LastfmScrobblerLogReader&) = delete;
+
+    bool open(const std::string& path, std::string& error);
+
+    // Next play line; header lines (#AUDIOSCROBBLER, #TZ, #CLIENT) are consumed on the way. False at end of file.
+    bool next(LastfmScrobblerLogEntry& out);
+
+    std::uint64_t lines() const
+    {
+        return lines_;
+    }
+
+    // Lines with too few fields or no usable timestamp.
+    std::uint64_t malformedLines() const
+    {
+        return malformed_;
+    }
+
+    // #TZ/UNKNOWN: the device wrote local wall-clock times; next() converts them with the host time zone.
+    bool localTimestamps() const
+    {
+        return localTimes_;
+    }
+
+  private:
+    bool readLine();
+    bool parseLine(LastfmScrobblerLogEntry& out);
+
+    std::FILE* file_ = nullptr;
+    std::vector<char> buffer_;
+    std::size_t pos_ = 0;
+    std::size_t end_ = 0;
+    bool eof_ = false;
+
+    std::string line_;
+    bool lineTooLong_ = false;
+    std::vector<std::string> fields_;
+    std::uint64_t lines_ = 0;
+    std::uint64_t malformed_ = 0;
+    bool localTimes_ = false;
+};
+
+struct LastfmScrobblerLogImportOptions
+{
+    // Plays kept in memory before they are handed to the queue; each chunk is one queue save.
+    std::size_t chunkSize = 5000;
+
+    // Optional: false drops the play (exclusion rules).
+    std::function<bool(const LastfmTrackInfo&)> accept;
+
+    // Optional: plays it already holds count as duplicates.
+    const ILastfmScrobbleHistory* history = nullptr;
+
+    // Plays before this are counted as too old and not queued (0 = no limit).
+    std::time_t notBefore = 0;
+
+    // Plays before this are queued for the other sinks only (see LastfmQueue::queueScrobblesForRetry).
+    std::time_t lastfmNotBefore = 0;
+
+    // Optional: polled once per line; true stops the import after the chunks already queued.
+    std::function<bool()> cancelled;
+
+    // Optional: called after each chunk with the number of lines read so far.
+    std::function<void(std::uint64_t lines)> progress;
+};
+
+struct LastfmScrobblerLogImportResult
+{
+    bool ok = false;
+    bool cancelled = false;
+    std::string error;
+
+    std::uint64_t lines = 0;
+    std::uint64_t queued = 0;
+    std::uint64_t duplicates = 0; // already scrobbled, already pending, or repeated in the file
+    std::uint64_t skipped = 0;    // rating S
+    std::uint64_t tooOld = 0;     // before notBefore, or before lastfmNotBefore with no other sink ready
+    std::uint64_t tooShort = 0;   // under the minimum track length
+    std::uint64_t excluded = 0;
+    std::uint64_t malformed = 0;
+    std::uint64_t notQueued = 0;  // no sink was ready when the chunk was handed over
+};
+
+// Reads a .scrobbler.log and queues its plays for every ready sink, in chunks. Runs on the caller's thread.
+LastfmScrobblerLogImportResult lastfmImportScrobblerLog(const std::string& path, LastfmQueue& queue,
+                                                        const LastfmScrobblerLogImportOptions& options = {});
+
+// One-line summary for the console or a popup.
+std::string lastfmDescribeScrobblerLogImport(const LastfmScrobblerLogImportResult& r);
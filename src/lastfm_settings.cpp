@@ -0,0 +1,115 @@
+//
+//  lastfm_settings.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "lastfm_settings.h"
+#include "lastfm_prefs_pane.h"
+#include "lastfm_state.h"
+#include "debug.h"
+
+#include <memory>
+#include <mutex>
+
+namespace
+{
+// Readers share ownership of the snapshot they loaded, so a retired one lives until its last reader lets go.
+// currentMutex only guards the pointer copy; building a snapshot happens under publishMutex.
+static std::shared_ptr<const LastfmSettings> g_current;
+static std::mutex currentMutex;
+
+static std::mutex publishMutex;
+static std::uint64_t g_version = 0;
+
+// Building a snapshot can normalize radio groups, which calls back into set_state().
+static thread_local bool t_publishing = false;
+
+static std::shared_ptr<const LastfmExclusionFilter> compileFilter(
+    const std::string& rules, const std::shared_ptr<const LastfmExclusionFilter>& previous, const char* what)
+{
+    if (previous && previous->rules() == rules)
+        return previous;
+
+    return LastfmExclusionFilter::compile(rules, what);
+}
+
+static std::shared_ptr<const LastfmSettings> loadCurrent()
+{
+    std::lock_guard<std::mutex> lock(currentMutex);
+    return g_current;
+}
+
+static std::shared_ptr<LastfmSettings> buildSnapshot(std::uint64_t version, const LastfmSettings* previous)
+{
+    auto s = std::make_shared<LastfmSettings>();
+    s->version = version;
+
+    const LastfmAuthState auth = lastfmGetAuthState();
+    s->authenticated = auth.isAuthenticated;
+    s->suspended = auth.isSuspended;
+    if (auth.isAuthenticated)
+        s->username = auth.username;
+
+    s->logLevel = lastfmConsoleLogLevel();
+    s->disableNowPlaying = lastfmDisableNowPlaying();
+    s->onlyFromMediaLibrary = lastfmOnlyScrobbleFromMediaLibrary();
+    s->dynamicSourcesMode = lastfmDynamicSourcesMode();
+    s->treatVariousArtistsAsEmpty = lastfmTagTreatVariousArtistsAsEmpty();
+
+    s->artistTf = lastfmArtistTf();
+    s->albumArtistTf = lastfmAlbumArtistTf();
+    s->titleTf = lastfmTitleTf();
+    s->albumTf = lastfmAlbumTf();
+
+    s->excludedArtists = lastfmExcludedArtistsPatternList();
+    s->excludedTitles = lastfmExcludedTitlesPatternList();
+
+    s->listenBrainzToken = lastfmListenBrainzToken();
+
+    s->artistFilter = compileFilter(s->excludedArtists, previous ? previous->artistFilter : nullptr, "artist");
+    s->titleFilter = compileFilter(s->excludedTitles, previous ? previous->titleFilter : nullptr, "title");
+
+    const bool filtersUnchanged =
+        previous && s->artistFilter == previous->artistFilter && s->titleFilter == previous->titleFilter;
+    s->filterVersion = filtersUnchanged ? previous->filterVersion : version;
+
+    return s;
+}
+} // namespace
+
+void lastfmPublishSettings()
+{
+    if (t_publishing)
+        return;
+
+    t_publishing = true;
+    {
+        std::lock_guard<std::mutex> lock(publishMutex);
+
+        const std::shared_ptr<const LastfmSettings> previous = loadCurrent();
+        std::shared_ptr<const LastfmSettings> s = buildSnapshot(++g_version, previous.get());
+        lfmLogLevel.store(s->logLevel, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> currentLock(currentMutex);
+        g_current.swap(s);
+    }
+    t_publishing = false;
+}
+
+std::shared_ptr<const LastfmSettings> lastfmSettings()
+{
+    if (auto s = loadCurrent())
+        return s;
+
+    // First use before init published anything.
+    lastfmPublishSettings();
+
+    if (auto s = loadCurrent())
+        return s;
+
+    // Re-entered while the first snapshot is being built.
+    static const auto defaults = std::make_shared<const LastfmSettings>();
+    return defaults;
+}
@@ -0,0 +1,55 @@
+//
+//  lastfm_settings.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include "lastfm_filter.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Immutable snapshot of prefs + auth flags read on hot paths (playback callbacks, logging).
+// A new snapshot is published whenever prefs or auth change; readers do one atomic load.
+struct LastfmSettings
+{
+    std::uint64_t version = 0;
+
+    // Auth (cfg-backed, see lastfm_state)
+    bool authenticated = false;
+    bool suspended = false;
+    std::string username; // empty when not authenticated
+
+    // Advanced prefs
+    int logLevel = 1;
+    bool disableNowPlaying = false;
+    bool onlyFromMediaLibrary = false;
+    int dynamicSourcesMode = 2; // 0 = none, 1 = NP only, 2 = NP & scrobbling
+    bool treatVariousArtistsAsEmpty = false;
+
+    std::string artistTf;
+    std::string albumArtistTf;
+    std::string titleTf;
+    std::string albumTf;
+
+    std::string excludedArtists;
+    std::string excludedTitles;
+
+    std::string listenBrainzToken;
+
+    // Compiled from excludedArtists / excludedTitles; shared with the previous snapshot when unchanged.
+    std::shared_ptr<const LastfmExclusionFilter> artistFilter;
+    std::shared_ptr<const LastfmExclusionFilter> titleFilter;
+    std::uint64_t filterVersion = 0; // snapshot version in which either filter last changed
+};
+
+// Current snapshot. Allocation-free; the caller shares ownership, so the snapshot stays valid for as long as
+// the returned pointer is held, however many newer ones get published meanwhile.
+std::shared_ptr<const LastfmSettings> lastfmSettings();
+
+// Re-read prefs + auth and publish a new snapshot. Safe to call from any thread.
+void lastfmPublishSettings();
@@ -0,0 +1,62 @@
+//
+//  lastfm_spsc_ring.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Bounded single-producer / single-consumer queue. push() and peek()/pop() never block or allocate;
+// the producer learns about a full ring from push() returning false. Capacity must be a power of two
+// (one slot stays unused to tell full from empty).
+template <typename T, std::size_t Capacity> class LastfmSpscRing
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+  public:
+    // Producer. Moves from `value` only on success.
+    bool push(T& value)
+    {
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+        const std::size_t next = (head + 1) & (Capacity - 1);
+        if (next == tail_.load(std::memory_order_acquire))
+            return false;
+
+        slots_[head] = std::move(value);
+        head_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer. Oldest element, or nullptr when empty. Valid until pop().
+    T* peek()
+    {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire))
+            return nullptr;
+        return &slots_[tail];
+    }
+
+    // Consumer. Drops the element returned by peek(); the slot is reset so it releases what it holds.
+    void pop()
+    {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        slots_[tail] = T{};
+        tail_.store((tail + 1) & (Capacity - 1), std::memory_order_release);
+    }
+
+    bool empty() const
+    {
+        return tail_.load(std::memory_order_acquire) == head_.load(std::memory_order_acquire);
+    }
+
+  private:
+    std::array<T, Capacity> slots_{};
+    alignas(64) std::atomic<std::size_t> head_{0};
+    alignas(64) std::atomic<std::size_t> tail_{0};
+};
@@ -6,6 +6,7 @@
 //
 
 #include "lastfm_state.h"
+#include "lastfm_settings.h"
 #include "debug.h"
 
 #include <foobar2000/SDK/foobar2000.h>
@@ -48,24 +49,26 @@ LastfmAuthState lastfmGetAuthState()
 
 void lastfmSetAuthState(const LastfmAuthState& state)
 {
-    std::lock_guard<std::mutex> lock(authMutex);
-    cfgLastfmAuthenticated.set(state.isAuthenticated);
-    cfgLastfmUsername.set(state.username.c_str());
-    cfgLastfmSessionKey.set(state.sessionKey.c_str());
-    if (state.isAuthenticated)
-        cfgLastfmSuspended.set(false);
+    {
+        std::lock_guard<std::mutex> lock(authMutex);
+        cfgLastfmAuthenticated.set(state.isAuthenticated);
+        cfgLastfmUsername.set(state.username.c_str());
+        cfgLastfmSessionKey.set(state.sessionKey.c_str());
+        if (state.isAuthenticated)
+            cfgLastfmSuspended.set(false);
+    }
+    lastfmPublishSettings();
 }
 
+// Flags are read on every playback tick: served from the settings snapshot, republished by the mutators.
 bool lastfmIsAuthenticated()
 {
-    std::lock_guard<std::mutex> lock(authMutex);
-    return cfgLastfmAuthenticated.get();
+    return lastfmSettings()->authenticated;
 }
 
 bool lastfmIsSuspended()
 {
-    std::lock_guard<std::mutex> lock(authMutex);
-    return cfgLastfmSuspended.get();
+    return lastfmSettings()->suspended;
 }
 
 void lastfmClearAuthentication()
@@ -81,6 +84,7 @@ void lastfmClearAuthentication()
         cfgLastfmSessionKey.set("");
         cfgLastfmSuspended.set(false);
     }
+    lastfmPublishSettings();
 
     pfc::string_formatter f;
     f << "Now authenticated=" << (lastfmIsAuthenticated() ? 1 : 0) << ", user='" << user << "'";
@@ -97,6 +101,7 @@ void lastfmClearSuspension()
         cfgLastfmSuspended.set(false);
         user = cfgLastfmUsername.get();
     }
+    lastfmPublishSettings();
 
     pfc::string_formatter f;
     f << "Suspended=" << (lastfmIsSuspended() ? "yes" : "no") << ", user='" << user << "'";
@@ -113,6 +118,7 @@ void lastfmSuspendCurrentUser()
         cfgLastfmSuspended.set(true);
         user = cfgLastfmUsername.get();
     }
+    lastfmPublishSettings();
 
     pfc::string_formatter f;
     f << "Suspended=" << (lastfmIsSuspended() ? "yes" : "no") << ", user='" << user << "'";
@@ -0,0 +1,397 @@
+//
+//  lastfm_stats.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "lastfm_stats.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+static constexpr std::int64_t K_PARTITION_SECONDS = 7 * 24 * 3600;
+
+static char fold(char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+static bool equalsFolded(const std::string& a, const std::string& b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (std::size_t i = 0; i < a.size(); ++i)
+    {
+        if (a[i] != b[i] && fold(a[i]) != fold(b[i]))
+            return false;
+    }
+    return true;
+}
+
+// FNV-1a over the owner and the folded name, finished so the low bits index the table.
+static std::uint64_t hashName(std::uint32_t owner, const std::string& name)
+{
+    std::uint64_t h = 1469598103934665603ULL ^ owner;
+    for (const char c : name)
+        h = (h ^ static_cast<unsigned char>(fold(c))) * 1099511628211ULL;
+    h ^= h >> 29;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    return h ^ (h >> 32);
+}
+
+static std::tm localTm(std::time_t t)
+{
+    std::tm tm{};
+#if defined(_WIN32)
+    localtime_s(&tm, &t);
+#else
+    localtime_r(&t, &tm);
+#endif
+    return tm;
+}
+
+static std::string formatHours(std::uint64_t seconds)
+{
+    const std::uint64_t minutes = seconds / 60;
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%llu:%02u h", static_cast<unsigned long long>(minutes / 60),
+                  static_cast<unsigned>(minutes % 60));
+    return buf;
+}
+} // namespace
+
+void lastfmStatsPeriodRange(LastfmStatsPeriod period, std::time_t now, std::time_t& from, std::time_t& to)
+{
+    if (period == LastfmStatsPeriod::ALL)
+    {
+        from = 0;
+        to = std::numeric_limits<std::time_t>::max();
+        return;
+    }
+
+    std::tm start = localTm(now);
+    start.tm_hour = 0;
+    start.tm_min = 0;
+    start.tm_sec = 0;
+    start.tm_isdst = -1;
+
+    switch (period)
+    {
+    case LastfmStatsPeriod::WEEK:
+        start.tm_mday -= (start.tm_wday + 6) % 7;
+        break;
+    case LastfmStatsPeriod::MONTH:
+        start.tm_mday = 1;
+        break;
+    case LastfmStatsPeriod::YEAR:
+        start.tm_mday = 1;
+        start.tm_mon = 0;
+        break;
+    default:
+        break;
+    }
+
+    // mktime normalizes the day and month arithmetic and picks the right DST offset at either end.
+    std::tm end = start;
+    switch (period)
+    {
+    case LastfmStatsPeriod::DAY:
+        end.tm_mday += 1;
+        break;
+    case LastfmStatsPeriod::WEEK:
+        end.tm_mday += 7;
+        break;
+    case LastfmStatsPeriod::MONTH:
+        end.tm_mon += 1;
+        break;
+    default:
+        end.tm_year += 1;
+        break;
+    }
+
+    from = std::mktime(&start);
+    to = std::mktime(&end);
+}
+
+const char* lastfmStatsPeriodName(LastfmStatsPeriod period)
+{
+    switch (period)
+    {
+    case LastfmStatsPeriod::DAY:
+        return "Today";
+    case LastfmStatsPeriod::WEEK:
+        return "This week";
+    case LastfmStatsPeriod::MONTH:
+        return "This month";
+    case LastfmStatsPeriod::YEAR:
+        return "This year";
+    case LastfmStatsPeriod::ALL:
+        return "All time";
+    }
+    return "?";
+}
+
+std::uint32_t LastfmListeningStats::Pool::intern(std::uint32_t owner, const std::string& name)
+{
+    // Load factor at most 0.5.
+    if ((names_.size() + 1) * 2 > slots_.size())
+    {
+        std::vector<std::uint64_t> old(std::max<std::size_t>(1024, slots_.size() * 2), 0);
+        old.swap(slots_);
+        const std::size_t mask = slots_.size() - 1;
+        for (const std::uint64_t slot : old)
+        {
+            if (slot == 0)
+                continue;
+            std::size_t i = static_cast<std::size_t>(slot >> 32) & mask;
+            while (slots_[i] != 0)
+                i = (i + 1) & mask;
+            slots_[i] = slot;
+        }
+    }
+
+    const std::uint64_t h = hashName(owner, name);
+    const std::uint64_t tag = h << 32;
+    const std::size_t mask = slots_.size() - 1;
+    std::size_t i = static_cast<std::size_t>(h & 0xffffffffu) & mask;
+    for (; slots_[i] != 0; i = (i + 1) & mask)
+    {
+        if ((slots_[i] & 0xffffffff00000000ULL) != tag)
+            continue;
+        const auto id = static_cast<std::uint32_t>((slots_[i] & 0xffffffffu) - 1);
+        if (owners_[id] == owner && equalsFolded(names_[id], name))
+            return id;
+    }
+
+    const auto id = static_cast<std::uint32_t>(names_.size());
+    slots_[i] = tag | (static_cast<std::uint64_t>(id) + 1);
+    names_.push_back(name);
+    owners_.push_back(owner);
+    return id;
+}
+
+void LastfmListeningStats::add(const LastfmHistoryRecord& play)
+{
+    if (play.timestamp <= 0 || play.artist.empty() || play.title.empty())
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    const std::uint32_t artist = artists_.intern(0, play.artist);
+    const std::uint32_t track = tracks_.intern(artist, play.title);
+
+    std::uint32_t album = NO_ALBUM;
+    if (!play.album.empty())
+    {
+        const bool ownAlbum = play.albumArtist.empty() || play.albumArtist == play.artist;
+        album = albums_.intern(ownAlbum ? artist : artists_.intern(0, play.albumArtist), play.album);
+    }
+
+    const auto t = static_cast<std::uint32_t>(std::min<std::time_t>(play.timestamp, 0xffffffffu));
+    const std::int64_t key = static_cast<std::int64_t>(t) / K_PARTITION_SECONDS;
+    if (key != lastPartitionKey_)
+    {
+        lastPartition_ = &partitions_[key];
+        lastPartitionKey_ = key;
+    }
+
+    Partition& p = *lastPartition_;
+    if (!p.time.empty() && t < p.time.back())
+        p.sorted = false;
+
+    p.time.push_back(t);
+    p.artist.push_back(artist);
+    p.track.push_back(track);
+    p.album.push_back(album);
+    p.seconds.push_back(play.durationSeconds > 0.0 ? static_cast<std::uint32_t>(play.durationSeconds) : 0);
+    ++plays_;
+}
+
+template <typename F> void LastfmListeningStats::scanLocked(std::time_t from, std::time_t to, F&& f) const
+{
+    if (from >= to || partitions_.empty())
+        return;
+
+    const std::int64_t lo = std::max<std::int64_t>(from, 0);
+    const std::int64_t hi = std::min<std::int64_t>(to, 0xffffffffu);
+
+    for (auto it = partitions_.lower_bound(lo / K_PARTITION_SECONDS); it != partitions_.end(); ++it)
+    {
+        const std::int64_t start = it->first * K_PARTITION_SECONDS;
+        if (start >= hi)
+            break;
+
+        Partition& p = it->second;
+        if (!p.sorted)
+        {
+            std::vector<std::uint32_t> order(p.time.size());
+            std::iota(order.begin(), order.end(), 0u);
+            std::stable_sort(order.begin(), order.end(),
+                             [&p](std::uint32_t a, std::uint32_t b) { return p.time[a] < p.time[b]; });
+
+            for (std::vector<std::uint32_t>* column : {&p.time, &p.artist, &p.track, &p.album, &p.seconds})
+            {
+                std::vector<std::uint32_t> sorted(column->size());
+                for (std::size_t i = 0; i < order.size(); ++i)
+                    sorted[i] = (*column)[order[i]];
+                column->swap(sorted);
+            }
+            p.sorted = true;
+        }
+
+        std::size_t begin = 0;
+        std::size_t end = p.time.size();
+        if (start < lo)
+            begin = std::lower_bound(p.time.begin(), p.time.end(), static_cast<std::uint32_t>(lo)) - p.time.begin();
+        if (start + K_PARTITION_SECONDS > hi)
+            end = std::lower_bound(p.time.begin(), p.time.end(), static_cast<std::uint32_t>(hi)) - p.time.begin();
+        if (begin < end)
+            f(p, begin, end);
+    }
+}
+
+std::vector<LastfmStatsEntry> LastfmListeningStats::top(LastfmStatsKind kind, std::time_t from, std::time_t to,
+                                                        std::size_t limit) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    const Pool& pool = kind == LastfmStatsKind::ARTIST ? artists_ : kind == LastfmStatsKind::TRACK ? tracks_ : albums_;
+    std::vector<std::uint32_t> plays(pool.size(), 0);
+    std::vector<std::uint64_t> seconds(pool.size(), 0);
+    std::vector<std::uint32_t> touched;
+
+    scanLocked(from, to,
+               [&](const Partition& p, std::size_t begin, std::size_t end)
+               {
+                   const std::vector<std::uint32_t>& ids = kind == LastfmStatsKind::ARTIST  ? p.artist
+                                                           : kind == LastfmStatsKind::TRACK ? p.track
+                                                                                            : p.album;
+                   for (std::size_t i = begin; i < end; ++i)
+                   {
+                       const std::uint32_t id = ids[i];
+                       if (id == NO_ALBUM)
+                           continue;
+                       if (plays[id]++ == 0)
+                           touched.push_back(id);
+                       seconds[id] += p.seconds[i];
+                   }
+               });
+
+    const std::size_t n = std::min(limit, touched.size());
+    std::partial_sort(touched.begin(), touched.begin() + static_cast<std::ptrdiff_t>(n), touched.end(),
+                      [&](std::uint32_t a, std::uint32_t b)
+                      {
+                          if (plays[a] != plays[b])
+                              return plays[a] > plays[b];
+                          if (seconds[a] != seconds[b])
+                              return seconds[a] > seconds[b];
+                          return pool.name(a) < pool.name(b);
+                      });
+
+    std::vector<LastfmStatsEntry> out(n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const std::uint32_t id = touched[i];
+        LastfmStatsEntry& e = out[i];
+        e.plays = plays[id];
+        e.seconds = seconds[id];
+        if (kind == LastfmStatsKind::ARTIST)
+        {
+            e.artist = pool.name(id);
+            continue;
+        }
+        e.artist = artists_.name(pool.owner(id));
+        e.name = pool.name(id);
+    }
+    return out;
+}
+
+LastfmStatsTotals LastfmListeningStats::totals(std::time_t from, std::time_t to) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    LastfmStatsTotals t;
+    std::vector<bool> artistSeen(artists_.size(), false);
+    std::vector<bool> trackSeen(tracks_.size(), false);
+
+    scanLocked(from, to,
+               [&](const Partition& p, std::size_t begin, std::size_t end)
+               {
+                   t.plays += end - begin;
+                   for (std::size_t i = begin; i < end; ++i)
+                   {
+                       t.seconds += p.seconds[i];
+                       if (!artistSeen[p.artist[i]])
+                       {
+                           artistSeen[p.artist[i]] = true;
+                           ++t.artists;
+                       }
+                       if (!trackSeen[p.track[i]])
+                       {
+                           trackSeen[p.track[i]] = true;
+                           ++t.tracks;
+                       }
+                   }
+               });
+    return t;
+}
+
+std::size_t LastfmListeningStats::plays() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return plays_;
+}
+
+std::string lastfmDescribeListeningStats(const LastfmListeningStats& stats, std::time_t now, std::size_t limit)
+{
+    if (stats.plays() == 0)
+        return "No scrobbles recorded yet. Statistics cover plays acknowledged since the history was started.";
+
+    std::string s;
+    std::time_t from = 0;
+    std::time_t to = 0;
+
+    for (const LastfmStatsPeriod period : {LastfmStatsPeriod::DAY, LastfmStatsPeriod::WEEK, LastfmStatsPeriod::MONTH,
+                                           LastfmStatsPeriod::YEAR, LastfmStatsPeriod::ALL})
+    {
+        lastfmStatsPeriodRange(period, now, from, to);
+        const LastfmStatsTotals t = stats.totals(from, to);
+        s += lastfmStatsPeriodName(period);
+        s += ": " + std::to_string(t.plays) + " play(s), " + formatHours(t.seconds) + ", " +
+             std::to_string(t.artists) + " artist(s), " + std::to_string(t.tracks) + " track(s)\n";
+    }
+
+    const std::pair<LastfmStatsKind, const char*> kinds[] = {
+        {LastfmStatsKind::ARTIST, "artists"}, {LastfmStatsKind::TRACK, "tracks"}, {LastfmStatsKind::ALBUM, "albums"}};
+
+    for (const LastfmStatsPeriod period : {LastfmStatsPeriod::WEEK, LastfmStatsPeriod::MONTH, LastfmStatsPeriod::YEAR})
+    {
+        lastfmStatsPeriodRange(period, now, from, to);
+        for (const auto& kind : kinds)
+        {
+            const std::vector<LastfmStatsEntry> top = stats.top(kind.first, from, to, limit);
+            if (top.empty())
+                continue;
+
+            s += "\nTop ";
+            s += kind.second;
+            s += " (";
+            s += lastfmStatsPeriodName(period);
+            s += "):\n";
+            for (std::size_t i = 0; i < top.size(); ++i)
+            {
+                const LastfmStatsEntry& e = top[i];
+                s += "  " + std::to_string(i + 1) + ". " + e.artist;
+                if (!e.name.empty())
+                    s += " - " + e.name;
+                s += " (" + std::to_string(e.plays) + ")\n";
+            }
+        }
+    }
+    return s;
+}
@@ -0,0 +1,126 @@
+//
+//  lastfm_stats.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "lastfm_history.h"
+
+enum class LastfmStatsPeriod
+{
+    DAY,
+    WEEK, // Monday to Sunday
+    MONTH,
+    YEAR,
+    ALL,
+};
+
+enum class LastfmStatsKind
+{
+    ARTIST,
+    TRACK,
+    ALBUM,
+};
+
+struct LastfmStatsEntry
+{
+    std::string artist; // album artist for ALBUM
+    std::string name;   // title or album; empty for ARTIST
+    std::uint64_t plays = 0;
+    std::uint64_t seconds = 0;
+};
+
+struct LastfmStatsTotals
+{
+    std::uint64_t plays = 0;
+    std::uint64_t seconds = 0; // sum of track lengths
+    std::size_t artists = 0;
+    std::size_t tracks = 0;
+};
+
+// [from, to) of the local-time period containing `now`.
+void lastfmStatsPeriodRange(LastfmStatsPeriod period, std::time_t now, std::time_t& from, std::time_t& to);
+const char* lastfmStatsPeriodName(LastfmStatsPeriod period);
+
+// Listening statistics over the scrobble history, kept in memory column by column. Artists, tracks and albums
+// are interned once (names compared ASCII case-insensitively, as Last.fm does; the first spelling seen is
+// shown), so a play is five 32-bit values: start time, artist, track, album and length. Plays are partitioned
+// by week; a query walks only the partitions it overlaps, uses whole partitions without looking at the times
+// and binary-searches the two at its edges, counting into flat arrays indexed by id.
+class LastfmListeningStats
+{
+  public:
+    void add(const LastfmHistoryRecord& play);
+
+    // Most played first (ties: longer listening time, then name); at most `limit` entries.
+    std::vector<LastfmStatsEntry> top(LastfmStatsKind kind, std::time_t from, std::time_t to,
+                                      std::size_t limit) const;
+    LastfmStatsTotals totals(std::time_t from, std::time_t to) const;
+
+    std::size_t plays() const;
+
+  private:
+    static constexpr std::uint32_t NO_ALBUM = 0xffffffffu;
+
+    struct Partition
+    {
+        std::vector<std::uint32_t> time; // seconds since 1970, UTC
+        std::vector<std::uint32_t> artist;
+        std::vector<std::uint32_t> track;
+        std::vector<std::uint32_t> album;
+        std::vector<std::uint32_t> seconds;
+        bool sorted = true; // by time; imports append out of order
+    };
+
+    // Interned (owner, name) pairs: tracks and albums are owned by an artist id, artists by 0. Open addressing
+    // over one flat array of (hash, id) words, so a lookup is one probe plus one string compare.
+    class Pool
+    {
+      public:
+        std::uint32_t intern(std::uint32_t owner, const std::string& name);
+        std::size_t size() const
+        {
+            return names_.size();
+        }
+        const std::string& name(std::uint32_t id) const
+        {
+            return names_[id];
+        }
+        std::uint32_t owner(std::uint32_t id) const
+        {
+            return owners_[id];
+        }
+
+      private:
+        std::vector<std::uint64_t> slots_; // hash << 32 | (id + 1); 0 = empty
+        std::vector<std::string> names_;
+        std::vector<std::uint32_t> owners_;
+    };
+
+    // Calls f(partition, begin, end) for the row ranges inside [from, to).
+    template <typename F> void scanLocked(std::time_t from, std::time_t to, F&& f) const;
+
+    mutable std::mutex mutex_;
+    mutable std::map<std::int64_t, Partition> partitions_;
+    Partition* lastPartition_ = nullptr; // plays mostly arrive in time order
+    std::int64_t lastPartitionKey_ = -1;
+    std::size_t plays_ = 0;
+
+    Pool artists_;
+    Pool tracks_; // owned by the artist
+    Pool albums_; // owned by the album artist
+};
+
+// Popup text: totals for every period and the top `limit` artists, tracks and albums of this week, month and year.
+std::string lastfmDescribeListeningStats(const LastfmListeningStats& stats, std::time_t now, std::size_t limit);
@@ -0,0 +1,125 @@
+//
+//  lastfm_titleformat.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "lastfm_titleformat.h"
+#include "lastfm_util.h"
+#include "debug.h"
+
+#include <cstring>
+#include <map>
+#include <mutex>
+
+namespace
+{
+static constexpr char K_FIELD_SEPARATOR = '\x1F';
+static constexpr const char* K_TAG_ARTIST_TF = "[%ARTIST%]";
+
+// Expression sets rarely change; keep the last few around so switching back is free.
+static constexpr std::size_t K_MAX_CACHED_SETS = 8;
+
+static std::mutex cacheMutex;
+static std::map<std::string, std::shared_ptr<const LastfmTitleformatSet>> cache;
+
+static std::string evalSingle(const metadb_handle_ptr& track, const service_ptr_t<titleformat_object>& script)
+{
+    if (!script.is_valid())
+        return {};
+
+    pfc::string8 out;
+    track->format_title(nullptr, out, script, nullptr);
+    return lastfm::util::cleanTagValue(out.c_str());
+}
+} // namespace
+
+std::shared_ptr<const LastfmTitleformatSet> LastfmTitleformatSet::get(const std::string& artistTf,
+                                                                      const std::string& albumArtistTf,
+                                                                      const std::string& titleTf,
+                                                                      const std::string& albumTf)
+{
+    const std::string* exprs[FIELD_COUNT - 1] = {&artistTf, &albumArtistTf, &titleTf, &albumTf};
+
+    std::string key;
+    for (const std::string* e : exprs)
+    {
+        key += *e;
+        key.push_back(K_FIELD_SEPARATOR);
+    }
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    auto it = cache.find(key);
+    if (it != cache.end())
+        return it->second;
+
+    std::shared_ptr<LastfmTitleformatSet> set(new LastfmTitleformatSet());
+    static_api_ptr_t<titleformat_compiler> compiler;
+
+    // key already is "a<US>aa<US>t<US>al<US>"; append the fallback to complete the script.
+    const std::string script = key + K_TAG_ARTIST_TF;
+    compiler->compile_safe(set->combined_, script.c_str());
+
+    for (std::size_t i = 0; i < FIELD_COUNT - 1; ++i)
+    {
+        if (!exprs[i]->empty())
+            compiler->compile_safe(set->single_[i], exprs[i]->c_str());
+    }
+    compiler->compile_safe(set->single_[FIELD_COUNT - 1], K_TAG_ARTIST_TF);
+
+    if (cache.size() >= K_MAX_CACHED_SETS)
+        cache.clear();
+    cache.emplace(std::move(key), set);
+
+    return set;
+}
+
+void LastfmTitleformatSet::evaluate(const metadb_handle_ptr& track, LastfmTfFields& out) const
+{
+    std::string* fields[FIELD_COUNT] = {&out.artist, &out.albumArtist, &out.title, &out.album, &out.tagArtist};
+
+    if (!track.is_valid())
+    {
+        for (std::string* f : fields)
+            f->clear();
+        return;
+    }
+
+    pfc::string8 combined;
+    if (combined_.is_valid())
+        track->format_title(nullptr, combined, combined_, nullptr);
+
+    const char* p = combined.c_str();
+    const char* parts[FIELD_COUNT + 1];
+    std::size_t count = 0;
+    parts[count++] = p;
+    for (; *p; ++p)
+    {
+        if (*p == K_FIELD_SEPARATOR)
+        {
+            if (count == FIELD_COUNT)
+            {
+                count = FIELD_COUNT + 1; // too many separators
+                break;
+            }
+            parts[count++] = p + 1;
+        }
+    }
+
+    if (count != FIELD_COUNT)
+    {
+        LFM_DEBUG("Titleformat: combined output did not split cleanly, evaluating fields separately.");
+        for (std::size_t i = 0; i < FIELD_COUNT; ++i)
+            *fields[i] = evalSingle(track, single_[i]);
+        return;
+    }
+
+    for (std::size_t i = 0; i < FIELD_COUNT; ++i)
+    {
+        const char* begin = parts[i];
+        const char* end = (i + 1 < FIELD_COUNT) ? parts[i + 1] - 1 : begin + std::strlen(begin);
+        *fields[i] = lastfm::util::cleanTagValue(std::string(begin, end).c_str());
+    }
+}
@@ -0,0 +1,47 @@
+//
+//  lastfm_titleformat.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <foobar2000/SDK/foobar2000.h>
+
+#include <memory>
+#include <string>
+
+// Values produced by one evaluation, already passed through cleanTagValue().
+struct LastfmTfFields
+{
+    std::string artist;
+    std::string albumArtist;
+    std::string title;
+    std::string album;
+    std::string tagArtist; // plain [%ARTIST%], used by the Various Artists fallback
+};
+
+// The artist / album artist / title / album expressions plus the [%ARTIST%] fallback, compiled into one
+// script whose outputs are joined by a unit separator (0x1F). A track is formatted with a single
+// format_title() call and split once. Immutable; instances are cached and shared per expression set.
+class LastfmTitleformatSet
+{
+  public:
+    static std::shared_ptr<const LastfmTitleformatSet> get(const std::string& artistTf,
+                                                           const std::string& albumArtistTf,
+                                                           const std::string& titleTf, const std::string& albumTf);
+
+    void evaluate(const metadb_handle_ptr& track, LastfmTfFields& out) const;
+
+  private:
+    static constexpr std::size_t FIELD_COUNT = 5;
+
+    LastfmTitleformatSet() = default;
+
+    service_ptr_t<titleformat_object> combined_;
+
+    // Per-field scripts, used only when a user expression swallows the separator (e.g. an unterminated
+    // quote) and the combined output does not split into FIELD_COUNT parts.
+    service_ptr_t<titleformat_object> single_[FIELD_COUNT];
+};
@@ -0,0 +1,354 @@
+//
+//  lastfm_trace.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "lastfm_trace.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+static constexpr char K_MAGIC[8] = {'L', 'F', 'M', 'T', 'R', 'A', 'C', 'E'};
+static constexpr std::uint8_t K_VERSION = 1;
+static constexpr std::uint8_t K_TAG_TRACK = 0x80;
+
+static constexpr std::size_t K_FLUSH_BYTES = 64 * 1024;
+
+// Sanity limits for the reader; a trace never comes close.
+static constexpr std::uint64_t K_MAX_STRING = 64 * 1024;
+static constexpr std::uint64_t K_MAX_META = 1024;
+
+static std::uint64_t secondsToMs(double seconds)
+{
+    if (!(seconds > 0.0))
+        return 0;
+    return static_cast<std::uint64_t>(std::llround(seconds * 1000.0));
+}
+} // namespace
+
+const char* lastfmTraceKindName(LastfmTraceKind kind)
+{
+    switch (kind)
+    {
+    case LastfmTraceKind::NEW_TRACK:
+        return "new_track";
+    case LastfmTraceKind::STOP:
+        return "stop";
+    case LastfmTraceKind::SEEK:
+        return "seek";
+    case LastfmTraceKind::PAUSE:
+        return "pause";
+    case LastfmTraceKind::TIME:
+        return "time";
+    case LastfmTraceKind::EDITED:
+        return "edited";
+    case LastfmTraceKind::DYNAMIC_INFO:
+        return "dynamic_info";
+    }
+    return "?";
+}
+
+LastfmTraceWriter::~LastfmTraceWriter()
+{
+    close();
+}
+
+bool LastfmTraceWriter::open(const std::string& path, std::string& error)
+{
+    close();
+
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_)
+    {
+        error = "cannot create " + path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    buffer_.assign(K_MAGIC, sizeof(K_MAGIC));
+    buffer_.push_back(static_cast<char>(K_VERSION));
+    bytes_ = 0;
+    events_ = 0;
+    haveLastMs_ = false;
+    return true;
+}
+
+void LastfmTraceWriter::close()
+{
+    if (!file_)
+        return;
+
+    if (!buffer_.empty())
+        std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+    bytes_ += buffer_.size();
+    buffer_.clear();
+
+    std::fclose(file_);
+    file_ = nullptr;
+}
+
+void LastfmTraceWriter::writeTrack(const LastfmTraceTrack& track)
+{
+    if (!file_)
+        return;
+
+    buffer_.push_back(static_cast<char>(K_TAG_TRACK));
+    putVarint(track.id);
+    putString(track.path);
+
+    std::uint64_t bits = 0;
+    static_assert(sizeof(bits) == sizeof(track.length), "f64");
+    std::memcpy(&bits, &track.length, sizeof(bits));
+    for (int i = 0; i < 8; ++i)
+        buffer_.push_back(static_cast<char>((bits >> (8 * i)) & 0xff));
+
+    putMeta(track.meta);
+    flushIfFull();
+}
+
+void LastfmTraceWriter::writeEvent(const LastfmTraceEvent& ev)
+{
+    if (!file_)
+        return;
+
+    const std::int64_t delta = haveLastMs_ ? ev.atMs - lastMs_ : 0;
+    lastMs_ = ev.atMs;
+    haveLastMs_ = true;
+
+    buffer_.push_back(static_cast<char>(ev.kind));
+    putVarint(delta > 0 ? static_cast<std::uint64_t>(delta) : 0);
+
+    switch (ev.kind)
+    {
+    case LastfmTraceKind::NEW_TRACK:
+    case LastfmTraceKind::EDITED:
+        putVarint(ev.trackId);
+        break;
+    case LastfmTraceKind::SEEK:
+    case LastfmTraceKind::TIME:
+        putVarint(secondsToMs(ev.time));
+        break;
+    case LastfmTraceKind::PAUSE:
+        buffer_.push_back(ev.flag ? 1 : 0);
+        break;
+    case LastfmTraceKind::DYNAMIC_INFO:
+        putMeta(ev.meta);
+        break;
+    case LastfmTraceKind::STOP:
+        break;
+    }
+
+    ++events_;
+    flushIfFull();
+}
+
+void LastfmTraceWriter::putVarint(std::uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        buffer_.push_back(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    buffer_.push_back(static_cast<char>(v));
+}
+
+void LastfmTraceWriter::putString(const std::string& s)
+{
+    putVarint(s.size());
+    buffer_.append(s);
+}
+
+void LastfmTraceWriter::putMeta(const LastfmTraceMeta& meta)
+{
+    putVarint(meta.size());
+    for (const auto& kv : meta)
+    {
+        putString(kv.first);
+        putString(kv.second);
+    }
+}
+
+void LastfmTraceWriter::flushIfFull()
+{
+    if (buffer_.size() < K_FLUSH_BYTES)
+        return;
+
+    std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+    bytes_ += buffer_.size();
+    buffer_.clear();
+}
+
+LastfmTraceReader::~LastfmTraceReader()
+{
+    if (file_)
+        std::fclose(file_);
+}
+
+bool LastfmTraceReader::open(const std::string& path, std::string& error)
+{
+    if (file_)
+        std::fclose(file_);
+
+    file_ = std::fopen(path.c_str(), "rb");
+    if (!file_)
+    {
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    char magic[sizeof(K_MAGIC)];
+    std::uint8_t version = 0;
+    if (std::fread(magic, 1, sizeof(magic), file_) != sizeof(magic) ||
+        std::memcmp(magic, K_MAGIC, sizeof(magic)) != 0 || !getByte(version))
+    {
+        error = path + ": not a trace file";
+        return false;
+    }
+    if (version != K_VERSION)
+    {
+        error = path + ": unsupported trace version " + std::to_string(version);
+        return false;
+    }
+
+    nowMs_ = 0;
+    return true;
+}
+
+LastfmTraceReader::Record LastfmTraceReader::next(LastfmTraceTrack& track, LastfmTraceEvent& ev)
+{
+    if (!file_)
+        return fail("not open");
+
+    std::uint8_t tag = 0;
+    if (!getByte(tag))
+        return Record::END;
+
+    if (tag == K_TAG_TRACK)
+    {
+        std::uint64_t id = 0;
+        if (!getVarint(id) || !getString(track.path))
+            return fail("truncated track record");
+
+        std::uint64_t bits = 0;
+        for (int i = 0; i < 8; ++i)
+        {
+            std::uint8_t b = 0;
+            if (!getByte(b))
+                return fail("truncated track record");
+            bits |= static_cast<std::uint64_t>(b) << (8 * i);
+        }
+        std::memcpy(&track.length, &bits, sizeof(bits));
+
+        if (!getMeta(track.meta))
+            return fail("truncated track metadata");
+
+        track.id = static_cast<std::uint32_t>(id);
+        return Record::TRACK;
+    }
+
+    if (tag < static_cast<std::uint8_t>(LastfmTraceKind::NEW_TRACK) ||
+        tag > static_cast<std::uint8_t>(LastfmTraceKind::DYNAMIC_INFO))
+        return fail("unknown record tag");
+
+    std::uint64_t delta = 0;
+    if (!getVarint(delta))
+        return fail("truncated event");
+
+    ev = LastfmTraceEvent{};
+    ev.kind = static_cast<LastfmTraceKind>(tag);
+    nowMs_ += static_cast<std::int64_t>(delta);
+    ev.atMs = nowMs_;
+
+    std::uint64_t v = 0;
+    switch (ev.kind)
+    {
+    case LastfmTraceKind::NEW_TRACK:
+    case LastfmTraceKind::EDITED:
+        if (!getVarint(v))
+            return fail("truncated event");
+        ev.trackId = static_cast<std::uint32_t>(v);
+        break;
+    case LastfmTraceKind::SEEK:
+    case LastfmTraceKind::TIME:
+        if (!getVarint(v))
+            return fail("truncated event");
+        ev.time = static_cast<double>(v) / 1000.0;
+        break;
+    case LastfmTraceKind::PAUSE:
+    {
+        std::uint8_t b = 0;
+        if (!getByte(b))
+            return fail("truncated event");
+        ev.flag = b != 0;
+        break;
+    }
+    case LastfmTraceKind::DYNAMIC_INFO:
+        if (!getMeta(ev.meta))
+            return fail("truncated dynamic info");
+        break;
+    case LastfmTraceKind::STOP:
+        break;
+    }
+
+    return Record::EVENT;
+}
+
+bool LastfmTraceReader::getByte(std::uint8_t& b)
+{
+    const int c = std::fgetc(file_);
+    if (c == EOF)
+        return false;
+    b = static_cast<std::uint8_t>(c);
+    return true;
+}
+
+bool LastfmTraceReader::getVarint(std::uint64_t& v)
+{
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        std::uint8_t b = 0;
+        if (!getByte(b))
+            return false;
+        v |= static_cast<std::uint64_t>(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+bool LastfmTraceReader::getString(std::string& s)
+{
+    std::uint64_t n = 0;
+    if (!getVarint(n) || n > K_MAX_STRING)
+        return false;
+
+    s.resize(static_cast<std::size_t>(n));
+    return n == 0 || std::fread(&s[0], 1, s.size(), file_) == s.size();
+}
+
+bool LastfmTraceReader::getMeta(LastfmTraceMeta& meta)
+{
+    std::uint64_t n = 0;
+    if (!getVarint(n) || n > K_MAX_META)
+        return false;
+
+    meta.clear();
+    meta.resize(static_cast<std::size_t>(n));
+    for (auto& kv : meta)
+    {
+        if (!getString(kv.first) || !getString(kv.second))
+            return false;
+    }
+    return true;
+}
+
+LastfmTraceReader::Record LastfmTraceReader::fail(const char* what)
+{
+    error_ = what;
+    return Record::BAD;
+}
@@ -0,0 +1,136 @@
+//
+//  lastfm_trace.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Playback event traces: what the play callbacks reported, in order, with enough track metadata to drive
+// LastfmTracker again outside foobar2000 (tools/trace_replay). No SDK types here.
+//
+// File layout: "LFMTRACE", u8 version, then records. Each record starts with a tag byte:
+//   0x80 TRACK   varint id, string path, f64 length, meta   (defines or redefines a track id)
+//   1..7 event   varint ms since previous event, then by kind:
+//                NEW_TRACK / EDITED: varint track id;  SEEK / TIME: varint ms;  PAUSE: u8;
+//                DYNAMIC_INFO: meta;  STOP: nothing
+// varint = unsigned LEB128, string = varint length + bytes, meta = varint count + (name, value) strings,
+// f64 = IEEE little endian.
+enum class LastfmTraceKind : std::uint8_t
+{
+    NEW_TRACK = 1,
+    STOP,
+    SEEK,
+    PAUSE,
+    TIME,
+    EDITED,
+    DYNAMIC_INFO
+};
+
+const char* lastfmTraceKindName(LastfmTraceKind kind);
+
+using LastfmTraceMeta = std::vector<std::pair<std::string, std::string>>;
+
+struct LastfmTraceTrack
+{
+    std::uint32_t id = 0;
+    std::string path;
+    double length = 0.0;
+    LastfmTraceMeta meta;
+};
+
+struct LastfmTraceEvent
+{
+    LastfmTraceKind kind = LastfmTraceKind::STOP;
+    std::int64_t atMs = 0;     // writer: any monotonic ms; reader: ms since the first event
+    double time = 0.0;         // SEEK, TIME
+    bool flag = false;         // PAUSE
+    std::uint32_t trackId = 0; // NEW_TRACK, EDITED
+    LastfmTraceMeta meta;      // DYNAMIC_INFO
+};
+
+class LastfmTraceWriter
+{
+  public:
+    LastfmTraceWriter() = default;
+    LastfmTraceWriter(const LastfmTraceWriter&) = delete;
+    LastfmTraceWriter& operator=(const LastfmTraceWriter&) = delete;
+    ~LastfmTraceWriter();
+
+    bool open(const std::string& path, std::string& error);
+    bool isOpen() const
+    {
+        return file_ != nullptr;
+    }
+    void close();
+
+    void writeTrack(const LastfmTraceTrack& track);
+    void writeEvent(const LastfmTraceEvent& ev);
+
+    std::uint64_t eventCount() const
+    {
+        return events_;
+    }
+    std::uint64_t bytesWritten() const
+    {
+        return bytes_ + buffer_.size();
+    }
+
+  private:
+    void putVarint(std::uint64_t v);
+    void putString(const std::string& s);
+    void putMeta(const LastfmTraceMeta& meta);
+    void flushIfFull();
+
+    std::FILE* file_ = nullptr;
+    std::string buffer_;
+    std::uint64_t bytes_ = 0;
+    std::uint64_t events_ = 0;
+    std::int64_t lastMs_ = 0;
+    bool haveLastMs_ = false;
+};
+
+class LastfmTraceReader
+{
+  public:
+    enum class Record
+    {
+        END,
+        TRACK,
+        EVENT,
+        BAD
+    };
+
+    LastfmTraceReader() = default;
+    LastfmTraceReader(const LastfmTraceReader&) = delete;
+    LastfmTraceReader& operator=(const LastfmTraceReader&) = delete;
+    ~LastfmTraceReader();
+
+    bool open(const std::string& path, std::string& error);
+
+    // Fills `track` for TRACK records and `ev` for EVENT records. BAD leaves a reason in error().
+    Record next(LastfmTraceTrack& track, LastfmTraceEvent& ev);
+
+    const std::string& error() const
+    {
+        return error_;
+    }
+
+  private:
+    bool getByte(std::uint8_t& b);
+    bool getVarint(std::uint64_t& v);
+    bool getString(std::string& s);
+    bool getMeta(LastfmTraceMeta& meta);
+    Record fail(const char* what);
+
+    std::FILE* file_ = nullptr;
+    std::int64_t nowMs_ = 0;
+    std::string error_;
+};
@@ -5,10 +5,9 @@
 //  (c) 2025-2026 by Konstantinos Kyriakopoulos
 //
 
-#include "lastfm_prefs_pane.h"
+#include "lastfm_settings.h"
 #include "lastfm_tracker.h"
-#include "lastfm_core.h"
-#include "lastfm_state.h"
+#include "lastfm_library.h"
 #include "lastfm_util.h"
 #include "debug.h"
 
@@ -17,8 +16,7 @@
 #include <ctime>
 #include <string>
 #include <cstring>
-#include <regex>
-#include <mutex>
+#include <atomic>
 #include <vector>
 
 namespace
@@ -30,19 +28,9 @@ static bool isVariousArtistsValue(const std::string& value)
     return s == "various artists";
 }
 
-static std::string evalTitleFormat(const metadb_handle_ptr& track, const service_ptr_t<titleformat_object>& script)
+static void applyVariousArtistsRule(const LastfmSettings& settings, std::string& albumArtist)
 {
-    if (!track.is_valid() || !script.is_valid())
-        return {};
-
-    pfc::string8 out;
-    track->format_title(nullptr, out, script, nullptr);
-    return lastfm::util::cleanTagValue(out.c_str());
-}
-
-static void applyVariousArtistsRule(std::string& albumArtist)
-{
-    if (!lastfmTagTreatVariousArtistsAsEmpty())
+    if (!settings.treatVariousArtistsAsEmpty)
         return;
 
     if (albumArtist.empty())
@@ -55,107 +43,6 @@ static void applyVariousArtistsRule(std::string& albumArtist)
         albumArtist.clear();
 }
 
-static bool isTrackInMediaLibrary(const metadb_handle_ptr& track)
-{
-    if (!track.is_valid())
-        return false;
-
-    static_api_ptr_t<library_manager> lm;
-    return lm->is_item_in_library(track);
-}
-
-static bool isNetworkStreamPath(const metadb_handle_ptr& track)
-{
-    if (!track.is_valid())
-        return false;
-
-    const char* p = track->get_path();
-    if (!p)
-        return false;
-
-    // Be strict: foobar can use pseudo-schemes like foo:// for local container tracks (ISO, etc).
-    // We only treat real network stream schemes as "stream".
-    return (std::strncmp(p, "http://", 7) == 0) || (std::strncmp(p, "https://", 8) == 0) ||
-           (std::strncmp(p, "mms://", 6) == 0) || (std::strncmp(p, "rtsp://", 7) == 0) ||
-           (std::strncmp(p, "icy://", 6) == 0);
-}
-
-static bool looksLikeStationTitle(const std::string& title)
-{
-    if (title.empty())
-        return true;
-
-    // long sentences / slogans / blurbs / bs
-    if (title.size() > 80)
-        return true;
-
-    int alpha = 0;
-    int spaces = 0;
-
-    bool hasBracket = false;
-    bool hasUrl = false;
-
-    std::string norm;
-    norm.reserve(title.size());
-
-    for (unsigned char c : title)
-    {
-        const char lc = (char)std::tolower(c);
-        norm.push_back(lc);
-
-        if (std::isalpha(c))
-            ++alpha;
-        else if (std::isspace(c))
-            ++spaces;
-
-        if (c == '[' || c == ']')
-            hasBracket = true;
-    }
-
-    if (norm.find("http") != std::string::npos || norm.find("www.") != std::string::npos)
-        hasUrl = true;
-
-    if (alpha < 3)
-        return true;
-
-    if (hasBracket)
-        return true;
-
-    if (spaces > (int)title.size() / 3)
-        return true;
-
-    if (hasUrl)
-        return true;
-
-    return false;
-}
-
-static bool parseArtistTitleFromCombined(const std::string& combined, std::string& artist, std::string& title)
-{
-    const char* seps[] = {" - ", " – ", " — ", ": "};
-    for (const char* sep : seps)
-    {
-        const std::size_t pos = combined.find(sep);
-        if (pos == std::string::npos)
-            continue;
-
-        const std::string left = combined.substr(0, pos);
-        const std::string right = combined.substr(pos + std::strlen(sep));
-
-        artist = lastfm::util::cleanTagValue(left.c_str());
-        title = lastfm::util::cleanTagValue(right.c_str());
-
-        if (artist.empty() || title.empty())
-            continue;
-
-        if (looksLikeStationTitle(title))
-            continue;
-
-        return true;
-    }
-    return false;
-}
-
 static bool extractStreamArtistTitle(const file_info& info, std::string& outArtist, std::string& outTitle,
                                      std::string& outAlbum)
 {
@@ -187,7 +74,7 @@ static bool extractStreamArtistTitle(const file_info& info, std::string& outArti
     if (!combined.empty())
     {
         std::string a, t;
-        if (parseArtistTitleFromCombined(combined, a, t))
+        if (lastfm::util::parseArtistTitleFromCombined(combined, a, t))
         {
             outArtist = a;
             outTitle = t;
@@ -205,7 +92,7 @@ static bool extractStreamArtistTitle(const file_info& info, std::string& outArti
     std::string al = firstOf(kAlbum, sizeof(kAlbum) / sizeof(kAlbum[0]));
 
     // If title looks like station branding/slogan, reject it.
-    if (!t.empty() && looksLikeStationTitle(t))
+    if (!t.empty() && lastfm::util::looksLikeStationTitle(t))
         t.clear();
 
     if (!a.empty() && !t.empty())
@@ -219,38 +106,15 @@ static bool extractStreamArtistTitle(const file_info& info, std::string& outArti
     return false;
 }
 
-class TextOrRegexFilter
+// Logs the first few exclusions per filter, then stays quiet.
+class ExclusionLogLimiter
 {
   public:
-    explicit TextOrRegexFilter(const char* what) : what_(what)
+    explicit ExclusionLogLimiter(const char* what) : what_(what)
     {
     }
 
-    bool matches(const std::string& value, const std::string& rawRules)
-    {
-        rebuildIfNeeded(rawRules);
-        std::lock_guard<std::mutex> lock(m_);
-        if (raw_.empty())
-            return false;
-
-        const std::string vLower = lowerCopy(value);
-
-        for (const auto& needle : substrLower_)
-        {
-            if (!needle.empty() && vLower.find(needle) != std::string::npos)
-                return true;
-        }
-
-        for (const auto& rx : regexes_)
-        {
-            if (std::regex_search(value, rx.re))
-                return true;
-        }
-
-        return false;
-    }
-
-    void logMatchLimited(const std::string& value)
+    void log(const std::string& value)
     {
         int r = remaining_.load(std::memory_order_relaxed);
         while (r > 0)
@@ -264,208 +128,108 @@ class TextOrRegexFilter
     }
 
   private:
-    struct Rx
-    {
-        std::string pat;
-        std::regex re;
-    };
-
-    static bool hasRegexMeta(const std::string& s)
-    {
-        for (char c : s)
-        {
-            switch (c)
-            {
-            case '.':
-            case '^':
-            case '$':
-            case '|':
-            case '?':
-            case '*':
-            case '+':
-            case '(':
-            case ')':
-            case '[':
-            case ']':
-            case '{':
-            case '}':
-            case '\\':
-                return true;
-            default:
-                break;
-            }
-        }
-        return false;
-    }
-
-    static std::string trimCopy(const std::string& in)
-    {
-        std::size_t b = 0;
-        while (b < in.size() && std::isspace((unsigned char)in[b]))
-            ++b;
-        std::size_t e = in.size();
-        while (e > b && std::isspace((unsigned char)in[e - 1]))
-            --e;
-        return (e > b) ? in.substr(b, e - b) : std::string{};
-    }
-
-    static std::string lowerCopy(const std::string& in)
-    {
-        std::string out;
-        out.reserve(in.size());
-        for (unsigned char c : in)
-            out.push_back((char)std::tolower(c));
-        return out;
-    }
-
-    void rebuildIfNeeded(const std::string& rawRules)
-    {
-        std::lock_guard<std::mutex> lock(m_);
-        if (rawRules == raw_)
-            return;
-
-        raw_ = rawRules;
-        substrLower_.clear();
-        regexes_.clear();
-
-        if (raw_.empty())
-            return;
-
-        constexpr std::size_t kMaxPatterns = 32;
-        constexpr std::size_t kMaxLen = 256;
-
-        std::size_t start = 0;
-        while (start <= raw_.size() && (substrLower_.size() + regexes_.size()) < kMaxPatterns)
-        {
-            std::size_t end = raw_.find(';', start);
-            if (end == std::string::npos)
-                end = raw_.size();
-
-            std::string entry = trimCopy(raw_.substr(start, end - start));
-            start = end + 1;
-
-            if (entry.empty())
-                continue;
-
-            if (entry.size() > kMaxLen)
-                continue;
-
-            if (!hasRegexMeta(entry))
-            {
-                substrLower_.push_back(lowerCopy(entry));
-                continue;
-            }
-
-            try
-            {
-                regexes_.push_back(Rx{entry, std::regex(entry, std::regex::ECMAScript | std::regex::icase)});
-            }
-            catch (const std::regex_error&)
-            {
-                LFM_INFO("Exclude " << what_ << ": invalid regex ignored: " << entry.c_str());
-            }
-        }
-    }
-
     const char* what_ = "";
-    std::mutex m_;
-    std::string raw_;
-    std::vector<std::string> substrLower_;
-    std::vector<Rx> regexes_;
     std::atomic<int> remaining_{10};
 };
 
-static TextOrRegexFilter g_excludeArtist("artist");
-static TextOrRegexFilter g_excludeTitle("title");
+static ExclusionLogLimiter g_excludeArtistLog("artist");
+static ExclusionLogLimiter g_excludeTitleLog("title");
 
-static bool isExcludedByFilters(const std::string& artist, const std::string& title)
+static LastfmFilterDecisionCache g_filterDecisions;
+
+static bool evaluateFilters(const LastfmSettings& settings, const std::string& artist, const std::string& title)
 {
-    const std::string artistRules = lastfmExcludedArtistsPatternList();
-    if (!artistRules.empty() && g_excludeArtist.matches(artist, artistRules))
+    if (settings.artistFilter && settings.artistFilter->matches(artist))
     {
-        g_excludeArtist.logMatchLimited(artist);
+        g_excludeArtistLog.log(artist);
         return true;
     }
 
-    const std::string titleRules = lastfmExcludedTitlesPatternList();
-    if (!titleRules.empty() && g_excludeTitle.matches(title, titleRules))
+    if (settings.titleFilter && settings.titleFilter->matches(title))
     {
-        g_excludeTitle.logMatchLimited(title);
+        g_excludeTitleLog.log(title);
         return true;
     }
 
     return false;
 }
 
-} // namespace
-
-void LastfmTracker::recompileTfIfNeeded()
+static bool isExcludedByFilters(const std::string& artist, const std::string& title)
 {
-    static_api_ptr_t<titleformat_compiler> compiler;
+    // Filters are compiled when the settings snapshot is published.
+    const std::shared_ptr<const LastfmSettings> snapshot = lastfmSettings();
+    const LastfmSettings& settings = *snapshot;
+
+    const std::uint64_t key = LastfmFilterDecisionCache::key(artist, title, settings.filterVersion);
+    bool excluded = false;
+    if (g_filterDecisions.lookup(key, excluded))
+        return excluded;
+
+    excluded = evaluateFilters(settings, artist, title);
+    g_filterDecisions.store(key, excluded);
+    return excluded;
+}
 
-    const std::string artistExpr = lastfmArtistTf();
-    if (artistExpr != cachedArtistTfExpr_)
-    {
-        cachedArtistTfExpr_ = artistExpr;
-        artistTf_.release();
-        if (!artistExpr.empty())
-            compiler->compile_safe(artistTf_, artistExpr.c_str());
-    }
+// library_manager is main-thread only. The pipeline front-end resolves membership when a track starts,
+// so this normally hits the cache; a miss is resolved on the main thread for the next check.
+static bool isInMediaLibrary(const metadb_handle_ptr& track)
+{
+    bool inLibrary = false;
+    if (lastfmLookupMediaLibrary(track, inLibrary))
+        return inLibrary;
 
-    const std::string albumArtistExpr = lastfmAlbumArtistTf();
-    if (albumArtistExpr != cachedAlbumArtistTfExpr_)
-    {
-        cachedAlbumArtistTfExpr_ = albumArtistExpr;
-        albumArtistTf_.release();
-        if (!albumArtistExpr.empty())
-            compiler->compile_safe(albumArtistTf_, albumArtistExpr.c_str());
-    }
+    fb2k::inMainThread([track] { lastfmIsInMediaLibrary(track); });
+    return false;
+}
 
-    const std::string titleExpr = lastfmTitleTf();
-    if (titleExpr != cachedTitleTfExpr_)
-    {
-        cachedTitleTfExpr_ = titleExpr;
-        titleTf_.release();
-        if (!titleExpr.empty())
-            compiler->compile_safe(titleTf_, titleExpr.c_str());
-    }
+} // namespace
 
-    const std::string albumExpr = lastfmAlbumTf();
-    if (albumExpr != cachedAlbumTfExpr_)
-    {
-        cachedAlbumTfExpr_ = albumExpr;
-        albumTf_.release();
-        if (!albumExpr.empty())
-            compiler->compile_safe(albumTf_, albumExpr.c_str());
-    }
+LastfmFilterDecisionCache::Stats lastfmFilterDecisionStats()
+{
+    return g_filterDecisions.stats();
+}
 
-    if (!fallbackArtistTf_.is_valid())
-        compiler->compile_safe(fallbackArtistTf_, "[%ARTIST%]");
+bool lastfmIsExcludedByFilters(const LastfmSettings& settings, const std::string& artist, const std::string& title)
+{
+    return evaluateFilters(settings, artist, title);
 }
 
-void LastfmTracker::fillTrackInfoFromTf(const metadb_handle_ptr& track, LastfmTrackInfo& out)
+void lastfmFillTrackInfo(const LastfmSettings& settings, const LastfmTitleformatSet& tf, const metadb_handle_ptr& track,
+                         LastfmTrackInfo& out)
 {
-    recompileTfIfNeeded();
+    LastfmTfFields fields;
+    tf.evaluate(track, fields);
 
-    out.artist = evalTitleFormat(track, artistTf_);
-    out.title = evalTitleFormat(track, titleTf_);
-    out.album = evalTitleFormat(track, albumTf_);
-    out.albumArtist = evalTitleFormat(track, albumArtistTf_);
+    out.artist = std::move(fields.artist);
+    out.title = std::move(fields.title);
+    out.album = std::move(fields.album);
+    out.albumArtist = std::move(fields.albumArtist);
 
-    applyVariousArtistsRule(out.albumArtist);
+    applyVariousArtistsRule(settings, out.albumArtist);
 
-    if (lastfmTagTreatVariousArtistsAsEmpty() && isVariousArtistsValue(out.artist) && out.albumArtist.empty())
+    if (settings.treatVariousArtistsAsEmpty && isVariousArtistsValue(out.artist) && out.albumArtist.empty())
     {
-        std::string fallbackArtist = evalTitleFormat(track, fallbackArtistTf_);
-        if (!fallbackArtist.empty())
-            out.artist = fallbackArtist;
+        if (!fields.tagArtist.empty())
+            out.artist = std::move(fields.tagArtist);
     }
 }
 
-unsigned LastfmTracker::get_flags()
+void LastfmTracker::recompileTfIfNeeded(const LastfmSettings& settings)
 {
-    return flag_on_playback_new_track | flag_on_playback_stop | flag_on_playback_time | flag_on_playback_seek |
-           flag_on_playback_pause | flag_on_playback_dynamic_info | flag_on_playback_dynamic_info_track;
+    // Expressions only change with a new settings snapshot.
+    if (settings.version == cachedTfSettingsVersion_ && tf_)
+        return;
+    cachedTfSettingsVersion_ = settings.version;
+
+    tf_ = LastfmTitleformatSet::get(settings.artistTf, settings.albumArtistTf, settings.titleTf, settings.albumTf);
+}
+
+void LastfmTracker::fillTrackInfoFromTf(const metadb_handle_ptr& track, LastfmTrackInfo& out)
+{
+    const std::shared_ptr<const LastfmSettings> snapshot = lastfmSettings();
+    const LastfmSettings& settings = *snapshot;
+    recompileTfIfNeeded(settings);
+    lastfmFillTrackInfo(settings, *tf_, track, out);
 }
 
 void LastfmTracker::resetState()
@@ -486,6 +250,7 @@ void LastfmTracker::resetState()
     currentHandle.release();
     startWallclock = 0;
 
+    tagsDirty_ = false;
     resetDynamicSegmentState();
 }
 
@@ -501,13 +266,14 @@ void LastfmTracker::updateFromTrack(const metadb_handle_ptr& track)
     }
 
     fillTrackInfoFromTf(track, current);
+    tagsDirty_ = false;
 
     // Do NOT split TITLE for network streams at track-start.
     // Many streams put station info in TITLE like "Station - something" and we'd spam NP.
     if (!isCurrentStream && current.artist.empty() && !current.title.empty())
     {
         std::string a, t;
-        if (parseArtistTitleFromCombined(current.title, a, t))
+        if (lastfm::util::parseArtistTitleFromCombined(current.title, a, t))
         {
             current.artist = a;
             current.title = t;
@@ -523,16 +289,16 @@ void LastfmTracker::updateFromTrack(const metadb_handle_ptr& track)
     rules.reset(current.durationSeconds);
 }
 
-void LastfmTracker::on_playback_new_track(metadb_handle_ptr track)
+void LastfmTracker::onNewTrack(const metadb_handle_ptr& track)
 {
-    isCurrentStream = isNetworkStreamPath(track);
+    isCurrentStream = lastfm::util::isNetworkStreamPath(track.is_valid() ? track->get_path() : nullptr);
     LFM_DEBUG("Track path: " << (track->get_path() ? track->get_path() : "<null>")
                              << " stream=" << (isCurrentStream ? "yes" : "no"));
 
     // Natural boundary: submit previous track (if eligible) before switching state.
     submitDynamicPendingIfAny();
     submitScrobbleIfNeeded();
-    LastfmCore::instance().scrobbler().retryAsync();
+    output_.retryAsync();
 
     resetState();
     isPlaying = true;
@@ -553,7 +319,10 @@ void LastfmTracker::on_playback_new_track(metadb_handle_ptr track)
         return;
     }
 
-    if (lastfmOnlyScrobbleFromMediaLibrary() && !isTrackInMediaLibrary(track))
+    const std::shared_ptr<const LastfmSettings> snapshot = lastfmSettings();
+    const LastfmSettings& settings = *snapshot;
+
+    if (settings.onlyFromMediaLibrary && !isInMediaLibrary(track))
     {
         LFM_DEBUG("Track skipped: not in Media Library.");
         resetState();
@@ -567,20 +336,19 @@ void LastfmTracker::on_playback_new_track(metadb_handle_ptr track)
         return;
     }
 
-    if (lastfmIsSuspended())
+    if (settings.suspended)
         return;
 
     LFM_DEBUG("Now playing: " << current.artist.c_str() << " - " << current.title.c_str());
 
-    auto& scrobbler = LastfmCore::instance().scrobbler();
-    scrobbler.onNowPlaying(current);
+    output_.onNowPlaying(current);
 }
 
-void LastfmTracker::on_playback_time(double time)
+void LastfmTracker::onTime(double time)
 {
     playbackTime = time;
 
-    const bool suspended = lastfmIsSuspended();
+    const bool suspended = lastfmSettings()->suspended;
 
     // Policy: while suspended, freeze scrobble progress (do not count time).
     if (!suspended)
@@ -610,39 +378,33 @@ void LastfmTracker::on_playback_time(double time)
         haveLastReportedTime = false;
     }
 
-    auto& scrobbler = LastfmCore::instance().scrobbler();
-    if (currentHandle.is_valid() && (scrobbleSent || pendingDueToMissingMetadata) && !isCurrentStream)
+    // Tag edits after the threshold: only re-read when the metadb reported a change for this handle.
+    if (tagsDirty_ && currentHandle.is_valid() && (scrobbleSent || pendingDueToMissingMetadata) &&
+        !isCurrentStream)
     {
-        file_info_impl info;
-        if (currentHandle->get_info(info))
-        {
-            LastfmTrackInfo refreshed = current;
-            fillTrackInfoFromTf(currentHandle, refreshed);
-
-            std::string newArtist = refreshed.artist;
-            std::string newTitle = refreshed.title;
-            std::string newAlbum = refreshed.album;
-            std::string newAlbumArtist = refreshed.albumArtist;
+        tagsDirty_ = false;
 
-            if (newArtist != current.artist || newTitle != current.title || newAlbum != current.album ||
-                newAlbumArtist != current.albumArtist)
-            {
-                current.artist = newArtist;
-                current.title = newTitle;
-                current.album = newAlbum;
-                current.albumArtist = newAlbumArtist;
+        LastfmTrackInfo refreshed = current;
+        fillTrackInfoFromTf(currentHandle, refreshed);
 
-                if (!suspended)
-                {
-                    if (scrobbleSent)
-                        scrobbler.refreshPendingMetadata(current);
+        if (refreshed.artist != current.artist || refreshed.title != current.title ||
+            refreshed.album != current.album || refreshed.albumArtist != current.albumArtist)
+        {
+            current.artist = refreshed.artist;
+            current.title = refreshed.title;
+            current.album = refreshed.album;
+            current.albumArtist = refreshed.albumArtist;
 
-                    scrobbler.sendNowPlayingOnly(current);
-                }
+            if (!suspended)
+            {
+                if (scrobbleSent)
+                    output_.refreshPendingMetadata(current);
 
-                if (pendingDueToMissingMetadata && !current.artist.empty() && !current.title.empty())
-                    pendingDueToMissingMetadata = false;
+                output_.sendNowPlayingOnly(current);
             }
+
+            if (pendingDueToMissingMetadata && !current.artist.empty() && !current.title.empty())
+                pendingDueToMissingMetadata = false;
         }
     }
 
@@ -657,7 +419,7 @@ void LastfmTracker::on_playback_time(double time)
     submitScrobbleIfNeeded();
 }
 
-void LastfmTracker::on_playback_seek(double time)
+void LastfmTracker::onSeek(double time)
 {
     if (!isPlaying || current.durationSeconds <= 0.0)
         return;
@@ -671,17 +433,16 @@ void LastfmTracker::on_playback_seek(double time)
     }
 }
 
-void LastfmTracker::on_playback_pause(bool paused)
+void LastfmTracker::onPause(bool paused)
 {
     rules.paused = paused;
 }
 
-void LastfmTracker::on_playback_stop(play_control::t_stop_reason)
+void LastfmTracker::onStop()
 {
     submitDynamicPendingIfAny();
     submitScrobbleIfNeeded();
-    auto& scrobbler = LastfmCore::instance().scrobbler();
-    scrobbler.retryAsync();
+    output_.retryAsync();
     resetState();
 }
 
@@ -693,10 +454,13 @@ void LastfmTracker::submitScrobbleIfNeeded()
     if (!rules.shouldScrobble())
         return;
 
+    const std::shared_ptr<const LastfmSettings> snapshot = lastfmSettings();
+    const LastfmSettings& settings = *snapshot;
+
     // Policy: Only submit from Media Library
-    if (lastfmOnlyScrobbleFromMediaLibrary() && currentHandle.is_valid())
+    if (settings.onlyFromMediaLibrary && currentHandle.is_valid())
     {
-        if (!isTrackInMediaLibrary(currentHandle))
+        if (!isInMediaLibrary(currentHandle))
             return;
     }
 
@@ -710,12 +474,12 @@ void LastfmTracker::submitScrobbleIfNeeded()
     if (effectiveListenedSeconds < threshold)
         return;
 
-    // Last-moment refresh if mandatory tags look missing.
-    if (currentHandle.is_valid())
+    // Last-moment refresh if tags changed since the track started, or once if mandatory ones look missing.
+    const bool missingTags = current.artist.empty() || current.title.empty();
+    if (currentHandle.is_valid() && (tagsDirty_ || (missingTags && !pendingDueToMissingMetadata)))
     {
-        file_info_impl info;
-        if (currentHandle->get_info(info))
-            fillTrackInfoFromTf(currentHandle, current);
+        tagsDirty_ = false;
+        fillTrackInfoFromTf(currentHandle, current);
     }
 
     // If still missing after refresh, block and wait for tag update.
@@ -733,19 +497,18 @@ void LastfmTracker::submitScrobbleIfNeeded()
         return;
 
     // Eligible, but suspended -> remember and defer.
-    if (lastfmIsSuspended())
+    if (settings.suspended)
     {
         thresholdReachedButDeferred = true;
         return;
     }
 
-    if (!lastfmIsAuthenticated())
+    if (!settings.authenticated)
         return;
 
     scrobbleSent = true;
 
-    auto& scrobbler = LastfmCore::instance().scrobbler();
-    scrobbler.queueScrobble(current, playbackTime, startWallclock, /*refreshOnSubmit=*/true);
+    output_.queueScrobble(current, playbackTime, startWallclock, /*refreshOnSubmit=*/true);
 }
 
 void LastfmTracker::handleDynamicStreamUpdate(const file_info& info)
@@ -757,7 +520,9 @@ void LastfmTracker::handleDynamicStreamUpdate(const file_info& info)
     if (!isCurrentStream)
         return;
 
-    const int mode = lastfmDynamicSourcesMode();
+    const std::shared_ptr<const LastfmSettings> snapshot = lastfmSettings();
+    const LastfmSettings& settings = *snapshot;
+    const int mode = settings.dynamicSourcesMode;
     if (mode == 0)
         return;
 
@@ -766,7 +531,7 @@ void LastfmTracker::handleDynamicStreamUpdate(const file_info& info)
         return;
 
     // Generic filter: station branding etc.
-    if (looksLikeStationTitle(newTitle))
+    if (lastfm::util::looksLikeStationTitle(newTitle))
     {
         LFM_DEBUG("Stream dynamic ignored (looksLikeStationTitle): " << newTitle.c_str());
         return;
@@ -822,11 +587,9 @@ void LastfmTracker::handleDynamicStreamUpdate(const file_info& info)
     effectiveListenedSeconds = 0.0;
     haveLastReportedTime = false;
 
-    if (lastfmIsSuspended())
+    if (settings.suspended)
         return;
 
-    auto& scrobbler = LastfmCore::instance().scrobbler();
-
     // If we were waiting for dynamic metadata, this is the "start" of the stream track.
     if (pendingDueToMissingMetadata)
     {
@@ -841,7 +604,7 @@ void LastfmTracker::handleDynamicStreamUpdate(const file_info& info)
         effectiveListenedSeconds = 0.0;
         haveLastReportedTime = false;
 
-        if (lastfmDisableNowPlaying())
+        if (settings.disableNowPlaying)
         {
             LFM_DEBUG("Dynamic NP suppressed (stream start): " << current.artist.c_str() << " - "
                                                                << current.title.c_str());
@@ -850,20 +613,20 @@ void LastfmTracker::handleDynamicStreamUpdate(const file_info& info)
         {
             LFM_DEBUG("Submitting dynamic NP (stream start): " << current.artist.c_str() << " - "
                                                                << current.title.c_str());
-            scrobbler.onNowPlaying(current);
+            output_.onNowPlaying(current);
         }
         return;
     }
 
     // Otherwise it's an update / track change.
-    if (lastfmDisableNowPlaying())
+    if (settings.disableNowPlaying)
     {
         LFM_DEBUG("Dynamic NP suppressed (dynamic): " << current.artist.c_str() << " - " << current.title.c_str());
     }
     else
     {
         LFM_DEBUG("Submitting dynamic NP (dynamic): " << current.artist.c_str() << " - " << current.title.c_str());
-        scrobbler.sendNowPlayingOnly(current);
+        output_.sendNowPlayingOnly(current);
     }
 }
 
@@ -886,7 +649,7 @@ void LastfmTracker::resetDynamicSegmentState()
 void LastfmTracker::maybeCacheDynamicScrobble()
 {
     // Only cache when dynamic scrobbling is enabled (mode 2).
-    if (lastfmDynamicSourcesMode() != 2)
+    if (lastfmSettings()->dynamicSourcesMode != 2)
         return;
 
     if (!currentHandle.is_valid() || !isCurrentStream)
@@ -921,18 +684,21 @@ void LastfmTracker::submitDynamicPendingIfAny()
     if (!currentHandle.is_valid() || !isCurrentStream)
         return;
 
-    if (lastfmDynamicSourcesMode() != 2)
+    const std::shared_ptr<const LastfmSettings> snapshot = lastfmSettings();
+    const LastfmSettings& settings = *snapshot;
+
+    if (settings.dynamicSourcesMode != 2)
         return;
 
     // Keep global policy consistent. If user selected "only from Media Library", streams never scrobble.
-    if (lastfmOnlyScrobbleFromMediaLibrary())
+    if (settings.onlyFromMediaLibrary)
         return;
 
     // Do not submit while suspended; keep it cached for the next boundary after resume.
-    if (lastfmIsSuspended())
+    if (settings.suspended)
         return;
 
-    if (!lastfmIsAuthenticated())
+    if (!settings.authenticated)
         return;
 
     if (isExcludedByFilters(dynamicPendingTrack.artist, dynamicPendingTrack.title))
@@ -945,31 +711,18 @@ void LastfmTracker::submitDynamicPendingIfAny()
     dynamicSubmitted = true;
     dynamicPending = false;
 
-    auto& scrobbler = LastfmCore::instance().scrobbler();
-    scrobbler.queueScrobble(dynamicPendingTrack, dynamicPendingPlaybackTime, dynamicPendingStartWallclock,
+    output_.queueScrobble(dynamicPendingTrack, dynamicPendingPlaybackTime, dynamicPendingStartWallclock,
                             /*refreshOnSubmit=*/true);
-    scrobbler.retryAsync();
+    output_.retryAsync();
 }
 
-void LastfmTracker::on_playback_dynamic_info(const file_info& info)
+void LastfmTracker::onDynamicInfo(const file_info& info)
 {
     handleDynamicStreamUpdate(info);
 }
 
-void LastfmTracker::on_playback_dynamic_info_track(const file_info& info)
+void LastfmTracker::onTagsEdited(const metadb_handle_ptr& track)
 {
-    handleDynamicStreamUpdate(info);
+    if (track.is_valid() && track == currentHandle)
+        tagsDirty_ = true;
 }
-
-// Unused callbacks (required by interface)
-void LastfmTracker::on_playback_starting(play_control::t_track_command, bool)
-{
-}
-void LastfmTracker::on_playback_edited(metadb_handle_ptr)
-{
-}
-void LastfmTracker::on_volume_change(float)
-{
-}
-
-static play_callback_static_factory_t<LastfmTracker> lastfmTrackerFactory;
@@ -9,31 +9,39 @@
 
 #include <foobar2000/SDK/foobar2000.h>
 
+#include <cstdint>
 #include <ctime>
+#include <memory>
 #include <string>
 
 #include "lastfm_rules.h"
 #include "lastfm_track_info.h"
-#include "lastfm_prefs_pane.h"
-
-class LastfmTracker : public play_callback_static
+#include "lastfm_settings.h"
+#include "lastfm_filter.h"
+#include "lastfm_titleformat.h"
+#include "lastfm_tracker_output.h"
+
+// Scrobble bookkeeping for the playing track. Not a play_callback itself: LastfmPlaybackPipeline feeds it
+// events on its own thread, and that thread is the only one touching this object.
+class LastfmTracker
 {
   public:
-    unsigned get_flags() override;
-    void on_playback_starting(play_control::t_track_command command, bool paused) override;
-    void on_playback_new_track(metadb_handle_ptr track) override;
-    void on_playback_stop(play_control::t_stop_reason reason) override;
-    void on_playback_seek(double time) override;
-    void on_playback_pause(bool paused) override;
-    void on_playback_edited(metadb_handle_ptr track) override;
-    void on_playback_dynamic_info(const file_info& info) override;
-    void on_playback_dynamic_info_track(const file_info& info) override;
-    void on_playback_time(double time) override;
-    void on_volume_change(float volume) override;
+    explicit LastfmTracker(ILastfmTrackerOutput& output) : output_(output)
+    {
+    }
+
+    void onNewTrack(const metadb_handle_ptr& track);
+    void onStop();
+    void onSeek(double time);
+    void onPause(bool paused);
+    void onTime(double time);
+    // Tags of `track` changed (metadb notification or playback edit).
+    void onTagsEdited(const metadb_handle_ptr& track);
+    void onDynamicInfo(const file_info& info);
 
   private:
     void fillTrackInfoFromTf(const metadb_handle_ptr& track, LastfmTrackInfo& out);
-    void recompileTfIfNeeded();
+    void recompileTfIfNeeded(const LastfmSettings& settings);
     void resetState();
     void submitScrobbleIfNeeded();
     void updateFromTrack(const metadb_handle_ptr& track);
@@ -58,19 +66,15 @@ class LastfmTracker : public play_callback_static
     // Track became eligible while suspended; defer submission until stop/new-track boundary.
     bool thresholdReachedButDeferred = false;
 
+    ILastfmTrackerOutput& output_;
+
     metadb_handle_ptr currentHandle;
     LastfmRules rules;
 
-    service_ptr_t<titleformat_object> artistTf_;
-    service_ptr_t<titleformat_object> albumArtistTf_;
-    service_ptr_t<titleformat_object> titleTf_;
-    service_ptr_t<titleformat_object> albumTf_;
-    service_ptr_t<titleformat_object> fallbackArtistTf_;
+    bool tagsDirty_ = false; // currentHandle's tags changed since they were last read
 
-    std::string cachedArtistTfExpr_;
-    std::string cachedAlbumArtistTfExpr_;
-    std::string cachedTitleTfExpr_;
-    std::string cachedAlbumTfExpr_;
+    std::shared_ptr<const LastfmTitleformatSet> tf_;
+    std::uint64_t cachedTfSettingsVersion_ = 0;
 
     // Dynamic stream scrobble (network sources only)
     bool dynamicActive = false;
@@ -89,3 +93,15 @@ class LastfmTracker : public play_callback_static
     void maybeCacheDynamicScrobble();
     void submitDynamicPendingIfAny();
 };
+
+// Artist, album artist, title and album of `track` as the tracker reads them: the settings' expressions
+// (compiled into `tf`) plus the Various Artists rule. Thread-safe; the library backfill runs it on many threads.
+void lastfmFillTrackInfo(const LastfmSettings& settings, const LastfmTitleformatSet& tf, const metadb_handle_ptr& track,
+                         LastfmTrackInfo& out);
+
+// The tracker's artist / title exclusion filters, evaluated directly: bulk scans would only push the tracks
+// played recently out of the decision cache.
+bool lastfmIsExcludedByFilters(const LastfmSettings& settings, const std::string& artist, const std::string& title);
+
+// Exclusion-filter decision cache counters (instrumentation).
+LastfmFilterDecisionCache::Stats lastfmFilterDecisionStats();
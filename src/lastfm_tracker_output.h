@@ -0,0 +1,27 @@
+//
+//  lastfm_tracker_output.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <ctime>
+
+#include "lastfm_track_info.h"
+
+// Everything LastfmTracker decides ends up as one of these calls. Implemented by LastfmScrobbler;
+// the trace replay tool substitutes a recorder.
+class ILastfmTrackerOutput
+{
+  public:
+    virtual ~ILastfmTrackerOutput() = default;
+
+    virtual void onNowPlaying(const LastfmTrackInfo& track) = 0;
+    virtual void sendNowPlayingOnly(const LastfmTrackInfo& track) = 0;
+    virtual void refreshPendingMetadata(const LastfmTrackInfo& track) = 0;
+    virtual void queueScrobble(const LastfmTrackInfo& track, double playbackSeconds, std::time_t startWallclock,
+                               bool refreshOnSubmit) = 0;
+    virtual void retryAsync() = 0;
+};
@@ -8,20 +8,13 @@
 #include "lastfm_ui.h"
 #include "lastfm_state.h"
 #include "lastfm_prefs_pane_state.h"
+#include "lastfm_settings.h"
 
-#include <foobar2000/SDK/advconfig.h>
 #include <foobar2000/SDK/foobar2000.h>
 
-// Reuse the exact GUID from lastfm_prefs_pane.cpp:
-static const GUID GUID_LASTFM_PREFS_CHECKBOX_0 = {
-    0x290f410b, 0x7c8d, 0x45b7, {0x8b, 0x2e, 0x8d, 0xd4, 0xf9, 0x41, 0x5a, 0x82}};
-
 bool lastfmDisableNowplaying()
 {
-    service_ptr_t<advconfig_entry_checkbox> e;
-    if (!advconfig_entry::g_find_t(e, GUID_LASTFM_PREFS_CHECKBOX_0))
-        return false; // default = enabled
-    return e->get_state();
+    return lastfmSettings()->disableNowPlaying;
 }
 
 LastfmAuthState getAuthState()
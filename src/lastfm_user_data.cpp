@@ -0,0 +1,486 @@
+//
+//  lastfm_user_data.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "lastfm_user_data.h"
+#include "lastfm_util.h"
+#include "debug.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+namespace
+{
+static constexpr char K_MAGIC[7] = {'L', 'F', 'M', 'U', 'D', 'A', 'T'};
+static constexpr std::uint8_t K_VERSION = 1;
+
+// Sanity limit for the stored username.
+static constexpr std::uint64_t K_MAX_USERNAME = 256;
+
+static void putVarint(std::string& out, std::uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+static bool getVarint(const std::string& in, std::size_t& pos, std::uint64_t& v)
+{
+    v = 0;
+    for (unsigned shift = 0; shift < 64 && pos < in.size(); shift += 7)
+    {
+        const auto b = static_cast<std::uint8_t>(in[pos++]);
+        v |= static_cast<std::uint64_t>(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+static std::uint32_t wallSeconds(std::time_t t)
+{
+    return t > 0 ? static_cast<std::uint32_t>(std::min<std::time_t>(t, 0xffffffffu)) : 0;
+}
+} // namespace
+
+LastfmUserDataCache::LastfmUserDataCache(std::size_t capacity, std::time_t ttlSeconds)
+    : capacity_(std::max<std::size_t>(1, std::min<std::size_t>(capacity, NIL - 1))), ttl_(ttlSeconds)
+{
+}
+
+std::uint64_t LastfmUserDataCache::key(const std::string& artist, const std::string& title)
+{
+    return lastfm::util::trackKey(artist, title);
+}
+
+void LastfmUserDataCache::unlinkLocked(std::uint32_t i)
+{
+    Node& n = nodes_[i];
+    if (n.prev != NIL)
+        nodes_[n.prev].next = n.next;
+    else
+        head_ = n.next;
+    if (n.next != NIL)
+        nodes_[n.next].prev = n.prev;
+    else
+        tail_ = n.prev;
+    n.prev = n.next = NIL;
+}
+
+void LastfmUserDataCache::pushFrontLocked(std::uint32_t i)
+{
+    Node& n = nodes_[i];
+    n.prev = NIL;
+    n.next = head_;
+    if (head_ != NIL)
+        nodes_[head_].prev = i;
+    head_ = i;
+    if (tail_ == NIL)
+        tail_ = i;
+}
+
+LastfmUserDataCache::Lookup LastfmUserDataCache::lookup(std::uint64_t key, std::time_t now, LastfmTrackUserData& out)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = index_.find(key);
+    if (it == index_.end())
+        return Lookup::MISS;
+
+    const std::uint32_t i = it->second;
+    if (head_ != i)
+    {
+        unlinkLocked(i);
+        pushFrontLocked(i);
+    }
+
+    const Node& n = nodes_[i];
+    out = n.data;
+    return static_cast<std::time_t>(n.fetched) + ttl_ > now ? Lookup::FRESH : Lookup::STALE;
+}
+
+bool LastfmUserDataCache::isFresh(std::uint64_t key, std::time_t now) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = index_.find(key);
+    return it != index_.end() && static_cast<std::time_t>(nodes_[it->second].fetched) + ttl_ > now;
+}
+
+void LastfmUserDataCache::store(std::uint64_t key, const LastfmTrackUserData& data, std::time_t now)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    storeLocked(key, data, wallSeconds(now));
+}
+
+void LastfmUserDataCache::storeLocked(std::uint64_t key, const LastfmTrackUserData& data, std::uint32_t fetched)
+{
+    std::uint32_t i = NIL;
+    const auto it = index_.find(key);
+    if (it != index_.end())
+    {
+        i = it->second;
+        unlinkLocked(i);
+    }
+    else if (nodes_.size() < capacity_)
+    {
+        i = static_cast<std::uint32_t>(nodes_.size());
+        nodes_.emplace_back();
+        index_.emplace(key, i);
+    }
+    else
+    {
+        // Full: the least recently used node takes the new key.
+        i = tail_;
+        unlinkLocked(i);
+        index_.erase(nodes_[i].key);
+        index_.emplace(key, i);
+    }
+
+    Node& n = nodes_[i];
+    n.key = key;
+    n.data = data;
+    n.fetched = fetched;
+    pushFrontLocked(i);
+}
+
+void LastfmUserDataCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    nodes_.clear();
+    index_.clear();
+    head_ = tail_ = NIL;
+}
+
+std::size_t LastfmUserDataCache::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return nodes_.size();
+}
+
+bool LastfmUserDataCache::load(const std::string& path, const std::string& username, std::string& error)
+{
+    clear();
+
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f)
+    {
+        if (errno == ENOENT)
+            return true; // first run
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    std::string in;
+    char buf[64 * 1024];
+    std::size_t n = 0;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0)
+        in.append(buf, n);
+    std::fclose(f);
+
+    std::size_t pos = sizeof(K_MAGIC) + 1;
+    if (in.size() < pos || std::memcmp(in.data(), K_MAGIC, sizeof(K_MAGIC)) != 0 ||
+        static_cast<std::uint8_t>(in[sizeof(K_MAGIC)]) != K_VERSION)
+    {
+        LFM_INFO("User data cache: " << path.c_str() << " is not a cache file, starting empty");
+        return true;
+    }
+
+    std::uint64_t len = 0;
+    if (!getVarint(in, pos, len) || len > K_MAX_USERNAME || len > in.size() - pos ||
+        in.compare(pos, static_cast<std::size_t>(len), username) != 0 || len != username.size())
+    {
+        LFM_DEBUG("User data cache: written for another user, starting empty");
+        return true;
+    }
+    pos += static_cast<std::size_t>(len);
+
+    std::uint64_t count = 0;
+    if (!getVarint(in, pos, count))
+        return true;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    nodes_.reserve(static_cast<std::size_t>(std::min<std::uint64_t>(count, capacity_)));
+
+    // Oldest first, so the last one read ends up most recently used.
+    for (std::uint64_t e = 0; e < count; ++e)
+    {
+        if (in.size() - pos < 8)
+            break;
+        std::uint64_t key = 0;
+        for (int b = 0; b < 8; ++b)
+            key |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(in[pos++])) << (8 * b);
+
+        std::uint64_t playcount = 0;
+        std::uint64_t fetched = 0;
+        if (!getVarint(in, pos, playcount) || pos >= in.size())
+            break;
+        const bool loved = in[pos++] != 0;
+        if (!getVarint(in, pos, fetched))
+            break;
+
+        LastfmTrackUserData d;
+        d.playcount = static_cast<std::uint32_t>(std::min<std::uint64_t>(playcount, 0xffffffffu));
+        d.loved = loved;
+        storeLocked(key, d, static_cast<std::uint32_t>(std::min<std::uint64_t>(fetched, 0xffffffffu)));
+    }
+
+    LFM_DEBUG("User data cache: " << (unsigned)nodes_.size() << " entries loaded");
+    return true;
+}
+
+bool LastfmUserDataCache::save(const std::string& path, const std::string& username, std::string& error) const
+{
+    std::string out(K_MAGIC, sizeof(K_MAGIC));
+    out.push_back(static_cast<char>(K_VERSION));
+    putVarint(out, username.size());
+    out += username;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        out.reserve(out.size() + nodes_.size() * 16 + 10);
+        putVarint(out, nodes_.size());
+        for (std::uint32_t i = tail_; i != NIL; i = nodes_[i].prev)
+        {
+            const Node& n = nodes_[i];
+            for (int b = 0; b < 8; ++b)
+                out.push_back(static_cast<char>((n.key >> (8 * b)) & 0xff));
+            putVarint(out, n.data.playcount);
+            out.push_back(n.data.loved ? 1 : 0);
+            putVarint(out, n.fetched);
+        }
+    }
+
+    // Written next to the old file and renamed over it, so a crash leaves one or the other.
+    const std::string tmp = path + ".tmp";
+    std::FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f)
+    {
+        error = "cannot create " + tmp + ": " + std::strerror(errno);
+        return false;
+    }
+    const bool written = std::fwrite(out.data(), 1, out.size(), f) == out.size();
+    const bool closed = std::fclose(f) == 0;
+    if (!written || !closed || std::rename(tmp.c_str(), path.c_str()) != 0)
+    {
+        error = "cannot write " + path + ": " + std::strerror(errno);
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+LastfmUserDataPrefetcher::LastfmUserDataPrefetcher(LastfmUserDataCache& cache, Fetch fetch, Config cfg,
+                                                   ILastfmClock& clock)
+    : cache_(cache), fetch_(std::move(fetch)), cfg_(std::move(cfg)), clock_(clock)
+{
+}
+
+LastfmUserDataPrefetcher::~LastfmUserDataPrefetcher()
+{
+    stop();
+}
+
+void LastfmUserDataPrefetcher::start()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (thread_.joinable())
+        return;
+    stopping_ = false;
+    thread_ = std::thread([this] { threadMain(); });
+}
+
+void LastfmUserDataPrefetcher::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    clock_.notify(cv_);
+
+    if (thread_.joinable())
+        thread_.join();
+}
+
+bool LastfmUserDataPrefetcher::request(std::uint64_t key, const std::string& artist, const std::string& title)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_)
+            return false;
+        if (pendingKeys_.count(key) != 0)
+            return true;
+        if (requests_.size() >= cfg_.maxPending)
+            return false;
+        pendingKeys_.insert(key);
+        requests_.push_back(Request{key, artist, title});
+    }
+    clock_.notify(cv_);
+    return true;
+}
+
+void LastfmUserDataPrefetcher::clearPending()
+{
+    std::vector<std::uint64_t> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Queued and in-flight keys alike; the round in progress then reports none of its own.
+        dropped.assign(pendingKeys_.begin(), pendingKeys_.end());
+        requests_.clear();
+        pendingKeys_.clear();
+        ++epoch_;
+    }
+    reportDropped(dropped);
+}
+
+void LastfmUserDataPrefetcher::reportDropped(const std::vector<std::uint64_t>& keys) const
+{
+    if (!keys.empty() && cfg_.onDropped)
+        cfg_.onDropped(keys);
+}
+
+std::size_t LastfmUserDataPrefetcher::pending() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return requests_.size();
+}
+
+bool LastfmUserDataPrefetcher::sleepFor(std::chrono::milliseconds d)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    clock_.waitUntil(lock, cv_, clock_.now() + d, [this] { return stopping_; });
+    return !stopping_;
+}
+
+void LastfmUserDataPrefetcher::threadMain()
+{
+    std::vector<Request> batch;
+    std::vector<std::uint64_t> resolved;
+    std::vector<std::uint64_t> dropped;
+    ILastfmClock::SteadyTime lastFetch = ILastfmClock::SteadyTime::min();
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            clock_.waitUntil(lock, cv_, ILastfmClock::SteadyTime::max(),
+                             [this] { return stopping_ || !requests_.empty(); });
+            if (stopping_)
+                return;
+        }
+
+        // Shared cooldown first, then let due scrobbles go out before any lookups.
+        const std::time_t blocked = cfg_.blockedUntil ? cfg_.blockedUntil() : 0;
+        const std::time_t now = clock_.wallNow();
+        if (blocked > now)
+        {
+            if (!sleepFor(std::chrono::seconds(blocked - now)))
+                return;
+            continue;
+        }
+        if (cfg_.busy && cfg_.busy())
+        {
+            if (!sleepFor(cfg_.busyPause))
+                return;
+            continue;
+        }
+
+        batch.clear();
+        std::uint64_t epoch = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            epoch = epoch_;
+            while (!requests_.empty() && batch.size() < cfg_.batchSize)
+            {
+                batch.push_back(std::move(requests_.back()));
+                requests_.pop_back();
+            }
+        }
+
+        resolved.clear();
+        dropped.clear();
+        bool rateLimited = false;
+        std::size_t done = 0;
+        for (; done < batch.size(); ++done)
+        {
+            const Request& r = batch[done];
+            if (cache_.isFresh(r.key, clock_.wallNow()))
+            {
+                resolved.push_back(r.key);
+                continue;
+            }
+
+            const ILastfmClock::SteadyTime due = lastFetch == ILastfmClock::SteadyTime::min()
+                                                     ? lastFetch
+                                                     : lastFetch + cfg_.minSpacing;
+            const ILastfmClock::SteadyTime steadyNow = clock_.now();
+            if (due > steadyNow &&
+                !sleepFor(std::chrono::duration_cast<std::chrono::milliseconds>(due - steadyNow)))
+                return;
+
+            LastfmTrackUserData data;
+            const LastfmScrobbleResult res = fetch_(r.artist, r.title, data);
+            lastFetch = clock_.now();
+            if (res == LastfmScrobbleResult::RATE_LIMITED)
+            {
+                rateLimited = true;
+                break;
+            }
+            if (res == LastfmScrobbleResult::TEMPORARY_ERROR || res == LastfmScrobbleResult::INVALID_SESSION)
+            {
+                dropped.push_back(r.key); // asked again the next time the row is drawn
+                continue;
+            }
+
+            // OTHER_ERROR is an unknown track: cached as never played, so it is not asked for again until the TTL.
+            // Stored under the lock, so a user change either comes after it (and clears the cache) or before it
+            // (and the previous user's answer is discarded).
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (epoch == epoch_)
+            {
+                cache_.store(r.key, data, clock_.wallNow());
+                resolved.push_back(r.key);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (epoch == epoch_)
+            {
+                // Unsent requests go back to the newest end, in their original order (batch[done] was the newest),
+                // to be retried after the cooldown.
+                const std::size_t sent = rateLimited ? done : batch.size();
+                for (std::size_t i = batch.size(); i-- > sent;)
+                    requests_.push_back(std::move(batch[i]));
+                for (std::size_t i = 0; i < sent; ++i)
+                    pendingKeys_.erase(batch[i].key);
+            }
+            else
+            {
+                // clearPending() already reported this round's keys.
+                resolved.clear();
+                dropped.clear();
+            }
+        }
+
+        if (!resolved.empty() && cfg_.onResolved)
+            cfg_.onResolved(resolved);
+        reportDropped(dropped);
+
+        if (rateLimited)
+        {
+            LFM_INFO("User data: rate limited, " << (unsigned)pending() << " lookup(s) wait for the cooldown.");
+            if (cfg_.onRateLimited)
+                cfg_.onRateLimited();
+            if (!cfg_.blockedUntil && !sleepFor(cfg_.rateLimitPause))
+                return;
+        }
+    }
+}
@@ -0,0 +1,170 @@
+//
+//  lastfm_user_data.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "lastfm_clock.h"
+#include "lastfm_scrobble_result.h"
+
+// What Last.fm knows about the user and one track (track.getInfo with username).
+struct LastfmTrackUserData
+{
+    std::uint32_t playcount = 0;
+    bool loved = false;
+};
+
+// LRU cache of LastfmTrackUserData with a time to live. Entries past it are still served (stale) so a playlist
+// never renders empty while a refresh is on its way. Saved to and loaded from a small binary file, tagged with
+// the user it belongs to.
+class LastfmUserDataCache
+{
+  public:
+    enum class Lookup
+    {
+        FRESH,
+        STALE,
+        MISS,
+    };
+
+    static constexpr std::size_t DEFAULT_CAPACITY = 100000;
+    static constexpr std::time_t DEFAULT_TTL_SECONDS = 24 * 3600;
+
+    explicit LastfmUserDataCache(std::size_t capacity = DEFAULT_CAPACITY,
+                                 std::time_t ttlSeconds = DEFAULT_TTL_SECONDS);
+
+    // Last.fm matches artist and title case-insensitively; so does the key.
+    static std::uint64_t key(const std::string& artist, const std::string& title);
+
+    // Marks the entry most recently used.
+    Lookup lookup(std::uint64_t key, std::time_t now, LastfmTrackUserData& out);
+    bool isFresh(std::uint64_t key, std::time_t now) const;
+    void store(std::uint64_t key, const LastfmTrackUserData& data, std::time_t now);
+    void clear();
+    std::size_t size() const;
+
+    // A file written for another user (or not a cache file) loads as empty.
+    bool load(const std::string& path, const std::string& username, std::string& error);
+    bool save(const std::string& path, const std::string& username, std::string& error) const;
+
+  private:
+    static constexpr std::uint32_t NIL = 0xffffffffu;
+
+    struct Node
+    {
+        std::uint64_t key = 0;
+        LastfmTrackUserData data;
+        std::uint32_t fetched = 0; // unix seconds
+        std::uint32_t prev = NIL;  // towards most recently used
+        std::uint32_t next = NIL;
+    };
+
+    void unlinkLocked(std::uint32_t i);
+    void pushFrontLocked(std::uint32_t i);
+    void storeLocked(std::uint64_t key, const LastfmTrackUserData& data, std::uint32_t fetched);
+
+    const std::size_t capacity_;
+    const std::time_t ttl_;
+
+    mutable std::mutex mutex_;
+    std::vector<Node> nodes_;
+    std::unordered_map<std::uint64_t, std::uint32_t> index_;
+    std::uint32_t head_ = NIL; // most recently used
+    std::uint32_t tail_ = NIL;
+};
+
+// Resolves cache misses in the background, newest request first (the rows on screen now beat the ones scrolled
+// past). Requests are deduplicated while pending and bounded in number. Each round sends up to batchSize
+// track.getInfo calls spaced by minSpacing and then reports the keys it resolved in one onResolved call, so the
+// UI refreshes once per round rather than once per track. Keys given up on (failed lookups, requests cleared on a
+// user change) go to onDropped instead; every accepted request ends in exactly one of the two.
+//
+// Rate control is shared with the scrobble queue: the prefetcher sleeps while blockedUntil() is in the future or
+// busy() says scrobbles are waiting, and reports its own rate-limit answers through onRateLimited() so the
+// queue backs off too.
+class LastfmUserDataPrefetcher
+{
+  public:
+    using Fetch = std::function<LastfmScrobbleResult(const std::string& artist, const std::string& title,
+                                                     LastfmTrackUserData& out)>;
+
+    struct Config
+    {
+        std::size_t maxPending;
+        std::size_t batchSize;
+        std::chrono::milliseconds minSpacing;
+        std::chrono::milliseconds busyPause;
+        std::chrono::milliseconds rateLimitPause; // when there is no blockedUntil to follow
+        std::function<std::time_t()> blockedUntil;
+        std::function<bool()> busy;
+        std::function<void()> onRateLimited;
+        std::function<void(const std::vector<std::uint64_t>& keys)> onResolved;
+        std::function<void(const std::vector<std::uint64_t>& keys)> onDropped;
+
+        Config() noexcept
+            : maxPending(5000), batchSize(25), minSpacing(250), busyPause(2000), rateLimitPause(6 * 60 * 1000)
+        {
+        }
+    };
+
+    LastfmUserDataPrefetcher(LastfmUserDataCache& cache, Fetch fetch, Config cfg = Config(),
+                             ILastfmClock& clock = lastfmSystemClock());
+    ~LastfmUserDataPrefetcher();
+
+    LastfmUserDataPrefetcher(const LastfmUserDataPrefetcher&) = delete;
+    LastfmUserDataPrefetcher& operator=(const LastfmUserDataPrefetcher&) = delete;
+
+    void start();
+    void stop(); // idempotent, joins the thread
+
+    // Thread-safe and cheap. True when a fetch of the key is queued or already under way; false when the backlog
+    // is full or the prefetcher is stopping.
+    bool request(std::uint64_t key, const std::string& artist, const std::string& title);
+
+    // Drops everything not fetched yet (user change). The round in progress stores nothing more.
+    void clearPending();
+
+    std::size_t pending() const;
+
+  private:
+    struct Request
+    {
+        std::uint64_t key = 0;
+        std::string artist;
+        std::string title;
+    };
+
+    void threadMain();
+    bool sleepFor(std::chrono::milliseconds d); // false when stopping
+    void reportDropped(const std::vector<std::uint64_t>& keys) const;
+
+    LastfmUserDataCache& cache_;
+    Fetch fetch_;
+    Config cfg_;
+    ILastfmClock& clock_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Request> requests_;
+    std::unordered_set<std::uint64_t> pendingKeys_; // queued or in the round in progress
+    std::uint64_t epoch_ = 0;                       // bumped by clearPending()
+    bool stopping_ = false;
+    std::thread thread_;
+};
@@ -0,0 +1,162 @@
+//
+//  lastfm_user_data_fields.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "lastfm_user_data_fields.h"
+#include "lastfm_core.h"
+#include "lastfm_settings.h"
+#include "lastfm_titleformat.h"
+
+#include <foobar2000/SDK/foobar2000.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace
+{
+static constexpr std::size_t K_MAX_WAITING_KEYS = 5000;   // same bound as the prefetcher backlog
+static constexpr std::size_t K_MAX_WAITING_PER_KEY = 16;  // one track shown in a few playlists
+
+enum : t_uint32
+{
+    FIELD_PLAYCOUNT,
+    FIELD_LOVED,
+    FIELD_COUNT,
+};
+
+static const char* const K_FIELD_NAMES[FIELD_COUNT] = {"lastfm_playcount", "lastfm_loved"};
+
+// Handles drawn while their entry was being fetched, by cache key. The prefetcher reports every key it was asked
+// for, resolved or dropped; the bound only guards against a report racing the insert.
+static std::mutex g_waitingMutex;
+static std::unordered_map<std::uint64_t, std::vector<metadb_handle_ptr>> g_waiting;
+
+static void addWaiting(std::uint64_t key, metadb_handle* handle)
+{
+    std::lock_guard<std::mutex> lock(g_waitingMutex);
+    auto it = g_waiting.find(key);
+    if (it == g_waiting.end())
+    {
+        if (g_waiting.size() >= K_MAX_WAITING_KEYS)
+            g_waiting.erase(g_waiting.begin()); // its tracks miss one redraw
+        it = g_waiting.emplace(key, std::vector<metadb_handle_ptr>()).first;
+    }
+
+    auto& handles = it->second;
+    if (handles.size() >= K_MAX_WAITING_PER_KEY)
+        return;
+    for (const auto& h : handles)
+        if (h.get_ptr() == handle)
+            return;
+    handles.push_back(metadb_handle_ptr(handle));
+}
+
+// Artist and title as scrobbled, through the user's expressions.
+static bool scrobbleArtistTitle(metadb_handle* handle, std::string& artist, std::string& title)
+{
+    // The user's expressions may reference our own fields; those evaluate empty instead of recursing.
+    thread_local bool evaluating = false;
+    if (evaluating)
+        return false;
+
+    const std::shared_ptr<const LastfmSettings> snapshot = lastfmSettings();
+    const LastfmSettings& settings = *snapshot;
+    thread_local std::uint64_t cachedVersion = 0;
+    thread_local std::shared_ptr<const LastfmTitleformatSet> tf;
+    if (!tf || cachedVersion != settings.version)
+    {
+        tf = LastfmTitleformatSet::get(settings.artistTf, settings.albumArtistTf, settings.titleTf, settings.albumTf);
+        cachedVersion = settings.version;
+    }
+
+    LastfmTfFields fields;
+    evaluating = true;
+    tf->evaluate(metadb_handle_ptr(handle), fields);
+    evaluating = false;
+
+    artist = std::move(fields.artist);
+    title = std::move(fields.title);
+    return !artist.empty() && !title.empty();
+}
+
+class LastfmUserDataFieldProvider : public metadb_display_field_provider
+{
+  public:
+    t_uint32 get_field_count() override
+    {
+        return FIELD_COUNT;
+    }
+
+    void get_field_name(t_uint32 index, pfc::string_base& out) override
+    {
+        out = index < FIELD_COUNT ? K_FIELD_NAMES[index] : "";
+    }
+
+    bool process_field(t_uint32 index, metadb_handle* handle, titleformat_text_out* out) override
+    {
+        if (index >= FIELD_COUNT || !handle || !lastfmSettings()->authenticated)
+            return false;
+
+        std::string artist;
+        std::string title;
+        if (!scrobbleArtistTitle(handle, artist, title))
+            return false;
+
+        LastfmTrackUserData data;
+        bool fetching = false;
+        const auto found = LastfmCore::instance().scrobbler().trackUserData(artist, title, data, fetching);
+        if (fetching)
+            addWaiting(LastfmUserDataCache::key(artist, title), handle);
+        if (found == LastfmUserDataCache::Lookup::MISS)
+            return false;
+
+        if (index == FIELD_LOVED)
+        {
+            // Boolean field: true when loved, false (and empty) otherwise, so [%lastfm_loved%] works.
+            if (!data.loved)
+                return false;
+            out->write(titleformat_inputtypes::meta, "1");
+            return true;
+        }
+
+        const std::string text = std::to_string(data.playcount);
+        out->write(titleformat_inputtypes::meta, text.c_str(), text.size());
+        return true;
+    }
+};
+
+static service_factory_single_t<LastfmUserDataFieldProvider> g_userDataFieldProvider;
+} // namespace
+
+void lastfmUserDataFieldsResolved(const std::vector<std::uint64_t>& keys)
+{
+    metadb_handle_list refresh;
+    {
+        std::lock_guard<std::mutex> lock(g_waitingMutex);
+        for (std::uint64_t key : keys)
+        {
+            auto it = g_waiting.find(key);
+            if (it == g_waiting.end())
+                continue;
+            for (const auto& h : it->second)
+                refresh.add_item(h);
+            g_waiting.erase(it);
+        }
+    }
+
+    if (refresh.get_count() == 0)
+        return;
+
+    fb2k::inMainThread([refresh] { metadb_io::get()->dispatch_refresh(refresh); });
+}
+
+void lastfmUserDataFieldsDropped(const std::vector<std::uint64_t>& keys)
+{
+    std::lock_guard<std::mutex> lock(g_waitingMutex);
+    for (std::uint64_t key : keys)
+        g_waiting.erase(key);
+}
@@ -0,0 +1,20 @@
+//
+//  lastfm_user_data_fields.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Titleformat fields %lastfm_playcount% and %lastfm_loved%, answered from the scrobbler's user data cache.
+
+// Called by the prefetcher after each round: tracks drawn while their entry was missing or stale are refreshed
+// (one metadb refresh for the round, on the main thread).
+void lastfmUserDataFieldsResolved(const std::vector<std::uint64_t>& keys);
+
+// Called for keys the prefetcher gave up on: their tracks are forgotten until drawn again.
+void lastfmUserDataFieldsDropped(const std::vector<std::uint64_t>& keys);
@@ -6,35 +6,20 @@
 //
 
 #include "lastfm_util.h"
-#include "debug.h"
 
+#if defined(__APPLE__)
 #include <CommonCrypto/CommonDigest.h>
+#endif
 
 #include <string>
 #include <cctype>
+#include <cstdint>
 #include <cstring>
 
 namespace lastfm
 {
 namespace util
 {
-static std::string redact_url_for_log(const char* url)
-{
-    if (!url)
-        return "(null)";
-
-    std::string s(url);
-
-    // If there's a query, don't log it.
-    auto q = s.find('?');
-    if (q != std::string::npos)
-    {
-        s.resize(q);
-        s += "?<redacted>";
-    }
-    return s;
-}
-
 std::string cleanTagValue(const char* value)
 {
     if (!value)
@@ -66,10 +51,221 @@ std::string cleanTagValue(const char* value)
     return s;
 }
 
+bool isNetworkStreamPath(const char* p)
+{
+    if (!p)
+        return false;
+
+    // Be strict: foobar can use pseudo-schemes like foo:// for local container tracks (ISO, etc).
+    // We only treat real network stream schemes as "stream".
+    return (std::strncmp(p, "http://", 7) == 0) || (std::strncmp(p, "https://", 8) == 0) ||
+           (std::strncmp(p, "mms://", 6) == 0) || (std::strncmp(p, "rtsp://", 7) == 0) ||
+           (std::strncmp(p, "icy://", 6) == 0);
+}
+
+bool looksLikeStationTitle(const std::string& title)
+{
+    if (title.empty())
+        return true;
+
+    // long sentences / slogans / blurbs / bs
+    if (title.size() > 80)
+        return true;
+
+    int alpha = 0;
+    int spaces = 0;
+
+    bool hasBracket = false;
+    bool hasUrl = false;
+
+    std::string norm;
+    norm.reserve(title.size());
+
+    for (unsigned char c : title)
+    {
+        const char lc = (char)std::tolower(c);
+        norm.push_back(lc);
+
+        if (std::isalpha(c))
+            ++alpha;
+        else if (std::isspace(c))
+            ++spaces;
+
+        if (c == '[' || c == ']')
+            hasBracket = true;
+    }
+
+    if (norm.find("http") != std::string::npos || norm.find("www.") != std::string::npos)
+        hasUrl = true;
+
+    if (alpha < 3)
+        return true;
+
+    if (hasBracket)
+        return true;
+
+    if (spaces > (int)title.size() / 3)
+        return true;
+
+    if (hasUrl)
+        return true;
+
+    return false;
+}
+
+bool parseArtistTitleFromCombined(const std::string& combined, std::string& artist, std::string& title)
+{
+    const char* seps[] = {" - ", " – ", " — ", ": "};
+    for (const char* sep : seps)
+    {
+        const std::size_t pos = combined.find(sep);
+        if (pos == std::string::npos)
+            continue;
+
+        const std::string left = combined.substr(0, pos);
+        const std::string right = combined.substr(pos + std::strlen(sep));
+
+        artist = cleanTagValue(left.c_str());
+        title = cleanTagValue(right.c_str());
+
+        if (artist.empty() || title.empty())
+            continue;
+
+        if (looksLikeStationTitle(title))
+            continue;
+
+        return true;
+    }
+    return false;
+}
+
+#if !defined(__APPLE__)
+// RFC 1321, for builds without CommonCrypto.
+static constexpr int CC_MD5_DIGEST_LENGTH = 16;
+
+std::uint64_t playKey(std::time_t startTimestamp, const std::string& artist, const std::string& title)
+{
+    constexpr std::uint64_t FNV_OFFSET = 0xcbf29ce484222325ull;
+    constexpr std::uint64_t FNV_PRIME = 0x100000001b3ull;
+
+    std::uint64_t h = FNV_OFFSET;
+    std::uint64_t t = static_cast<std::uint64_t>(startTimestamp);
+    for (int i = 0; i < 8; ++i, t >>= 8)
+        h = (h ^ (t & 0xffu)) * FNV_PRIME;
+    // 0xff cannot occur in UTF-8, so "a" + "bc" and "ab" + "c" stay apart.
+    for (unsigned char c : artist)
+        h = (h ^ c) * FNV_PRIME;
+    h = (h ^ 0xffu) * FNV_PRIME;
+    for (unsigned char c : title)
+        h = (h ^ c) * FNV_PRIME;
+    return h;
+}
+
+std::uint64_t trackKey(const std::string& artist, const std::string& title)
+{
+    constexpr std::uint64_t FNV_OFFSET = 0xcbf29ce484222325ull;
+    constexpr std::uint64_t FNV_PRIME = 0x100000001b3ull;
+
+    std::uint64_t h = FNV_OFFSET;
+    for (char c : artist)
+        h = (h ^ static_cast<unsigned char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c)) * FNV_PRIME;
+    h = (h ^ 0xffu) * FNV_PRIME;
+    for (char c : title)
+        h = (h ^ static_cast<unsigned char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c)) * FNV_PRIME;
+    return h;
+}
+
+static void md5Digest(const void* data, std::size_t len, unsigned char* digest)
+{
+    static const std::uint32_t K[64] = {
+        0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+        0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+        0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+        0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+        0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+        0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+        0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+        0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+    static const int R[64] = {7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+                              5, 9,  14, 20, 5, 9,  14, 20, 5, 9,  14, 20, 5, 9,  14, 20,
+                              4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+                              6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21};
+
+    std::uint32_t h[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+
+    // Message + 0x80 + zero padding + 64-bit little-endian bit length, in 64-byte blocks.
+    std::string msg(static_cast<const char*>(data), len);
+    msg.push_back(static_cast<char>(0x80));
+    while (msg.size() % 64 != 56)
+        msg.push_back('\0');
+    const std::uint64_t bits = static_cast<std::uint64_t>(len) * 8;
+    for (int i = 0; i < 8; ++i)
+        msg.push_back(static_cast<char>((bits >> (8 * i)) & 0xFF));
+
+    for (std::size_t off = 0; off < msg.size(); off += 64)
+    {
+        std::uint32_t w[16];
+        for (int i = 0; i < 16; ++i)
+        {
+            const unsigned char* b = reinterpret_cast<const unsigned char*>(msg.data() + off + i * 4);
+            w[i] = static_cast<std::uint32_t>(b[0]) | (static_cast<std::uint32_t>(b[1]) << 8) |
+                   (static_cast<std::uint32_t>(b[2]) << 16) | (static_cast<std::uint32_t>(b[3]) << 24);
+        }
+
+        std::uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+        for (int i = 0; i < 64; ++i)
+        {
+            std::uint32_t f;
+            int g;
+            if (i < 16)
+            {
+                f = (b & c) | (~b & d);
+                g = i;
+            }
+            else if (i < 32)
+            {
+                f = (d & b) | (~d & c);
+                g = (5 * i + 1) % 16;
+            }
+            else if (i < 48)
+            {
+                f = b ^ c ^ d;
+                g = (3 * i + 5) % 16;
+            }
+            else
+            {
+                f = c ^ (b | ~d);
+                g = (7 * i) % 16;
+            }
+
+            const std::uint32_t t = d;
+            d = c;
+            c = b;
+            const std::uint32_t x = a + f + K[i] + w[g];
+            b = b + ((x << R[i]) | (x >> (32 - R[i])));
+            a = t;
+        }
+
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+    }
+
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            digest[i * 4 + j] = static_cast<unsigned char>((h[i] >> (8 * j)) & 0xFF);
+}
+#endif
+
 std::string md5HexLower(const std::string& data)
 {
     unsigned char digest[CC_MD5_DIGEST_LENGTH];
+#if defined(__APPLE__)
     CC_MD5(data.data(), (CC_LONG)data.size(), digest);
+#else
+    md5Digest(data.data(), data.size(), digest);
+#endif
 
     static const char hex[] = "0123456789abcdef";
     std::string out;
@@ -112,64 +308,6 @@ std::string urlEncode(const std::string& value)
     return out;
 }
 
-bool httpRequestToString(const char* method, const char* url, pfc::string8& outBody, std::string& outError)
-{
-    outBody.reset();
-    outError.clear();
-
-    if (!method || !*method)
-    {
-        outError = "Invalid HTTP method (empty).";
-        return false;
-    }
-    if (!url || !*url)
-    {
-        outError = "Invalid URL (empty).";
-        return false;
-    }
-
-    try
-    {
-        auto client = standard_api_create_t<http_client>();
-        http_request::ptr req = client->create_request(method);
-
-        LFM_DEBUG("HTTP " << method << " " << redact_url_for_log(url).c_str());
-
-        file::ptr stream = req->run(url, fb2k::noAbort);
-        if (!stream.is_valid())
-        {
-            outError = "No response stream.";
-            return false;
-        }
-
-        pfc::string8 line;
-        while (!stream->is_eof(fb2k::noAbort))
-        {
-            line.reset();
-            stream->read_string_raw(line, fb2k::noAbort);
-            outBody += line;
-        }
-
-        return true;
-    }
-    catch (const std::exception& e)
-    {
-        outError = e.what() ? e.what() : "HTTP exception";
-        LFM_DEBUG("HTTP exception: " << (outError.empty() ? "(empty)" : outError.c_str()));
-        return false;
-    }
-}
-
-bool httpGetToString(const char* url, pfc::string8& outBody, std::string& outError)
-{
-    return httpRequestToString("GET", url, outBody, outError);
-}
-
-bool httpPostToString(const char* url, pfc::string8& outBody, std::string& outError)
-{
-    return httpRequestToString("POST", url, outBody, outError);
-}
-
 // JSON helpers
 
 static const char* skipWs(const char* p)
@@ -377,6 +515,50 @@ bool jsonFindIntValue(const char* json, const char* key, int& out)
     return false;
 }
 
+bool jsonFindObject(const char* json, const char* key, std::string& out)
+{
+    out.clear();
+    if (!json || !*json || !key || !*key)
+        return false;
+
+    const std::string needle = std::string("\"") + key + "\"";
+    for (const char* p = std::strstr(json, needle.c_str()); p; p = std::strstr(p + 1, needle.c_str()))
+    {
+        const char* v = skipWs(p + needle.size());
+        if (*v != ':')
+            continue;
+        v = skipWs(v + 1);
+        if (*v != '{')
+            continue;
+
+        // Balanced braces, skipping over strings (which may contain braces and escaped quotes).
+        int depth = 0;
+        bool inString = false;
+        for (const char* q = v; *q; ++q)
+        {
+            if (inString)
+            {
+                if (*q == '\\' && q[1])
+                    ++q;
+                else if (*q == '"')
+                    inString = false;
+                continue;
+            }
+            if (*q == '"')
+                inString = true;
+            else if (*q == '{')
+                ++depth;
+            else if (*q == '}' && --depth == 0)
+            {
+                out.assign(v, static_cast<std::size_t>(q - v + 1));
+                return true;
+            }
+        }
+        return false; // truncated
+    }
+    return false;
+}
+
 bool jsonHasKey(const char* json, const char* key)
 {
     if (!json || !key || !*key)
@@ -7,10 +7,10 @@
 
 #pragma once
 
+#include <cstdint>
+#include <ctime>
 #include <string>
 
-#include <foobar2000/SDK/foobar2000.h>
-
 namespace lastfm
 {
 namespace util
@@ -25,17 +25,27 @@ struct LastfmApiErrorInfo
 LastfmApiErrorInfo extractLastfmApiError(const char* body);
 
 std::string cleanTagValue(const char* value);
+bool isNetworkStreamPath(const char* path);
+
+// Stream titles: station slogans/blurbs, and "Artist - Title" packed into one field.
+bool looksLikeStationTitle(const std::string& title);
+bool parseArtistTitleFromCombined(const std::string& combined, std::string& artist, std::string& title);
+
+// Identity of one play for duplicate detection: FNV-1a over start time, artist and title (exact strings).
+std::uint64_t playKey(std::time_t startTimestamp, const std::string& artist, const std::string& title);
+
+// Identity of a track as Last.fm matches it: FNV-1a over artist and title, ASCII case-folded.
+std::uint64_t trackKey(const std::string& artist, const std::string& title);
+
 std::string md5HexLower(const std::string& data);
 std::string urlEncode(const std::string& value);
 
-bool httpRequestToString(const char* method, const char* url, pfc::string8& outBody, std::string& outError);
-bool httpGetToString(const char* url, pfc::string8& outBody, std::string& outError);
-bool httpPostToString(const char* url, pfc::string8& outBody, std::string& outError);
-
 // Minimal JSON helpers (not a full parser)
 bool jsonFindStringValue(const char* json, const char* key, std::string& out);
 bool jsonFindIntValue(const char* json, const char* key, int& out);
 bool jsonHasKey(const char* json, const char* key);
+// Raw text of the first object value of `key`, braces included.
+bool jsonFindObject(const char* json, const char* key, std::string& out);
 
 } // namespace util
 } // namespace lastfm
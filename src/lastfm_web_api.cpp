@@ -6,89 +6,17 @@
 //
 
 #include "lastfm_web_api.h"
-#include "lastfm_no.h"
-#include "lastfm_ui.h"
 #include "lastfm_util.h"
 #include "debug.h"
 
-#include <foobar2000/SDK/foobar2000.h>
-
-#include <algorithm>
-#include <cctype>
-#include <cstring>
-#include <map>
-#include <string>
 #include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <utility>
 
 namespace
 {
-struct ApiOutcome
-{
-    LastfmScrobbleResult result = LastfmScrobbleResult::OTHER_ERROR;
-    int apiError = 0;
-    std::string apiMessage;
-    bool hasJson = false;
-};
-
-static ApiOutcome classifyResponse(bool httpOk, const std::string& httpError, const pfc::string8& body)
-{
-    ApiOutcome out;
-
-    // Transport failure
-    if (!httpOk)
-    {
-        LFM_INFO("Last.fm HTTP failure: " << (httpError.empty() ? "unknown error" : httpError.c_str()));
-        out.result = LastfmScrobbleResult::TEMPORARY_ERROR;
-        return out;
-    }
-
-    const char* bodyC = body.c_str();
-
-    lastfm::util::LastfmApiErrorInfo apiInfo = lastfm::util::extractLastfmApiError(bodyC);
-
-    if (!apiInfo.hasJson)
-    {
-        LFM_INFO("Last.fm response is not valid JSON (size=" << body.get_length() << ")");
-        out.result = LastfmScrobbleResult::TEMPORARY_ERROR;
-        return out;
-    }
-
-    out.hasJson = true;
-
-    if (apiInfo.hasError)
-    {
-        out.apiError = apiInfo.errorCode;
-        out.apiMessage = apiInfo.message;
-
-        switch (apiInfo.errorCode)
-        {
-        case 9:
-            out.result = LastfmScrobbleResult::INVALID_SESSION;
-            break;
-
-        case 8:
-        case 11:
-        case 16:
-            out.result = LastfmScrobbleResult::TEMPORARY_ERROR;
-            break;
-        case 29:
-            out.result = LastfmScrobbleResult::RATE_LIMITED;
-            break;
-        default:
-            out.result = LastfmScrobbleResult::OTHER_ERROR;
-            break;
-        }
-
-        LFM_INFO("Last.fm API error " << apiInfo.errorCode << (apiInfo.message.empty() ? "" : ": ")
-                                      << apiInfo.message.c_str());
-        return out;
-    }
-
-    // Success
-    out.result = LastfmScrobbleResult::SUCCESS;
-    return out;
-}
-
 #ifdef LFM_DEBUG
 
 static void selfTest_extractLastfmApiError()
@@ -120,123 +48,91 @@ static void selfTest_extractLastfmApiError()
 
 #endif
 
-static bool buildNowPlayingParams(std::map<std::string, std::string>& params, std::string& apiSecretOut,
-                                  const std::string& artist, const std::string& title, const std::string& album,
-                                  const std::string& albumArtist, const std::string& mbid, double durationSeconds)
+// "artist":{"corrected":"1","#text":"Name"}, as in scrobble and Now Playing responses.
+static bool correctedName(const std::string& json, const char* key, std::string& name)
+{
+    std::string obj;
+    if (!lastfm::util::jsonFindObject(json.c_str(), key, obj))
+        return false;
+
+    std::string flag;
+    lastfm::util::jsonFindStringValue(obj.c_str(), "corrected", flag);
+    if (flag != "1")
+        return true; // kept as sent; name stays empty
+    return lastfm::util::jsonFindStringValue(obj.c_str(), "#text", name);
+}
+
+static void learnCorrections(ILastfmCorrections* corrections, const LastfmTrackInfo& sent, const std::string& body)
+{
+    if (!corrections)
+        return;
+
+    // An ignored artist or track (codes 1 and 2) says nothing about the spelling.
+    std::string ignored;
+    std::string code;
+    if (lastfm::util::jsonFindObject(body.c_str(), "ignoredMessage", ignored) &&
+        lastfm::util::jsonFindStringValue(ignored.c_str(), "code", code) && (code == "1" || code == "2"))
+        return;
+
+    LastfmCorrection c;
+    if (!correctedName(body, "artist", c.artist) || !correctedName(body, "track", c.title))
+        return;
+    if (c.artist.empty())
+        c.artist = sent.artist;
+    if (c.title.empty())
+        c.title = sent.title;
+    corrections->learn(sent.artist, sent.title, c);
+}
+} // namespace
+
+LastfmWebApi::LastfmWebApi(ILastfmHttpTransport& http, std::function<LastfmApiCredentials()> credentials,
+                           std::string baseUrl)
+    : http_(http), credentials_(std::move(credentials)), baseUrl_(std::move(baseUrl))
 {
-    LastfmAuthState state = getAuthState();
-    if (!state.isAuthenticated || state.sessionKey.empty())
+}
+
+bool LastfmWebApi::updateNowPlaying(const LastfmTrackInfo& track)
+{
+    const LastfmApiCredentials cred = credentials_();
+    if (cred.sessionKey.empty())
     {
         LFM_INFO("NowPlaying: not authenticated, skipping.");
         return false;
     }
 
-    if (artist.empty() || title.empty())
+    if (track.artist.empty() || track.title.empty())
     {
         LFM_INFO("Missing track info, not submitting.");
         return false;
     }
 
-    const std::string apiKey = __key();
-    const std::string apiSecret = __sec();
-
-    if (apiKey.empty() || apiSecret.empty())
+    if (cred.apiKey.empty() || cred.apiSecret.empty())
     {
         LFM_INFO("NowPlaying: API key/secret not configured.");
         return false;
     }
 
-    apiSecretOut = apiSecret;
-
-    params = {
-        {"api_key", apiKey},      {"artist", artist}, {"track", title}, {"method", "track.updateNowPlaying"},
-        {"sk", state.sessionKey},
-    };
-
-    if (!album.empty())
-        params["album"] = album;
-
-    if (!albumArtist.empty())
-        params["albumArtist"] = albumArtist;
-
-    if (!mbid.empty())
-        params["mbid"] = mbid;
-
-    if (durationSeconds > 0.0)
-    {
-        int dur = static_cast<int>(durationSeconds + 0.5);
-        params["duration"] = std::to_string(dur);
-    }
-
-    return true;
-}
-
-static pfc::string8 buildNowPlayingUrl(const std::map<std::string, std::string>& params, const std::string& apiSecret)
-{
-    std::string sigSrc;
-    for (const auto& kv : params)
-    {
-        sigSrc += kv.first;
-        sigSrc += kv.second;
-    }
-    sigSrc += apiSecret;
-
-    const std::string apiSig = lastfm::util::md5HexLower(sigSrc);
-
-    pfc::string8 url;
-    url << "https://ws.audioscrobbler.com/2.0/?";
-
-    bool first = true;
-    for (const auto& kv : params)
-    {
-        if (!first)
-            url << "&";
-        first = false;
+    const auto params = lastfm::request::nowPlayingParams(track, cred.apiKey, cred.sessionKey);
+    const std::string url = lastfm::request::signedUrl(baseUrl_, params, cred.apiSecret);
 
-        const std::string encodedVal = lastfm::util::urlEncode(kv.second);
-        url << kv.first.c_str() << "=" << encodedVal.c_str();
-    }
-
-    url << "&api_sig=" << apiSig.c_str() << "&format=json";
-    return url;
-}
-
-static bool postNowPlayingAndClassify(const char* urlCStr)
-{
-    pfc::string8 body;
+    std::string body;
     std::string httpError;
-
-    const bool httpOk = lastfm::util::httpPostToString(urlCStr, body, httpError);
+    const bool httpOk = http_.request("POST", url, body, httpError);
 
     if (httpOk)
-        LFM_DEBUG("NowPlaying response received. (size=" << body.get_length() << ")");
+        LFM_DEBUG("NowPlaying response received. (size=" << body.size() << ")");
 
-    const ApiOutcome outcome = classifyResponse(httpOk, httpError, body);
+    const auto outcome = lastfm::request::classifyResponse(httpOk, httpError, body);
 
     if (outcome.result == LastfmScrobbleResult::SUCCESS)
     {
         LFM_DEBUG("NowPlaying OK.");
+        learnCorrections(corrections_, track, body);
         return true;
     }
 
     return false;
 }
-} // namespace
-
-bool LastfmWebApi::updateNowPlaying(const LastfmTrackInfo& track)
-{
-    std::map<std::string, std::string> params;
-    std::string apiSecret;
-
-    if (!buildNowPlayingParams(params, apiSecret, track.artist, track.title, track.album, track.albumArtist, track.mbid,
-                               track.durationSeconds))
-    {
-        return false;
-    }
-
-    const pfc::string8 url = buildNowPlayingUrl(params, apiSecret);
-    return postNowPlayingAndClassify(url.c_str());
-}
 
 LastfmScrobbleResult LastfmWebApi::scrobble(const LastfmTrackInfo& track, double playbackSeconds,
                                             std::time_t startTimestamp)
@@ -245,17 +141,14 @@ LastfmScrobbleResult LastfmWebApi::scrobble(const LastfmTrackInfo& track, double
     static bool tested = (selfTest_extractLastfmApiError(), true);
 #endif
 
-    LastfmAuthState authState = getAuthState();
-    if (!authState.isAuthenticated || authState.sessionKey.empty())
+    const LastfmApiCredentials cred = credentials_();
+    if (cred.sessionKey.empty())
     {
         LFM_INFO("LastfmWebApi::scrobble(): no valid auth state.");
         return LastfmScrobbleResult::INVALID_SESSION;
     }
 
-    const std::string apiKey = __key();
-    const std::string apiSecret = __sec();
-
-    if (apiKey.empty() || apiSecret.empty())
+    if (cred.apiKey.empty() || cred.apiSecret.empty())
     {
         LFM_INFO("LastfmWebApi::scrobble(): API key/secret not configured.");
         return LastfmScrobbleResult::OTHER_ERROR;
@@ -274,57 +167,125 @@ LastfmScrobbleResult LastfmWebApi::scrobble(const LastfmTrackInfo& track, double
         startTs = now - static_cast<std::time_t>(playbackSeconds);
     }
 
-    std::map<std::string, std::string> params = {
-        {"api_key", apiKey},          {"artist", track.artist},
-        {"track", track.title},       {"timestamp", std::to_string(static_cast<long long>(startTs))},
-        {"method", "track.scrobble"}, {"sk", authState.sessionKey},
-    };
-
-    if (!track.album.empty())
-        params["album"] = track.album;
-    if (!track.albumArtist.empty())
-        params["albumArtist"] = track.albumArtist;
-    if (!track.mbid.empty())
-        params["mbid"] = track.mbid;
-    if (track.durationSeconds > 0.0)
-        params["duration"] = std::to_string(static_cast<int>(track.durationSeconds));
-
-    std::string sig;
-    for (const auto& kv : params)
+    const auto params = lastfm::request::scrobbleParams(track, startTs, cred.apiKey, cred.sessionKey);
+    const std::string url = lastfm::request::signedUrl(baseUrl_, params, cred.apiSecret);
+
+    std::string body;
+    std::string httpError;
+    const bool httpOk = http_.request("POST", url, body, httpError);
+
+    const auto outcome = lastfm::request::classifyResponse(httpOk, httpError, body);
+
+    if (outcome.result == LastfmScrobbleResult::SUCCESS)
     {
-        sig += kv.first;
-        sig += kv.second;
+        LFM_INFO("Scrobble OK: " << track.artist.c_str() << " - " << track.title.c_str());
+        learnCorrections(corrections_, track, body);
     }
-    sig += apiSecret;
-    sig = lastfm::util::md5HexLower(sig);
 
-    pfc::string8 url;
-    url << "https://ws.audioscrobbler.com/2.0/?";
+    return outcome.result;
+}
+
+LastfmScrobbleResult LastfmWebApi::trackUserData(const std::string& artist, const std::string& title,
+                                                 LastfmTrackUserData& out)
+{
+    out = LastfmTrackUserData();
 
-    bool first = true;
-    for (const auto& kv : params)
-    {
-        if (!first)
-            url << "&";
-        first = false;
+    const LastfmApiCredentials cred = credentials_();
+    if (cred.sessionKey.empty() || cred.username.empty())
+        return LastfmScrobbleResult::INVALID_SESSION;
+
+    if (cred.apiKey.empty() || cred.apiSecret.empty())
+        return LastfmScrobbleResult::TEMPORARY_ERROR;
 
-        const std::string encodedValue = lastfm::util::urlEncode(kv.second);
-        url << kv.first.c_str() << "=" << encodedValue.c_str();
+    if (artist.empty() || title.empty())
+        return LastfmScrobbleResult::OTHER_ERROR;
+
+    const auto params = lastfm::request::trackInfoParams(artist, title, cred.apiKey, cred.username);
+    const std::string url = lastfm::request::signedUrl(baseUrl_, params, cred.apiSecret);
+
+    std::string body;
+    std::string httpError;
+    const bool httpOk = http_.request("GET", url, body, httpError);
+
+    // Error 6 ("Track not found") is an everyday answer for a library; keep it out of the log.
+    if (httpOk)
+    {
+        const auto apiInfo = lastfm::util::extractLastfmApiError(body.c_str());
+        if (apiInfo.hasError && apiInfo.errorCode == 6)
+            return LastfmScrobbleResult::OTHER_ERROR;
     }
 
-    url << "&api_sig=" << sig.c_str() << "&format=json";
+    const auto outcome = lastfm::request::classifyResponse(httpOk, httpError, body);
+    if (outcome.result != LastfmScrobbleResult::SUCCESS)
+        return outcome.result;
 
-    pfc::string8 body;
+    // Numbers arrive as strings ("userplaycount":"12"); accept plain numbers too.
+    std::string text;
+    int value = 0;
+    if (lastfm::util::jsonFindStringValue(body.c_str(), "userplaycount", text))
+        value = std::atoi(text.c_str());
+    else
+        lastfm::util::jsonFindIntValue(body.c_str(), "userplaycount", value);
+    out.playcount = value > 0 ? static_cast<std::uint32_t>(value) : 0;
+
+    value = 0;
+    if (lastfm::util::jsonFindStringValue(body.c_str(), "userloved", text))
+        value = std::atoi(text.c_str());
+    else
+        lastfm::util::jsonFindIntValue(body.c_str(), "userloved", value);
+    out.loved = value != 0;
+
+    return LastfmScrobbleResult::SUCCESS;
+}
+
+LastfmScrobbleResult LastfmWebApi::trackCorrection(const std::string& artist, const std::string& title,
+                                                   LastfmCorrection& out)
+{
+    out.artist = artist;
+    out.title = title;
+
+    const LastfmApiCredentials cred = credentials_();
+    if (cred.apiKey.empty() || cred.apiSecret.empty())
+        return LastfmScrobbleResult::TEMPORARY_ERROR;
+
+    if (artist.empty() || title.empty())
+        return LastfmScrobbleResult::OTHER_ERROR;
+
+    const auto params = lastfm::request::trackCorrectionParams(artist, title, cred.apiKey);
+    const std::string url = lastfm::request::signedUrl(baseUrl_, params, cred.apiSecret);
+
+    std::string body;
     std::string httpError;
+    const bool httpOk = http_.request("GET", url, body, httpError);
 
-    bool httpOk = lastfm::util::httpPostToString(url.c_str(), body, httpError);
+    // Unknown to Last.fm: nothing to correct.
+    if (httpOk)
+    {
+        const auto apiInfo = lastfm::util::extractLastfmApiError(body.c_str());
+        if (apiInfo.hasError && apiInfo.errorCode == 6)
+            return LastfmScrobbleResult::SUCCESS;
+    }
 
-    ApiOutcome outcome = classifyResponse(httpOk, httpError, body);
+    const auto outcome = lastfm::request::classifyResponse(httpOk, httpError, body);
+    if (outcome.result != LastfmScrobbleResult::SUCCESS)
+        return outcome.result;
 
-    if (outcome.result == LastfmScrobbleResult::SUCCESS)
+    // {"corrections":{"correction":{"track":{"name":..,"artist":{"name":..}},"@attr":{..}}}}; no correction is
+    // {"corrections":"\n "}.
+    std::string track;
+    if (!lastfm::util::jsonFindObject(body.c_str(), "track", track))
+        return LastfmScrobbleResult::SUCCESS;
+
+    std::string name;
+    std::string artistObj;
+    if (lastfm::util::jsonFindObject(track.c_str(), "artist", artistObj))
     {
-        LFM_INFO("Scrobble OK: " << track.artist.c_str() << " - " << track.title.c_str());
+        if (lastfm::util::jsonFindStringValue(artistObj.c_str(), "name", name) && !name.empty())
+            out.artist = name;
+        track.erase(track.find(artistObj), artistObj.size()); // leaves the track's own "name"
     }
+    if (lastfm::util::jsonFindStringValue(track.c_str(), "name", name) && !name.empty())
+        out.title = name;
 
-    return outcome.result;
+    return LastfmScrobbleResult::SUCCESS;
 }
@@ -8,13 +8,51 @@
 #pragma once
 
 #include <ctime>
+#include <functional>
+#include <string>
 
+#include "lastfm_corrections.h"
+#include "lastfm_http.h"
+#include "lastfm_request.h"
 #include "lastfm_scrobble_result.h"
 #include "lastfm_track_info.h"
+#include "lastfm_user_data.h"
 
+struct LastfmApiCredentials
+{
+    std::string apiKey;
+    std::string apiSecret;
+    std::string sessionKey; // empty when not authenticated
+    std::string username;   // likewise
+};
+
+// track.updateNowPlaying / track.scrobble / track.getInfo over an injected transport. Credentials are fetched per
+// request so a re-authentication takes effect immediately.
 class LastfmWebApi
 {
   public:
+    LastfmWebApi(ILastfmHttpTransport& http, std::function<LastfmApiCredentials()> credentials,
+                 std::string baseUrl = lastfm::request::DEFAULT_API_BASE_URL);
+
     bool updateNowPlaying(const LastfmTrackInfo& track);
     LastfmScrobbleResult scrobble(const LastfmTrackInfo& track, double playbackSeconds, std::time_t startTimestamp);
+
+    // The user's playcount and loved flag for one track (track.getInfo). A track Last.fm does not know answers
+    // OTHER_ERROR with `out` zeroed, which is worth caching like any other answer.
+    LastfmScrobbleResult trackUserData(const std::string& artist, const std::string& title, LastfmTrackUserData& out);
+
+    // track.getCorrection. A pair Last.fm has no correction for answers SUCCESS with the names unchanged.
+    LastfmScrobbleResult trackCorrection(const std::string& artist, const std::string& title, LastfmCorrection& out);
+
+    // Optional; set before use. Scrobble and Now Playing responses report Last.fm's spelling of what was sent.
+    void setCorrections(ILastfmCorrections* corrections)
+    {
+        corrections_ = corrections;
+    }
+
+  private:
+    ILastfmHttpTransport& http_;
+    std::function<LastfmApiCredentials()> credentials_;
+    std::string baseUrl_;
+    ILastfmCorrections* corrections_ = nullptr;
 };
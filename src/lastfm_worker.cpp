@@ -13,8 +13,8 @@
 
 using namespace std::chrono;
 
-LastfmWorker::LastfmWorker(LastfmClient& client, LastfmQueue& queue, Config cfg)
-    : client_(client), queue_(queue), cfg_(cfg)
+LastfmWorker::LastfmWorker(ILastfmScrobbleApi& client, LastfmQueue& queue, Config cfg, ILastfmClock& clock)
+    : client_(client), queue_(queue), cfg_(cfg), clock_(clock)
 {
 }
 
@@ -45,7 +45,7 @@ void LastfmWorker::stop()
     stopRequested_.store(true, std::memory_order_release);
 
     // Ensure Shutdown is enqueued even if queue is “full”
-    enqueue(Command{CmdType::Shutdown, Clock::now()});
+    enqueue(Command{CmdType::Shutdown, clock_.now()});
     wake();
 
     if (worker_.joinable() && std::this_thread::get_id() != worker_.get_id())
@@ -54,7 +54,7 @@ void LastfmWorker::stop()
 
 void LastfmWorker::wake()
 {
-    cv_.notify_one();
+    clock_.notify(cv_);
 }
 
 void LastfmWorker::enqueue(const Command& cmd)
@@ -78,6 +78,7 @@ void LastfmWorker::enqueue(const Command& cmd)
     }
 
     cmds_.push_back(cmd);
+    ++postVersion_;
 }
 
 void LastfmWorker::postNowPlaying(const LastfmTrackInfo& track)
@@ -89,6 +90,7 @@ void LastfmWorker::postNowPlaying(const LastfmTrackInfo& track)
     {
         std::lock_guard<std::mutex> lock(mtx_);
         pendingNowPlaying_ = track;
+        ++postVersion_;
     }
     wake();
 }
@@ -99,7 +101,7 @@ void LastfmWorker::postDrain()
         stopRequested_.load())
         return;
 
-    enqueue(Command{CmdType::Drain, Clock::now()});
+    enqueue(Command{CmdType::Drain, clock_.now()});
     wake();
 }
 
@@ -109,7 +111,7 @@ void LastfmWorker::postDrainAfter(std::chrono::milliseconds delay)
         stopRequested_.load())
         return;
 
-    enqueue(Command{CmdType::Drain, Clock::now() + delay});
+    enqueue(Command{CmdType::Drain, clock_.now() + delay});
     wake();
 }
 
@@ -119,7 +121,29 @@ void LastfmWorker::postAuthRecovered()
         stopRequested_.load())
         return;
 
-    enqueue(Command{CmdType::AuthRecovered, Clock::now()});
+    enqueue(Command{CmdType::AuthRecovered, clock_.now()});
+    wake();
+}
+
+void LastfmWorker::postCorrectionLookup()
+{
+    if (!cfg_.corrections)
+        return;
+
+    postCorrectionLookupAfter(cfg_.correctionLookupInterval);
+}
+
+void LastfmWorker::postCorrectionLookupAfter(std::chrono::milliseconds delay)
+{
+    if (shuttingDown_.load(std::memory_order_acquire) || !running_.load(std::memory_order_acquire) ||
+        stopRequested_.load())
+        return;
+
+    // One lookup in flight or planned at a time.
+    if (correctionLookupPlanned_.exchange(true))
+        return;
+
+    enqueue(Command{CmdType::CorrectionLookup, clock_.now() + delay});
     wake();
 }
 
@@ -131,6 +155,16 @@ void LastfmWorker::postInvalidSession()
         pendingNowPlaying_.reset();
     }
     authBlocked_.store(true);
+    queue_.holdSink(lastfm::sink::LASTFM, true);
+}
+
+LastfmDrainPlan LastfmWorker::drainPlan() const
+{
+    const std::size_t pending = queue_.getPendingScrobbleCount();
+    const std::time_t minSpacing =
+        (pending > COOLDOWN_LIMIT) ? static_cast<std::time_t>(duration_cast<seconds>(cfg_.drainMinInterval).count()) : 0;
+
+    return queue_.drainPlan(clock_.wallNow(), minSpacing);
 }
 
 void LastfmWorker::threadMain()
@@ -139,7 +173,7 @@ void LastfmWorker::threadMain()
 
     for (;;)
     {
-        Command cmd{CmdType::Drain, Clock::now()};
+        Command cmd{CmdType::Drain, clock_.now()};
         bool haveCmd = false;
 
         // earliest notBefore is timed wake
@@ -149,7 +183,12 @@ void LastfmWorker::threadMain()
             std::unique_lock<std::mutex> lock(mtx_);
 
             if (pendingNowPlaying_.has_value())
-                nextWake = Clock::now();
+            {
+                // Due once the debounce interval since the last send has passed.
+                nextWake = (lastNowPlayingSent_ == Clock::time_point::min())
+                               ? clock_.now()
+                               : lastNowPlayingSent_ + cfg_.nowPlayingMinInterval;
+            }
 
             if (!cmds_.empty())
             {
@@ -157,19 +196,15 @@ void LastfmWorker::threadMain()
                     nextWake = std::min(nextWake, c.notBefore);
             }
 
-            if (cmds_.empty() && !pendingNowPlaying_.has_value())
-            {
-                cv_.wait(lock, [this]()
-                         { return stopRequested_.load() || !cmds_.empty() || pendingNowPlaying_.has_value(); });
-            }
-            else
-            {
-                cv_.wait_until(lock, nextWake, [this]()
-                               { return stopRequested_.load() || !cmds_.empty() || pendingNowPlaying_.has_value(); });
-            }
+            // Sleep until the earliest item is due or something new is posted. Waking on "queue not empty"
+            // would spin while a delayed drain or a debounced Now Playing waits. Nothing queued: nextWake is
+            // max() and there is no timeout.
+            const std::uint64_t seenVersion = postVersion_;
+            clock_.waitUntil(lock, cv_, nextWake, [this, seenVersion]()
+                             { return stopRequested_.load() || postVersion_ != seenVersion; });
 
             // Pop first eligible command (notBefore <= now)
-            const auto now = Clock::now();
+            const auto now = clock_.now();
             for (auto it = cmds_.begin(); it != cmds_.end(); ++it)
             {
                 if (it->notBefore <= now)
@@ -221,9 +256,15 @@ void LastfmWorker::handle(const Command& cmd)
 
     case CmdType::AuthRecovered:
         authBlocked_.store(false);
+        queue_.holdSink(lastfm::sink::LASTFM, false);
         handleDrain();
         break;
 
+    case CmdType::CorrectionLookup:
+        correctionLookupPlanned_.store(false);
+        handleCorrectionLookup();
+        break;
+
     case CmdType::Shutdown:
         break;
     }
@@ -238,7 +279,7 @@ void LastfmWorker::handleNowPlayingIfReady()
         if (!pendingNowPlaying_.has_value())
             return;
 
-        const auto now = Clock::now();
+        const auto now = clock_.now();
         if (lastNowPlayingSent_ != Clock::time_point::min() && now - lastNowPlayingSent_ < cfg_.nowPlayingMinInterval)
             return;
 
@@ -270,56 +311,143 @@ void LastfmWorker::handleDrain()
     if (cfg_.drainEnabled && cfg_.drainEnabled() == false)
         return;
 
-    if (authBlocked_.load())
+    // Per-sink readiness (authentication, invalid-session hold) is the queue's call.
+    if (!queue_.hasReadySink())
         return;
 
-    if (!client_.isAuthenticated() || client_.isSuspended())
-        return;
-
-    const auto now = Clock::now();
+    const auto now = clock_.now();
 
     const std::size_t pending0 = queue_.getPendingScrobbleCount();
+    if (pending0 == 0)
+        return;
+
     const bool enforceCooldown = pending0 > COOLDOWN_LIMIT;
 
     if (enforceCooldown)
     {
-        if (now - lastDrain_ < cfg_.drainMinInterval)
+        // min() means "never drained"; subtracting it would overflow.
+        if (lastDrain_ != Clock::time_point::min() && now - lastDrain_ < cfg_.drainMinInterval)
+        {
+            scheduleNextDrain(pending0);
             return;
+        }
         lastDrain_ = now;
     }
 
     // Drain only if something is due
-    const std::time_t nowWall = std::time(nullptr);
-    if (pending0 == 0)
-        return;
-    if (!queue_.hasDueScrobble(nowWall))
+    if (!queue_.hasDueScrobble(clock_.wallNow()))
+    {
+        scheduleNextDrain(pending0);
         return;
+    }
+
+    const LastfmDrainPlan plan = drainPlan();
+    LFM_DEBUG("Drain plan: pending=" << (unsigned)plan.pending << " due=" << (unsigned)plan.due
+                                     << " batch=" << plan.batchSize << " spacing=" << (long long)plan.spacing
+                                     << "s");
 
-    const auto budgetEnd = Clock::now() + cfg_.drainBudget;
+    const auto budgetEnd = clock_.now() + cfg_.drainBudget;
+    unsigned attempted = 0;
 
-    while (Clock::now() < budgetEnd)
+    while (clock_.now() < budgetEnd && attempted < plan.batchSize)
     {
         if (shuttingDown_.load(std::memory_order_acquire) || stopRequested_.load(std::memory_order_acquire))
             break;
 
-        queue_.retryQueuedScrobbles();
+        const unsigned n = queue_.retryQueuedScrobbles();
+        attempted += n;
 
         if (shuttingDown_.load(std::memory_order_acquire) || stopRequested_.load(std::memory_order_acquire))
             break;
 
-        if (queue_.getPendingScrobbleCount() == 0)
+        if (n == 0 || queue_.getPendingScrobbleCount() == 0)
             break;
 
-        if (!queue_.hasDueScrobble(std::time(nullptr)))
+        if (!queue_.hasDueScrobble(clock_.wallNow()))
             break;
 
-        std::this_thread::sleep_for(cfg_.drainStepSleep);
+        clock_.sleepFor(cfg_.drainStepSleep);
     }
 
-    // If still due, schedule a follow-up soon (paced)
-    if (!shuttingDown_.load(std::memory_order_acquire) && !stopRequested_.load(std::memory_order_acquire) &&
-        queue_.getPendingScrobbleCount() > 0 && queue_.hasDueScrobble(std::time(nullptr)))
-    {
+    if (shuttingDown_.load(std::memory_order_acquire) || stopRequested_.load(std::memory_order_acquire))
+        return;
+
+    const std::size_t pending1 = queue_.getPendingScrobbleCount();
+    if (pending1 == 0)
+        return;
+
+    // Small queues with work still due: follow up soon. Everything else follows the plan.
+    if (pending1 <= COOLDOWN_LIMIT && queue_.hasDueScrobble(clock_.wallNow()))
         postDrainAfter(std::chrono::milliseconds(250));
+    else
+        scheduleNextDrain(pending1);
+}
+
+void LastfmWorker::scheduleNextDrain(std::size_t pending)
+{
+    if (shuttingDown_.load(std::memory_order_acquire) || stopRequested_.load(std::memory_order_acquire))
+        return;
+
+    const LastfmDrainPlan plan = drainPlan();
+    if (plan.pending == 0 || plan.nextRun == 0)
+        return;
+
+    const auto now = clock_.now();
+    const std::time_t nowWall = clock_.wallNow();
+
+    Clock::time_point at = now + seconds(std::max<std::time_t>(0, plan.nextRun - nowWall));
+    if (pending > COOLDOWN_LIMIT && lastDrain_ != Clock::time_point::min())
+        at = std::max(at, lastDrain_ + cfg_.drainMinInterval);
+
+    // Re-plan at least hourly; never spin faster than the step pacing.
+    at = std::clamp(at, now + milliseconds(250), now + hours(1));
+
+    // One timed drain is enough; keep the earlier one if already scheduled.
+    if (plannedDrain_ > now && plannedDrain_ <= at)
+        return;
+
+    plannedDrain_ = at;
+    postDrainAfter(duration_cast<milliseconds>(at - now));
+}
+
+void LastfmWorker::handleCorrectionLookup()
+{
+    if (!cfg_.corrections || authBlocked_.load() || !client_.isAuthenticated() || client_.isSuspended())
+        return;
+
+    // Lookups only fill gaps: scrobbles go first, and a rate-limited Last.fm gets none.
+    const std::time_t nowWall = clock_.wallNow();
+    const std::time_t blockedUntil = queue_.rateLimitedUntil(lastfm::sink::LASTFM);
+    if (blockedUntil > nowWall)
+    {
+        postCorrectionLookupAfter(duration_cast<milliseconds>(seconds(blockedUntil - nowWall)));
+        return;
     }
+    if (queue_.hasDueScrobble(nowWall))
+    {
+        postCorrectionLookupAfter(cfg_.correctionLookupInterval);
+        return;
+    }
+
+    std::string artist;
+    std::string title;
+    if (!cfg_.corrections->nextLookup(artist, title))
+        return;
+
+    LastfmCorrection correction;
+    switch (client_.trackCorrection(artist, title, correction))
+    {
+    case LastfmScrobbleResult::SUCCESS:
+        cfg_.corrections->learn(artist, title, correction);
+        break;
+
+    case LastfmScrobbleResult::RATE_LIMITED:
+        queue_.noteRateLimited(lastfm::sink::LASTFM);
+        break;
+
+    default:
+        break; // looked up again the next time the pair is queued
+    }
+
+    postCorrectionLookupAfter(cfg_.correctionLookupInterval);
 }
@@ -17,8 +17,9 @@
 #include <optional>
 #include <thread>
 
-#include "lastfm_client.h"
+#include "lastfm_clock.h"
 #include "lastfm_queue.h"
+#include "lastfm_scrobble_api.h"
 #include "lastfm_track_info.h"
 
 // Single-worker actor: all Last.fm side-effects (network + draining) run on one dedicated thread.
@@ -27,7 +28,7 @@ class LastfmWorker
 {
   public:
     static const int COOLDOWN_LIMIT = 50;
-    using Clock = std::chrono::steady_clock;
+    using Clock = std::chrono::steady_clock; // time_point type; values come from the injected ILastfmClock
     bool isShuttingDown() const noexcept
     {
         return shuttingDown_.load(std::memory_order_acquire);
@@ -42,15 +43,18 @@ class LastfmWorker
         std::chrono::milliseconds drainBudget;
         std::chrono::milliseconds drainStepSleep;
         std::function<bool()> drainEnabled;
+        ILastfmCorrections* corrections;                     // background track.getCorrection lookups when set
+        std::chrono::milliseconds correctionLookupInterval; // between lookups, and while scrobbles are due
 
         Config() noexcept
             : maxPendingCommands(2048), coalesceNowPlaying(true), nowPlayingMinInterval(1500), drainMinInterval(250),
-              drainBudget(1200), drainStepSleep(10)
+              drainBudget(1200), drainStepSleep(10), corrections(nullptr), correctionLookupInterval(1000)
         {
         }
     };
 
-    explicit LastfmWorker(LastfmClient& client, LastfmQueue& queue, Config cfg = Config());
+    explicit LastfmWorker(ILastfmScrobbleApi& client, LastfmQueue& queue, Config cfg = Config(),
+                          ILastfmClock& clock = lastfmSystemClock());
     ~LastfmWorker();
 
     LastfmWorker(const LastfmWorker&) = delete;
@@ -66,14 +70,21 @@ class LastfmWorker
     void postDrainAfter(std::chrono::milliseconds delay);
     void postAuthRecovered();
 
+    // Resolves the pairs the corrections map is waiting on, one at a time, whenever no scrobble is due.
+    void postCorrectionLookup();
+
     // Called when INVALID_SESSION is detected (clears auth). Blocks worker side-effects until recovered.
     void postInvalidSession();
 
+    // Current drain schedule (thread-safe, computed on demand).
+    LastfmDrainPlan drainPlan() const;
+
   private:
     enum class CmdType : std::uint8_t
     {
         Drain,
         AuthRecovered,
+        CorrectionLookup,
         Shutdown
     };
 
@@ -91,15 +102,20 @@ class LastfmWorker
     void handle(const Command& cmd);
     void handleNowPlayingIfReady();
     void handleDrain();
+    void scheduleNextDrain(std::size_t pending);
+    void handleCorrectionLookup();
+    void postCorrectionLookupAfter(std::chrono::milliseconds delay);
 
     std::atomic<bool> shuttingDown_{false};
-    LastfmClient& client_;
+    ILastfmScrobbleApi& client_;
     LastfmQueue& queue_;
     Config cfg_;
+    ILastfmClock& clock_;
 
     std::mutex mtx_;
     std::condition_variable cv_;
     std::deque<Command> cmds_;
+    std::uint64_t postVersion_ = 0; // bumped per posted command / Now Playing; ends the worker's timed wait
 
     // Coalesced NowPlaying state (latest wins)
     std::optional<LastfmTrackInfo> pendingNowPlaying_;
@@ -107,7 +123,9 @@ class LastfmWorker
 
     // Drain pacing & auth gate
     Clock::time_point lastDrain_{Clock::time_point::min()};
+    Clock::time_point plannedDrain_{Clock::time_point::min()};
     std::atomic<bool> authBlocked_{false};
+    std::atomic<bool> correctionLookupPlanned_{false};
 
     std::thread worker_;
     std::atomic<bool> running_{false};
@@ -10,6 +10,9 @@
 #include "version.h"
 #include "debug.h"
 #include "lastfm_core.h"
+#include "lastfm_library.h"
+#include "lastfm_playback_pipeline.h"
+#include "lastfm_settings.h"
 
 // Component GUID
 static const GUID FOO_SCROBBLER_MAC_GUID = {
@@ -32,11 +35,17 @@ class FooScrobblerMacComponent : public initquit
     {
         console::formatter f;
         f << FOOSCROBBLER_NAME << " " << FOOSCROBBLER_VERSION;
+
+        lastfmLogUseConsole();
+        lastfmPublishSettings();
     }
 
     void on_quit() override
     {
+        lastfmPlaybackPipelineShutdown();
+        lastfmMediaLibraryShutdown();
         LastfmCore::instance().scrobbler().shutdown();
+        lastfmLogShutdown();
     }
 };
 
@@ -0,0 +1,453 @@
+//
+//  drain_sim.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+//  Runs the real LastfmWorker, LastfmQueue and LastfmBudget against a simulated Last.fm service on a
+//  LastfmVirtualClock: a week of retry backoff, rate-limit cooldowns and daily budget resets over a large
+//  backlog takes seconds. Reports throughput per day, time-in-queue latency, error handling and how much of
+//  the backlog aged out of Last.fm's two-week window before it was sent.
+//
+//  Build (one line, from tools/drain_sim/):
+//
+//  c++ -std=c++20 -O2 -I../../src drain_sim.cpp ../../src/lastfm_{worker,queue,scrobble_sink,budget,drain_planner,clock,config_store,util,log}.cpp -lpthread -o drain_sim
+//
+
+#include "lastfm_clock.h"
+#include "lastfm_config_store.h"
+#include "lastfm_drain_planner.h"
+#include "lastfm_log.h"
+#include "lastfm_queue.h"
+#include "lastfm_scrobble_api.h"
+#include "lastfm_worker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+std::atomic<int> lfmLogLevel{static_cast<int>(LfmLogLevel::OFF)};
+
+namespace
+{
+// 2026-03-02 00:00:00 UTC, a Monday. Fixed so runs are reproducible.
+static constexpr std::time_t K_DEFAULT_START = 1772409600;
+
+struct Options
+{
+    unsigned seed = 1;
+    int days = 7;
+    int backlog = 100000;
+    int backlogSpanDays = 10; // backlog start times spread over this many days before the run
+    int livePerDay = 0;       // new plays queued during the run
+    int budget = -1;          // -1 = plugin default
+    int cooldownSeconds = -1; // -1 = plugin default
+    int latencyMs = 250;      // per request
+    double temporaryErrorRate = 0.01;
+    double otherErrorRate = 0.0;
+    int serverHourlyLimit = 0; // answer RATE_LIMITED beyond this many scrobbles per rolling hour (0 = none)
+    int outageStartHour = -1;  // TEMPORARY_ERROR for every request during the outage
+    int outageHours = 0;
+    bool timeline = false;
+};
+
+struct Accept
+{
+    std::time_t at = 0;
+    std::time_t queuedAt = 0;
+    std::time_t startTimestamp = 0;
+    bool live = false;
+};
+
+// Stands in for LastfmClient. Called on the worker thread only; the mutex covers the reads from main().
+class SimulatedService final : public ILastfmScrobbleApi
+{
+  public:
+    SimulatedService(ILastfmClock& clock, const Options& opt) : clock_(clock), opt_(opt), rng_(opt.seed)
+    {
+    }
+
+    bool isAuthenticated() const override
+    {
+        return true;
+    }
+
+    bool isSuspended() const override
+    {
+        return false;
+    }
+
+    bool updateNowPlaying(const LastfmTrackInfo&) override
+    {
+        clock_.sleepFor(std::chrono::milliseconds(opt_.latencyMs));
+        return true;
+    }
+
+    LastfmScrobbleResult scrobble(const LastfmTrackInfo& track, double, std::time_t startTimestamp) override
+    {
+        clock_.sleepFor(std::chrono::milliseconds(opt_.latencyMs));
+        const std::time_t now = clock_.wallNow();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++requests_;
+
+        if (inOutage(now))
+        {
+            ++temporaryErrors_;
+            return LastfmScrobbleResult::TEMPORARY_ERROR;
+        }
+
+        while (!recentAccepts_.empty() && recentAccepts_.front() <= now - 3600)
+            recentAccepts_.pop_front();
+        if (opt_.serverHourlyLimit > 0 && (int)recentAccepts_.size() >= opt_.serverHourlyLimit)
+        {
+            ++rateLimited_;
+            return LastfmScrobbleResult::RATE_LIMITED;
+        }
+
+        std::uniform_real_distribution<double> u(0.0, 1.0);
+        const double roll = u(rng_);
+        if (roll < opt_.temporaryErrorRate)
+        {
+            ++temporaryErrors_;
+            return LastfmScrobbleResult::TEMPORARY_ERROR;
+        }
+        if (roll < opt_.temporaryErrorRate + opt_.otherErrorRate)
+        {
+            ++otherErrors_;
+            return LastfmScrobbleResult::OTHER_ERROR;
+        }
+
+        recentAccepts_.push_back(now);
+
+        // The album field carries "<id>" so the harness can look up when the entry was queued.
+        const std::size_t id = static_cast<std::size_t>(std::strtoull(track.album.c_str(), nullptr, 10));
+        Accept a;
+        a.at = now;
+        a.startTimestamp = startTimestamp;
+        a.live = track.albumArtist == "live";
+        if (id < queuedAt_.size())
+        {
+            a.queuedAt = queuedAt_[id];
+            if (accepted_[id])
+                ++duplicates_;
+            accepted_[id] = true;
+        }
+        accepts_.push_back(a);
+        return LastfmScrobbleResult::SUCCESS;
+    }
+
+    std::size_t registerQueued(std::time_t at)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queuedAt_.push_back(at);
+        accepted_.push_back(false);
+        return queuedAt_.size() - 1;
+    }
+
+    std::size_t queuedCount() const
+    {
+        return queuedAt_.size();
+    }
+
+    template <typename F> void inspect(F&& f)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        f(*this);
+    }
+
+    std::vector<Accept> accepts_;
+    std::uint64_t requests_ = 0;
+    std::uint64_t temporaryErrors_ = 0;
+    std::uint64_t otherErrors_ = 0;
+    std::uint64_t rateLimited_ = 0;
+    std::uint64_t duplicates_ = 0;
+
+  private:
+    bool inOutage(std::time_t now) const
+    {
+        if (opt_.outageStartHour < 0 || opt_.outageHours <= 0)
+            return false;
+        const std::time_t begin = K_DEFAULT_START + (std::time_t)opt_.outageStartHour * 3600;
+        return now >= begin && now < begin + (std::time_t)opt_.outageHours * 3600;
+    }
+
+    ILastfmClock& clock_;
+    const Options& opt_;
+    std::mt19937 rng_;
+    std::mutex mutex_;
+    std::deque<std::time_t> recentAccepts_;
+    std::vector<std::time_t> queuedAt_;
+    std::vector<bool> accepted_;
+};
+
+static LastfmQueue::NewScrobble makeScrobble(std::size_t id, std::time_t start, bool live)
+{
+    LastfmQueue::NewScrobble s;
+    s.track.artist = "Artist " + std::to_string(id % 997);
+    s.track.title = "Title " + std::to_string(id);
+    s.track.album = std::to_string(id);
+    s.track.albumArtist = live ? "live" : "backlog";
+    s.track.durationSeconds = 240.0;
+    s.playbackSeconds = 240.0;
+    s.startTimestamp = start;
+    return s;
+}
+
+static std::string formatDuration(double seconds)
+{
+    char buf[32];
+    if (seconds < 0)
+        return "-";
+    if (seconds < 120)
+        std::snprintf(buf, sizeof(buf), "%.0fs", seconds);
+    else if (seconds < 7200)
+        std::snprintf(buf, sizeof(buf), "%.1fm", seconds / 60.0);
+    else if (seconds < 172800)
+        std::snprintf(buf, sizeof(buf), "%.1fh", seconds / 3600.0);
+    else
+        std::snprintf(buf, sizeof(buf), "%.1fd", seconds / 86400.0);
+    return buf;
+}
+
+static double percentile(std::vector<double>& v, double p)
+{
+    if (v.empty())
+        return -1.0;
+    const std::size_t i = std::min(v.size() - 1, static_cast<std::size_t>(p * static_cast<double>(v.size())));
+    std::nth_element(v.begin(), v.begin() + static_cast<std::ptrdiff_t>(i), v.end());
+    return v[i];
+}
+
+static void printLatency(const char* label, std::vector<double> v)
+{
+    if (v.empty())
+    {
+        std::printf("  %-8s      -\n", label);
+        return;
+    }
+    const double p50 = percentile(v, 0.50);
+    const double p90 = percentile(v, 0.90);
+    const double p99 = percentile(v, 0.99);
+    const double max = *std::max_element(v.begin(), v.end());
+    std::printf("  %-8s %8zu  p50 %8s  p90 %8s  p99 %8s  max %8s\n", label, v.size(), formatDuration(p50).c_str(),
+                formatDuration(p90).c_str(), formatDuration(p99).c_str(), formatDuration(max).c_str());
+}
+
+static void usage()
+{
+    std::fprintf(stderr,
+                 "usage: drain_sim [--days N] [--backlog N] [--backlog-span DAYS] [--live-per-day N]\n"
+                 "                 [--budget N] [--cooldown S] [--latency MS] [--temp-errors P] [--other-errors P]\n"
+                 "                 [--server-hourly N] [--outage START_HOUR,HOURS] [--seed N] [--timeline] [--log]\n");
+}
+
+static bool parseArgs(int argc, char** argv, Options& opt)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string a = argv[i];
+        auto next = [&]() -> const char*
+        {
+            if (i + 1 >= argc)
+                return nullptr;
+            return argv[++i];
+        };
+        const char* v = nullptr;
+        if (a == "--timeline")
+            opt.timeline = true;
+        else if (a == "--log")
+            lfmLogLevel.store(static_cast<int>(LfmLogLevel::DEBUG_LOG));
+        else if (!(v = next()))
+            return false;
+        else if (a == "--days")
+            opt.days = std::atoi(v);
+        else if (a == "--backlog")
+            opt.backlog = std::atoi(v);
+        else if (a == "--backlog-span")
+            opt.backlogSpanDays = std::atoi(v);
+        else if (a == "--live-per-day")
+            opt.livePerDay = std::atoi(v);
+        else if (a == "--budget")
+            opt.budget = std::atoi(v);
+        else if (a == "--cooldown")
+            opt.cooldownSeconds = std::atoi(v);
+        else if (a == "--latency")
+            opt.latencyMs = std::atoi(v);
+        else if (a == "--temp-errors")
+            opt.temporaryErrorRate = std::atof(v);
+        else if (a == "--other-errors")
+            opt.otherErrorRate = std::atof(v);
+        else if (a == "--server-hourly")
+            opt.serverHourlyLimit = std::atoi(v);
+        else if (a == "--outage")
+        {
+            if (std::sscanf(v, "%d,%d", &opt.outageStartHour, &opt.outageHours) != 2)
+                return false;
+        }
+        else if (a == "--seed")
+            opt.seed = static_cast<unsigned>(std::strtoul(v, nullptr, 10));
+        else
+            return false;
+    }
+    return opt.days > 0 && opt.backlog >= 0 && opt.backlogSpanDays >= 0;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parseArgs(argc, argv, opt))
+    {
+        usage();
+        return 2;
+    }
+
+    LastfmMemoryConfigStore config;
+    if (opt.budget >= 0)
+        config.setInt(lastfm::config::DAILY_BUDGET, opt.budget);
+    if (opt.cooldownSeconds >= 0)
+        config.setInt(lastfm::config::DRAIN_COOLDOWN_SECONDS, opt.cooldownSeconds);
+
+    const auto realStart = std::chrono::steady_clock::now();
+
+    LastfmVirtualClock clock(K_DEFAULT_START);
+    SimulatedService service(clock, opt);
+    LastfmQueue queue(service, [] {}, config, clock);
+
+    // Backlog: plays spread evenly over the days before the run, oldest first.
+    {
+        std::vector<LastfmQueue::NewScrobble> batch;
+        batch.reserve(static_cast<std::size_t>(opt.backlog));
+        const std::time_t span = (std::time_t)opt.backlogSpanDays * 86400;
+        for (int i = 0; i < opt.backlog; ++i)
+        {
+            const std::time_t start = K_DEFAULT_START - span + (span * i) / std::max(1, opt.backlog) - 240;
+            batch.push_back(makeScrobble(service.registerQueued(K_DEFAULT_START), start, false));
+        }
+        queue.queueScrobblesForRetry(batch);
+    }
+
+    // Same configuration LastfmScrobbler builds.
+    LastfmWorker::Config cfg;
+    cfg.drainEnabled = [&queue]() { return queue.drainEnabled(); };
+    cfg.drainMinInterval = queue.drainCooldown();
+    LastfmWorker worker(service, queue, cfg, clock);
+
+    clock.setParticipants(1);
+    worker.start();
+    worker.postDrain();
+
+    using namespace std::chrono;
+    const auto end = clock.start() + hours(24 * opt.days);
+    const auto liveInterval =
+        opt.livePerDay > 0 ? duration_cast<milliseconds>(hours(24)) / opt.livePerDay : milliseconds::max();
+    auto nextLive = opt.livePerDay > 0 ? clock.start() + liveInterval : ILastfmClock::SteadyTime::max();
+    auto nextSample = opt.timeline ? clock.start() + hours(6) : ILastfmClock::SteadyTime::max();
+    std::uint64_t steps = 0;
+
+    if (opt.timeline)
+        std::printf("%-10s %9s %9s %9s %8s\n", "time", "pending", "accepted", "expiring", "next run");
+
+    for (;;)
+    {
+        clock.advance(std::min({end, nextLive, nextSample}));
+        ++steps;
+        const auto now = clock.now();
+        if (now >= end)
+            break;
+
+        if (now >= nextLive)
+        {
+            const std::time_t wall = clock.wallNow();
+            std::vector<LastfmQueue::NewScrobble> one{makeScrobble(service.registerQueued(wall), wall - 240, true)};
+            queue.queueScrobblesForRetry(one);
+            worker.postDrain();
+            nextLive += liveInterval;
+        }
+
+        if (now >= nextSample)
+        {
+            const LastfmDrainPlan plan = worker.drainPlan();
+            std::size_t accepted = 0;
+            service.inspect([&](SimulatedService& s) { accepted = s.accepts_.size(); });
+            const std::string at = formatDuration(duration<double>(now - clock.start()).count());
+            const std::string next =
+                plan.nextRun ? formatDuration((double)(plan.nextRun - clock.wallNow())) : std::string("-");
+            std::printf("%-10s %9zu %9zu %9zu %8s\n", at.c_str(), plan.pending, accepted,
+                        plan.expiringSoon + plan.expired, next.c_str());
+            nextSample += hours(6);
+        }
+    }
+
+    const LastfmDrainPlan finalPlan = worker.drainPlan();
+    clock.release();
+    worker.stop();
+
+    const double realSeconds = duration<double>(steady_clock::now() - realStart).count();
+
+    std::vector<double> backlogLatency;
+    std::vector<double> liveLatency;
+    std::vector<std::uint64_t> perDay(static_cast<std::size_t>(opt.days), 0);
+    std::uint64_t tooOld = 0;
+    std::uint64_t requests = 0, temporaryErrors = 0, otherErrors = 0, rateLimited = 0, duplicates = 0;
+    std::size_t queued = 0;
+
+    service.inspect(
+        [&](SimulatedService& s)
+        {
+            for (const Accept& a : s.accepts_)
+            {
+                (a.live ? liveLatency : backlogLatency).push_back(static_cast<double>(a.at - a.queuedAt));
+                const std::time_t day = (a.at - K_DEFAULT_START) / 86400;
+                if (day >= 0 && day < opt.days)
+                    ++perDay[static_cast<std::size_t>(day)];
+                if (a.at - a.startTimestamp > LastfmDrainPlanner::ACCEPTANCE_WINDOW_SECONDS)
+                    ++tooOld;
+            }
+            requests = s.requests_;
+            temporaryErrors = s.temporaryErrors_;
+            otherErrors = s.otherErrors_;
+            rateLimited = s.rateLimited_;
+            duplicates = s.duplicates_;
+            queued = s.queuedCount();
+        });
+
+    const std::size_t accepted = backlogLatency.size() + liveLatency.size();
+
+    std::printf("\nsimulated %d day(s) in %.2f s real time (%llu clock steps)\n", opt.days, realSeconds,
+                static_cast<unsigned long long>(steps));
+    const int64_t budget = config.getInt(lastfm::config::DAILY_BUDGET, lastfm::config::DEFAULT_DAILY_BUDGET);
+    std::printf("backlog %d over %d day(s), live %d/day, budget %lld/day, cooldown %llds, latency %dms\n",
+                opt.backlog, opt.backlogSpanDays, opt.livePerDay, static_cast<long long>(budget),
+                static_cast<long long>(queue.drainCooldown().count()), opt.latencyMs);
+    std::printf("\nrequests %llu: accepted %zu, temporary %llu, other %llu, rate-limited %llu, duplicates %llu\n",
+                static_cast<unsigned long long>(requests), accepted, static_cast<unsigned long long>(temporaryErrors),
+                static_cast<unsigned long long>(otherErrors), static_cast<unsigned long long>(rateLimited),
+                static_cast<unsigned long long>(duplicates));
+    std::printf("queued %zu, still pending %zu, dropped %lld\n", queued, finalPlan.pending,
+                static_cast<long long>(queued) - static_cast<long long>(accepted) -
+                    static_cast<long long>(finalPlan.pending));
+    std::printf("sent after the two-week window (ignored by Last.fm): %llu; due to expire: %zu expired, %zu soon\n",
+                static_cast<unsigned long long>(tooOld), finalPlan.expired, finalPlan.expiringSoon);
+
+    std::printf("\naccepted per day:");
+    for (std::uint64_t n : perDay)
+        std::printf(" %llu", static_cast<unsigned long long>(n));
+    std::printf("\n\ntime in queue until accepted:\n");
+    printLatency("backlog", std::move(backlogLatency));
+    printLatency("live", std::move(liveLatency));
+
+    if (finalPlan.completionEta > 0)
+        std::printf("\nplanner ETA for the rest: %s\n",
+                    formatDuration((double)(finalPlan.completionEta - clock.wallNow())).c_str());
+
+    lastfmLogShutdown();
+    return 0;
+}
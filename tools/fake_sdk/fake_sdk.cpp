@@ -0,0 +1,305 @@
+//
+//  fake_sdk.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+//  Implementation of the tools' fake SDK (foobar2000/SDK/foobar2000.h).
+//
+
+#include <foobar2000/SDK/foobar2000.h>
+
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <initializer_list>
+#include <memory>
+
+namespace
+{
+static bool equalsNoCase(const std::string& a, const char* b)
+{
+    const std::size_t n = std::strlen(b);
+    if (a.size() != n)
+        return false;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i])))
+            return false;
+    }
+    return true;
+}
+
+static std::string lower(std::string s)
+{
+    for (char& c : s)
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return s;
+}
+
+class ScriptEvaluator
+{
+  public:
+    ScriptEvaluator(const file_info& info, const char* path) : info_(info), path_(path ? path : "")
+    {
+    }
+
+    std::string run(const std::string& script)
+    {
+        const char* p = script.c_str();
+        bool found = false;
+        return sequence(p, "", found);
+    }
+
+  private:
+    // Evaluates until end of input or an unnested character from `stops` (left unconsumed).
+    std::string sequence(const char*& p, const char* stops, bool& found)
+    {
+        std::string out;
+        while (*p && !std::strchr(stops, *p))
+        {
+            const char c = *p++;
+            switch (c)
+            {
+            case '\'':
+                while (*p && *p != '\'')
+                    out.push_back(*p++);
+                if (*p)
+                    ++p;
+                break;
+            case '%':
+            {
+                std::string name;
+                while (*p && *p != '%')
+                    name.push_back(*p++);
+                if (*p)
+                    ++p;
+                const std::string value = field(lower(name));
+                if (!value.empty())
+                    found = true;
+                out += value.empty() ? "?" : value;
+                break;
+            }
+            case '[':
+            {
+                bool inner = false;
+                std::string text = sequence(p, "]", inner);
+                if (*p == ']')
+                    ++p;
+                if (inner)
+                {
+                    out += text;
+                    found = true;
+                }
+                break;
+            }
+            case '$':
+                out += function(p, found);
+                break;
+            default:
+                out.push_back(c);
+                break;
+            }
+        }
+        return out;
+    }
+
+    std::string function(const char*& p, bool& found)
+    {
+        std::string name;
+        while (*p && *p != '(')
+            name.push_back(*p++);
+        if (*p != '(')
+            return "[UNKNOWN FUNCTION]";
+        ++p;
+
+        std::vector<std::string> args;
+        std::vector<bool> argFound;
+        for (;;)
+        {
+            bool f = false;
+            args.push_back(sequence(p, ",)", f));
+            argFound.push_back(f);
+            if (*p == ',')
+            {
+                ++p;
+                continue;
+            }
+            if (*p == ')')
+                ++p;
+            break;
+        }
+
+        name = lower(name);
+        if (name == "meta" && !args.empty())
+        {
+            const std::size_t idx = args.size() > 1 ? static_cast<std::size_t>(std::atoi(args[1].c_str())) : 0;
+            const char* v = info_.meta_get(args[0].c_str(), idx);
+            if (v && *v)
+            {
+                found = true;
+                return v;
+            }
+            return {};
+        }
+        if (name == "if2" && args.size() == 2)
+        {
+            const std::size_t pick = argFound[0] ? 0 : 1;
+            found = found || argFound[pick];
+            return args[pick];
+        }
+        if (name == "if" && (args.size() == 2 || args.size() == 3))
+        {
+            if (argFound[0])
+            {
+                found = found || argFound[1];
+                return args[1];
+            }
+            if (args.size() == 3)
+            {
+                found = found || argFound[2];
+                return args[2];
+            }
+            return {};
+        }
+        if (name == "trim" && args.size() == 1)
+        {
+            std::string s = args[0];
+            const std::size_t b = s.find_first_not_of(' ');
+            const std::size_t e = s.find_last_not_of(' ');
+            found = found || argFound[0];
+            return b == std::string::npos ? std::string() : s.substr(b, e - b + 1);
+        }
+        return "[UNKNOWN FUNCTION]";
+    }
+
+    std::string meta(const char* name) const
+    {
+        std::string out;
+        for (std::size_t i = 0;; ++i)
+        {
+            const char* v = info_.meta_get(name, i);
+            if (!v)
+                break;
+            if (i > 0)
+                out += ", ";
+            out += v;
+        }
+        return out;
+    }
+
+    std::string firstOf(std::initializer_list<const char*> names) const
+    {
+        for (const char* n : names)
+        {
+            std::string v = meta(n);
+            if (!v.empty())
+                return v;
+        }
+        return {};
+    }
+
+    std::string fileName() const
+    {
+        std::string s = path_;
+        const std::size_t slash = s.find_last_of('/');
+        if (slash != std::string::npos)
+            s = s.substr(slash + 1);
+        const std::size_t dot = s.find_last_of('.');
+        if (dot != std::string::npos && dot > 0)
+            s.resize(dot);
+        return s;
+    }
+
+    // Field remappings as documented for foobar2000's title formatting.
+    std::string field(const std::string& name) const
+    {
+        if (name == "artist")
+            return firstOf({"artist", "album artist", "composer", "performer"});
+        if (name == "album artist")
+            return firstOf({"album artist", "artist", "composer", "performer"});
+        if (name == "track artist")
+        {
+            const std::string albumArtist = firstOf({"album artist", "artist", "composer", "performer"});
+            const std::string artist = firstOf({"artist", "album artist", "composer", "performer"});
+            return artist == albumArtist ? std::string() : artist;
+        }
+        if (name == "title")
+        {
+            std::string v = meta("title");
+            return v.empty() ? fileName() : v;
+        }
+        if (name == "path")
+            return path_;
+        if (name == "filename")
+            return fileName();
+        if (name == "length_seconds")
+            return std::to_string(static_cast<long long>(std::llround(info_.get_length())));
+        return meta(name.c_str());
+    }
+
+    const file_info& info_;
+    std::string path_;
+};
+
+// Compiled scripts live for the whole run, like the services that would own them.
+static std::deque<std::unique_ptr<titleformat_object>> compiledScripts;
+
+} // namespace
+
+namespace fb2k
+{
+void inMainThread(std::function<void()> f)
+{
+    if (f)
+        f();
+}
+} // namespace fb2k
+
+const char* file_info::meta_get(const char* name, std::size_t idx) const
+{
+    if (!name)
+        return nullptr;
+    for (const auto& entry : meta_)
+    {
+        if (equalsNoCase(entry.first, name))
+            return idx < entry.second.size() ? entry.second[idx].c_str() : nullptr;
+    }
+    return nullptr;
+}
+
+void file_info::meta_add(const char* name, const char* value)
+{
+    if (!name || !value)
+        return;
+    for (auto& entry : meta_)
+    {
+        if (equalsNoCase(entry.first, name))
+        {
+            entry.second.emplace_back(value);
+            return;
+        }
+    }
+    meta_.emplace_back(name, std::vector<std::string>{value});
+}
+
+void titleformat_compiler::compile_safe(service_ptr_t<titleformat_object>& out, const char* spec)
+{
+    compiledScripts.push_back(std::make_unique<titleformat_object>(spec ? spec : ""));
+    out = compiledScripts.back().get();
+}
+
+void metadb_handle::format_title(titleformat_hook*, pfc::string_base& out,
+                                 const service_ptr_t<titleformat_object>& script, titleformat_text_filter*)
+{
+    if (!script.is_valid())
+    {
+        out.reset();
+        return;
+    }
+
+    ScriptEvaluator eval(info_, path_.c_str());
+    const std::string text = eval.run(script->script());
+    out.set_string(text.c_str());
+}
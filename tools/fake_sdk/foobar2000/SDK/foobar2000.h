@@ -0,0 +1,268 @@
+//
+//  foobar2000.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+//  Fake SDK for tools/trace_replay: just the surface the tracker and titleformat code use, backed by plain
+//  in-memory objects so they can be driven without foobar2000. Not a general SDK shim; the queue, budget,
+//  worker and web API build without it (see tools/drain_sim).
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+typedef std::int64_t t_int64;
+typedef std::uint64_t t_uint64;
+typedef std::uint32_t t_uint32;
+typedef std::size_t t_size;
+
+namespace pfc
+{
+class string_base
+{
+  public:
+    virtual ~string_base() = default;
+    virtual const char* get_ptr() const = 0;
+    virtual void set_string(const char* p, std::size_t len = SIZE_MAX) = 0;
+    virtual void add_string(const char* p, std::size_t len = SIZE_MAX) = 0;
+
+    const char* c_str() const
+    {
+        return get_ptr();
+    }
+    string_base& operator=(const char* p)
+    {
+        set_string(p);
+        return *this;
+    }
+    string_base& operator+=(const char* p)
+    {
+        add_string(p);
+        return *this;
+    }
+    bool is_empty() const
+    {
+        return *get_ptr() == 0;
+    }
+    void reset()
+    {
+        set_string("");
+    }
+};
+
+class string8 : public string_base
+{
+  public:
+    string8() = default;
+    string8(const char* p) : s_(p ? p : "")
+    {
+    }
+
+    const char* get_ptr() const override
+    {
+        return s_.c_str();
+    }
+    void set_string(const char* p, std::size_t len = SIZE_MAX) override
+    {
+        s_ = (len == SIZE_MAX) ? std::string(p ? p : "") : std::string(p, len);
+    }
+    void add_string(const char* p, std::size_t len = SIZE_MAX) override
+    {
+        s_ += (len == SIZE_MAX) ? std::string(p ? p : "") : std::string(p, len);
+    }
+    string8& operator+=(const char* p)
+    {
+        add_string(p);
+        return *this;
+    }
+    string8& operator+=(const string8& p)
+    {
+        s_ += p.s_;
+        return *this;
+    }
+    operator const char*() const
+    {
+        return s_.c_str();
+    }
+
+  private:
+    std::string s_;
+};
+} // namespace pfc
+
+// Non-owning. The harness owns every object it hands out.
+template <typename T> class service_ptr_t
+{
+  public:
+    service_ptr_t() = default;
+    service_ptr_t(T* p) : p_(p)
+    {
+    }
+
+    bool is_valid() const
+    {
+        return p_ != nullptr;
+    }
+    bool is_empty() const
+    {
+        return p_ == nullptr;
+    }
+    void release()
+    {
+        p_ = nullptr;
+    }
+    T* get_ptr() const
+    {
+        return p_;
+    }
+    T* operator->() const
+    {
+        return p_;
+    }
+    bool operator==(const service_ptr_t& o) const
+    {
+        return p_ == o.p_;
+    }
+    bool operator!=(const service_ptr_t& o) const
+    {
+        return p_ != o.p_;
+    }
+
+  private:
+    T* p_ = nullptr;
+};
+
+template <typename T> class static_api_ptr_t
+{
+  public:
+    T* operator->() const
+    {
+        static T instance;
+        return &instance;
+    }
+};
+
+class service_base
+{
+  public:
+    virtual ~service_base() = default;
+};
+
+namespace fb2k
+{
+// "Main thread" work runs inline on the caller.
+void inMainThread(std::function<void()> f);
+} // namespace fb2k
+
+class file_info
+{
+  public:
+    virtual ~file_info() = default;
+
+    // Case-insensitive, like the real thing.
+    const char* meta_get(const char* name, std::size_t idx) const;
+    std::size_t meta_get_count() const
+    {
+        return meta_.size();
+    }
+    const char* meta_enum_name(std::size_t i) const
+    {
+        return meta_[i].first.c_str();
+    }
+    std::size_t meta_enum_value_count(std::size_t i) const
+    {
+        return meta_[i].second.size();
+    }
+    const char* meta_enum_value(std::size_t i, std::size_t j) const
+    {
+        return meta_[i].second[j].c_str();
+    }
+    void meta_add(const char* name, const char* value);
+
+    double get_length() const
+    {
+        return length_;
+    }
+    void set_length(double length)
+    {
+        length_ = length;
+    }
+
+  private:
+    std::vector<std::pair<std::string, std::vector<std::string>>> meta_;
+    double length_ = 0.0;
+};
+
+class file_info_impl : public file_info
+{
+  public:
+    file_info_impl() = default;
+    file_info_impl(const file_info& other) : file_info(other)
+    {
+    }
+};
+
+class titleformat_hook;
+class titleformat_text_filter;
+
+// Compiled script: literal text, %field%, [optional sections], 'quoted text', $meta(), $if2().
+// Enough for the scrobbler's default and typical custom expressions.
+class titleformat_object : public service_base
+{
+  public:
+    explicit titleformat_object(std::string script) : script_(std::move(script))
+    {
+    }
+    const std::string& script() const
+    {
+        return script_;
+    }
+
+  private:
+    std::string script_;
+};
+
+class titleformat_compiler : public service_base
+{
+  public:
+    void compile_safe(service_ptr_t<titleformat_object>& out, const char* spec);
+};
+
+class metadb_handle : public service_base
+{
+  public:
+    metadb_handle(std::string path, const file_info& info) : path_(std::move(path)), info_(info)
+    {
+    }
+
+    const char* get_path() const
+    {
+        return path_.c_str();
+    }
+    bool get_info(file_info& out) const
+    {
+        out = info_;
+        return true;
+    }
+    void format_title(titleformat_hook* hook, pfc::string_base& out, const service_ptr_t<titleformat_object>& script,
+                      titleformat_text_filter* filter);
+
+    // Replay only: a trace's EDITED record carries the new tags.
+    void replace_info(const file_info& info)
+    {
+        info_ = info;
+    }
+
+  private:
+    std::string path_;
+    file_info_impl info_;
+};
+typedef service_ptr_t<metadb_handle> metadb_handle_ptr;
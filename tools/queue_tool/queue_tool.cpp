@@ -0,0 +1,657 @@
+//
+//  queue_tool.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+//  Offline look at a pending-scrobble queue, without foobar2000: the "queue.pending" value (LastfmQueue's
+//  #FSQ1 / #FSQ2 / #FSQ3 text) saved to a file, or with --store a LastfmFileConfigStore file as the Linux tools
+//  keep. Loads and saves go through the real LastfmQueue, so the numbers match what the plugin sees at startup.
+//
+//      queue_tool stats FILE                 entries per sink, age distribution, retry-count histogram,
+//                                            duplicates and bytes per field
+//      queue_tool compact IN OUT             drop rows the queue would skip, optionally --expire DAYS and
+//                                            --dedup, and write --format fsq3 (default) or fsq2
+//      queue_tool bench FILE                 queue load and save times over --iterations runs
+//
+//  Build (one line, from tools/queue_tool/):
+//
+//  c++ -std=c++20 -O2 -I../../src queue_tool.cpp ../../src/lastfm_{queue,scrobble_sink,budget,drain_planner,clock,config_store,util,log}.cpp -lpthread -o queue_tool
+//
+
+#include "lastfm_config_store.h"
+#include "lastfm_log.h"
+#include "lastfm_queue.h"
+#include "lastfm_scrobble_api.h"
+#include "lastfm_scrobble_sink.h"
+#include "lastfm_util.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+std::atomic<int> lfmLogLevel{static_cast<int>(LfmLogLevel::OFF)};
+
+namespace
+{
+// Row layout written by LastfmQueue::appendSerialized.
+static constexpr std::size_t K_MIN_COLUMNS = 11;  // rows with fewer are skipped on load
+static constexpr std::size_t K_FSQ2_COLUMNS = 13; // up to the mbid
+static constexpr std::size_t K_SINKS_COLUMN = 13; // FSQ3 pending-sink mask; "retry,other,next" per slot after it
+
+// Column names in order; the per-slot retry columns after "sinks" are named by sink.
+static const char* const K_COLUMN_NAMES[] = {"artist",  "title",   "album",      "album_artist", "duration",
+                                             "playback", "start",   "refresh",    "retries",      "next_retry",
+                                             "id",       "other_errors", "mbid",  "sinks"};
+
+static constexpr std::time_t K_LASTFM_WINDOW_SECONDS = 14 * 24 * 3600;
+
+struct Options
+{
+    std::string command;
+    std::string in;
+    std::string out;
+    bool store = false;
+    bool dedup = false;
+    int expireDays = 0;
+    std::string format = "fsq3";
+    std::time_t now = 0;
+    int iterations = 5;
+};
+
+// Raw columns, still escaped, so kept rows are written back byte for byte.
+struct Row
+{
+    std::vector<std::string> cols;
+};
+
+struct Blob
+{
+    std::string header; // first line when it is one, "" for headerless legacy rows
+    std::vector<Row> rows;
+    std::size_t skipped = 0; // rows LastfmQueue would not load
+    std::size_t bytes = 0;
+};
+
+// Accepts anything; the tool never dispatches.
+class IdleScrobbleApi final : public ILastfmScrobbleApi
+{
+  public:
+    bool isAuthenticated() const override
+    {
+        return true;
+    }
+    bool isSuspended() const override
+    {
+        return false;
+    }
+    bool updateNowPlaying(const LastfmTrackInfo&) override
+    {
+        return true;
+    }
+    LastfmScrobbleResult scrobble(const LastfmTrackInfo&, double, std::time_t) override
+    {
+        return LastfmScrobbleResult::SUCCESS;
+    }
+};
+
+// Registered for the slots past Last.fm so their pending deliveries survive the load.
+class IdleSink final : public ILastfmScrobbleSink
+{
+  public:
+    explicit IdleSink(const char* name) : name_(name)
+    {
+    }
+    const char* name() const override
+    {
+        return name_;
+    }
+    bool ready() const override
+    {
+        return true;
+    }
+    void submit(const std::vector<LastfmSinkScrobble>& batch, std::vector<LastfmScrobbleResult>& results) override
+    {
+        results.assign(batch.size(), LastfmScrobbleResult::SUCCESS);
+    }
+
+  private:
+    const char* name_;
+};
+
+// A queue over the blob with every sink slot registered.
+class LoadedQueue
+{
+  public:
+    explicit LoadedQueue(const std::string& blob) : listenBrainz_("ListenBrainz"), libreFm_("Libre.fm")
+    {
+        store_.setString(lastfm::config::PENDING_SCROBBLES, blob);
+        queue_ = std::make_unique<LastfmQueue>(api_, [] {}, store_);
+        queue_->addSink(lastfm::sink::LISTENBRAINZ, listenBrainz_);
+        queue_->addSink(lastfm::sink::LIBREFM, libreFm_);
+    }
+
+    LastfmQueue* operator->()
+    {
+        return queue_.get();
+    }
+
+    std::size_t savedBytes()
+    {
+        return store_.getString(lastfm::config::PENDING_SCROBBLES).size();
+    }
+
+  private:
+    IdleScrobbleApi api_;
+    IdleSink listenBrainz_;
+    IdleSink libreFm_;
+    LastfmMemoryConfigStore store_;
+    std::unique_ptr<LastfmQueue> queue_;
+};
+
+static const char* sinkName(unsigned slot)
+{
+    switch (slot)
+    {
+    case lastfm::sink::LASTFM:
+        return "Last.fm";
+    case lastfm::sink::LISTENBRAINZ:
+        return "ListenBrainz";
+    case lastfm::sink::LIBREFM:
+        return "Libre.fm";
+    default:
+        return "other";
+    }
+}
+
+static std::uint64_t playKeyOf(const Row& row)
+{
+    return lastfm::util::playKey(static_cast<std::time_t>(std::atoll(row.cols[6].c_str())),
+                                 LastfmQueue::unescapeField(row.cols[0]), LastfmQueue::unescapeField(row.cols[1]));
+}
+
+static bool readInput(const Options& opt, const std::string& path, std::string& out, std::string& error)
+{
+    if (opt.store)
+    {
+        // load() takes a missing file for an empty store.
+        LastfmFileConfigStore store(path);
+        if (!std::ifstream(path) || !store.load())
+        {
+            error = "cannot read " + path + ": " + std::strerror(errno);
+            return false;
+        }
+        out = store.getString(lastfm::config::PENDING_SCROBBLES);
+        return true;
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    if (in.bad())
+    {
+        error = "cannot read " + path;
+        return false;
+    }
+    return true;
+}
+
+// Same row rules as LastfmQueue::ensureCacheLoadedLocked, minus the sink check (LoadedQueue registers them all).
+static bool parseBlob(const std::string& text, Blob& blob, std::string& error)
+{
+    blob = Blob{};
+    blob.bytes = text.size();
+
+    std::size_t pos = 0;
+    const std::size_t firstEnd = std::min(text.find('\n'), text.size());
+    const std::string first = text.substr(0, firstEnd);
+    if (first == LastfmQueue::QUEUE_VERSION || first == "#FSQ2" || first == "#FSQ1")
+    {
+        blob.header = first;
+        pos = firstEnd + 1;
+    }
+    else if (!first.empty() && first[0] == '#')
+    {
+        error = "unknown queue format \"" + first + "\" (the queue loads it as empty)";
+        return false;
+    }
+
+    const bool hasSinkColumns = blob.header == LastfmQueue::QUEUE_VERSION;
+    while (pos < text.size())
+    {
+        const std::size_t end = std::min(text.find('\n', pos), text.size());
+        if (end == pos)
+        {
+            ++pos;
+            continue;
+        }
+
+        Row row;
+        for (std::size_t start = pos;;)
+        {
+            const std::size_t tab = text.find('\t', start);
+            if (tab == std::string::npos || tab >= end)
+            {
+                row.cols.emplace_back(text, start, end - start);
+                break;
+            }
+            row.cols.emplace_back(text, start, tab - start);
+            start = tab + 1;
+        }
+        pos = end + 1;
+
+        if (row.cols.size() < K_MIN_COLUMNS || std::strtoull(row.cols[10].c_str(), nullptr, 10) == 0 ||
+            row.cols[0].empty() || row.cols[1].empty() || std::atoll(row.cols[6].c_str()) <= 0)
+        {
+            ++blob.skipped;
+            continue;
+        }
+
+        // Everything is handled in the FSQ3 layout; rows from before it were queued for Last.fm only.
+        if (!hasSinkColumns || row.cols.size() <= K_SINKS_COLUMN)
+        {
+            row.cols.resize(K_FSQ2_COLUMNS, "");
+            if (row.cols[11].empty())
+                row.cols[11] = "0";
+            row.cols.push_back(std::to_string(1u << lastfm::sink::LASTFM));
+        }
+        blob.rows.push_back(std::move(row));
+    }
+    return true;
+}
+
+static unsigned sinkMask(const Row& row)
+{
+    return static_cast<unsigned>(std::strtoul(row.cols[K_SINKS_COLUMN].c_str(), nullptr, 10));
+}
+
+// Sets the mask and sizes the per-slot columns to the highest pending slot, as the queue writes them.
+static void setSinkMask(Row& row, unsigned mask)
+{
+    row.cols[K_SINKS_COLUMN] = std::to_string(mask);
+    unsigned highest = 0;
+    for (unsigned slot = 1; slot < lastfm::sink::MAX_SINKS; ++slot)
+        if (mask & (1u << slot))
+            highest = slot;
+    row.cols.resize(K_SINKS_COLUMN + 1 + highest, "0,0,0");
+}
+
+// Folds the deliveries `from` still owes into `into`, with their retry state.
+static void mergeSinks(Row& into, const Row& from)
+{
+    const unsigned have = sinkMask(into);
+    const unsigned add = sinkMask(from) & ~have;
+    if (add == 0)
+        return;
+
+    setSinkMask(into, have | add);
+    if (add & (1u << lastfm::sink::LASTFM))
+        for (std::size_t c : {8, 9, 11})
+            into.cols[c] = from.cols[c];
+    for (unsigned slot = 1; slot < lastfm::sink::MAX_SINKS; ++slot)
+        if ((add & (1u << slot)) && K_SINKS_COLUMN + slot < from.cols.size())
+            into.cols[K_SINKS_COLUMN + slot] = from.cols[K_SINKS_COLUMN + slot];
+}
+
+static std::string columnName(std::size_t c)
+{
+    if (c < std::size(K_COLUMN_NAMES))
+        return K_COLUMN_NAMES[c];
+    return std::string(sinkName(static_cast<unsigned>(c - K_SINKS_COLUMN))) + " retry";
+}
+
+static double msSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static int runStats(const Options& opt)
+{
+    std::string text, error;
+    Blob blob;
+    if (!readInput(opt, opt.in, text, error) || !parseBlob(text, blob, error))
+    {
+        std::fprintf(stderr, "queue_tool: %s\n", error.c_str());
+        return 1;
+    }
+
+    std::printf("%s: %zu bytes, %s, %zu row(s), %zu skipped on load\n", opt.in.c_str(), blob.bytes,
+                blob.header.empty() ? "headerless" : blob.header.c_str(), blob.rows.size(), blob.skipped);
+
+    const auto started = std::chrono::steady_clock::now();
+    LoadedQueue queue(text);
+    const std::size_t entries = queue->getPendingScrobbleCount();
+    std::printf("LastfmQueue: %zu entries in %.1f ms;", entries, msSince(started));
+    for (unsigned slot : {lastfm::sink::LASTFM, lastfm::sink::LISTENBRAINZ, lastfm::sink::LIBREFM})
+        std::printf(" %s %zu", sinkName(slot), queue->getPendingScrobbleCount(slot));
+    std::printf("\n");
+
+    // Age and retries from the queue's own view of the entries.
+    static constexpr std::time_t K_AGE_LIMITS[] = {0, 3600, 86400, 7 * 86400, K_LASTFM_WINDOW_SECONDS, 30 * 86400};
+    static const char* const K_AGE_LABELS[] = {"future",   "< 1 hour",  "< 1 day",   "< 7 days",
+                                               "< 14 days", "< 30 days", ">= 30 days"};
+    static constexpr int K_RETRY_LIMITS[] = {0, 1, 2, 5, 10, 20};
+    static const char* const K_RETRY_LABELS[] = {"0", "1", "2", "3-5", "6-10", "11-20", "> 20"};
+
+    std::size_t ages[std::size(K_AGE_LABELS)] = {};
+    std::size_t retries[std::size(K_RETRY_LABELS)] = {};
+    std::size_t due = 0;
+    std::time_t oldest = 0, newest = 0;
+    queue->forEachPending(
+        [&](const LastfmQueue::PendingScrobble& p)
+        {
+            const std::time_t age = opt.now - p.startTimestamp;
+            std::size_t a = 0;
+            while (a < std::size(K_AGE_LIMITS) && age >= K_AGE_LIMITS[a])
+                ++a;
+            ++ages[a];
+
+            std::size_t r = 0;
+            while (r < std::size(K_RETRY_LIMITS) && p.retryCount > K_RETRY_LIMITS[r])
+                ++r;
+            ++retries[r];
+
+            // Starts in the future (a wrong device clock) have their own bucket and stay out of oldest / newest.
+            due += p.nextRetryTimestamp <= opt.now;
+            if (age < 0)
+                return true;
+            oldest = oldest == 0 ? p.startTimestamp : std::min(oldest, p.startTimestamp);
+            newest = std::max(newest, p.startTimestamp);
+            return true;
+        });
+
+    auto bar = [&](std::size_t n)
+    {
+        const std::size_t width = entries ? (n * 40 + entries - 1) / entries : 0;
+        return std::string(width, '#');
+    };
+
+    std::printf("\nage (start time; Last.fm rejects plays older than 14 days)\n");
+    for (std::size_t i = 0; i < std::size(ages); ++i)
+        std::printf("  %-10s %9zu  %s\n", K_AGE_LABELS[i], ages[i], bar(ages[i]).c_str());
+    if (oldest > 0)
+        std::printf("  oldest %.1f days, newest %.1f days\n", (double)(opt.now - oldest) / 86400.0,
+                    (double)(opt.now - newest) / 86400.0);
+
+    std::printf("\nretries (highest over the pending sinks), %zu due now\n", due);
+    for (std::size_t i = 0; i < std::size(retries); ++i)
+        std::printf("  %-10s %9zu  %s\n", K_RETRY_LABELS[i], retries[i], bar(retries[i]).c_str());
+
+    // Duplicates and sizes from the raw rows.
+    std::unordered_map<std::uint64_t, std::size_t> seen;
+    seen.reserve(blob.rows.size());
+    std::size_t duplicates = 0;
+    std::vector<std::size_t> columnBytes;
+    std::size_t separators = 0;
+    for (const Row& row : blob.rows)
+    {
+        duplicates += !seen.emplace(playKeyOf(row), 0).second;
+        if (columnBytes.size() < row.cols.size())
+            columnBytes.resize(row.cols.size());
+        for (std::size_t c = 0; c < row.cols.size(); ++c)
+            columnBytes[c] += row.cols[c].size();
+        separators += row.cols.size();
+    }
+    std::printf("\n%zu duplicate play(s) (same start, artist and title)\n", duplicates);
+
+    std::printf("\nbytes per field%s\n", blob.header == LastfmQueue::QUEUE_VERSION ? "" : " (as FSQ3)");
+    const std::size_t rows = std::max<std::size_t>(1, blob.rows.size());
+    const double total = static_cast<double>(std::max<std::size_t>(1, blob.bytes));
+    for (std::size_t c = 0; c < columnBytes.size(); ++c)
+        std::printf("  %-20s %12zu  %7.1f/row  %5.1f%%\n", columnName(c).c_str(), columnBytes[c],
+                    (double)columnBytes[c] / (double)rows, 100.0 * (double)columnBytes[c] / total);
+    std::printf("  %-20s %12zu  %7.1f/row  %5.1f%%\n", "tabs and newlines", separators, (double)separators / rows,
+                100.0 * (double)separators / total);
+    return 0;
+}
+
+static int runCompact(const Options& opt)
+{
+    const bool fsq2 = opt.format == "fsq2";
+    if (!fsq2 && opt.format != "fsq3")
+    {
+        std::fprintf(stderr, "queue_tool: --format is fsq2 or fsq3\n");
+        return 2;
+    }
+
+    std::string text, error;
+    Blob blob;
+    if (!readInput(opt, opt.in, text, error) || !parseBlob(text, blob, error))
+    {
+        std::fprintf(stderr, "queue_tool: %s\n", error.c_str());
+        return 1;
+    }
+
+    const std::time_t cutoff = opt.expireDays > 0 ? opt.now - (std::time_t)opt.expireDays * 86400 : 0;
+    std::size_t expired = 0, merged = 0, notLastfm = 0, othersDropped = 0;
+    std::vector<Row> kept;
+    kept.reserve(blob.rows.size());
+    std::unordered_map<std::uint64_t, std::size_t> index;
+
+    for (Row& row : blob.rows)
+    {
+        if (cutoff > 0 && std::atoll(row.cols[6].c_str()) < cutoff)
+        {
+            ++expired;
+            continue;
+        }
+        if (opt.dedup)
+        {
+            const auto it = index.emplace(playKeyOf(row), kept.size());
+            if (!it.second)
+            {
+                mergeSinks(kept[it.first->second], row);
+                ++merged;
+                continue;
+            }
+        }
+        kept.push_back(std::move(row));
+    }
+
+    std::string out = fsq2 ? "#FSQ2" : LastfmQueue::QUEUE_VERSION;
+    out += '\n';
+    std::size_t written = 0;
+    for (Row& row : kept)
+    {
+        if (fsq2)
+        {
+            // FSQ2 has no sink columns: only Last.fm deliveries can be kept.
+            const unsigned sinks = sinkMask(row);
+            if ((sinks & (1u << lastfm::sink::LASTFM)) == 0)
+            {
+                ++notLastfm;
+                continue;
+            }
+            othersDropped += (sinks & ~(1u << lastfm::sink::LASTFM)) != 0;
+            row.cols.resize(K_FSQ2_COLUMNS);
+        }
+        for (std::size_t c = 0; c < row.cols.size(); ++c)
+        {
+            if (c > 0)
+                out += '\t';
+            out += row.cols[c];
+        }
+        out += '\n';
+        ++written;
+    }
+
+    const std::string tmp = opt.out + ".tmp";
+    std::FILE* f = std::fopen(tmp.c_str(), "wb");
+    const bool ok = f && std::fwrite(out.data(), 1, out.size(), f) == out.size();
+    if (f && std::fclose(f) != 0)
+        f = nullptr;
+    if (!ok || !f || std::rename(tmp.c_str(), opt.out.c_str()) != 0)
+    {
+        std::fprintf(stderr, "queue_tool: cannot write %s: %s\n", opt.out.c_str(), std::strerror(errno));
+        std::remove(tmp.c_str());
+        return 1;
+    }
+
+    std::printf("%zu row(s) in, %zu skipped (not loadable), %zu expired, %zu duplicate(s) merged", blob.rows.size(),
+                blob.skipped, expired, merged);
+    if (fsq2)
+        std::printf(", %zu not owed to Last.fm", notLastfm);
+    std::printf("\n%zu row(s) out as %s, %zu -> %zu bytes\n", written, fsq2 ? "#FSQ2" : LastfmQueue::QUEUE_VERSION,
+                blob.bytes, out.size());
+    if (othersDropped > 0)
+    {
+        std::fflush(stdout);
+        std::fprintf(stderr,
+                     "queue_tool: warning: %zu row(s) kept for Last.fm also owed other services; FSQ2 drops those "
+                     "deliveries\n",
+                     othersDropped);
+    }
+
+    // What the plugin will make of it.
+    LoadedQueue check(out);
+    std::printf("LastfmQueue loads %zu entries\n", check->getPendingScrobbleCount());
+    return 0;
+}
+
+static int runBench(const Options& opt)
+{
+    std::string text, error;
+    if (!readInput(opt, opt.in, text, error))
+    {
+        std::fprintf(stderr, "queue_tool: %s\n", error.c_str());
+        return 1;
+    }
+
+    LastfmQueue::NewScrobble extra;
+    extra.track.artist = "queue_tool";
+    extra.track.title = "bench";
+    extra.track.durationSeconds = 200.0;
+    extra.playbackSeconds = 200.0;
+    extra.startTimestamp = opt.now - 300;
+
+    // Load: parse into the cache. Cold save: the first save after a load formats every row. Warm save: later
+    // saves reuse the formatted rows.
+    std::vector<double> load, cold, warm;
+    std::size_t entries = 0, savedBytes = 0;
+    for (int i = 0; i < opt.iterations; ++i)
+    {
+        LoadedQueue queue(text);
+
+        auto t = std::chrono::steady_clock::now();
+        entries = queue->getPendingScrobbleCount();
+        load.push_back(msSince(t));
+
+        t = std::chrono::steady_clock::now();
+        queue->queueScrobblesForRetry({extra});
+        cold.push_back(msSince(t));
+
+        t = std::chrono::steady_clock::now();
+        queue->queueScrobblesForRetry({extra});
+        warm.push_back(msSince(t));
+
+        savedBytes = queue.savedBytes();
+    }
+
+    std::printf("%zu entries, %zu bytes loaded, %zu bytes saved, %d iteration(s)\n", entries, text.size(),
+                savedBytes, opt.iterations);
+    auto report = [&](const char* label, std::vector<double>& ms, std::size_t bytes)
+    {
+        std::sort(ms.begin(), ms.end());
+        const double median = ms[ms.size() / 2];
+        std::printf("  %-10s min %9.2f ms  median %9.2f ms  %8.1f MB/s\n", label, ms.front(), median,
+                    median > 0.0 ? (double)bytes / 1e3 / median : 0.0);
+    };
+    report("load", load, text.size());
+    report("save_cold", cold, savedBytes);
+    report("save_warm", warm, savedBytes);
+    return 0;
+}
+
+static void usage()
+{
+    std::fprintf(stderr,
+                 "usage: queue_tool stats FILE [--store] [--now UNIX]\n"
+                 "       queue_tool compact IN OUT [--store] [--dedup] [--expire DAYS] [--format fsq3|fsq2]\n"
+                 "                                 [--now UNIX]\n"
+                 "       queue_tool bench FILE [--store] [--iterations N] [--log]\n");
+}
+
+static bool parseArgs(int argc, char** argv, Options& opt)
+{
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string a = argv[i];
+        auto next = [&]() -> const char*
+        {
+            if (i + 1 >= argc)
+                return nullptr;
+            return argv[++i];
+        };
+        const char* v = nullptr;
+        if (a == "--store")
+            opt.store = true;
+        else if (a == "--dedup")
+            opt.dedup = true;
+        else if (a == "--log")
+            lfmLogLevel.store(static_cast<int>(LfmLogLevel::DEBUG_LOG));
+        else if (a.rfind("--", 0) != 0)
+            positional.push_back(a);
+        else if (!(v = next()))
+            return false;
+        else if (a == "--expire")
+            opt.expireDays = std::atoi(v);
+        else if (a == "--format")
+            opt.format = v;
+        else if (a == "--now")
+            opt.now = static_cast<std::time_t>(std::atoll(v));
+        else if (a == "--iterations")
+            opt.iterations = std::atoi(v);
+        else
+            return false;
+    }
+
+    if (positional.empty())
+        return false;
+    opt.command = positional[0];
+    if (opt.now <= 0)
+        opt.now = std::time(nullptr);
+
+    const std::size_t files = opt.command == "compact" ? 2 : 1;
+    if (positional.size() != files + 1 || opt.iterations <= 0 || opt.expireDays < 0)
+        return false;
+    opt.in = positional[1];
+    if (files == 2)
+        opt.out = positional[2];
+    return opt.command == "stats" || opt.command == "compact" || opt.command == "bench";
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parseArgs(argc, argv, opt))
+    {
+        usage();
+        return 2;
+    }
+
+    int rc = 0;
+    if (opt.command == "stats")
+        rc = runStats(opt);
+    else if (opt.command == "compact")
+        rc = runCompact(opt);
+    else
+        rc = runBench(opt);
+
+    lastfmLogShutdown();
+    return rc;
+}
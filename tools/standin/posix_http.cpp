@@ -0,0 +1,234 @@
+//
+//  posix_http.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+
+#include "posix_http.h"
+
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+struct ParsedUrl
+{
+    std::string host;
+    std::string port = "80";
+    std::string target = "/"; // path + query
+};
+
+static bool parseUrl(const std::string& url, ParsedUrl& out, std::string& error)
+{
+    static const char* scheme = "http://";
+    if (url.compare(0, std::strlen(scheme), scheme) != 0)
+    {
+        error = "only http:// URLs are supported";
+        return false;
+    }
+
+    const std::size_t hostStart = std::strlen(scheme);
+    const std::size_t slash = url.find('/', hostStart);
+    const std::string authority =
+        url.substr(hostStart, slash == std::string::npos ? std::string::npos : slash - hostStart);
+    if (slash != std::string::npos)
+        out.target = url.substr(slash);
+
+    const std::size_t colon = authority.rfind(':');
+    if (colon != std::string::npos)
+    {
+        out.host = authority.substr(0, colon);
+        out.port = authority.substr(colon + 1);
+    }
+    else
+    {
+        out.host = authority;
+    }
+
+    if (out.host.empty())
+    {
+        error = "URL has no host";
+        return false;
+    }
+    return true;
+}
+
+static int connectTo(const ParsedUrl& u, int timeoutMs, std::string& error)
+{
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* res = nullptr;
+    const int rc = getaddrinfo(u.host.c_str(), u.port.c_str(), &hints, &res);
+    if (rc != 0)
+    {
+        error = std::string("resolve failed: ") + gai_strerror(rc);
+        return -1;
+    }
+
+    int fd = -1;
+    for (addrinfo* ai = res; ai; ai = ai->ai_next)
+    {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+
+        timeval tv{};
+        tv.tv_sec = timeoutMs / 1000;
+        tv.tv_usec = (timeoutMs % 1000) * 1000;
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+            break;
+
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+
+    if (fd < 0)
+        error = std::string("connect failed: ") + std::strerror(errno);
+    return fd;
+}
+
+static bool sendAll(int fd, const std::string& data)
+{
+    std::size_t off = 0;
+    while (off < data.size())
+    {
+        const ssize_t n = send(fd, data.data() + off, data.size() - off, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        off += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+} // namespace
+
+bool PosixHttpTransport::request(const char* method, const std::string& url, std::string& outBody,
+                                 std::string& outError)
+{
+    return exchange(method, url, {}, nullptr, std::string(), outBody, outError);
+}
+
+bool PosixHttpTransport::post(const std::string& url, const std::vector<LastfmHttpHeader>& headers,
+                              const char* contentType, const std::string& body, std::string& outBody,
+                              std::string& outError)
+{
+    return exchange("POST", url, headers, contentType, body, outBody, outError);
+}
+
+bool PosixHttpTransport::exchange(const char* method, const std::string& url,
+                                  const std::vector<LastfmHttpHeader>& headers, const char* contentType,
+                                  const std::string& body, std::string& outBody, std::string& outError)
+{
+    outBody.clear();
+    outError.clear();
+
+    ParsedUrl u;
+    if (!parseUrl(url, u, outError))
+        return false;
+
+    const int fd = connectTo(u, timeoutMs_, outError);
+    if (fd < 0)
+        return false;
+
+    std::string req;
+    req.reserve(u.target.size() + body.size() + 256);
+    req += method;
+    req += ' ';
+    req += u.target;
+    req += " HTTP/1.1\r\nHost: ";
+    req += u.host;
+    for (const LastfmHttpHeader& h : headers)
+    {
+        req += "\r\n";
+        req += h.name;
+        req += ": ";
+        req += h.value;
+    }
+    if (contentType)
+    {
+        req += "\r\nContent-Type: ";
+        req += contentType;
+    }
+    req += "\r\nContent-Length: ";
+    req += std::to_string(body.size());
+    req += "\r\nConnection: close\r\n\r\n";
+    req += body;
+
+    if (!sendAll(fd, req))
+    {
+        outError = std::string("send failed: ") + std::strerror(errno);
+        close(fd);
+        return false;
+    }
+
+    // Connection: close, so the response ends at EOF.
+    std::string raw;
+    char buf[16384];
+    for (;;)
+    {
+        const ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+        {
+            outError = std::string("receive failed: ") + std::strerror(errno);
+            close(fd);
+            return false;
+        }
+        if (n == 0)
+            break;
+        raw.append(buf, static_cast<std::size_t>(n));
+    }
+    close(fd);
+
+    const std::size_t headerEnd = raw.find("\r\n\r\n");
+    if (raw.compare(0, 5, "HTTP/") != 0 || headerEnd == std::string::npos)
+    {
+        outError = "malformed HTTP response";
+        return false;
+    }
+
+    outBody = raw.substr(headerEnd + 4);
+    return true;
+}
+
+std::string posixHttpUrlDecode(const std::string& in)
+{
+    std::string out;
+    out.reserve(in.size());
+    for (std::size_t i = 0; i < in.size(); ++i)
+    {
+        const char c = in[i];
+        if (c == '+')
+        {
+            out.push_back(' ');
+        }
+        else if (c == '%' && i + 2 < in.size() && std::isxdigit((unsigned char)in[i + 1]) &&
+                 std::isxdigit((unsigned char)in[i + 2]))
+        {
+            const char hex[3] = {in[i + 1], in[i + 2], 0};
+            out.push_back(static_cast<char>(std::strtol(hex, nullptr, 16)));
+            i += 2;
+        }
+        else
+        {
+            out.push_back(c);
+        }
+    }
+    return out;
+}
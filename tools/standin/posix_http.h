@@ -0,0 +1,39 @@
+//
+//  posix_http.h
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+//  Plain-HTTP transport over POSIX sockets for the Linux tools. One connection per request, no TLS: meant for
+//  the local stand-in server, not for ws.audioscrobbler.com.
+//
+
+#pragma once
+
+#include "lastfm_http.h"
+
+#include <string>
+#include <vector>
+
+class PosixHttpTransport final : public ILastfmHttpTransport
+{
+  public:
+    explicit PosixHttpTransport(int timeoutMs = 30000) : timeoutMs_(timeoutMs)
+    {
+    }
+
+    // Any HTTP status counts as a response: Last.fm sends its JSON errors with 4xx/5xx codes.
+    bool request(const char* method, const std::string& url, std::string& outBody, std::string& outError) override;
+
+    bool post(const std::string& url, const std::vector<LastfmHttpHeader>& headers, const char* contentType,
+              const std::string& body, std::string& outBody, std::string& outError) override;
+
+  private:
+    bool exchange(const char* method, const std::string& url, const std::vector<LastfmHttpHeader>& headers,
+                  const char* contentType, const std::string& body, std::string& outBody, std::string& outError);
+
+    int timeoutMs_;
+};
+
+// Decodes %XX and '+' (form encoding).
+std::string posixHttpUrlDecode(const std::string& in);
@@ -0,0 +1,458 @@
+//
+//  standin_load.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+//  End-to-end drain load test: the real LastfmWorker, LastfmQueue and LastfmWebApi over HTTP against
+//  standin_server (or anything else speaking the 2.0 API on plain http://). Authenticates through
+//  auth.getToken / auth.getSession, queues a backlog in one batch, lets the worker drain it on wall-clock time
+//  and reports throughput, per-request latency and what the server answered. With --listenbrainz the backlog is
+//  also delivered through the ListenBrainz sink (bulk submit-listens, same server by default).
+//
+//  Build (one line, from tools/standin/):
+//
+//  c++ -std=c++20 -O2 -I../../src standin_load.cpp posix_http.cpp ../../src/lastfm_{worker,queue,scrobble_sink,budget,drain_planner,clock,config_store}.cpp ../../src/lastfm_{request,web_api,util,log,json_writer,listenbrainz}.cpp -lpthread -o standin_load
+//
+//  ./standin_server --latency 20 --error16 0.01 &
+//  ./standin_load --backlog 10000 --listenbrainz
+//
+
+#include "lastfm_config_store.h"
+#include "lastfm_listenbrainz.h"
+#include "lastfm_log.h"
+#include "lastfm_queue.h"
+#include "lastfm_request.h"
+#include "lastfm_scrobble_api.h"
+#include "lastfm_util.h"
+#include "lastfm_web_api.h"
+#include "lastfm_worker.h"
+#include "posix_http.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+std::atomic<int> lfmLogLevel{static_cast<int>(LfmLogLevel::OFF)};
+
+namespace
+{
+struct Options
+{
+    std::string url = "http://127.0.0.1:8450/2.0/";
+    std::string apiKey = "standin-api-key";
+    std::string apiSecret = "standin-api-secret";
+    bool listenBrainz = false;
+    std::string lbUrl = "http://127.0.0.1:8450/";
+    std::string lbToken = "standin-lb-token";
+    int backlog = 1000;
+    int spanDays = 7; // backlog start times spread over this many days before now
+    int budget = 0;   // 0 = unlimited
+    int cooldownSeconds = 0;
+    int timeoutSeconds = 600;
+    int httpTimeoutMs = 30000;
+};
+
+// Times every request and tallies what came back. Called on the worker thread and from main().
+class MeasuringTransport final : public ILastfmHttpTransport
+{
+  public:
+    explicit MeasuringTransport(ILastfmHttpTransport& inner) : inner_(inner)
+    {
+    }
+
+    bool request(const char* method, const std::string& url, std::string& outBody, std::string& outError) override
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const bool ok = inner_.request(method, url, outBody, outError);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        const bool isScrobble = url.find("method=track.scrobble") != std::string::npos;
+        const lastfm::util::LastfmApiErrorInfo info = lastfm::util::extractLastfmApiError(outBody.c_str());
+        int ignored = 0;
+        if (ok && isScrobble && !info.hasError)
+            lastfm::util::jsonFindIntValue(outBody.c_str(), "ignored", ignored);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        (isScrobble ? scrobbleMs : otherMs).push_back(ms);
+        if (!ok)
+            ++transportFailures;
+        else if (info.hasError)
+            ++errorsByCode[info.errorCode];
+        ignoredScrobbles += static_cast<unsigned>(ignored);
+        return ok;
+    }
+
+    bool post(const std::string& url, const std::vector<LastfmHttpHeader>& headers, const char* contentType,
+              const std::string& body, std::string& outBody, std::string& outError) override
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const bool ok = inner_.post(url, headers, contentType, body, outBody, outError);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        int code = 0;
+        const bool hasError = ok && lastfm::util::jsonFindIntValue(outBody.c_str(), "code", code);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        listensMs.push_back(ms);
+        if (!ok)
+            ++transportFailures;
+        else if (hasError)
+            ++lbErrorsByStatus[code];
+        return ok;
+    }
+
+    template <typename F> void inspect(F&& f)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        f(*this);
+    }
+
+    std::vector<double> scrobbleMs;
+    std::vector<double> otherMs;
+    std::vector<double> listensMs;
+    std::map<int, unsigned> errorsByCode;
+    std::map<int, unsigned> lbErrorsByStatus;
+    unsigned transportFailures = 0;
+    unsigned ignoredScrobbles = 0;
+
+  private:
+    ILastfmHttpTransport& inner_;
+    std::mutex mutex_;
+};
+
+// Session state shared by the Web API (credentials per request) and main() (re-authentication).
+class Session
+{
+  public:
+    Session(ILastfmHttpTransport& http, const Options& opt) : http_(http), opt_(opt)
+    {
+    }
+
+    // auth.getToken, then auth.getSession; the stand-in authorizes tokens on issue.
+    bool authenticate(std::string& error)
+    {
+        lastfm::request::Params params{{"method", "auth.getToken"}, {"api_key", opt_.apiKey}};
+        std::string body;
+        if (!http_.request("GET", lastfm::request::signedUrl(opt_.url, params, opt_.apiSecret), body, error))
+            return false;
+
+        std::string token;
+        if (!lastfm::util::jsonFindStringValue(body.c_str(), "token", token))
+        {
+            error = "auth.getToken: " + body;
+            return false;
+        }
+
+        params = {{"method", "auth.getSession"}, {"api_key", opt_.apiKey}, {"token", token}};
+        if (!http_.request("GET", lastfm::request::signedUrl(opt_.url, params, opt_.apiSecret), body, error))
+            return false;
+
+        std::string key;
+        if (!lastfm::util::jsonFindStringValue(body.c_str(), "key", key))
+        {
+            error = "auth.getSession: " + body;
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        sessionKey_ = key;
+        return true;
+    }
+
+    LastfmApiCredentials credentials()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        LastfmApiCredentials c;
+        c.apiKey = opt_.apiKey;
+        c.apiSecret = opt_.apiSecret;
+        c.sessionKey = sessionKey_;
+        c.username = sessionKey_.empty() ? "" : "standin"; // the name standin_server hands out with every session
+        return c;
+    }
+
+  private:
+    ILastfmHttpTransport& http_;
+    const Options& opt_;
+    std::mutex mutex_;
+    std::string sessionKey_;
+};
+
+// Stands in for LastfmClient.
+class WebApiClient final : public ILastfmScrobbleApi
+{
+  public:
+    WebApiClient(LastfmWebApi& api, Session& session) : api_(api), session_(session)
+    {
+    }
+
+    bool isAuthenticated() const override
+    {
+        return !session_.credentials().sessionKey.empty();
+    }
+
+    bool isSuspended() const override
+    {
+        return false;
+    }
+
+    bool updateNowPlaying(const LastfmTrackInfo& track) override
+    {
+        return api_.updateNowPlaying(track);
+    }
+
+    LastfmScrobbleResult scrobble(const LastfmTrackInfo& track, double playbackSeconds,
+                                  std::time_t startTimestamp) override
+    {
+        const LastfmScrobbleResult r = api_.scrobble(track, playbackSeconds, startTimestamp);
+        if (r == LastfmScrobbleResult::SUCCESS)
+            ++succeeded;
+        return r;
+    }
+
+    std::atomic<unsigned> succeeded{0};
+
+  private:
+    LastfmWebApi& api_;
+    Session& session_;
+};
+
+static double percentile(std::vector<double>& v, double p)
+{
+    if (v.empty())
+        return -1.0;
+    const std::size_t i = std::min(v.size() - 1, static_cast<std::size_t>(p * static_cast<double>(v.size())));
+    std::nth_element(v.begin(), v.begin() + static_cast<std::ptrdiff_t>(i), v.end());
+    return v[i];
+}
+
+static void printLatency(const char* label, std::vector<double> v)
+{
+    if (v.empty())
+    {
+        std::printf("  %-10s        -\n", label);
+        return;
+    }
+    const double p50 = percentile(v, 0.50);
+    const double p90 = percentile(v, 0.90);
+    const double p99 = percentile(v, 0.99);
+    const double max = *std::max_element(v.begin(), v.end());
+    std::printf("  %-10s %8zu  p50 %8.2fms  p90 %8.2fms  p99 %8.2fms  max %8.2fms\n", label, v.size(), p50, p90,
+                p99, max);
+}
+
+static void usage()
+{
+    std::fprintf(stderr,
+                 "usage: standin_load [--url URL] [--key K] [--secret S] [--backlog N] [--span-days N]\n"
+                 "                    [--budget N] [--cooldown S] [--timeout S] [--http-timeout MS] [--log]\n"
+                 "                    [--listenbrainz] [--lb-url URL] [--lb-token T]\n");
+}
+
+static bool parseArgs(int argc, char** argv, Options& opt)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string a = argv[i];
+        auto next = [&]() -> const char*
+        {
+            if (i + 1 >= argc)
+                return nullptr;
+            return argv[++i];
+        };
+        const char* v = nullptr;
+        if (a == "--log")
+            lfmLogLevel.store(static_cast<int>(LfmLogLevel::DEBUG_LOG));
+        else if (a == "--listenbrainz")
+            opt.listenBrainz = true;
+        else if (!(v = next()))
+            return false;
+        else if (a == "--url")
+            opt.url = v;
+        else if (a == "--key")
+            opt.apiKey = v;
+        else if (a == "--secret")
+            opt.apiSecret = v;
+        else if (a == "--lb-url")
+            opt.lbUrl = v;
+        else if (a == "--lb-token")
+            opt.lbToken = v;
+        else if (a == "--backlog")
+            opt.backlog = std::atoi(v);
+        else if (a == "--span-days")
+            opt.spanDays = std::atoi(v);
+        else if (a == "--budget")
+            opt.budget = std::atoi(v);
+        else if (a == "--cooldown")
+            opt.cooldownSeconds = std::atoi(v);
+        else if (a == "--timeout")
+            opt.timeoutSeconds = std::atoi(v);
+        else if (a == "--http-timeout")
+            opt.httpTimeoutMs = std::atoi(v);
+        else
+            return false;
+    }
+    return opt.backlog >= 0 && opt.spanDays >= 0 && opt.budget >= 0 && opt.timeoutSeconds > 0;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parseArgs(argc, argv, opt))
+    {
+        usage();
+        return 2;
+    }
+
+    PosixHttpTransport posix(opt.httpTimeoutMs);
+    MeasuringTransport http(posix);
+    Session session(http, opt);
+
+    std::string error;
+    if (!session.authenticate(error))
+    {
+        std::fprintf(stderr, "authentication against %s failed: %s\n", opt.url.c_str(), error.c_str());
+        return 1;
+    }
+
+    LastfmMemoryConfigStore config;
+    config.setInt(lastfm::config::DAILY_BUDGET, opt.budget > 0 ? opt.budget : 1000000000);
+    config.setInt(lastfm::config::DRAIN_COOLDOWN_SECONDS, opt.cooldownSeconds);
+
+    LastfmWebApi api(http, [&session] { return session.credentials(); }, opt.url);
+    WebApiClient client(api, session);
+
+    // Error 9 blocks the worker like in the plugin; main() re-authenticates and unblocks it.
+    std::atomic<bool> needsReauth{false};
+    LastfmWorker* workerPtr = nullptr;
+    LastfmQueue queue(
+        client,
+        [&]
+        {
+            if (workerPtr)
+                workerPtr->postInvalidSession();
+            needsReauth.store(true);
+        },
+        config);
+
+    LastfmListenBrainzSink listenBrainz(http, [&opt] { return opt.lbToken; }, opt.lbUrl);
+    if (opt.listenBrainz)
+        queue.addSink(lastfm::sink::LISTENBRAINZ, listenBrainz);
+
+    {
+        std::vector<LastfmQueue::NewScrobble> batch;
+        batch.reserve(static_cast<std::size_t>(opt.backlog));
+        const std::time_t now = std::time(nullptr);
+        const std::time_t span = static_cast<std::time_t>(opt.spanDays) * 86400;
+        for (int i = 0; i < opt.backlog; ++i)
+        {
+            LastfmQueue::NewScrobble s;
+            s.track.artist = "Artist " + std::to_string(i % 997);
+            s.track.title = "Title " + std::to_string(i);
+            s.track.album = "Album " + std::to_string(i % 113);
+            s.track.durationSeconds = 240.0;
+            s.playbackSeconds = 240.0;
+            s.startTimestamp = now - span + (span * i) / std::max(1, opt.backlog) - 240;
+            batch.push_back(std::move(s));
+        }
+        queue.queueScrobblesForRetry(batch);
+    }
+
+    // Same configuration LastfmScrobbler builds.
+    LastfmWorker::Config cfg;
+    cfg.drainEnabled = [&queue]() { return queue.drainEnabled(); };
+    cfg.drainMinInterval = queue.drainCooldown();
+    LastfmWorker worker(client, queue, cfg);
+    workerPtr = &worker;
+
+    std::printf("draining %d scrobble(s) against %s%s%s\n", opt.backlog, opt.url.c_str(),
+                opt.listenBrainz ? " and " : "", opt.listenBrainz ? opt.lbUrl.c_str() : "");
+    std::fflush(stdout);
+
+    using namespace std::chrono;
+    const auto start = steady_clock::now();
+    const auto deadline = start + seconds(opt.timeoutSeconds);
+    auto nextProgress = start + seconds(5);
+    unsigned reauths = 0;
+
+    worker.start();
+    worker.postDrain();
+
+    std::size_t pending = queue.getPendingScrobbleCount();
+    while (pending > 0 && steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(milliseconds(50));
+
+        if (needsReauth.exchange(false))
+        {
+            if (!session.authenticate(error))
+            {
+                std::fprintf(stderr, "re-authentication failed: %s\n", error.c_str());
+                break;
+            }
+            ++reauths;
+            worker.postAuthRecovered();
+            worker.postDrain();
+        }
+
+        pending = queue.getPendingScrobbleCount();
+        if (steady_clock::now() >= nextProgress)
+        {
+            std::printf("  %6.1fs  pending %zu (ListenBrainz %zu), accepted %u\n",
+                        duration<double>(steady_clock::now() - start).count(), pending,
+                        queue.getPendingScrobbleCount(lastfm::sink::LISTENBRAINZ), client.succeeded.load());
+            std::fflush(stdout);
+            nextProgress += seconds(5);
+        }
+    }
+
+    const double elapsed = duration<double>(steady_clock::now() - start).count();
+    worker.stop();
+    workerPtr = nullptr;
+
+    const unsigned accepted = client.succeeded.load();
+    std::printf("\n%s in %.2f s: accepted %u, still pending %zu, re-authenticated %u time(s)\n",
+                pending == 0 ? "drained" : "timed out", elapsed, accepted, pending, reauths);
+    std::printf("throughput %.1f scrobbles/s\n", elapsed > 0.0 ? accepted / elapsed : 0.0);
+    if (opt.listenBrainz)
+    {
+        const std::size_t lbPending = queue.getPendingScrobbleCount(lastfm::sink::LISTENBRAINZ);
+        std::printf("ListenBrainz: delivered %zu, still pending %zu\n",
+                    static_cast<std::size_t>(opt.backlog) - lbPending, lbPending);
+    }
+
+    http.inspect(
+        [&](MeasuringTransport& t)
+        {
+            std::printf("\nrequest latency:\n");
+            printLatency("scrobble", t.scrobbleMs);
+            printLatency("other", t.otherMs);
+            printLatency("listens", t.listensMs);
+
+            std::printf("\nserver answers: ignored scrobbles %u, transport failures %u, API errors:",
+                        t.ignoredScrobbles, t.transportFailures);
+            if (t.errorsByCode.empty())
+                std::printf(" none");
+            for (const auto& kv : t.errorsByCode)
+                std::printf(" %d=%u", kv.first, kv.second);
+            if (!t.lbErrorsByStatus.empty())
+            {
+                std::printf("\nListenBrainz errors:");
+                for (const auto& kv : t.lbErrorsByStatus)
+                    std::printf(" %d=%u", kv.first, kv.second);
+            }
+            std::printf("\n");
+        });
+
+    lastfmLogShutdown();
+    return pending == 0 ? 0 : 1;
+}
@@ -0,0 +1,750 @@
+//
+//  standin_server.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+//  Local stand-in for the Last.fm 2.0 API, for end-to-end drain load tests (see standin_load.cpp).
+//  Implements auth.getToken, auth.getSession (tokens are authorized immediately), track.updateNowPlaying
+//  and track.scrobble (single or batched artist[i]/track[i]/timestamp[i], up to 50), with api_sig
+//  verification. Also ListenBrainz POST /1/submit-listens (up to 1000 listens, "Authorization: Token ...").
+//  Faults: per-request latency, error 29 bursts, random error 9/11/16, ignoredMessage answers; on the
+//  ListenBrainz route they answer 429, 401 and 503. Prints counters on SIGINT/SIGTERM.
+//
+//  Build (one line, from tools/standin/):
+//
+//  c++ -std=c++20 -O2 -I../../src standin_server.cpp posix_http.cpp ../../src/lastfm_{request,util,log}.cpp -lpthread -o standin_server
+//
+
+#include "lastfm_log.h"
+#include "lastfm_request.h"
+#include "lastfm_util.h"
+#include "posix_http.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+std::atomic<int> lfmLogLevel{static_cast<int>(LfmLogLevel::OFF)};
+
+namespace
+{
+static constexpr int K_MAX_BATCH = 50;
+static constexpr std::size_t K_MAX_LISTENS = 1000;
+static constexpr std::time_t K_MAX_AGE_SECONDS = 14 * 24 * 3600;
+static constexpr std::time_t K_MAX_FUTURE_SECONDS = 24 * 3600;
+static constexpr std::size_t K_MAX_REQUEST_BYTES = 1 << 20;
+
+struct Options
+{
+    int port = 8450;
+    std::string apiKey = "standin-api-key";
+    std::string apiSecret = "standin-api-secret";
+    std::string lbToken = "standin-lb-token";
+    int latencyMs = 0;
+    int jitterMs = 0;
+    int burst29Every = 0; // every N track.* requests ...
+    int burst29Length = 0; // ... the next M answer error 29
+    double error9Rate = 0.0;
+    double error11Rate = 0.0;
+    double error16Rate = 0.0;
+    double ignoredRate = 0.0;
+    unsigned seed = 1;
+    int statsEverySeconds = 0;
+};
+
+struct Reply
+{
+    int status = 200;
+    std::string body;
+};
+
+static std::atomic<bool> stopRequested{false};
+
+static void onSignal(int)
+{
+    stopRequested.store(true);
+}
+
+static std::string jsonEscape(const std::string& in)
+{
+    std::string out;
+    out.reserve(in.size() + 8);
+    for (unsigned char c : in)
+    {
+        switch (c)
+        {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            if (c < 0x20)
+            {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            }
+            else
+            {
+                out.push_back(static_cast<char>(c));
+            }
+            break;
+        }
+    }
+    return out;
+}
+
+static Reply apiError(int code, const char* message)
+{
+    Reply r;
+    switch (code)
+    {
+    case 9:
+        r.status = 403;
+        break;
+    case 11:
+    case 16:
+        r.status = 503;
+        break;
+    case 29:
+        r.status = 429;
+        break;
+    default:
+        r.status = 400;
+        break;
+    }
+    r.body = "{\"error\":" + std::to_string(code) + ",\"message\":\"" + jsonEscape(message) + "\"}";
+    return r;
+}
+
+// ListenBrainz errors carry the HTTP status as their code.
+static Reply lbError(int status, const char* message)
+{
+    return {status, "{\"code\":" + std::to_string(status) + ",\"error\":\"" + jsonEscape(message) + "\"}"};
+}
+
+static std::size_t countOccurrences(const std::string& s, const char* needle)
+{
+    std::size_t n = 0;
+    for (std::size_t pos = s.find(needle); pos != std::string::npos; pos = s.find(needle, pos + 1))
+        ++n;
+    return n;
+}
+
+static void parseForm(const std::string& s, lastfm::request::Params& out)
+{
+    std::size_t pos = 0;
+    while (pos < s.size())
+    {
+        std::size_t amp = s.find('&', pos);
+        if (amp == std::string::npos)
+            amp = s.size();
+
+        const std::string pair = s.substr(pos, amp - pos);
+        const std::size_t eq = pair.find('=');
+        if (!pair.empty())
+        {
+            if (eq == std::string::npos)
+                out[posixHttpUrlDecode(pair)] = "";
+            else
+                out[posixHttpUrlDecode(pair.substr(0, eq))] = posixHttpUrlDecode(pair.substr(eq + 1));
+        }
+        pos = amp + 1;
+    }
+}
+
+class StandinService
+{
+  public:
+    explicit StandinService(const Options& opt) : opt_(opt), rng_(opt.seed)
+    {
+    }
+
+    Reply handle(const lastfm::request::Params& params)
+    {
+        const auto get = [&](const char* k) -> std::string
+        {
+            auto it = params.find(k);
+            return it == params.end() ? std::string() : it->second;
+        };
+
+        const std::string method = get("method");
+        count(requestsByMethod_, method.empty() ? "(none)" : method);
+
+        if (opt_.latencyMs > 0 || opt_.jitterMs > 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(opt_.latencyMs + jitter()));
+
+        if (method.empty())
+            return fail(6, "Invalid parameters - method missing");
+        if (get("api_key") != opt_.apiKey)
+            return fail(10, "Invalid API key - You must be granted a valid key by last.fm");
+        if (!signatureValid(params))
+            return fail(13, "Invalid method signature supplied");
+
+        if (method == "auth.getToken")
+            return getToken();
+        if (method == "auth.getSession")
+            return getSession(get("token"));
+
+        if (method != "track.updateNowPlaying" && method != "track.scrobble")
+            return fail(3, "Invalid Method - No method with that name in this package");
+
+        if (!sessionValid(get("sk")))
+            return fail(9, "Invalid session key - Please re-authenticate");
+
+        if (int code = injectedError())
+        {
+            switch (code)
+            {
+            case 29:
+                return fail(29, "Rate Limit Exceeded - Your IP has made too many requests in a short period");
+            case 9:
+                return fail(9, "Invalid session key - Please re-authenticate");
+            case 11:
+                return fail(11, "Service Offline - This service is temporarily offline. Try again later.");
+            default:
+                return fail(16, "There was a temporary error processing your request. Please try again");
+            }
+        }
+
+        if (method == "track.updateNowPlaying")
+            return nowPlaying(params);
+        return scrobble(params);
+    }
+
+    // POST /1/submit-listens. The payload is checked by counting fields rather than parsed: enough to catch a
+    // listen without artist or track, or a request over the server's limit.
+    Reply submitListens(const std::string& authorization, const std::string& body)
+    {
+        count(requestsByMethod_, "submit-listens");
+
+        if (opt_.latencyMs > 0 || opt_.jitterMs > 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(opt_.latencyMs + jitter()));
+
+        if (authorization != "Token " + opt_.lbToken)
+            return lbFail(401, "Invalid authorization token.");
+
+        std::string listenType;
+        const bool parsed = !body.empty() && body.front() == '{' &&
+                            lastfm::util::jsonFindStringValue(body.c_str(), "listen_type", listenType);
+        if (!parsed)
+            return lbFail(400, "Cannot parse JSON document.");
+        if (listenType != "import" && listenType != "single")
+            return lbFail(400, "JSON document must contain a valid listen_type.");
+
+        const std::size_t listens = countOccurrences(body, "\"listened_at\":");
+        if (listens == 0)
+            return lbFail(400, "JSON document has no listens.");
+        if (listens > K_MAX_LISTENS)
+            return lbFail(400, "Too many listens. You may not submit more than 1000 listens at once.");
+        if (countOccurrences(body, "\"artist_name\":") != listens ||
+            countOccurrences(body, "\"track_name\":") != listens)
+            return lbFail(400, "JSON document does not contain artist_name and track_name for every listen.");
+
+        switch (injectedError())
+        {
+        case 0:
+            break;
+        case 29:
+            return lbFail(429, "Too many requests.");
+        case 9:
+            return lbFail(401, "Invalid authorization token.");
+        default:
+            return lbFail(503, "Service temporarily unavailable.");
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            listens_ += listens;
+        }
+        return {200, "{\"status\":\"ok\"}"};
+    }
+
+    void printStats()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::printf("requests:");
+        for (const auto& kv : requestsByMethod_)
+            std::printf(" %s=%llu", kv.first.c_str(), kv.second);
+        std::printf("\nscrobbles: accepted %llu, ignored %llu", accepted_, ignored_);
+        std::printf("\nlistens: accepted %llu", listens_);
+        std::printf("\nerrors:");
+        if (errorsByCode_.empty())
+            std::printf(" none");
+        for (const auto& kv : errorsByCode_)
+            std::printf(" %s=%llu", kv.first.c_str(), kv.second);
+        std::printf("\n");
+        std::fflush(stdout);
+    }
+
+  private:
+    struct Ignore
+    {
+        int code = 0;
+        const char* text = "";
+    };
+
+    void count(std::map<std::string, unsigned long long>& m, const std::string& key)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++m[key];
+    }
+
+    int jitter()
+    {
+        if (opt_.jitterMs <= 0)
+            return 0;
+        std::lock_guard<std::mutex> lock(mutex_);
+        return std::uniform_int_distribution<int>(0, opt_.jitterMs)(rng_);
+    }
+
+    Reply fail(int code, const char* message)
+    {
+        count(errorsByCode_, std::to_string(code));
+        return apiError(code, message);
+    }
+
+    Reply lbFail(int status, const char* message)
+    {
+        count(errorsByCode_, "http" + std::to_string(status));
+        return lbError(status, message);
+    }
+
+    bool signatureValid(const lastfm::request::Params& params) const
+    {
+        auto sig = params.find("api_sig");
+        if (sig == params.end())
+            return false;
+
+        lastfm::request::Params signedParams = params;
+        signedParams.erase("api_sig");
+        signedParams.erase("format");
+        signedParams.erase("callback");
+        return lastfm::request::signature(signedParams, opt_.apiSecret) == sig->second;
+    }
+
+    bool sessionValid(const std::string& sk)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return !sk.empty() && sessions_.count(sk) != 0;
+    }
+
+    // 0, or the error a track.* request answers with.
+    int injectedError()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const unsigned long long n = trackRequests_++;
+        if (opt_.burst29Every > 0 && opt_.burst29Length > 0)
+        {
+            const unsigned long long period = static_cast<unsigned long long>(opt_.burst29Every + opt_.burst29Length);
+            if (n % period >= static_cast<unsigned long long>(opt_.burst29Every))
+                return 29;
+        }
+
+        const double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng_);
+        if (u < opt_.error9Rate)
+            return 9;
+        if (u < opt_.error9Rate + opt_.error11Rate)
+            return 11;
+        if (u < opt_.error9Rate + opt_.error11Rate + opt_.error16Rate)
+            return 16;
+        return 0;
+    }
+
+    std::string randomHex(std::size_t n)
+    {
+        static const char hex[] = "0123456789abcdef";
+        std::string out;
+        std::uniform_int_distribution<int> d(0, 15);
+        for (std::size_t i = 0; i < n; ++i)
+            out.push_back(hex[d(rng_)]);
+        return out;
+    }
+
+    Reply getToken()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const std::string token = randomHex(32);
+        tokens_.insert(token);
+        return {200, "{\"token\":\"" + token + "\"}"};
+    }
+
+    Reply getSession(const std::string& token)
+    {
+        std::string key;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (tokens_.erase(token) == 1)
+            {
+                key = randomHex(32);
+                sessions_.insert(key);
+            }
+        }
+        if (key.empty())
+            return fail(4, "Invalid authentication token supplied");
+
+        return {200, "{\"session\":{\"name\":\"standin\",\"key\":\"" + key + "\",\"subscriber\":0}}"};
+    }
+
+    Ignore ignoreFor(std::time_t timestamp)
+    {
+        const std::time_t now = std::time(nullptr);
+        if (timestamp < now - K_MAX_AGE_SECONDS)
+            return {3, "Timestamp too old"};
+        if (timestamp > now + K_MAX_FUTURE_SECONDS)
+            return {2, "Timestamp too new"};
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (opt_.ignoredRate > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(rng_) < opt_.ignoredRate)
+            return {1, "Artist was ignored"};
+        return {};
+    }
+
+    static std::string corrected(const char* name, const std::string& value)
+    {
+        return "\"" + std::string(name) + "\":{\"corrected\":\"0\",\"#text\":\"" + jsonEscape(value) + "\"}";
+    }
+
+    Reply nowPlaying(const lastfm::request::Params& params)
+    {
+        auto get = [&](const char* k)
+        {
+            auto it = params.find(k);
+            return it == params.end() ? std::string() : it->second;
+        };
+
+        if (get("artist").empty() || get("track").empty())
+            return fail(6, "Invalid parameters - artist and track are required");
+
+        return {200, "{\"nowplaying\":{" + corrected("artist", get("artist")) + "," + corrected("track", get("track")) +
+                         "," + corrected("album", get("album")) + "," + corrected("albumArtist", get("albumArtist")) +
+                         ",\"ignoredMessage\":{\"code\":\"0\",\"#text\":\"\"}}}"};
+    }
+
+    Reply scrobble(const lastfm::request::Params& params)
+    {
+        auto get = [&](const std::string& k)
+        {
+            auto it = params.find(k);
+            return it == params.end() ? std::string() : it->second;
+        };
+
+        const bool batched = params.count("artist[0]") != 0;
+        std::vector<std::string> items;
+        unsigned accepted = 0;
+        unsigned ignored = 0;
+
+        for (int i = 0; i < (batched ? K_MAX_BATCH : 1); ++i)
+        {
+            const std::string suffix = batched ? "[" + std::to_string(i) + "]" : "";
+            const std::string artist = get("artist" + suffix);
+            if (batched && artist.empty() && !params.count("track" + suffix))
+                break;
+
+            const std::string track = get("track" + suffix);
+            const std::string ts = get("timestamp" + suffix);
+            if (artist.empty() || track.empty() || ts.empty())
+                return fail(6, "Invalid parameters - artist, track and timestamp are required");
+
+            const std::time_t timestamp = static_cast<std::time_t>(std::atoll(ts.c_str()));
+            const Ignore ig = ignoreFor(timestamp);
+            (ig.code ? ignored : accepted) += 1;
+
+            items.push_back("{" + corrected("artist", artist) + "," + corrected("track", track) + "," +
+                            corrected("album", get("album" + suffix)) + "," +
+                            corrected("albumArtist", get("albumArtist" + suffix)) + ",\"timestamp\":\"" + ts +
+                            "\",\"ignoredMessage\":{\"code\":\"" + std::to_string(ig.code) + "\",\"#text\":\"" +
+                            ig.text + "\"}}");
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            accepted_ += accepted;
+            ignored_ += ignored;
+        }
+
+        std::string list;
+        if (batched)
+        {
+            list = "[";
+            for (std::size_t i = 0; i < items.size(); ++i)
+                list += (i ? "," : "") + items[i];
+            list += "]";
+        }
+        else
+        {
+            list = items.front();
+        }
+
+        return {200, "{\"scrobbles\":{\"scrobble\":" + list + ",\"@attr\":{\"accepted\":" + std::to_string(accepted) +
+                         ",\"ignored\":" + std::to_string(ignored) + "}}}"};
+    }
+
+    const Options& opt_;
+    std::mutex mutex_;
+    std::mt19937 rng_;
+    std::set<std::string> tokens_;
+    std::set<std::string> sessions_;
+    unsigned long long trackRequests_ = 0;
+    unsigned long long accepted_ = 0;
+    unsigned long long ignored_ = 0;
+    unsigned long long listens_ = 0;
+    std::map<std::string, unsigned long long> requestsByMethod_;
+    std::map<std::string, unsigned long long> errorsByCode_;
+};
+
+static const char* statusText(int status)
+{
+    switch (status)
+    {
+    case 200:
+        return "OK";
+    case 401:
+        return "Unauthorized";
+    case 403:
+        return "Forbidden";
+    case 429:
+        return "Too Many Requests";
+    case 503:
+        return "Service Unavailable";
+    default:
+        return "Bad Request";
+    }
+}
+
+static std::string headerValue(const std::string& raw, std::size_t headerEnd, const char* name)
+{
+    const std::string needle = std::string("\r\n") + name + ":";
+    const std::size_t pos = raw.find(needle);
+    if (pos == std::string::npos || pos >= headerEnd)
+        return {};
+
+    std::size_t begin = pos + needle.size();
+    const std::size_t end = raw.find("\r\n", begin);
+    while (begin < end && raw[begin] == ' ')
+        ++begin;
+    return raw.substr(begin, end - begin);
+}
+
+// One request per connection (the tools' transport sends Connection: close).
+static void serveConnection(int fd, StandinService& service)
+{
+    std::string raw;
+    char buf[8192];
+    std::size_t headerEnd = std::string::npos;
+    std::size_t contentLength = 0;
+
+    for (;;)
+    {
+        const ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0)
+            break;
+        raw.append(buf, static_cast<std::size_t>(n));
+        if (raw.size() > K_MAX_REQUEST_BYTES)
+            break;
+
+        if (headerEnd == std::string::npos)
+        {
+            headerEnd = raw.find("\r\n\r\n");
+            if (headerEnd != std::string::npos)
+            {
+                const std::size_t cl = raw.find("Content-Length:");
+                if (cl != std::string::npos && cl < headerEnd)
+                    contentLength = static_cast<std::size_t>(std::strtoul(raw.c_str() + cl + 15, nullptr, 10));
+            }
+        }
+        if (headerEnd != std::string::npos && raw.size() >= headerEnd + 4 + contentLength)
+            break;
+    }
+
+    Reply reply;
+    const std::size_t lineEnd = raw.find("\r\n");
+    const std::size_t sp1 = raw.find(' ');
+    const std::size_t sp2 = sp1 == std::string::npos ? std::string::npos : raw.find(' ', sp1 + 1);
+    if (headerEnd == std::string::npos || sp2 == std::string::npos || sp2 > lineEnd)
+    {
+        reply = apiError(6, "Malformed HTTP request");
+    }
+    else
+    {
+        const std::string target = raw.substr(sp1 + 1, sp2 - sp1 - 1);
+        if (target.compare(0, 17, "/1/submit-listens") == 0)
+        {
+            reply = service.submitListens(headerValue(raw, headerEnd, "Authorization"),
+                                          raw.substr(headerEnd + 4, contentLength));
+        }
+        else
+        {
+            lastfm::request::Params params;
+            const std::size_t q = target.find('?');
+            if (q != std::string::npos)
+                parseForm(target.substr(q + 1), params);
+            parseForm(raw.substr(headerEnd + 4, contentLength), params);
+            reply = service.handle(params);
+        }
+    }
+
+    std::string out = "HTTP/1.1 " + std::to_string(reply.status) + " " + statusText(reply.status) +
+                      "\r\nContent-Type: application/json\r\nContent-Length: " + std::to_string(reply.body.size()) +
+                      "\r\nConnection: close\r\n\r\n" + reply.body;
+
+    std::size_t off = 0;
+    while (off < out.size())
+    {
+        const ssize_t n = send(fd, out.data() + off, out.size() - off, MSG_NOSIGNAL);
+        if (n <= 0)
+            break;
+        off += static_cast<std::size_t>(n);
+    }
+    close(fd);
+}
+
+static void usage()
+{
+    std::fprintf(stderr,
+                 "usage: standin_server [--port N] [--key K] [--secret S] [--lb-token T] [--latency MS]\n"
+                 "                      [--jitter MS] [--burst29 EVERY,LENGTH] [--error9 P] [--error11 P]\n"
+                 "                      [--error16 P] [--ignored P] [--seed N] [--stats-every SEC]\n");
+}
+
+static bool parseArgs(int argc, char** argv, Options& opt)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string a = argv[i];
+        if (i + 1 >= argc)
+            return false;
+        const char* v = argv[++i];
+
+        if (a == "--port")
+            opt.port = std::atoi(v);
+        else if (a == "--key")
+            opt.apiKey = v;
+        else if (a == "--secret")
+            opt.apiSecret = v;
+        else if (a == "--lb-token")
+            opt.lbToken = v;
+        else if (a == "--latency")
+            opt.latencyMs = std::atoi(v);
+        else if (a == "--jitter")
+            opt.jitterMs = std::atoi(v);
+        else if (a == "--burst29")
+        {
+            if (std::sscanf(v, "%d,%d", &opt.burst29Every, &opt.burst29Length) != 2)
+                return false;
+        }
+        else if (a == "--error9")
+            opt.error9Rate = std::atof(v);
+        else if (a == "--error11")
+            opt.error11Rate = std::atof(v);
+        else if (a == "--error16")
+            opt.error16Rate = std::atof(v);
+        else if (a == "--ignored")
+            opt.ignoredRate = std::atof(v);
+        else if (a == "--seed")
+            opt.seed = static_cast<unsigned>(std::strtoul(v, nullptr, 10));
+        else if (a == "--stats-every")
+            opt.statsEverySeconds = std::atoi(v);
+        else
+            return false;
+    }
+    return opt.port > 0 && opt.port < 65536;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parseArgs(argc, argv, opt))
+    {
+        usage();
+        return 2;
+    }
+
+    const int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    const int one = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(opt.port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(listenFd, 128) != 0)
+    {
+        std::fprintf(stderr, "cannot listen on 127.0.0.1:%d: %s\n", opt.port, std::strerror(errno));
+        return 1;
+    }
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    std::printf("listening on http://127.0.0.1:%d/2.0/ (key %s)\n", opt.port, opt.apiKey.c_str());
+    std::fflush(stdout);
+
+    StandinService service(opt);
+    std::atomic<int> active{0};
+    auto nextStats = std::chrono::steady_clock::now() + std::chrono::seconds(opt.statsEverySeconds);
+
+    while (!stopRequested.load())
+    {
+        pollfd pfd{listenFd, POLLIN, 0};
+        if (poll(&pfd, 1, 200) > 0)
+        {
+            const int fd = accept(listenFd, nullptr, nullptr);
+            if (fd >= 0)
+            {
+                ++active;
+                std::thread(
+                    [fd, &service, &active]
+                    {
+                        serveConnection(fd, service);
+                        --active;
+                    })
+                    .detach();
+            }
+        }
+
+        if (opt.statsEverySeconds > 0 && std::chrono::steady_clock::now() >= nextStats)
+        {
+            service.printStats();
+            nextStats += std::chrono::seconds(opt.statsEverySeconds);
+        }
+    }
+
+    close(listenFd);
+    while (active.load() > 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    service.printStats();
+    lastfmLogShutdown();
+    return 0;
+}
@@ -0,0 +1,572 @@
+//
+//  trace_replay.cpp
+//  foo_scrobbler_mac
+//
+//  (c) 2025-2026 by Konstantinos Kyriakopoulos
+//
+//  Replays a playback trace (Last.fm > Record playback trace) through LastfmTracker on Linux, against
+//  the fake SDK in ../fake_sdk and a scrobbler stand-in that only records what the tracker asked for.
+//  Runs in virtual time: events are fed back to back unless --speed asks for scaled pauses. Reports CPU
+//  time per event type and the tracker's decisions. --generate writes a synthetic trace (skips, seeks,
+//  pauses, tag edits, chatty streams) for when no recorded one is at hand.
+//
+//  Build (one line, from tools/trace_replay/):
+//
+//  c++ -std=c++20 -O2 -I../fake_sdk -I../../src trace_replay.cpp ../fake_sdk/fake_sdk.cpp ../../src/lastfm_{tracker,titleformat,filter,log,trace,util}.cpp -lpthread -o trace_replay
+//
+
+#include "lastfm_library.h"
+#include "lastfm_log.h"
+#include "lastfm_settings.h"
+#include "lastfm_trace.h"
+#include "lastfm_tracker.h"
+#include "lastfm_util.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+std::atomic<int> lfmLogLevel{static_cast<int>(LfmLogLevel::OFF)};
+
+namespace
+{
+static auto g_settingsPtr = std::make_shared<LastfmSettings>();
+static LastfmSettings& g_settings = *g_settingsPtr;
+
+struct Options
+{
+    std::string tracePath;
+    std::string generatePath;
+    unsigned seed = 1;
+    int plays = 500;
+    int tracks = 200;
+    double speed = 0.0; // 0 = as fast as possible
+    bool printDecisions = false;
+};
+
+static std::string formatClock(std::int64_t ms)
+{
+    const std::int64_t s = ms / 1000;
+    char buf[32];
+    if (s >= 86400)
+        std::snprintf(buf, sizeof(buf), "%lldd %02lld:%02lld:%02lld", static_cast<long long>(s / 86400),
+                      static_cast<long long>((s / 3600) % 24), static_cast<long long>((s / 60) % 60),
+                      static_cast<long long>(s % 60));
+    else
+        std::snprintf(buf, sizeof(buf), "%02lld:%02lld:%02lld", static_cast<long long>(s / 3600),
+                      static_cast<long long>((s / 60) % 60), static_cast<long long>(s % 60));
+    return buf;
+}
+
+static std::uint64_t threadCpuNs()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<std::uint64_t>(ts.tv_nsec);
+}
+
+// Stands in for LastfmScrobbler: counts and optionally prints each decision, stamped with virtual time.
+class RecordingOutput : public ILastfmTrackerOutput
+{
+  public:
+    std::int64_t nowMs = 0;
+    bool print = false;
+
+    std::uint64_t nowPlaying = 0;
+    std::uint64_t nowPlayingUpdates = 0;
+    std::uint64_t metadataRefreshes = 0;
+    std::uint64_t scrobbles = 0;
+    std::uint64_t retries = 0;
+
+    void onNowPlaying(const LastfmTrackInfo& track) override
+    {
+        ++nowPlaying;
+        show("NOW PLAYING", track, nullptr);
+    }
+    void sendNowPlayingOnly(const LastfmTrackInfo& track) override
+    {
+        ++nowPlayingUpdates;
+        show("NP UPDATE  ", track, nullptr);
+    }
+    void refreshPendingMetadata(const LastfmTrackInfo& track) override
+    {
+        ++metadataRefreshes;
+        show("REFRESH    ", track, nullptr);
+    }
+    void queueScrobble(const LastfmTrackInfo& track, double playbackSeconds, std::time_t, bool) override
+    {
+        ++scrobbles;
+        char extra[48];
+        std::snprintf(extra, sizeof(extra), "at %.0fs", playbackSeconds);
+        show("SCROBBLE   ", track, extra);
+    }
+    void retryAsync() override
+    {
+        ++retries;
+    }
+
+  private:
+    void show(const char* what, const LastfmTrackInfo& track, const char* extra) const
+    {
+        if (!print)
+            return;
+        std::printf("[%s] %s %s - %s%s%s\n", formatClock(nowMs).c_str(), what, track.artist.c_str(),
+                    track.title.c_str(), extra ? " " : "", extra ? extra : "");
+    }
+};
+
+struct KindStats
+{
+    std::uint64_t count = 0;
+    std::uint64_t totalNs = 0;
+    std::uint64_t maxNs = 0;
+};
+
+static void toFileInfo(const LastfmTraceMeta& meta, double length, file_info_impl& out)
+{
+    out = file_info_impl();
+    for (const auto& kv : meta)
+        out.meta_add(kv.first.c_str(), kv.second.c_str());
+    out.set_length(length);
+}
+
+static int replay(const Options& opt)
+{
+    LastfmTraceReader reader;
+    std::string error;
+    if (!reader.open(opt.tracePath, error))
+    {
+        std::fprintf(stderr, "trace_replay: %s\n", error.c_str());
+        return 1;
+    }
+
+    RecordingOutput output;
+    output.print = opt.printDecisions;
+    LastfmTracker tracker(output);
+
+    std::map<std::uint32_t, std::unique_ptr<metadb_handle>> handles;
+    KindStats stats[static_cast<int>(LastfmTraceKind::DYNAMIC_INFO) + 1];
+    std::uint64_t events = 0;
+    std::int64_t lastMs = 0;
+
+    const auto wallStart = std::chrono::steady_clock::now();
+
+    LastfmTraceTrack track;
+    LastfmTraceEvent ev;
+    for (;;)
+    {
+        const LastfmTraceReader::Record rec = reader.next(track, ev);
+        if (rec == LastfmTraceReader::Record::END)
+            break;
+        if (rec == LastfmTraceReader::Record::BAD)
+        {
+            std::fprintf(stderr, "trace_replay: %s after %llu event(s)\n", reader.error().c_str(),
+                         static_cast<unsigned long long>(events));
+            return 1;
+        }
+
+        if (rec == LastfmTraceReader::Record::TRACK)
+        {
+            file_info_impl info;
+            toFileInfo(track.meta, track.length, info);
+
+            auto it = handles.find(track.id);
+            if (it == handles.end())
+                handles.emplace(track.id, std::make_unique<metadb_handle>(track.path, info));
+            else
+                it->second->replace_info(info);
+            continue;
+        }
+
+        if (opt.speed > 0.0 && ev.atMs > lastMs)
+            std::this_thread::sleep_for(std::chrono::microseconds(
+                static_cast<std::int64_t>(static_cast<double>(ev.atMs - lastMs) * 1000.0 / opt.speed)));
+        lastMs = ev.atMs;
+        output.nowMs = ev.atMs;
+
+        metadb_handle_ptr handle;
+        if (ev.kind == LastfmTraceKind::NEW_TRACK || ev.kind == LastfmTraceKind::EDITED)
+        {
+            auto it = handles.find(ev.trackId);
+            if (it == handles.end())
+            {
+                std::fprintf(stderr, "trace_replay: event refers to undefined track %u\n", ev.trackId);
+                return 1;
+            }
+            handle = it->second.get();
+        }
+
+        file_info_impl dynamicInfo;
+        if (ev.kind == LastfmTraceKind::DYNAMIC_INFO)
+            toFileInfo(ev.meta, 0.0, dynamicInfo);
+
+        const std::uint64_t t0 = threadCpuNs();
+        switch (ev.kind)
+        {
+        case LastfmTraceKind::NEW_TRACK:
+            tracker.onNewTrack(handle);
+            break;
+        case LastfmTraceKind::STOP:
+            tracker.onStop();
+            break;
+        case LastfmTraceKind::SEEK:
+            tracker.onSeek(ev.time);
+            break;
+        case LastfmTraceKind::PAUSE:
+            tracker.onPause(ev.flag);
+            break;
+        case LastfmTraceKind::TIME:
+            tracker.onTime(ev.time);
+            break;
+        case LastfmTraceKind::EDITED:
+            tracker.onTagsEdited(handle);
+            break;
+        case LastfmTraceKind::DYNAMIC_INFO:
+            tracker.onDynamicInfo(dynamicInfo);
+            break;
+        }
+        const std::uint64_t dt = threadCpuNs() - t0;
+
+        KindStats& ks = stats[static_cast<int>(ev.kind)];
+        ++ks.count;
+        ks.totalNs += dt;
+        if (dt > ks.maxNs)
+            ks.maxNs = dt;
+        ++events;
+    }
+
+    const double wallMs =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+
+    std::printf("trace:    %s\n", opt.tracePath.c_str());
+    std::printf("events:   %llu, %zu track(s), virtual span %s, replayed in %.1f ms", static_cast<unsigned long long>(events),
+                handles.size(), formatClock(lastMs).c_str(), wallMs);
+    if (wallMs > 0.0)
+        std::printf(" (%.0fx real time)", static_cast<double>(lastMs) / wallMs);
+    std::printf("\n\n");
+
+    std::printf("%-14s %10s %12s %10s %10s\n", "event", "count", "cpu ms", "mean us", "max us");
+    std::uint64_t totalNs = 0;
+    for (int k = static_cast<int>(LastfmTraceKind::NEW_TRACK); k <= static_cast<int>(LastfmTraceKind::DYNAMIC_INFO); ++k)
+    {
+        const KindStats& ks = stats[k];
+        totalNs += ks.totalNs;
+        if (ks.count == 0)
+            continue;
+        std::printf("%-14s %10llu %12.3f %10.2f %10.2f\n", lastfmTraceKindName(static_cast<LastfmTraceKind>(k)),
+                    static_cast<unsigned long long>(ks.count), ks.totalNs / 1e6,
+                    static_cast<double>(ks.totalNs) / 1e3 / static_cast<double>(ks.count), ks.maxNs / 1e3);
+    }
+    std::printf("%-14s %10llu %12.3f\n\n", "total", static_cast<unsigned long long>(events), totalNs / 1e6);
+
+    std::printf("decisions:\n");
+    std::printf("  now playing         %llu\n", static_cast<unsigned long long>(output.nowPlaying));
+    std::printf("  now playing update  %llu\n", static_cast<unsigned long long>(output.nowPlayingUpdates));
+    std::printf("  metadata refresh    %llu\n", static_cast<unsigned long long>(output.metadataRefreshes));
+    std::printf("  scrobbles queued    %llu\n", static_cast<unsigned long long>(output.scrobbles));
+    std::printf("  retry requests      %llu\n", static_cast<unsigned long long>(output.retries));
+    return 0;
+}
+
+// Synthetic listening session. Playback time ticks once per second, as foobar2000 reports it.
+class SessionGenerator
+{
+  public:
+    SessionGenerator(const Options& opt) : opt_(opt), rng_(opt.seed)
+    {
+    }
+
+    int run()
+    {
+        std::string error;
+        if (!writer_.open(opt_.generatePath, error))
+        {
+            std::fprintf(stderr, "trace_replay: %s\n", error.c_str());
+            return 1;
+        }
+
+        for (int i = 0; i < opt_.plays; ++i)
+        {
+            const int roll = pick(0, 99);
+            if (roll < 5)
+                playStream();
+            else
+                playLocal(roll);
+
+            // Occasional stop between sessions.
+            if (pick(0, 19) == 0)
+            {
+                event(LastfmTraceKind::STOP);
+                nowMs_ += pick(10, 3600) * 1000;
+            }
+        }
+        event(LastfmTraceKind::STOP);
+
+        writer_.close();
+        std::printf("wrote %s: %llu event(s), %llu bytes, virtual span %s\n", opt_.generatePath.c_str(),
+                    static_cast<unsigned long long>(writer_.eventCount()),
+                    static_cast<unsigned long long>(writer_.bytesWritten()), formatClock(nowMs_).c_str());
+        return 0;
+    }
+
+  private:
+    int pick(int lo, int hi)
+    {
+        return std::uniform_int_distribution<int>(lo, hi)(rng_);
+    }
+
+    void event(LastfmTraceKind kind, double time = 0.0, bool flag = false, std::uint32_t trackId = 0,
+               LastfmTraceMeta meta = {})
+    {
+        LastfmTraceEvent ev;
+        ev.kind = kind;
+        ev.atMs = nowMs_;
+        ev.time = time;
+        ev.flag = flag;
+        ev.trackId = trackId;
+        ev.meta = std::move(meta);
+        writer_.writeEvent(ev);
+    }
+
+    void tick(double& position)
+    {
+        position += 1.0;
+        nowMs_ += 1000;
+        event(LastfmTraceKind::TIME, position);
+    }
+
+    LastfmTraceTrack localTrack(int n, int edits)
+    {
+        LastfmTraceTrack t;
+        t.id = static_cast<std::uint32_t>(n + 1);
+        t.path = "file:///music/artist" + std::to_string(n % 40) + "/track" + std::to_string(n) + ".flac";
+        t.length = 90.0 + (n * 37) % 420;
+        t.meta = {{"ARTIST", "Artist " + std::to_string(n % 40)},
+                  {"TITLE", "Song " + std::to_string(n) + (edits ? " (edit " + std::to_string(edits) + ")" : "")},
+                  {"ALBUM", "Album " + std::to_string(n / 12)}};
+        if (n % 9 == 0)
+            t.meta.push_back({"ALBUM ARTIST", "Various Artists"});
+        return t;
+    }
+
+    void playLocal(int roll)
+    {
+        const int n = pick(0, opt_.tracks - 1);
+        LastfmTraceTrack t = localTrack(n, 0);
+        if (defined_.insert(n).second)
+            writer_.writeTrack(t);
+
+        event(LastfmTraceKind::NEW_TRACK, 0.0, false, t.id);
+
+        double pos = 0.0;
+        const double length = t.length;
+
+        if (roll < 25) // skipped early
+        {
+            const int until = pick(2, 40);
+            while (pos < until)
+                tick(pos);
+            return;
+        }
+
+        const int seekAt = (roll < 35) ? pick(5, static_cast<int>(length / 2)) : -1;
+        const int pauseAt = (roll >= 35 && roll < 42) ? pick(5, static_cast<int>(length) - 5) : -1;
+        const int editAt = (roll >= 42 && roll < 47) ? pick(5, static_cast<int>(length) - 5) : -1;
+
+        while (pos < length)
+        {
+            if (static_cast<int>(pos) == seekAt)
+            {
+                pos = (pick(0, 1) == 0) ? length * 0.75 : 1.0;
+                event(LastfmTraceKind::SEEK, pos);
+            }
+            if (static_cast<int>(pos) == pauseAt)
+            {
+                event(LastfmTraceKind::PAUSE, 0.0, true);
+                nowMs_ += pick(30, 600) * 1000;
+                event(LastfmTraceKind::PAUSE, 0.0, false);
+            }
+            if (static_cast<int>(pos) == editAt)
+            {
+                writer_.writeTrack(localTrack(n, ++edits_[n]));
+                event(LastfmTraceKind::EDITED, 0.0, false, t.id);
+            }
+            tick(pos);
+        }
+    }
+
+    void playStream()
+    {
+        LastfmTraceTrack t;
+        t.id = 100000 + static_cast<std::uint32_t>(pick(0, 4));
+        t.path = "http://radio.example/stream" + std::to_string(t.id - 100000);
+        t.meta = {{"TITLE", "Example Radio " + std::to_string(t.id - 100000)}};
+        if (streamsDefined_.insert(t.id).second)
+            writer_.writeTrack(t);
+
+        event(LastfmTraceKind::NEW_TRACK, 0.0, false, t.id);
+
+        double pos = 0.0;
+        const int songs = pick(2, 8);
+        for (int s = 0; s < songs; ++s)
+        {
+            const std::string song = "Stream Artist " + std::to_string(pick(0, 99)) + " - Stream Song " +
+                                     std::to_string(pick(0, 999));
+            const int duration = pick(120, 300);
+            for (int i = 0; i < duration; ++i)
+            {
+                // Chatty stations repeat the same metadata every few seconds and mix in slogans.
+                if (i % pick(2, 10) == 0)
+                {
+                    const bool slogan = pick(0, 9) == 0;
+                    const std::string title = slogan ? "[Example Radio] www.radio.example - the best mix" : song;
+                    event(LastfmTraceKind::DYNAMIC_INFO, 0.0, false, 0, {{"title", title}});
+                    if (pick(0, 1) == 0)
+                        event(LastfmTraceKind::DYNAMIC_INFO, 0.0, false, 0, {{"title", title}});
+                }
+                tick(pos);
+            }
+        }
+    }
+
+    const Options& opt_;
+    std::mt19937 rng_;
+    LastfmTraceWriter writer_;
+    std::int64_t nowMs_ = 0;
+    std::set<int> defined_;
+    std::set<std::uint32_t> streamsDefined_;
+    std::map<int, int> edits_;
+};
+
+static void usage()
+{
+    std::fprintf(stderr,
+                 "usage: trace_replay [options] <trace.lfmtrace>\n"
+                 "       trace_replay --generate <out.lfmtrace> [--seed N] [--plays N] [--tracks N]\n"
+                 "\n"
+                 "  --decisions            print every decision with its virtual time\n"
+                 "  --speed X              sleep between events, X times faster than recorded (default: no sleep)\n"
+                 "  --log                  tracker debug log on stderr\n"
+                 "  --only-library         only scrobble from the Media Library (local paths count as library)\n"
+                 "  --exclude-artists P    exclusion rules, as in preferences\n"
+                 "  --exclude-titles P\n"
+                 "  --dynamic-mode N       0 = none, 1 = now playing only, 2 = now playing and scrobbling\n"
+                 "  --va-empty             treat \"Various Artists\" as empty album artist\n"
+                 "  --suspended            start suspended\n"
+                 "  --no-now-playing       disable now playing for streams\n"
+                 "  --artist-tf S, --album-artist-tf S, --title-tf S, --album-tf S\n");
+}
+
+static bool parseArgs(int argc, char** argv, Options& opt)
+{
+    g_settings.version = 1;
+    g_settings.authenticated = true;
+    g_settings.artistTf = "[%ARTIST%]";
+    g_settings.albumArtistTf = "[%ALBUM ARTIST%]";
+    g_settings.titleTf = "[%TITLE%]";
+    g_settings.albumTf = "[%ALBUM%]";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string a = argv[i];
+        auto value = [&](std::string& out) -> bool
+        {
+            if (i + 1 >= argc)
+                return false;
+            out = argv[++i];
+            return true;
+        };
+        std::string v;
+
+        if (a == "--generate" && value(opt.generatePath))
+            continue;
+        if (a == "--seed" && value(v))
+            opt.seed = static_cast<unsigned>(std::strtoul(v.c_str(), nullptr, 10));
+        else if (a == "--plays" && value(v))
+            opt.plays = std::atoi(v.c_str());
+        else if (a == "--tracks" && value(v))
+            opt.tracks = std::max(1, std::atoi(v.c_str()));
+        else if (a == "--speed" && value(v))
+            opt.speed = std::atof(v.c_str());
+        else if (a == "--decisions")
+            opt.printDecisions = true;
+        else if (a == "--log")
+            lfmLogLevel.store(static_cast<int>(LfmLogLevel::DEBUG_LOG));
+        else if (a == "--only-library")
+            g_settings.onlyFromMediaLibrary = true;
+        else if (a == "--exclude-artists" && value(g_settings.excludedArtists))
+            continue;
+        else if (a == "--exclude-titles" && value(g_settings.excludedTitles))
+            continue;
+        else if (a == "--dynamic-mode" && value(v))
+            g_settings.dynamicSourcesMode = std::atoi(v.c_str());
+        else if (a == "--va-empty")
+            g_settings.treatVariousArtistsAsEmpty = true;
+        else if (a == "--suspended")
+            g_settings.suspended = true;
+        else if (a == "--no-now-playing")
+            g_settings.disableNowPlaying = true;
+        else if (a == "--artist-tf" && value(g_settings.artistTf))
+            continue;
+        else if (a == "--album-artist-tf" && value(g_settings.albumArtistTf))
+            continue;
+        else if (a == "--title-tf" && value(g_settings.titleTf))
+            continue;
+        else if (a == "--album-tf" && value(g_settings.albumTf))
+            continue;
+        else if (!a.empty() && a[0] != '-' && opt.tracePath.empty())
+            opt.tracePath = a;
+        else
+            return false;
+    }
+
+    g_settings.artistFilter = LastfmExclusionFilter::compile(g_settings.excludedArtists, "artist");
+    g_settings.titleFilter = LastfmExclusionFilter::compile(g_settings.excludedTitles, "title");
+    g_settings.filterVersion = 1;
+
+    return !opt.generatePath.empty() || !opt.tracePath.empty();
+}
+} // namespace
+
+std::shared_ptr<const LastfmSettings> lastfmSettings()
+{
+    return g_settingsPtr;
+}
+
+bool lastfmIsInMediaLibrary(const metadb_handle_ptr& track)
+{
+    return track.is_valid() && !lastfm::util::isNetworkStreamPath(track->get_path());
+}
+
+bool lastfmLookupMediaLibrary(const metadb_handle_ptr& track, bool& inLibrary)
+{
+    inLibrary = lastfmIsInMediaLibrary(track);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parseArgs(argc, argv, opt))
+    {
+        usage();
+        return 2;
+    }
+
+    if (!opt.generatePath.empty())
+        return SessionGenerator(opt).run();
+
+    const int rc = replay(opt);
+    lastfmLogShutdown();
+    return rc;
+}